@@ -0,0 +1,1509 @@
+#ifndef YS_BVH_H
+#define YS_BVH_H
+
+#include "ys_geom.h"
+#include "ys_thread.h"
+#include "ys_file.h"
+#include "debug.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+#ifndef BVH_MAX_LEAF_SIZE
+#define BVH_MAX_LEAF_SIZE 8
+#endif
+
+#define BVH_BINS 16
+#define BVH_MAX_DEPTH 64
+#define BVH_TRAVERSAL_COST 1.0f
+
+// Wide BVH branching factor (4 or 8) and bits per quantized child bound
+// (8 or 16).
+#ifndef BVH_WIDE_WIDTH
+#define BVH_WIDE_WIDTH 8
+#endif
+
+#ifndef BVH_WIDE_BITS
+#define BVH_WIDE_BITS 8
+#endif
+
+#if BVH_WIDE_BITS == 16
+typedef u16 bvh_wide_q;
+#define BVH_WIDE_QMAX 65535
+#else
+typedef u8 bvh_wide_q;
+#define BVH_WIDE_QMAX 255
+#endif
+
+#define BVH_WIDE_EMPTY 0
+#define BVH_WIDE_INTERNAL 0xFF
+
+// Rays per packet for bvh_intersect_packet (8 or 16).
+#ifndef BVH_PACKET_SIZE
+#define BVH_PACKET_SIZE 8
+#endif
+
+#define BVH_NO_HIT 0xFFFFFFFFu
+
+#define BVH_FILE_MAGIC 0x48564259u   // "YBVH" read as little endian bytes
+#define BVH_FILE_MAGIC_SWAPPED 0x59425648u
+#define BVH_FILE_VERSION 1
+#define BVH_FILE_ALIGN 64
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Binary BVH stored as a flat node array. The root is node 0 and the two
+// children of an internal node are always stored next to each other, so
+// an internal node only keeps the index of its left child.
+typedef struct bvh_node {
+    aabb3 bounds;
+    u32 first;   // internal: left child index, leaf: first slot in prims
+    u32 count;   // internal: 0, leaf: number of primitives
+} bvh_node;
+
+typedef struct bvh {
+    bvh_node* nodes;
+    u32* prims;      // leaf slot -> caller's primitive index
+    u32 node_count;
+    u32 prim_count;
+    f32 build_cost;  // SAH cost right after bvh_build
+} bvh;
+
+// Wide node with child bounds quantized against the node's own box:
+// child_min = origin + q * 2^exp per axis. Child bounds are stored as
+// separate lanes so all children are tested against a ray at once.
+//
+// meta[i] is BVH_WIDE_EMPTY for unused slots, BVH_WIDE_INTERNAL for inner
+// children and the primitive count for leaves. Inner children are stored
+// contiguously from node_base and leaf primitives contiguously from
+// prim_base, both in slot order, so no per-child offsets are kept.
+typedef struct bvh_wide_node {
+    point3 origin;
+    i8 exp[3];
+    u8 child_count;
+    u32 node_base;
+    u32 prim_base;
+    u8 meta[BVH_WIDE_WIDTH];
+    bvh_wide_q min_x[BVH_WIDE_WIDTH];
+    bvh_wide_q min_y[BVH_WIDE_WIDTH];
+    bvh_wide_q min_z[BVH_WIDE_WIDTH];
+    bvh_wide_q max_x[BVH_WIDE_WIDTH];
+    bvh_wide_q max_y[BVH_WIDE_WIDTH];
+    bvh_wide_q max_z[BVH_WIDE_WIDTH];
+} bvh_wide_node;
+
+// On-disk layout: this header followed by the node and primitive arrays
+// exactly as they sit in memory. Children are referenced by index and the
+// arrays by offsets from the start of the file, so a mapped file is used
+// in place without any pointer fixups. A byte swapped magic means the
+// file was written on a machine of the other endianness; such files are
+// rejected rather than converted.
+typedef struct bvh_file_header {
+    u32 magic;
+    u32 version;
+    u32 node_size;      // sizeof(bvh_node) of the writer
+    u32 node_count;
+    u32 prim_count;
+    f32 build_cost;
+    u64 nodes_offset;   // bytes from the start of the file
+    u64 prims_offset;
+    u64 file_size;
+    u8 reserved[16];
+} bvh_file_header;
+
+// Closest point on the indexed triangles to a query point. bary holds the
+// weights of the three triangle corners, see closest_point_triangle_bary.
+typedef struct bvh_point_hit {
+    point3 point;
+    f32 dist_sq;
+    f32 bary[3];
+    u32 prim;
+} bvh_point_hit;
+
+typedef struct bvh_wide {
+    bvh_wide_node* nodes;
+    u32* prims;
+    u32 node_count;
+    u32 node_capacity;   // wide nodes allocated
+    u32 prim_count;
+} bvh_wide;
+
+
+/*
+ * === BVH INTERFACE ===
+*/
+b32 bvh_build(bvh* b, const aabb3* prim_bounds, u32 prim_count);
+void bvh_free(bvh* b);
+f32 bvh_sah_cost(const bvh* b);
+void bvh_refit(bvh* b, const aabb3* prim_bounds);
+void bvh_refit_triangles(bvh* b, const point3* positions, const u32* indices);
+u32 bvh_rotate(bvh* b);
+u32 bvh_optimize(bvh* b, f32 max_cost_ratio, u32 max_passes);
+u64 bvh_serialized_size(const bvh* b);
+u64 bvh_serialize(const bvh* b, void* out, u64 size);
+b32 bvh_deserialize(bvh* b, const void* data, u64 size);
+b32 bvh_save(const bvh* b, const char* path);
+b32 bvh_load_mapped(bvh* b, mapped_file* f, const char* path);
+b32 bvh_intersect(const bvh* b, const point3* positions, const u32* indices,
+        const ray3 ray, const f32 t_max, ray3_hit* hit);
+u32 bvh_intersect_packet(const bvh* b, const point3* positions, const u32* indices,
+        const ray3* rays, const u32 count, const f32 t_max, ray3_hit* hits);
+u32 bvh_intersect_stream(const bvh* b, const point3* positions, const u32* indices,
+        const ray3* rays, const u32 count, const f32 t_max, ray3_hit* hits);
+b32 bvh_closest_point(const bvh* b, const point3* positions, const u32* indices,
+        const point3 p, const f32 max_dist, bvh_point_hit* hit);
+
+
+/*
+ * === WIDE BVH INTERFACE ===
+*/
+b32 bvh_wide_build(bvh_wide* w, const bvh* b);
+void bvh_wide_free(bvh_wide* w);
+b32 bvh_wide_intersect(const bvh_wide* w, const point3* positions, const u32* indices,
+        const ray3 ray, const f32 t_max, ray3_hit* hit);
+
+
+#ifdef YS_BVH_IMPLEMENTATION
+
+/*
+ * ==== BUILD =======
+*/
+
+typedef struct bvh_bin {
+    aabb3 bounds;
+    u32 count;
+} bvh_bin;
+
+static u32 bvh_bin_index(const aabb3 centroids, const f32 scale, const u32 axis, const aabb3 prim) {
+    f32 c = (prim.min.e[axis] + prim.max.e[axis]) * 0.5f;
+    i32 bin = (i32)((c - centroids.min.e[axis]) * scale);
+    if (bin < 0) {
+        bin = 0;
+    }
+    if (bin > BVH_BINS - 1) {
+        bin = BVH_BINS - 1;
+    }
+    return (u32)bin;
+}
+
+// Finds the cheapest binned SAH split of a node. Returns the area weighted
+// primitive count of the split, or FLT_MAX when the centroids do not
+// spread along any axis.
+static f32 bvh_find_split(const bvh* b, const aabb3* prim_bounds, const bvh_node* node,
+        const aabb3 centroids, u32* out_axis, u32* out_bin) {
+    f32 best = FLT_MAX;
+    for (u32 axis = 0; axis < 3; ++axis) {
+        f32 extent = centroids.max.e[axis] - centroids.min.e[axis];
+        if (extent <= 0) {
+            continue;
+        }
+        f32 scale = BVH_BINS / extent;
+
+        bvh_bin bins[BVH_BINS];
+        for (u32 i = 0; i < BVH_BINS; ++i) {
+            bins[i].bounds = aabb3_empty();
+            bins[i].count = 0;
+        }
+        for (u32 i = 0; i < node->count; ++i) {
+            aabb3 pb = prim_bounds[b->prims[node->first + i]];
+            bvh_bin* bin = &bins[bvh_bin_index(centroids, scale, axis, pb)];
+            bin->bounds = aabb3_union(bin->bounds, pb);
+            bin->count++;
+        }
+
+        f32 left_area[BVH_BINS - 1];
+        u32 left_count[BVH_BINS - 1];
+        aabb3 acc = aabb3_empty();
+        u32 n = 0;
+        for (u32 i = 0; i < BVH_BINS - 1; ++i) {
+            acc = aabb3_union(acc, bins[i].bounds);
+            n += bins[i].count;
+            left_area[i] = aabb3_area(acc);
+            left_count[i] = n;
+        }
+
+        acc = aabb3_empty();
+        n = 0;
+        for (u32 i = BVH_BINS - 1; i > 0; --i) {
+            acc = aabb3_union(acc, bins[i].bounds);
+            n += bins[i].count;
+            if (n == 0 || left_count[i - 1] == 0) {
+                continue;
+            }
+            f32 cost = left_area[i - 1] * left_count[i - 1] + aabb3_area(acc) * n;
+            if (cost < best) {
+                best = cost;
+                *out_axis = axis;
+                *out_bin = i;
+            }
+        }
+    }
+    return best;
+}
+
+static aabb3 bvh_range_bounds(const bvh* b, const aabb3* prim_bounds, u32 first, u32 count) {
+    aabb3 r = aabb3_empty();
+    for (u32 i = 0; i < count; ++i) {
+        r = aabb3_union(r, prim_bounds[b->prims[first + i]]);
+    }
+    return r;
+}
+
+b32 bvh_build(bvh* b, const aabb3* prim_bounds, u32 prim_count) {
+    u32 max_nodes = prim_count > 0 ? prim_count * 2 - 1 : 1;
+    b->nodes = (bvh_node*)YS_MALLOC(sizeof(bvh_node) * max_nodes);
+    b->prims = (u32*)YS_MALLOC(sizeof(u32) * (prim_count > 0 ? prim_count : 1));
+    if (!b->nodes || !b->prims) {
+        bvh_free(b);
+        return 0;
+    }
+    b->prim_count = prim_count;
+    for (u32 i = 0; i < prim_count; ++i) {
+        b->prims[i] = i;
+    }
+
+    if (prim_count == 0) {
+        b->node_count = 0;
+        b->build_cost = 0;
+        return 1;
+    }
+
+    bvh_node* root = &b->nodes[0];
+    root->first = 0;
+    root->count = prim_count;
+    root->bounds = bvh_range_bounds(b, prim_bounds, 0, prim_count);
+    b->node_count = 1;
+
+    u32 stack[BVH_MAX_DEPTH * 2];
+    u32 depths[BVH_MAX_DEPTH * 2];
+    u32 top = 0;
+    stack[top] = 0;
+    depths[top++] = 0;
+
+    while (top > 0) {
+        --top;
+        u32 index = stack[top];
+        u32 depth = depths[top];
+        bvh_node* node = &b->nodes[index];
+        if (node->count <= 1) {
+            continue;
+        }
+
+        aabb3 centroids = aabb3_empty();
+        for (u32 i = 0; i < node->count; ++i) {
+            centroids = aabb3_grow(centroids, aabb3_center(prim_bounds[b->prims[node->first + i]]));
+        }
+
+        u32 axis = 0;
+        u32 split_bin = 0;
+        f32 cost = FLT_MAX;
+        // Past a certain depth only median splits are made so the tree
+        // never outgrows the fixed size traversal stacks.
+        if (depth < BVH_MAX_DEPTH - 32) {
+            cost = bvh_find_split(b, prim_bounds, node, centroids, &axis, &split_bin);
+        }
+
+        u32 mid;
+        if (cost < FLT_MAX) {
+            f32 area = aabb3_area(node->bounds);
+            f32 split_cost = BVH_TRAVERSAL_COST + (area > 0 ? cost / area : 0);
+            if (split_cost >= (f32)node->count && node->count <= BVH_MAX_LEAF_SIZE) {
+                continue;
+            }
+
+            f32 scale = BVH_BINS / (centroids.max.e[axis] - centroids.min.e[axis]);
+            u32 i = node->first;
+            u32 j = node->first + node->count;
+            while (i < j) {
+                if (bvh_bin_index(centroids, scale, axis, prim_bounds[b->prims[i]]) < split_bin) {
+                    ++i;
+                } else {
+                    u32 tmp = b->prims[i];
+                    b->prims[i] = b->prims[--j];
+                    b->prims[j] = tmp;
+                }
+            }
+            mid = i - node->first;
+        } else {
+            if (node->count <= BVH_MAX_LEAF_SIZE) {
+                continue;
+            }
+            mid = 0;
+        }
+        if (mid == 0 || mid == node->count) {
+            mid = node->count / 2;
+        }
+
+        u32 left = b->node_count;
+        b->node_count += 2;
+        bvh_node* l = &b->nodes[left];
+        bvh_node* r = &b->nodes[left + 1];
+        l->first = node->first;
+        l->count = mid;
+        r->first = node->first + mid;
+        r->count = node->count - mid;
+        l->bounds = bvh_range_bounds(b, prim_bounds, l->first, l->count);
+        r->bounds = bvh_range_bounds(b, prim_bounds, r->first, r->count);
+        node->first = left;
+        node->count = 0;
+
+        stack[top] = left;
+        depths[top++] = depth + 1;
+        stack[top] = left + 1;
+        depths[top++] = depth + 1;
+    }
+
+    b->build_cost = bvh_sah_cost(b);
+    return 1;
+}
+
+void bvh_free(bvh* b) {
+    YS_FREE(b->nodes);
+    YS_FREE(b->prims);
+    b->nodes = 0;
+    b->prims = 0;
+    b->node_count = 0;
+    b->prim_count = 0;
+}
+
+f32 bvh_sah_cost(const bvh* b) {
+    if (b->node_count == 0) {
+        return 0;
+    }
+    f32 root_area = aabb3_area(b->nodes[0].bounds);
+    if (root_area <= 0) {
+        return (f32)b->prim_count;
+    }
+    f32 cost = 0;
+    for (u32 i = 0; i < b->node_count; ++i) {
+        const bvh_node* n = &b->nodes[i];
+        f32 weight = n->count ? (f32)n->count : BVH_TRAVERSAL_COST;
+        cost += weight * aabb3_area(n->bounds);
+    }
+    return cost / root_area;
+}
+
+
+/*
+ * ==== REFIT =======
+*/
+
+// Leaf bounds come either from per primitive boxes or straight from
+// indexed triangles, whichever the caller has at hand.
+typedef struct bvh_refit_ctx {
+    bvh* b;
+    const aabb3* prim_bounds;
+    const point3* positions;
+    const u32* indices;
+    u32* roots;
+} bvh_refit_ctx;
+
+static aabb3 bvh_leaf_bounds(const bvh_refit_ctx* ctx, const bvh_node* n) {
+    const u32* prims = ctx->b->prims + n->first;
+    aabb3 r = aabb3_empty();
+    if (ctx->prim_bounds) {
+        for (u32 i = 0; i < n->count; ++i) {
+            r = aabb3_union(r, ctx->prim_bounds[prims[i]]);
+        }
+    } else {
+        for (u32 i = 0; i < n->count; ++i) {
+            const u32* tri = ctx->indices + prims[i] * 3;
+            r = aabb3_grow(r, ctx->positions[tri[0]]);
+            r = aabb3_grow(r, ctx->positions[tri[1]]);
+            r = aabb3_grow(r, ctx->positions[tri[2]]);
+        }
+    }
+    return r;
+}
+
+static aabb3 bvh_refit_node(const bvh_refit_ctx* ctx, u32 index) {
+    bvh_node* n = &ctx->b->nodes[index];
+    if (n->count) {
+        n->bounds = bvh_leaf_bounds(ctx, n);
+    } else {
+        aabb3 l = bvh_refit_node(ctx, n->first);
+        aabb3 r = bvh_refit_node(ctx, n->first + 1);
+        n->bounds = aabb3_union(l, r);
+    }
+    return n->bounds;
+}
+
+static void bvh_refit_task(void* arg, u32 begin, u32 end, u32 thread) {
+    (void)thread;
+    bvh_refit_ctx* ctx = (bvh_refit_ctx*)arg;
+    for (u32 i = begin; i < end; ++i) {
+        bvh_refit_node(ctx, ctx->roots[i]);
+    }
+}
+
+static void bvh_collect_depth(const bvh* b, u32 index, u32 depth, u32 target, u32* out, u32* count) {
+    const bvh_node* n = &b->nodes[index];
+    if (depth == target) {
+        out[(*count)++] = index;
+    } else if (!n->count) {
+        bvh_collect_depth(b, n->first, depth + 1, target, out, count);
+        bvh_collect_depth(b, n->first + 1, depth + 1, target, out, count);
+    }
+}
+
+// Refits everything above `target` depth; subtrees rooted at that depth
+// have already been refit by the workers.
+static aabb3 bvh_refit_top(const bvh_refit_ctx* ctx, u32 index, u32 depth, u32 target) {
+    bvh_node* n = &ctx->b->nodes[index];
+    if (depth == target) {
+        return n->bounds;
+    }
+    if (n->count) {
+        n->bounds = bvh_leaf_bounds(ctx, n);
+    } else {
+        aabb3 l = bvh_refit_top(ctx, n->first, depth + 1, target);
+        aabb3 r = bvh_refit_top(ctx, n->first + 1, depth + 1, target);
+        n->bounds = aabb3_union(l, r);
+    }
+    return n->bounds;
+}
+
+// Subtrees some levels below the root are refit in parallel, then the
+// few nodes above them are refit bottom-up on the calling thread.
+static void bvh_refit_parallel(bvh_refit_ctx* ctx) {
+    bvh* b = ctx->b;
+    if (b->node_count == 0) {
+        return;
+    }
+    u32 threads = thread_count();
+    u32 target = 0;
+    while ((1u << target) < threads * 4 && target < 8) {
+        ++target;
+    }
+    if (threads == 1 || b->node_count < 1024) {
+        bvh_refit_node(ctx, 0);
+        return;
+    }
+
+    u32 roots[1 << 8];
+    u32 count = 0;
+    bvh_collect_depth(b, 0, 0, target, roots, &count);
+    ctx->roots = roots;
+    parallel_for(count, 1, bvh_refit_task, ctx);
+    bvh_refit_top(ctx, 0, 0, target);
+}
+
+void bvh_refit(bvh* b, const aabb3* prim_bounds) {
+    bvh_refit_ctx ctx = {0};
+    ctx.b = b;
+    ctx.prim_bounds = prim_bounds;
+    bvh_refit_parallel(&ctx);
+}
+
+// For deforming meshes with fixed topology: `indices` holds three vertex
+// indices per triangle in the order the triangle bounds were passed to
+// bvh_build.
+void bvh_refit_triangles(bvh* b, const point3* positions, const u32* indices) {
+    bvh_refit_ctx ctx = {0};
+    ctx.b = b;
+    ctx.positions = positions;
+    ctx.indices = indices;
+    bvh_refit_parallel(&ctx);
+}
+
+
+/*
+ * ==== TREE ROTATIONS =======
+*/
+
+static void bvh_swap_nodes(bvh* b, u8* heights, u32 i, u32 j) {
+    bvh_node tmp = b->nodes[i];
+    b->nodes[i] = b->nodes[j];
+    b->nodes[j] = tmp;
+    u8 h = heights[i];
+    heights[i] = heights[j];
+    heights[j] = h;
+}
+
+static u8 bvh_max_u8(u8 a, u8 b) {
+    return a > b ? a : b;
+}
+
+// Tries the four child/grandchild swaps below `index` and applies the one
+// that shrinks the surface area of the reshaped child the most. The node
+// itself keeps its bounds since it still covers the same primitives.
+// Children are visited first so each pass works bottom-up.
+static u32 bvh_rotate_node(bvh* b, u8* heights, u32 index, u32 depth) {
+    bvh_node* n = &b->nodes[index];
+    if (n->count) {
+        heights[index] = 0;
+        return 0;
+    }
+    u32 a = n->first;
+    u32 rotations = bvh_rotate_node(b, heights, a, depth + 1)
+        + bvh_rotate_node(b, heights, a + 1, depth + 1);
+
+    f32 best = 0;
+    u32 from = 0;
+    u32 to = 0;
+    u32 reshaped = 0;
+    u8 new_height = 0;
+    for (u32 side = 0; side < 2; ++side) {
+        u32 keep = a + side;          // child that moves down
+        u32 other = a + 1 - side;     // child whose children get promoted
+        const bvh_node* o = &b->nodes[other];
+        if (o->count) {
+            continue;
+        }
+        f32 old_area = aabb3_area(o->bounds);
+        for (u32 g = 0; g < 2; ++g) {
+            u32 up = o->first + g;
+            u32 stay = o->first + 1 - g;
+            u8 h = 1 + bvh_max_u8(heights[keep], heights[stay]);
+            if (depth + 2 + h >= BVH_MAX_DEPTH) {
+                continue;
+            }
+            f32 delta = aabb3_area(aabb3_union(b->nodes[keep].bounds, b->nodes[stay].bounds)) - old_area;
+            if (delta < best) {
+                best = delta;
+                from = keep;
+                to = up;
+                reshaped = other;
+                new_height = h;
+            }
+        }
+    }
+
+    if (best < 0) {
+        bvh_swap_nodes(b, heights, from, to);
+        bvh_node* r = &b->nodes[reshaped];
+        r->bounds = aabb3_union(b->nodes[r->first].bounds, b->nodes[r->first + 1].bounds);
+        heights[reshaped] = new_height;
+        ++rotations;
+    }
+    heights[index] = 1 + bvh_max_u8(heights[a], heights[a + 1]);
+    return rotations;
+}
+
+// One bottom-up pass of tree rotations. Returns the number of rotations
+// applied, zero once the tree is locally optimal.
+u32 bvh_rotate(bvh* b) {
+    if (b->node_count < 3) {
+        return 0;
+    }
+    u8* heights = (u8*)YS_MALLOC(b->node_count);
+    if (!heights) {
+        return 0;
+    }
+    u32 rotations = bvh_rotate_node(b, heights, 0, 0);
+    YS_FREE(heights);
+    return rotations;
+}
+
+// Meant to run after a refit: when the SAH cost has drifted above
+// `max_cost_ratio` times the cost at build time, rotation passes are run
+// until the cost is back under the limit or no rotation helps anymore.
+// Returns the number of passes run.
+u32 bvh_optimize(bvh* b, f32 max_cost_ratio, u32 max_passes) {
+    u32 passes = 0;
+    while (passes < max_passes && bvh_sah_cost(b) > b->build_cost * max_cost_ratio) {
+        ++passes;
+        if (bvh_rotate(b) == 0) {
+            break;
+        }
+    }
+    return passes;
+}
+
+
+/*
+ * ==== SERIALIZATION =======
+*/
+
+static u64 bvh_align(u64 offset) {
+    return (offset + BVH_FILE_ALIGN - 1) & ~(u64)(BVH_FILE_ALIGN - 1);
+}
+
+static void bvh_file_layout(const bvh* b, bvh_file_header* h) {
+    u8* bytes = (u8*)h;
+    for (u32 i = 0; i < sizeof(bvh_file_header); ++i) {
+        bytes[i] = 0;
+    }
+    h->magic = BVH_FILE_MAGIC;
+    h->version = BVH_FILE_VERSION;
+    h->node_size = sizeof(bvh_node);
+    h->node_count = b->node_count;
+    h->prim_count = b->prim_count;
+    h->build_cost = b->build_cost;
+    h->nodes_offset = bvh_align(sizeof(bvh_file_header));
+    h->prims_offset = bvh_align(h->nodes_offset + (u64)b->node_count * sizeof(bvh_node));
+    h->file_size = h->prims_offset + (u64)b->prim_count * sizeof(u32);
+}
+
+u64 bvh_serialized_size(const bvh* b) {
+    bvh_file_header h;
+    bvh_file_layout(b, &h);
+    return h.file_size;
+}
+
+// Writes the file image into `out`. Returns the number of bytes written,
+// or 0 when `size` is too small.
+u64 bvh_serialize(const bvh* b, void* out, u64 size) {
+    bvh_file_header h;
+    bvh_file_layout(b, &h);
+    if (size < h.file_size) {
+        return 0;
+    }
+    u8* bytes = (u8*)out;
+    for (u64 i = 0; i < h.file_size; ++i) {
+        bytes[i] = 0;
+    }
+    *(bvh_file_header*)bytes = h;
+    bvh_node* nodes = (bvh_node*)(bytes + h.nodes_offset);
+    for (u32 i = 0; i < b->node_count; ++i) {
+        nodes[i] = b->nodes[i];
+    }
+    u32* prims = (u32*)(bytes + h.prims_offset);
+    for (u32 i = 0; i < b->prim_count; ++i) {
+        prims[i] = b->prims[i];
+    }
+    return h.file_size;
+}
+
+// True when [offset, offset + bytes) lies within size, without overflow.
+static b32 bvh_file_range(const u64 offset, const u64 bytes, const u64 size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+// Walks the tree of a file image once, so that queries on it stay in
+// bounds: children and leaf ranges must be inside the arrays and no path
+// may be deeper than the fixed traversal stacks allow. Cycles end the
+// walk once it has visited more nodes than the file holds.
+static b32 bvh_file_validate(const bvh_node* nodes, const u32* prims, const u32 node_count,
+        const u32 prim_count) {
+    for (u32 i = 0; i < prim_count; ++i) {
+        if (prims[i] >= prim_count) {
+            return 0;
+        }
+    }
+    if (node_count == 0) {
+        return prim_count == 0;
+    }
+    u32 stack[BVH_MAX_DEPTH];
+    u32 depths[BVH_MAX_DEPTH];
+    u32 top = 0;
+    u32 visited = 0;
+    stack[top] = 0;
+    depths[top++] = 0;
+    while (top > 0) {
+        --top;
+        const bvh_node* n = &nodes[stack[top]];
+        u32 depth = depths[top];
+        if (++visited > node_count) {
+            return 0;
+        }
+        if (n->count) {
+            if (n->count > prim_count || n->first > prim_count - n->count) {
+                return 0;
+            }
+            continue;
+        }
+        if (n->first >= node_count - 1 || depth + 1 >= BVH_MAX_DEPTH) {
+            return 0;
+        }
+        stack[top] = n->first;
+        depths[top++] = depth + 1;
+        stack[top] = n->first + 1;
+        depths[top++] = depth + 1;
+    }
+    return 1;
+}
+
+// Points `b` straight into a file image, nothing is copied. `data` must
+// stay alive and be BVH_FILE_ALIGN aligned (mapped files always are). The
+// image is checked before use, so a corrupt or hostile file is rejected
+// rather than read out of bounds. The result is read-only: query it, but
+// do not refit, rotate or free it.
+b32 bvh_deserialize(bvh* b, const void* data, u64 size) {
+    const bvh_file_header* h = (const bvh_file_header*)data;
+    if (size < sizeof(bvh_file_header) || ((u64)(uintptr_t)data & (BVH_FILE_ALIGN - 1))) {
+        return 0;
+    }
+    if (h->magic == BVH_FILE_MAGIC_SWAPPED) {
+        fprintf(stderr, "BVH file has the other byte order\n");
+        return 0;
+    }
+    if (h->magic != BVH_FILE_MAGIC || h->version != BVH_FILE_VERSION
+            || h->node_size != sizeof(bvh_node) || h->file_size > size) {
+        fprintf(stderr, "Incompatible BVH file\n");
+        return 0;
+    }
+    if ((h->nodes_offset & (BVH_FILE_ALIGN - 1)) || (h->prims_offset & 3)
+            || !bvh_file_range(h->nodes_offset, (u64)h->node_count * sizeof(bvh_node), h->file_size)
+            || !bvh_file_range(h->prims_offset, (u64)h->prim_count * sizeof(u32), h->file_size)) {
+        fprintf(stderr, "Corrupt BVH file\n");
+        return 0;
+    }
+    const bvh_node* nodes = (const bvh_node*)((const u8*)data + h->nodes_offset);
+    const u32* prims = (const u32*)((const u8*)data + h->prims_offset);
+    if (!bvh_file_validate(nodes, prims, h->node_count, h->prim_count)) {
+        fprintf(stderr, "Corrupt BVH file\n");
+        return 0;
+    }
+    b->nodes = (bvh_node*)nodes;
+    b->prims = (u32*)prims;
+    b->node_count = h->node_count;
+    b->prim_count = h->prim_count;
+    b->build_cost = h->build_cost;
+    return 1;
+}
+
+b32 bvh_save(const bvh* b, const char* path) {
+    u64 size = bvh_serialized_size(b);
+    void* image = YS_MALLOC(size);
+    if (!image) {
+        return 0;
+    }
+    bvh_serialize(b, image, size);
+    b32 ok = write_file(path, image, size);
+    YS_FREE(image);
+    return ok;
+}
+
+// Maps a file written by bvh_save and views it as in bvh_deserialize.
+// Release it with unmap_file(f) once the tree is no longer used.
+b32 bvh_load_mapped(bvh* b, mapped_file* f, const char* path) {
+    if (!map_file(f, path)) {
+        return 0;
+    }
+    if (!bvh_deserialize(b, f->data, f->size)) {
+        unmap_file(f);
+        return 0;
+    }
+    return 1;
+}
+
+
+/*
+ * ==== RAY QUERIES =======
+*/
+
+static void bvh_intersect_leaf(const bvh* b, const point3* positions, const u32* indices,
+        const bvh_node* n, const ray3 ray, ray3_hit* hit) {
+    for (u32 i = 0; i < n->count; ++i) {
+        u32 prim = b->prims[n->first + i];
+        const u32* tri = indices + prim * 3;
+        f32 t, u, v;
+        if (ray3_triangle(ray, positions[tri[0]], positions[tri[1]], positions[tri[2]], &t, &u, &v)
+                && t < hit->t) {
+            hit->t = t;
+            hit->u = u;
+            hit->v = v;
+            hit->prim = prim;
+        }
+    }
+}
+
+// Closest hit against the indexed triangles the tree was built over.
+// On a miss hit->prim is BVH_NO_HIT and hit->t is t_max.
+b32 bvh_intersect(const bvh* b, const point3* positions, const u32* indices,
+        const ray3 ray, const f32 t_max, ray3_hit* hit) {
+    hit->t = t_max;
+    hit->prim = BVH_NO_HIT;
+    if (b->node_count == 0) {
+        return 0;
+    }
+    vec3 inv = ray3_inv_dir(ray);
+    f32 t;
+    if (!ray3_aabb3(ray, inv, b->nodes[0].bounds, t_max, &t)) {
+        return 0;
+    }
+
+    u32 stack[BVH_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const bvh_node* n = &b->nodes[stack[--top]];
+        if (n->count) {
+            bvh_intersect_leaf(b, positions, indices, n, ray, hit);
+            continue;
+        }
+        f32 t0, t1;
+        b32 h0 = ray3_aabb3(ray, inv, b->nodes[n->first].bounds, hit->t, &t0);
+        b32 h1 = ray3_aabb3(ray, inv, b->nodes[n->first + 1].bounds, hit->t, &t1);
+        if (h0 && h1) {
+            // Far child goes first so the near one is popped next.
+            b32 near_first = t0 <= t1;
+            stack[top++] = n->first + near_first;
+            stack[top++] = n->first + !near_first;
+        } else if (h0) {
+            stack[top++] = n->first;
+        } else if (h1) {
+            stack[top++] = n->first + 1;
+        }
+    }
+    return hit->prim != BVH_NO_HIT;
+}
+
+// Rays of a packet in SoA form, plus interval bounds over the packet
+// used to reject whole nodes at once.
+typedef struct bvh_packet {
+    f32 ox[BVH_PACKET_SIZE];
+    f32 oy[BVH_PACKET_SIZE];
+    f32 oz[BVH_PACKET_SIZE];
+    f32 ix[BVH_PACKET_SIZE];
+    f32 iy[BVH_PACKET_SIZE];
+    f32 iz[BVH_PACKET_SIZE];
+    f32 t[BVH_PACKET_SIZE];
+    vec3 o_min;
+    vec3 o_max;
+    vec3 i_min;
+    vec3 i_max;
+    b32 coherent;    // all rays share the direction sign on every axis
+    vec3 dir;        // summed direction, decides child order
+} bvh_packet;
+
+static f32 bvh_interval_mul_min(f32 a, f32 i_min, f32 i_max) {
+    return a >= 0 ? a * i_min : a * i_max;
+}
+
+static f32 bvh_interval_mul_max(f32 a, f32 i_min, f32 i_max) {
+    return a >= 0 ? a * i_max : a * i_min;
+}
+
+// Conservative test of a box against every ray of the packet at once.
+// With all rays in one direction octant the slab distances can be bounded
+// with interval arithmetic over the packet's origins and inverse
+// directions, which amounts to testing the box against the packet's
+// bounding frustum. Returns 0 only when no ray can hit the box.
+static b32 bvh_packet_may_hit(const bvh_packet* p, const aabb3 box, const f32 t_max) {
+    if (!p->coherent) {
+        return 1;
+    }
+    f32 t0 = 0;
+    f32 t1 = t_max;
+    for (u32 axis = 0; axis < 3; ++axis) {
+        f32 i_min = p->i_min.e[axis];
+        f32 i_max = p->i_max.e[axis];
+        f32 lo = box.min.e[axis];
+        f32 hi = box.max.e[axis];
+        if (i_min < 0) {
+            // Negative directions enter through the max plane.
+            f32 tmp = lo;
+            lo = hi;
+            hi = tmp;
+        }
+        f32 near_lo;
+        f32 far_hi;
+        if (i_min >= 0) {
+            near_lo = bvh_interval_mul_min(lo - p->o_max.e[axis], i_min, i_max);
+            far_hi = bvh_interval_mul_max(hi - p->o_min.e[axis], i_min, i_max);
+        } else {
+            near_lo = bvh_interval_mul_min(lo - p->o_min.e[axis], i_min, i_max);
+            far_hi = bvh_interval_mul_max(hi - p->o_max.e[axis], i_min, i_max);
+        }
+        t0 = near_lo > t0 ? near_lo : t0;
+        t1 = far_hi < t1 ? far_hi : t1;
+    }
+    return t0 <= t1;
+}
+
+// Per ray slab test over the whole packet, returns the mask of rays that
+// hit the box before their current closest hit.
+static u32 bvh_packet_hit_mask(const bvh_packet* p, const aabb3 box, const u32 active) {
+    u32 mask = 0;
+    for (u32 i = 0; i < BVH_PACKET_SIZE; ++i) {
+        f32 x0 = (box.min.x - p->ox[i]) * p->ix[i];
+        f32 x1 = (box.max.x - p->ox[i]) * p->ix[i];
+        f32 y0 = (box.min.y - p->oy[i]) * p->iy[i];
+        f32 y1 = (box.max.y - p->oy[i]) * p->iy[i];
+        f32 z0 = (box.min.z - p->oz[i]) * p->iz[i];
+        f32 z1 = (box.max.z - p->oz[i]) * p->iz[i];
+        f32 t0 = x0 < x1 ? x0 : x1;
+        f32 t1 = x0 < x1 ? x1 : x0;
+        f32 ty0 = y0 < y1 ? y0 : y1;
+        f32 ty1 = y0 < y1 ? y1 : y0;
+        f32 tz0 = z0 < z1 ? z0 : z1;
+        f32 tz1 = z0 < z1 ? z1 : z0;
+        t0 = ty0 > t0 ? ty0 : t0;
+        t0 = tz0 > t0 ? tz0 : t0;
+        t0 = t0 > 0 ? t0 : 0;
+        t1 = ty1 < t1 ? ty1 : t1;
+        t1 = tz1 < t1 ? tz1 : t1;
+        t1 = p->t[i] < t1 ? p->t[i] : t1;
+        mask |= (u32)(t0 <= t1) << i;
+    }
+    return mask & active;
+}
+
+// Traces up to BVH_PACKET_SIZE rays together, meant for coherent rays
+// such as camera rays of a screen tile or shadow rays towards one light.
+// Nodes are culled for the whole packet first and only then per ray.
+// Returns the mask of rays that hit something; hits[i] is filled as in
+// bvh_intersect.
+u32 bvh_intersect_packet(const bvh* b, const point3* positions, const u32* indices,
+        const ray3* rays, const u32 count, const f32 t_max, ray3_hit* hits) {
+    DEBUG_ASSERT(count <= BVH_PACKET_SIZE);
+    bvh_packet p;
+    u32 active = 0;
+    p.dir.x = p.dir.y = p.dir.z = 0;
+    for (u32 i = 0; i < BVH_PACKET_SIZE; ++i) {
+        // Unused lanes repeat ray 0 but stay outside the active mask.
+        ray3 r = rays[i < count ? i : 0];
+        vec3 inv = ray3_inv_dir(r);
+        p.ox[i] = r.origin.x;
+        p.oy[i] = r.origin.y;
+        p.oz[i] = r.origin.z;
+        p.ix[i] = inv.x;
+        p.iy[i] = inv.y;
+        p.iz[i] = inv.z;
+        p.t[i] = t_max;
+        if (i < count) {
+            hits[i].t = t_max;
+            hits[i].prim = BVH_NO_HIT;
+            active |= 1u << i;
+            p.dir = vec3_add(p.dir, r.dir);
+        }
+    }
+    if (count == 0 || b->node_count == 0) {
+        return 0;
+    }
+
+    p.coherent = 1;
+    for (u32 axis = 0; axis < 3; ++axis) {
+        const f32* o = axis == 0 ? p.ox : axis == 1 ? p.oy : p.oz;
+        const f32* inv = axis == 0 ? p.ix : axis == 1 ? p.iy : p.iz;
+        p.o_min.e[axis] = p.o_max.e[axis] = o[0];
+        p.i_min.e[axis] = p.i_max.e[axis] = inv[0];
+        for (u32 i = 1; i < count; ++i) {
+            p.o_min.e[axis] = o[i] < p.o_min.e[axis] ? o[i] : p.o_min.e[axis];
+            p.o_max.e[axis] = o[i] > p.o_max.e[axis] ? o[i] : p.o_max.e[axis];
+            p.i_min.e[axis] = inv[i] < p.i_min.e[axis] ? inv[i] : p.i_min.e[axis];
+            p.i_max.e[axis] = inv[i] > p.i_max.e[axis] ? inv[i] : p.i_max.e[axis];
+        }
+        if (p.i_min.e[axis] < 0 && p.i_max.e[axis] > 0) {
+            p.coherent = 0;
+        }
+    }
+
+    u32 stack[BVH_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const bvh_node* n = &b->nodes[stack[--top]];
+
+        f32 packet_t = 0;
+        for (u32 i = 0; i < count; ++i) {
+            packet_t = p.t[i] > packet_t ? p.t[i] : packet_t;
+        }
+        if (!bvh_packet_may_hit(&p, n->bounds, packet_t)) {
+            continue;
+        }
+        u32 mask = bvh_packet_hit_mask(&p, n->bounds, active);
+        if (!mask) {
+            continue;
+        }
+
+        if (n->count) {
+            for (u32 i = 0; i < count; ++i) {
+                if (mask & (1u << i)) {
+                    bvh_intersect_leaf(b, positions, indices, n, rays[i], &hits[i]);
+                    p.t[i] = hits[i].t;
+                }
+            }
+            continue;
+        }
+
+        // Visit the child lying first along the packet's mean direction.
+        vec3 d = vec3_sub(aabb3_center(b->nodes[n->first + 1].bounds),
+            aabb3_center(b->nodes[n->first].bounds));
+        b32 left_first = vec3_dot(d, p.dir) >= 0;
+        stack[top++] = n->first + left_first;
+        stack[top++] = n->first + !left_first;
+    }
+
+    u32 result = 0;
+    for (u32 i = 0; i < count; ++i) {
+        result |= (u32)(hits[i].prim != BVH_NO_HIT) << i;
+    }
+    return result;
+}
+
+typedef struct bvh_stream {
+    const bvh* b;
+    const point3* positions;
+    const u32* indices;
+    const ray3* rays;
+    const vec3* inv;
+    ray3_hit* hits;
+    vec3 dir;    // direction of the current octant
+} bvh_stream;
+
+// Moves the rays of ids[0, count) that hit the box to the front and
+// returns how many there are.
+static u32 bvh_stream_filter(const bvh_stream* s, const aabb3 box, u32* ids, u32 count) {
+    u32 kept = 0;
+    for (u32 i = 0; i < count; ++i) {
+        u32 id = ids[i];
+        f32 t;
+        if (ray3_aabb3(s->rays[id], s->inv[id], box, s->hits[id].t, &t)) {
+            ids[i] = ids[kept];
+            ids[kept++] = id;
+        }
+    }
+    return kept;
+}
+
+static void bvh_stream_node(const bvh_stream* s, u32 index, u32* ids, u32 count) {
+    const bvh_node* n = &s->b->nodes[index];
+    count = bvh_stream_filter(s, n->bounds, ids, count);
+    if (count == 0) {
+        return;
+    }
+    if (n->count) {
+        for (u32 i = 0; i < count; ++i) {
+            bvh_intersect_leaf(s->b, s->positions, s->indices, n, s->rays[ids[i]], &s->hits[ids[i]]);
+        }
+        return;
+    }
+    // Every ray of the stream shares one direction octant, so the near
+    // child is the same for all of them. Filtering reorders ids but keeps
+    // the set, so the second child sees the same rays.
+    vec3 d = vec3_sub(aabb3_center(s->b->nodes[n->first + 1].bounds),
+        aabb3_center(s->b->nodes[n->first].bounds));
+    u32 near = vec3_dot(d, s->dir) >= 0 ? 0 : 1;
+    bvh_stream_node(s, n->first + near, ids, count);
+    bvh_stream_node(s, n->first + 1 - near, ids, count);
+}
+
+// Breadth-first tracing of a large batch of rays. Rays are sorted into
+// the eight direction octants, then each octant's stream walks the tree
+// with every node partitioning the stream down to the rays that hit it,
+// so each node is fetched once per stream instead of once per ray.
+// Returns the number of rays that hit; hits[i] is filled as in
+// bvh_intersect.
+u32 bvh_intersect_stream(const bvh* b, const point3* positions, const u32* indices,
+        const ray3* rays, const u32 count, const f32 t_max, ray3_hit* hits) {
+    for (u32 i = 0; i < count; ++i) {
+        hits[i].t = t_max;
+        hits[i].prim = BVH_NO_HIT;
+    }
+    if (count == 0 || b->node_count == 0) {
+        return 0;
+    }
+    vec3* inv = (vec3*)YS_MALLOC(sizeof(vec3) * count);
+    u32* ids = (u32*)YS_MALLOC(sizeof(u32) * count);
+    if (!inv || !ids) {
+        YS_FREE(inv);
+        YS_FREE(ids);
+        return 0;
+    }
+
+    u32 octant_start[9] = {0};
+    for (u32 i = 0; i < count; ++i) {
+        inv[i] = ray3_inv_dir(rays[i]);
+        u32 octant = (rays[i].dir.x < 0) | (rays[i].dir.y < 0) << 1 | (rays[i].dir.z < 0) << 2;
+        octant_start[octant + 1]++;
+    }
+    for (u32 o = 0; o < 8; ++o) {
+        octant_start[o + 1] += octant_start[o];
+    }
+    u32 fill[8];
+    for (u32 o = 0; o < 8; ++o) {
+        fill[o] = octant_start[o];
+    }
+    for (u32 i = 0; i < count; ++i) {
+        u32 octant = (rays[i].dir.x < 0) | (rays[i].dir.y < 0) << 1 | (rays[i].dir.z < 0) << 2;
+        ids[fill[octant]++] = i;
+    }
+
+    bvh_stream s;
+    s.b = b;
+    s.positions = positions;
+    s.indices = indices;
+    s.rays = rays;
+    s.inv = inv;
+    s.hits = hits;
+    for (u32 o = 0; o < 8; ++o) {
+        u32 n = octant_start[o + 1] - octant_start[o];
+        if (n == 0) {
+            continue;
+        }
+        s.dir.x = o & 1 ? -1.0f : 1.0f;
+        s.dir.y = o & 2 ? -1.0f : 1.0f;
+        s.dir.z = o & 4 ? -1.0f : 1.0f;
+        bvh_stream_node(&s, 0, ids + octant_start[o], n);
+    }
+
+    YS_FREE(inv);
+    YS_FREE(ids);
+    u32 found = 0;
+    for (u32 i = 0; i < count; ++i) {
+        found += hits[i].prim != BVH_NO_HIT;
+    }
+    return found;
+}
+
+
+/*
+ * ==== POINT QUERIES =======
+*/
+
+// Closest point on the indexed triangles within max_dist of p. Children
+// are visited nearest box first and skipped once their box is further
+// than the best triangle so far, so a tight max_dist (for example from a
+// neighbouring query) prunes most of the tree. On a miss hit->prim is
+// BVH_NO_HIT and hit->dist_sq is max_dist squared.
+b32 bvh_closest_point(const bvh* b, const point3* positions, const u32* indices,
+        const point3 p, const f32 max_dist, bvh_point_hit* hit) {
+    hit->dist_sq = max_dist < FLT_MAX ? max_dist * max_dist : FLT_MAX;
+    hit->prim = BVH_NO_HIT;
+    if (b->node_count == 0 || point_aabb3_dist_sq(p, b->nodes[0].bounds) >= hit->dist_sq) {
+        return 0;
+    }
+
+    u32 stack[BVH_MAX_DEPTH];
+    f32 stack_dist[BVH_MAX_DEPTH];
+    u32 top = 0;
+    stack[top] = 0;
+    stack_dist[top++] = 0.0f;
+    while (top > 0) {
+        --top;
+        if (stack_dist[top] >= hit->dist_sq) {
+            continue;
+        }
+        const bvh_node* n = &b->nodes[stack[top]];
+        if (n->count) {
+            for (u32 i = 0; i < n->count; ++i) {
+                u32 prim = b->prims[n->first + i];
+                const u32* tri = indices + prim * 3;
+                f32 bary[3];
+                point3 q = closest_point_triangle_bary(p, positions[tri[0]], positions[tri[1]],
+                    positions[tri[2]], bary);
+                f32 d = vec3_len_sq(vec3_sub(q, p));
+                if (d < hit->dist_sq) {
+                    hit->point = q;
+                    hit->dist_sq = d;
+                    hit->bary[0] = bary[0];
+                    hit->bary[1] = bary[1];
+                    hit->bary[2] = bary[2];
+                    hit->prim = prim;
+                }
+            }
+            continue;
+        }
+        f32 d0 = point_aabb3_dist_sq(p, b->nodes[n->first].bounds);
+        f32 d1 = point_aabb3_dist_sq(p, b->nodes[n->first + 1].bounds);
+        // Far child goes first so the near one is popped next.
+        b32 near_first = d0 <= d1;
+        f32 d_far = near_first ? d1 : d0;
+        f32 d_near = near_first ? d0 : d1;
+        if (d_far < hit->dist_sq) {
+            stack[top] = n->first + near_first;
+            stack_dist[top++] = d_far;
+        }
+        if (d_near < hit->dist_sq) {
+            stack[top] = n->first + !near_first;
+            stack_dist[top++] = d_near;
+        }
+    }
+    return hit->prim != BVH_NO_HIT;
+}
+
+
+/*
+ * ==== WIDE BVH =======
+*/
+
+static f32 bvh_wide_exp2(i32 e) {
+    union { u32 u; f32 f; } v;
+    v.u = (u32)(e + 127) << 23;
+    return v.f;
+}
+
+// Smallest power of two exponent with extent / 2^e <= BVH_WIDE_QMAX.
+static i8 bvh_wide_exponent(f32 extent) {
+    i32 e = 0;
+    frexpf(extent / BVH_WIDE_QMAX, &e);
+    if (extent <= 0) {
+        e = -126;
+    }
+    if (e < -126) {
+        e = -126;
+    }
+    if (e > 127) {
+        e = 127;
+    }
+    return (i8)e;
+}
+
+static bvh_wide_q bvh_wide_quantize(f32 v, f32 inv_scale, b32 round_up) {
+    f32 q = round_up ? ceilf(v * inv_scale) : floorf(v * inv_scale);
+    if (q < 0) {
+        q = 0;
+    }
+    if (q > BVH_WIDE_QMAX) {
+        q = BVH_WIDE_QMAX;
+    }
+    return (bvh_wide_q)q;
+}
+
+// Pulls up to BVH_WIDE_WIDTH children out of the binary subtree below
+// `index` by repeatedly opening the inner child with the largest area.
+static u32 bvh_wide_gather(const bvh* b, u32 index, u32* children) {
+    const bvh_node* n = &b->nodes[index];
+    if (n->count) {
+        children[0] = index;
+        return 1;
+    }
+    u32 count = 2;
+    children[0] = n->first;
+    children[1] = n->first + 1;
+    while (count < BVH_WIDE_WIDTH) {
+        i32 best = -1;
+        f32 best_area = -1;
+        for (u32 i = 0; i < count; ++i) {
+            const bvh_node* c = &b->nodes[children[i]];
+            f32 area = aabb3_area(c->bounds);
+            if (!c->count && area > best_area) {
+                best = (i32)i;
+                best_area = area;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        u32 opened = children[best];
+        children[best] = b->nodes[opened].first;
+        children[count++] = b->nodes[opened].first + 1;
+    }
+    return count;
+}
+
+// Wide nodes the collapse makes: one for the root and one per inner
+// child gathered. `stack` needs room for node_count entries.
+static u32 bvh_wide_count(const bvh* b, u32* stack) {
+    u32 top = 0;
+    u32 count = 1;
+    stack[top++] = 0;
+    while (top > 0) {
+        u32 children[BVH_WIDE_WIDTH];
+        u32 n = bvh_wide_gather(b, stack[--top], children);
+        for (u32 i = 0; i < n; ++i) {
+            if (b->nodes[children[i]].count == 0) {
+                stack[top++] = children[i];
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+// Collapses a binary BVH into the wide layout. The binary tree is left
+// untouched and can be freed afterwards. The wide nodes are counted
+// first so that only those are allocated.
+b32 bvh_wide_build(bvh_wide* w, const bvh* b) {
+    u32 max_nodes = b->node_count > 0 ? b->node_count : 1;
+    w->nodes = 0;
+    w->prims = (u32*)YS_MALLOC(sizeof(u32) * (b->prim_count > 0 ? b->prim_count : 1));
+    u32* pending = (u32*)YS_MALLOC(sizeof(u32) * 2 * max_nodes);
+    if (pending) {
+        w->node_capacity = b->node_count > 0 ? bvh_wide_count(b, pending) : 1;
+        w->nodes = (bvh_wide_node*)YS_MALLOC(sizeof(bvh_wide_node) * w->node_capacity);
+    }
+    if (!w->nodes || !w->prims || !pending) {
+        YS_FREE(pending);
+        bvh_wide_free(w);
+        return 0;
+    }
+    w->prim_count = b->prim_count;
+    w->node_count = 0;
+    if (b->node_count == 0) {
+        YS_FREE(pending);
+        return 1;
+    }
+
+    // Stack of (wide node, binary node) pairs still to be filled in.
+    u32 top = 0;
+    u32 prim_count = 0;
+    w->node_count = 1;
+    pending[top++] = 0;
+    pending[top++] = 0;
+
+    while (top > 0) {
+        u32 source = pending[--top];
+        u32 target = pending[--top];
+        bvh_wide_node* node = &w->nodes[target];
+        const aabb3 box = b->nodes[source].bounds;
+
+        u32 children[BVH_WIDE_WIDTH];
+        u32 count = bvh_wide_gather(b, source, children);
+
+        f32 inv_scale[3];
+        node->origin = box.min;
+        for (u32 axis = 0; axis < 3; ++axis) {
+            node->exp[axis] = bvh_wide_exponent(box.max.e[axis] - box.min.e[axis]);
+            inv_scale[axis] = 1.0f / bvh_wide_exp2(node->exp[axis]);
+        }
+        node->child_count = (u8)count;
+
+        u32 internal = 0;
+        for (u32 i = 0; i < count; ++i) {
+            internal += b->nodes[children[i]].count == 0;
+        }
+        node->node_base = w->node_count;
+        node->prim_base = prim_count;
+        w->node_count += internal;
+
+        u32 next_internal = node->node_base;
+        for (u32 i = 0; i < BVH_WIDE_WIDTH; ++i) {
+            if (i >= count) {
+                node->meta[i] = BVH_WIDE_EMPTY;
+                node->min_x[i] = node->min_y[i] = node->min_z[i] = BVH_WIDE_QMAX;
+                node->max_x[i] = node->max_y[i] = node->max_z[i] = 0;
+                continue;
+            }
+            const bvh_node* c = &b->nodes[children[i]];
+            node->min_x[i] = bvh_wide_quantize(c->bounds.min.x - box.min.x, inv_scale[0], 0);
+            node->min_y[i] = bvh_wide_quantize(c->bounds.min.y - box.min.y, inv_scale[1], 0);
+            node->min_z[i] = bvh_wide_quantize(c->bounds.min.z - box.min.z, inv_scale[2], 0);
+            node->max_x[i] = bvh_wide_quantize(c->bounds.max.x - box.min.x, inv_scale[0], 1);
+            node->max_y[i] = bvh_wide_quantize(c->bounds.max.y - box.min.y, inv_scale[1], 1);
+            node->max_z[i] = bvh_wide_quantize(c->bounds.max.z - box.min.z, inv_scale[2], 1);
+            if (c->count) {
+                node->meta[i] = (u8)c->count;
+                for (u32 k = 0; k < c->count; ++k) {
+                    w->prims[prim_count++] = b->prims[c->first + k];
+                }
+            } else {
+                node->meta[i] = BVH_WIDE_INTERNAL;
+                pending[top++] = next_internal++;
+                pending[top++] = children[i];
+            }
+        }
+    }
+
+    YS_FREE(pending);
+    return 1;
+}
+
+void bvh_wide_free(bvh_wide* w) {
+    YS_FREE(w->nodes);
+    YS_FREE(w->prims);
+    w->nodes = 0;
+    w->prims = 0;
+    w->node_count = 0;
+    w->node_capacity = 0;
+    w->prim_count = 0;
+}
+
+typedef struct bvh_wide_entry {
+    u32 node;
+    f32 t;
+} bvh_wide_entry;
+
+// Closest hit against indexed triangles. All children of a node are
+// tested with one fixed width loop over the quantized lanes, which the
+// compiler turns into SIMD code.
+b32 bvh_wide_intersect(const bvh_wide* w, const point3* positions, const u32* indices,
+        const ray3 ray, const f32 t_max, ray3_hit* hit) {
+    if (w->node_count == 0) {
+        return 0;
+    }
+    vec3 inv = ray3_inv_dir(ray);
+    hit->t = t_max;
+    b32 found = 0;
+
+    bvh_wide_entry stack[BVH_MAX_DEPTH * BVH_WIDE_WIDTH];
+    u32 top = 0;
+    stack[top].node = 0;
+    stack[top++].t = 0;
+
+    while (top > 0) {
+        bvh_wide_entry entry = stack[--top];
+        if (entry.t > hit->t) {
+            continue;
+        }
+        const bvh_wide_node* n = &w->nodes[entry.node];
+
+        // t = (origin + q * scale - ray.origin) * inv = q * a + b
+        f32 ax = bvh_wide_exp2(n->exp[0]) * inv.x;
+        f32 ay = bvh_wide_exp2(n->exp[1]) * inv.y;
+        f32 az = bvh_wide_exp2(n->exp[2]) * inv.z;
+        f32 bx = (n->origin.x - ray.origin.x) * inv.x;
+        f32 by = (n->origin.y - ray.origin.y) * inv.y;
+        f32 bz = (n->origin.z - ray.origin.z) * inv.z;
+
+        f32 t_near[BVH_WIDE_WIDTH];
+        u32 mask = 0;
+        for (u32 i = 0; i < BVH_WIDE_WIDTH; ++i) {
+            f32 x0 = n->min_x[i] * ax + bx;
+            f32 x1 = n->max_x[i] * ax + bx;
+            f32 y0 = n->min_y[i] * ay + by;
+            f32 y1 = n->max_y[i] * ay + by;
+            f32 z0 = n->min_z[i] * az + bz;
+            f32 z1 = n->max_z[i] * az + bz;
+            f32 tx0 = x0 < x1 ? x0 : x1;
+            f32 tx1 = x0 < x1 ? x1 : x0;
+            f32 ty0 = y0 < y1 ? y0 : y1;
+            f32 ty1 = y0 < y1 ? y1 : y0;
+            f32 tz0 = z0 < z1 ? z0 : z1;
+            f32 tz1 = z0 < z1 ? z1 : z0;
+            f32 t0 = tx0 > ty0 ? tx0 : ty0;
+            t0 = tz0 > t0 ? tz0 : t0;
+            t0 = t0 > 0 ? t0 : 0;
+            f32 t1 = tx1 < ty1 ? tx1 : ty1;
+            t1 = tz1 < t1 ? tz1 : t1;
+            t1 = t1 < hit->t ? t1 : hit->t;
+            t_near[i] = t0;
+            mask |= (u32)(t0 <= t1 * 1.0000003f) << i;
+        }
+
+        bvh_wide_entry inner[BVH_WIDE_WIDTH];
+        u32 inner_count = 0;
+        u32 next_node = n->node_base;
+        u32 next_prim = n->prim_base;
+        for (u32 i = 0; i < n->child_count; ++i) {
+            u8 meta = n->meta[i];
+            b32 hit_child = (mask >> i) & 1;
+            if (meta == BVH_WIDE_INTERNAL) {
+                if (hit_child) {
+                    // Insertion sort, farthest first, so the nearest
+                    // child ends up on top of the stack.
+                    u32 k = inner_count++;
+                    while (k > 0 && inner[k - 1].t < t_near[i]) {
+                        inner[k] = inner[k - 1];
+                        --k;
+                    }
+                    inner[k].node = next_node;
+                    inner[k].t = t_near[i];
+                }
+                ++next_node;
+                continue;
+            }
+            if (hit_child) {
+                for (u32 k = 0; k < meta; ++k) {
+                    u32 prim = w->prims[next_prim + k];
+                    const u32* tri = indices + prim * 3;
+                    f32 t, u, v;
+                    if (ray3_triangle(ray, positions[tri[0]], positions[tri[1]], positions[tri[2]], &t, &u, &v)
+                            && t < hit->t) {
+                        hit->t = t;
+                        hit->u = u;
+                        hit->v = v;
+                        hit->prim = prim;
+                        found = 1;
+                    }
+                }
+            }
+            next_prim += meta;
+        }
+        for (u32 i = 0; i < inner_count; ++i) {
+            stack[top++] = inner[i];
+        }
+    }
+    return found;
+}
+
+#endif
+#endif
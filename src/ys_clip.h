@@ -0,0 +1,158 @@
+#ifndef YS_CLIP_H
+#define YS_CLIP_H
+
+#include "ys_math.h"
+
+// Clip space planes, as outcode bits. A vertex is inside all of them when
+// -w <= x, y, z <= w, the OpenGL convention used by frustum_from_mat4.
+#define CLIP_LEFT 0x01
+#define CLIP_RIGHT 0x02
+#define CLIP_BOTTOM 0x04
+#define CLIP_TOP 0x08
+#define CLIP_NEAR 0x10
+#define CLIP_FAR 0x20
+#define CLIP_ALL 0x3F
+// Classification of a triangle fully outside one plane.
+#define CLIP_REJECT 0x80
+#define CLIP_PLANE_COUNT 6
+// Each plane adds at most one vertex to a convex polygon.
+#define CLIP_MAX_VERTICES (3 + CLIP_PLANE_COUNT)
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// A clip space position and its barycentric weights in the source
+// triangle, so clipped vertices can interpolate any vertex attribute.
+typedef struct clip_vertex {
+    vec4 position;
+    vec3 weights;
+} clip_vertex;
+
+
+/*
+ * === CLIP INTERFACE ===
+*/
+void clip_outcodes(const vec4* positions, const u32 count, u8* codes);
+u32 clip_classify(const u8* codes, const u32* indices, const u32 triangle_count, const u8 planes, u8* masks);
+u32 clip_polygon(clip_vertex* polygon, const u32 count, clip_vertex* scratch, const u8 planes);
+u32 clip_triangle(const vec4 a, const vec4 b, const vec4 c, const u8 planes, clip_vertex* out);
+
+
+#ifdef YS_CLIP_IMPLEMENTATION
+
+/*
+ * ==== CLIP IMPLEMENTATION =======
+*/
+
+// Outcode of each position: the bits of the planes it lies outside of.
+// Branch free, so the loop can be vectorized.
+void clip_outcodes(const vec4* positions, const u32 count, u8* codes) {
+    for (u32 i = 0; i < count; ++i) {
+        vec4 v = positions[i];
+        codes[i] = (u8)((v.x < -v.w) | (v.x > v.w) << 1 | (v.y < -v.w) << 2 | (v.y > v.w) << 3
+            | (v.z < -v.w) << 4 | (v.z > v.w) << 5);
+    }
+}
+
+// Trivial accept and reject from the vertex outcodes. Each triangle gets
+// CLIP_REJECT when all its vertices are outside one plane, else the
+// planes among `planes` it straddles, so 0 means it can be drawn as is.
+// Leaving planes out, such as the sides for a guard band rasterizer,
+// sends fewer triangles to the clipper. Returns how many need clipping.
+u32 clip_classify(const u8* codes, const u32* indices, const u32 triangle_count, const u8 planes, u8* masks) {
+    u32 clipped = 0;
+    for (u32 t = 0; t < triangle_count; ++t) {
+        u8 a = codes[indices[t * 3]];
+        u8 b = codes[indices[t * 3 + 1]];
+        u8 c = codes[indices[t * 3 + 2]];
+        u8 mask = (a | b | c) & planes;
+        mask = (a & b & c) ? CLIP_REJECT : mask;
+        masks[t] = mask;
+        clipped += mask != 0 && mask != CLIP_REJECT;
+    }
+    return clipped;
+}
+
+// Signed distance to a plane, scaled by w; inside is >= 0.
+static f32 clip_distance(const vec4 v, const u32 plane) {
+    f32 s = plane & 1 ? -1.0f : 1.0f;
+    return v.w + s * v.e[plane >> 1];
+}
+
+// Point where the edge from inside vertex a to outside vertex b meets the
+// plane. Always interpolating from the inside end makes an edge shared by
+// two triangles clip to the same point.
+static clip_vertex clip_intersect(const clip_vertex* a, const clip_vertex* b, const f32 da, const f32 db,
+        const u32 plane) {
+    f32 t = da / (da - db);
+    clip_vertex r;
+    r.position = vec4_add(a->position, vec4_mul_s(vec4_sub(b->position, a->position), t));
+    r.weights = vec3_add(a->weights, vec3_mul_s(vec3_sub(b->weights, a->weights), t));
+    // Snap onto the plane so rounding never leaves it outside.
+    r.position.e[plane >> 1] = plane & 1 ? r.position.w : -r.position.w;
+    return r;
+}
+
+// Sutherland-Hodgman clipping of a convex polygon against the planes in
+// `planes`. The result replaces the polygon, so both it and scratch need
+// room for count + CLIP_PLANE_COUNT vertices. Returns the new vertex
+// count, 0 when less than a triangle is left.
+u32 clip_polygon(clip_vertex* polygon, const u32 count, clip_vertex* scratch, const u8 planes) {
+    clip_vertex* in = polygon;
+    clip_vertex* out = scratch;
+    u32 n = count;
+    for (u32 plane = 0; plane < CLIP_PLANE_COUNT && n > 0; ++plane) {
+        if (!(planes & (1u << plane))) {
+            continue;
+        }
+        u32 m = 0;
+        u32 prev = n - 1;
+        f32 d_prev = clip_distance(in[prev].position, plane);
+        for (u32 i = 0; i < n; ++i) {
+            f32 d = clip_distance(in[i].position, plane);
+            // A vertex on the plane is kept as is rather than doubled by
+            // an intersection at its own position.
+            if (d >= 0.0f) {
+                if (d_prev < 0.0f && d > 0.0f) {
+                    out[m++] = clip_intersect(&in[i], &in[prev], d, d_prev, plane);
+                }
+                out[m++] = in[i];
+            } else if (d_prev > 0.0f) {
+                out[m++] = clip_intersect(&in[prev], &in[i], d_prev, d, plane);
+            }
+            prev = i;
+            d_prev = d;
+        }
+        clip_vertex* tmp = in;
+        in = out;
+        out = tmp;
+        n = m;
+    }
+    if (in != polygon) {
+        for (u32 i = 0; i < n; ++i) {
+            polygon[i] = in[i];
+        }
+    }
+    return n >= 3 ? n : 0;
+}
+
+// Clips triangle (a, b, c) against `planes`, usually the mask from
+// clip_classify. out holds CLIP_MAX_VERTICES vertices, a convex fan in
+// the triangle's winding. Returns the vertex count.
+u32 clip_triangle(const vec4 a, const vec4 b, const vec4 c, const u8 planes, clip_vertex* out) {
+    clip_vertex scratch[CLIP_MAX_VERTICES];
+    vec3 x = {{1.0f, 0.0f, 0.0f}};
+    vec3 y = {{0.0f, 1.0f, 0.0f}};
+    vec3 z = {{0.0f, 0.0f, 1.0f}};
+    out[0].position = a;
+    out[0].weights = x;
+    out[1].position = b;
+    out[1].weights = y;
+    out[2].position = c;
+    out[2].weights = z;
+    return clip_polygon(out, 3, scratch, planes);
+}
+
+#endif
+#endif
@@ -0,0 +1,739 @@
+#ifndef YS_DELAUNAY_H
+#define YS_DELAUNAY_H
+
+#include "ys_morton.h"
+#include "ys_predicates.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+#define DELAUNAY_NONE 0xFFFFFFFFu
+// The vertex at infinity, shared by the ghost triangles that close the
+// triangulation around its convex hull.
+#define DELAUNAY_INFINITE 0xFFFFFFFEu
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Delaunay triangulation of a point set, optionally constrained, as half-
+// edges: half-edge 3t + i of triangle t runs from vertex i to vertex i + 1,
+// counterclockwise, and `halfedges` holds its twin. Each hull edge has a
+// ghost triangle on its outer side with DELAUNAY_INFINITE as third vertex,
+// so every half-edge has a twin; skip those when drawing. Everything is
+// sized for `point_capacity` points at creation, so builds never allocate.
+typedef struct delaunay {
+    u32* triangles;       // 3 vertices per triangle
+    u32* halfedges;       // twin of each half-edge
+    u8* constrained;      // per half-edge, set on both twins
+    u32* vertex_map;      // vertex each input point became; duplicates map to the first
+    u32 triangle_count;   // ghost triangles included
+    u32 point_capacity;
+    const point2* points;
+    u32 point_count;
+    u32 last;             // triangle of the last insertion, where the next walk starts
+    u32* vertex_edge;     // a half-edge leaving each vertex
+    u32* keys;            // Hilbert keys, then the legalize or segment stack
+    u32* order;           // insertion order
+    u32* scratch;         // radix sort buffers, then constraint edge lists
+} delaunay;
+
+
+/*
+ * === DELAUNAY INTERFACE ===
+*/
+b32 delaunay_create(delaunay* d, const u32 max_points);
+void delaunay_free(delaunay* d);
+b32 delaunay_build(delaunay* d, const point2* points, const u32 count);
+b32 delaunay_constrain(delaunay* d, const u32* edges, const u32 edge_count);
+b32 delaunay_build_tiles(delaunay* tiles, const point2* const* points, const u32* point_counts,
+        const u32* const* edges, const u32* edge_counts, const u32 tile_count);
+
+
+#ifdef YS_DELAUNAY_IMPLEMENTATION
+
+// Results of a point location.
+#define DELAUNAY_IN_TRIANGLE 0
+#define DELAUNAY_ON_EDGE 1
+#define DELAUNAY_ON_VERTEX 2
+
+static u32 delaunay_triangle_capacity(const u32 n) {
+    return n > 2 ? 2 * n : 2;
+}
+
+static u32 delaunay_next(const u32 e) {
+    return e % 3 == 2 ? e - 2 : e + 1;
+}
+
+static u32 delaunay_prev(const u32 e) {
+    return e % 3 == 0 ? e + 2 : e - 1;
+}
+
+b32 delaunay_create(delaunay* d, const u32 max_points) {
+    u32 edges = 3 * delaunay_triangle_capacity(max_points);
+    u32 n = max_points > 0 ? max_points : 1;
+    d->triangles = (u32*)YS_MALLOC(sizeof(u32) * edges);
+    d->halfedges = (u32*)YS_MALLOC(sizeof(u32) * edges);
+    d->constrained = (u8*)YS_MALLOC(edges);
+    d->vertex_map = (u32*)YS_MALLOC(sizeof(u32) * n);
+    d->vertex_edge = (u32*)YS_MALLOC(sizeof(u32) * n);
+    d->keys = (u32*)YS_MALLOC(sizeof(u32) * 2 * (n + 2));
+    d->order = (u32*)YS_MALLOC(sizeof(u32) * n);
+    d->scratch = (u32*)YS_MALLOC(sizeof(u32) * 2 * (edges > 2 * n ? edges : 2 * n));
+    d->triangle_count = 0;
+    d->point_capacity = max_points;
+    d->points = 0;
+    d->point_count = 0;
+    d->last = 0;
+    if (!d->triangles || !d->halfedges || !d->constrained || !d->vertex_map || !d->vertex_edge || !d->keys
+            || !d->order || !d->scratch) {
+        delaunay_free(d);
+        return 0;
+    }
+    return 1;
+}
+
+void delaunay_free(delaunay* d) {
+    YS_FREE(d->triangles);
+    YS_FREE(d->halfedges);
+    YS_FREE(d->constrained);
+    YS_FREE(d->vertex_map);
+    YS_FREE(d->vertex_edge);
+    YS_FREE(d->keys);
+    YS_FREE(d->order);
+    YS_FREE(d->scratch);
+    d->triangles = 0;
+    d->halfedges = 0;
+    d->constrained = 0;
+    d->vertex_map = 0;
+    d->vertex_edge = 0;
+    d->keys = 0;
+    d->order = 0;
+    d->scratch = 0;
+}
+
+
+/*
+ * ==== TOPOLOGY =======
+*/
+
+static void delaunay_link(delaunay* d, const u32 a, const u32 b) {
+    d->halfedges[a] = b;
+    d->halfedges[b] = a;
+}
+
+static u32 delaunay_add(delaunay* d, const u32 a, const u32 b, const u32 c) {
+    u32 t = d->triangle_count++;
+    d->triangles[t * 3] = a;
+    d->triangles[t * 3 + 1] = b;
+    d->triangles[t * 3 + 2] = c;
+    d->constrained[t * 3] = 0;
+    d->constrained[t * 3 + 1] = 0;
+    d->constrained[t * 3 + 2] = 0;
+    return t;
+}
+
+static void delaunay_set(delaunay* d, const u32 t, const u32 a, const u32 b, const u32 c) {
+    d->triangles[t * 3] = a;
+    d->triangles[t * 3 + 1] = b;
+    d->triangles[t * 3 + 2] = c;
+}
+
+static b32 delaunay_is_ghost(const delaunay* d, const u32 t) {
+    return d->triangles[t * 3] == DELAUNAY_INFINITE || d->triangles[t * 3 + 1] == DELAUNAY_INFINITE
+        || d->triangles[t * 3 + 2] == DELAUNAY_INFINITE;
+}
+
+// Whether y lies inside the circumcircle of counterclockwise (p, q, x).
+// A ghost triangle's circle is the open half-plane beyond its hull edge.
+static b32 delaunay_conflict(const delaunay* d, const u32 p, const u32 q, const u32 x, const u32 y) {
+    const point2* v = d->points;
+    if (y == DELAUNAY_INFINITE) {
+        return 0;
+    }
+    if (x == DELAUNAY_INFINITE) {
+        return orient2d(v[p], v[q], v[y]) > 0.0;
+    }
+    if (p == DELAUNAY_INFINITE) {
+        return orient2d(v[q], v[x], v[y]) > 0.0;
+    }
+    if (q == DELAUNAY_INFINITE) {
+        return orient2d(v[x], v[p], v[y]) > 0.0;
+    }
+    return incircle(v[p], v[q], v[x], v[y]) > 0.0;
+}
+
+// Flips the diagonal of the two triangles on half-edge e, from p -> q to
+// y -> x where x and y are their apexes. e and its twin stay the diagonal;
+// the edges around the quad move, so their twins and flags are relinked.
+static void delaunay_flip(delaunay* d, const u32 e) {
+    u32 f = d->halfedges[e];
+    u32 a1 = delaunay_next(e), a2 = delaunay_prev(e);
+    u32 b1 = delaunay_next(f), b2 = delaunay_prev(f);
+    u32 p = d->triangles[e], q = d->triangles[f];
+    u32 x = d->triangles[a2], y = d->triangles[b2];
+    u32 ta1 = d->halfedges[a1], ta2 = d->halfedges[a2];
+    u32 tb1 = d->halfedges[b1], tb2 = d->halfedges[b2];
+    u8 ca1 = d->constrained[a1], ca2 = d->constrained[a2];
+    u8 cb1 = d->constrained[b1], cb2 = d->constrained[b2];
+
+    // (y, x, p) and (x, y, q).
+    d->triangles[e] = y;
+    d->triangles[a1] = x;
+    d->triangles[a2] = p;
+    d->triangles[f] = x;
+    d->triangles[b1] = y;
+    d->triangles[b2] = q;
+    delaunay_link(d, a1, ta2);
+    delaunay_link(d, a2, tb1);
+    delaunay_link(d, b1, tb2);
+    delaunay_link(d, b2, ta1);
+    d->constrained[a1] = ca2;
+    d->constrained[a2] = cb1;
+    d->constrained[b1] = cb2;
+    d->constrained[b2] = ca1;
+    if (p != DELAUNAY_INFINITE) {
+        d->vertex_edge[p] = a2;
+    }
+    if (q != DELAUNAY_INFINITE) {
+        d->vertex_edge[q] = b2;
+    }
+    if (x != DELAUNAY_INFINITE) {
+        d->vertex_edge[x] = a1;
+    }
+    if (y != DELAUNAY_INFINITE) {
+        d->vertex_edge[y] = b1;
+    }
+}
+
+// Restores the Delaunay property around a new vertex by flipping the
+// edges opposite it, starting from the ones on the stack.
+static void delaunay_legalize(delaunay* d, u32* stack, u32 top) {
+    while (top > 0) {
+        u32 e = stack[--top];
+        u32 f = d->halfedges[e];
+        u32 a2 = delaunay_prev(e);
+        if (d->constrained[e]
+                || !delaunay_conflict(d, d->triangles[e], d->triangles[f], d->triangles[a2],
+                    d->triangles[delaunay_prev(f)])) {
+            continue;
+        }
+        delaunay_flip(d, e);
+        // The apex now sits at the start of a1 and b0; the edges facing
+        // it are a2 and b1.
+        stack[top++] = a2;
+        stack[top++] = delaunay_next(f);
+    }
+}
+
+
+/*
+ * ==== INSERTION =======
+*/
+
+// Walks from the last triangle towards p, crossing any edge p lies
+// beyond. Stops in the triangle holding p, or in the ghost triangle
+// beyond the hull edge it crossed. Returns the kind of hit and, in *e,
+// the triangle's first half-edge, the edge p lies on, or a half-edge
+// leaving the vertex p coincides with.
+static u32 delaunay_locate(const delaunay* d, const point2 p, u32* e) {
+    const point2* v = d->points;
+    u32 t = d->last;
+    if (delaunay_is_ghost(d, t)) {
+        // Step over the hull edge, the one not touching infinity.
+        for (u32 i = 0; i < 3; ++i) {
+            if (d->triangles[t * 3 + i] != DELAUNAY_INFINITE
+                    && d->triangles[t * 3 + (i + 1) % 3] != DELAUNAY_INFINITE) {
+                t = d->halfedges[t * 3 + i] / 3;
+                break;
+            }
+        }
+    }
+    u32 entry = 0;
+    for (;;) {
+        u32 zeros = 0, zero_edge = 0;
+        b32 moved = 0;
+        for (u32 k = 0; k < 3; ++k) {
+            u32 edge = t * 3 + (entry + k) % 3;
+            f64 side = orient2d(v[d->triangles[edge]], v[d->triangles[delaunay_next(edge)]], p);
+            if (side < 0.0) {
+                u32 twin = d->halfedges[edge];
+                t = twin / 3;
+                entry = twin % 3 + 1;
+                if (delaunay_is_ghost(d, t)) {
+                    *e = t * 3;
+                    return DELAUNAY_IN_TRIANGLE;
+                }
+                moved = 1;
+                break;
+            }
+            if (side == 0.0) {
+                zero_edge = zeros ? (edge == delaunay_next(zero_edge) ? edge : zero_edge) : edge;
+                ++zeros;
+            }
+        }
+        if (moved) {
+            continue;
+        }
+        if (zeros == 0) {
+            *e = t * 3;
+            return DELAUNAY_IN_TRIANGLE;
+        }
+        if (zeros == 1) {
+            *e = zero_edge;
+            return DELAUNAY_ON_EDGE;
+        }
+        // On two edges: the vertex they share, which starts the later one.
+        *e = zero_edge;
+        return DELAUNAY_ON_VERTEX;
+    }
+}
+
+// Splits the triangle of half-edge 3t into three around vertex p.
+static void delaunay_split_triangle(delaunay* d, const u32 t, const u32 p, u32* stack) {
+    u32 a = d->triangles[t * 3], b = d->triangles[t * 3 + 1], c = d->triangles[t * 3 + 2];
+    u32 tb = d->halfedges[t * 3 + 1], tc = d->halfedges[t * 3 + 2];
+    u32 n1 = delaunay_add(d, b, c, p);
+    u32 n2 = delaunay_add(d, c, a, p);
+    delaunay_set(d, t, a, b, p);
+    delaunay_link(d, n1 * 3, tb);
+    delaunay_link(d, n2 * 3, tc);
+    delaunay_link(d, t * 3 + 1, n1 * 3 + 2);
+    delaunay_link(d, n1 * 3 + 1, n2 * 3 + 2);
+    delaunay_link(d, n2 * 3 + 1, t * 3 + 2);
+    d->vertex_edge[p] = t * 3 + 2;
+    if (a != DELAUNAY_INFINITE) {
+        d->vertex_edge[a] = t * 3;
+    }
+    if (b != DELAUNAY_INFINITE) {
+        d->vertex_edge[b] = n1 * 3;
+    }
+    if (c != DELAUNAY_INFINITE) {
+        d->vertex_edge[c] = n2 * 3;
+    }
+    stack[0] = t * 3;
+    stack[1] = n1 * 3;
+    stack[2] = n2 * 3;
+    d->last = t;
+    delaunay_legalize(d, stack, 3);
+}
+
+// Splits the two triangles on half-edge e (a -> b) at vertex p on it.
+static void delaunay_split_edge(delaunay* d, const u32 e, const u32 p, u32* stack) {
+    u32 f = d->halfedges[e];
+    u32 t = e / 3, u = f / 3;
+    u32 a = d->triangles[e], b = d->triangles[f];
+    u32 c = d->triangles[delaunay_prev(e)], dv = d->triangles[delaunay_prev(f)];
+    u32 tbc = d->halfedges[delaunay_next(e)], tca = d->halfedges[delaunay_prev(e)];
+    u32 tad = d->halfedges[delaunay_next(f)], tdb = d->halfedges[delaunay_prev(f)];
+
+    // (a, p, c), (p, b, c), (b, p, d) and (p, a, d).
+    delaunay_set(d, t, a, p, c);
+    u32 n1 = delaunay_add(d, p, b, c);
+    delaunay_set(d, u, b, p, dv);
+    u32 n2 = delaunay_add(d, p, a, dv);
+    delaunay_link(d, t * 3 + 2, tca);
+    delaunay_link(d, n1 * 3 + 1, tbc);
+    delaunay_link(d, u * 3 + 2, tdb);
+    delaunay_link(d, n2 * 3 + 1, tad);
+    delaunay_link(d, t * 3, n2 * 3);
+    delaunay_link(d, u * 3, n1 * 3);
+    delaunay_link(d, t * 3 + 1, n1 * 3 + 2);
+    delaunay_link(d, u * 3 + 1, n2 * 3 + 2);
+    d->vertex_edge[p] = t * 3 + 1;
+    if (a != DELAUNAY_INFINITE) {
+        d->vertex_edge[a] = t * 3;
+    }
+    if (b != DELAUNAY_INFINITE) {
+        d->vertex_edge[b] = u * 3;
+    }
+    if (c != DELAUNAY_INFINITE) {
+        d->vertex_edge[c] = t * 3 + 2;
+    }
+    if (dv != DELAUNAY_INFINITE) {
+        d->vertex_edge[dv] = u * 3 + 2;
+    }
+    stack[0] = t * 3 + 2;
+    stack[1] = n1 * 3 + 1;
+    stack[2] = u * 3 + 2;
+    stack[3] = n2 * 3 + 1;
+    d->last = t;
+    delaunay_legalize(d, stack, 4);
+}
+
+// Stable LSD radix sort of order by keys, 8 bits per pass.
+static void delaunay_sort(u32* keys, u32* order, u32* tmp_keys, u32* tmp_order, const u32 n) {
+    for (u32 shift = 0; shift < 32; shift += 8) {
+        u32 counts[256] = {0};
+        for (u32 i = 0; i < n; ++i) {
+            ++counts[(keys[i] >> shift) & 0xFF];
+        }
+        u32 sum = 0;
+        for (u32 i = 0; i < 256; ++i) {
+            u32 c = counts[i];
+            counts[i] = sum;
+            sum += c;
+        }
+        for (u32 i = 0; i < n; ++i) {
+            u32 slot = counts[(keys[i] >> shift) & 0xFF]++;
+            tmp_keys[slot] = keys[i];
+            tmp_order[slot] = order[i];
+        }
+        for (u32 i = 0; i < n; ++i) {
+            keys[i] = tmp_keys[i];
+            order[i] = tmp_order[i];
+        }
+    }
+}
+
+// Triangulates points, which must stay alive while d is used. Points are
+// inserted in Hilbert order, so each walk starts next to its target and
+// is short. Duplicates are merged, see vertex_map. Returns 0 when count
+// exceeds the capacity. When every point is on one line there are no
+// triangles.
+b32 delaunay_build(delaunay* d, const point2* points, const u32 count) {
+    if (count > d->point_capacity) {
+        return 0;
+    }
+    d->points = points;
+    d->point_count = count;
+    d->triangle_count = 0;
+    d->last = 0;
+    if (count < 3) {
+        for (u32 i = 0; i < count; ++i) {
+            d->vertex_map[i] = i;
+            d->vertex_edge[i] = DELAUNAY_NONE;
+        }
+        return 1;
+    }
+
+    point2 lo = points[0], hi = points[0];
+    for (u32 i = 1; i < count; ++i) {
+        lo.x = points[i].x < lo.x ? points[i].x : lo.x;
+        lo.y = points[i].y < lo.y ? points[i].y : lo.y;
+        hi.x = points[i].x > hi.x ? points[i].x : hi.x;
+        hi.y = points[i].y > hi.y ? points[i].y : hi.y;
+    }
+    // A square box keeps the curve's cells square.
+    f32 extent = hi.x - lo.x > hi.y - lo.y ? hi.x - lo.x : hi.y - lo.y;
+    hi.x = lo.x + extent;
+    hi.y = lo.y + extent;
+    hilbert2_encode_points(points, count, lo, hi, d->keys);
+    for (u32 i = 0; i < count; ++i) {
+        d->order[i] = i;
+        d->vertex_map[i] = i;
+        d->vertex_edge[i] = DELAUNAY_NONE;
+    }
+    delaunay_sort(d->keys, d->order, d->scratch, d->scratch + count, count);
+
+    // First triangle: the first point, the next distinct one, and the next
+    // one off their line.
+    u32 a = d->order[0], b = DELAUNAY_NONE, c = DELAUNAY_NONE;
+    u32 bi = 0, ci = 0;
+    f64 side = 0.0;
+    for (u32 i = 1; i < count && b == DELAUNAY_NONE; ++i) {
+        point2 q = points[d->order[i]];
+        if (q.x != points[a].x || q.y != points[a].y) {
+            b = d->order[i];
+            bi = i;
+        }
+    }
+    for (u32 i = bi + 1; i < count && b != DELAUNAY_NONE && c == DELAUNAY_NONE; ++i) {
+        side = orient2d(points[a], points[b], points[d->order[i]]);
+        if (side != 0.0) {
+            c = d->order[i];
+            ci = i;
+        }
+    }
+    if (c == DELAUNAY_NONE) {
+        return 1;
+    }
+    if (side < 0.0) {
+        u32 swap = b;
+        b = c;
+        c = swap;
+    }
+    u32 t = delaunay_add(d, a, b, c);
+    u32 g0 = delaunay_add(d, b, a, DELAUNAY_INFINITE);
+    u32 g1 = delaunay_add(d, c, b, DELAUNAY_INFINITE);
+    u32 g2 = delaunay_add(d, a, c, DELAUNAY_INFINITE);
+    delaunay_link(d, t * 3, g0 * 3);
+    delaunay_link(d, t * 3 + 1, g1 * 3);
+    delaunay_link(d, t * 3 + 2, g2 * 3);
+    delaunay_link(d, g0 * 3 + 1, g2 * 3 + 2);
+    delaunay_link(d, g0 * 3 + 2, g1 * 3 + 1);
+    delaunay_link(d, g1 * 3 + 2, g2 * 3 + 1);
+    d->vertex_edge[a] = t * 3;
+    d->vertex_edge[b] = t * 3 + 1;
+    d->vertex_edge[c] = t * 3 + 2;
+    d->last = t;
+
+    // The keys are spent; their space is the legalize stack, which holds
+    // at most the edges around one vertex.
+    u32* stack = d->keys;
+    for (u32 i = 1; i < count; ++i) {
+        if (i == bi || i == ci) {
+            continue;
+        }
+        u32 p = d->order[i];
+        u32 e;
+        u32 hit = delaunay_locate(d, points[p], &e);
+        if (hit == DELAUNAY_ON_VERTEX) {
+            d->vertex_map[p] = d->triangles[e];
+        } else if (hit == DELAUNAY_ON_EDGE) {
+            delaunay_split_edge(d, e, p, stack);
+        } else {
+            delaunay_split_triangle(d, e / 3, p, stack);
+        }
+    }
+    return 1;
+}
+
+
+/*
+ * ==== CONSTRAINTS =======
+*/
+
+// The half-edge from a to b, or DELAUNAY_NONE.
+static u32 delaunay_find_edge(const delaunay* d, const u32 a, const u32 b) {
+    u32 start = d->vertex_edge[a];
+    u32 e = start;
+    do {
+        if (d->triangles[delaunay_next(e)] == b) {
+            return e;
+        }
+        e = d->halfedges[delaunay_prev(e)];
+    } while (e != start);
+    return DELAUNAY_NONE;
+}
+
+// Constraint segments waiting to be inserted, split at vertices they pass
+// through, and the edges they cross, as vertex pairs.
+typedef struct delaunay_lists {
+    u32* segments;
+    u32 segment_count;
+    u32* queue;
+    u32 queue_capacity;
+    u32 head;
+    u32 tail;
+    u32* fresh;
+    u32 fresh_count;
+} delaunay_lists;
+
+static void delaunay_push(delaunay_lists* l, const u32 a, const u32 b) {
+    l->queue[(l->tail % l->queue_capacity) * 2] = a;
+    l->queue[(l->tail % l->queue_capacity) * 2 + 1] = b;
+    ++l->tail;
+}
+
+// Finds the edges segment u -> v crosses and queues them. When the
+// segment runs through a vertex w, queues nothing and returns w instead,
+// so the caller splits it there. Returns DELAUNAY_NONE otherwise, or u
+// when the segment crosses a constrained edge.
+static u32 delaunay_crossings(delaunay* d, delaunay_lists* l, const u32 u, const u32 v) {
+    const point2* pts = d->points;
+    point2 pu = pts[u], pv = pts[v];
+    // The triangle around u the segment leaves through.
+    u32 start = d->vertex_edge[u];
+    u32 e = start, cross = DELAUNAY_NONE;
+    do {
+        u32 a = d->triangles[delaunay_next(e)], b = d->triangles[delaunay_prev(e)];
+        if (a != DELAUNAY_INFINITE) {
+            f64 sa = orient2d(pu, pv, pts[a]);
+            if (sa == 0.0 && (pts[a].x - pu.x) * (pv.x - pu.x) + (pts[a].y - pu.y) * (pv.y - pu.y) > 0.0f) {
+                return a;
+            }
+            if (sa < 0.0 && b != DELAUNAY_INFINITE && orient2d(pu, pv, pts[b]) > 0.0) {
+                cross = delaunay_next(e);
+                break;
+            }
+        }
+        e = d->halfedges[delaunay_prev(e)];
+    } while (e != start);
+    if (cross == DELAUNAY_NONE) {
+        return u;
+    }
+
+    // Cross triangles until v, the crossed edge always running from the
+    // right of the segment to its left.
+    l->head = l->tail = 0;
+    for (;;) {
+        if (d->constrained[cross]) {
+            return u;
+        }
+        delaunay_push(l, d->triangles[cross], d->triangles[delaunay_next(cross)]);
+        u32 f = d->halfedges[cross];
+        u32 c = d->triangles[delaunay_prev(f)];
+        if (c == v) {
+            return DELAUNAY_NONE;
+        }
+        f64 sc = orient2d(pu, pv, pts[c]);
+        if (sc == 0.0) {
+            return c;
+        }
+        cross = sc < 0.0 ? delaunay_prev(f) : delaunay_next(f);
+    }
+}
+
+// Flips the queued crossing edges out of the way until u - v is an edge
+// (Sloan's method), then flips the new edges back to Delaunay where the
+// constraint allows.
+static void delaunay_insert_segment(delaunay* d, delaunay_lists* l, const u32 u, const u32 v) {
+    const point2* pts = d->points;
+    point2 pu = pts[u], pv = pts[v];
+    l->fresh_count = 0;
+    while (l->head != l->tail) {
+        u32 a = l->queue[(l->head % l->queue_capacity) * 2];
+        u32 b = l->queue[(l->head % l->queue_capacity) * 2 + 1];
+        ++l->head;
+        u32 e = delaunay_find_edge(d, a, b);
+        u32 f = d->halfedges[e];
+        u32 x = d->triangles[delaunay_prev(e)], y = d->triangles[delaunay_prev(f)];
+        // Only a strictly convex quad can be flipped; try it again later.
+        f64 sa = orient2d(pts[x], pts[y], pts[a]), sb = orient2d(pts[x], pts[y], pts[b]);
+        if (!((sa > 0.0 && sb < 0.0) || (sa < 0.0 && sb > 0.0))) {
+            delaunay_push(l, a, b);
+            continue;
+        }
+        delaunay_flip(d, e);
+        f64 sx = x == u || x == v ? 0.0 : orient2d(pu, pv, pts[x]);
+        f64 sy = y == u || y == v ? 0.0 : orient2d(pu, pv, pts[y]);
+        if ((sx > 0.0 && sy < 0.0) || (sx < 0.0 && sy > 0.0)) {
+            delaunay_push(l, x, y);
+        } else {
+            l->fresh[l->fresh_count * 2] = x;
+            l->fresh[l->fresh_count * 2 + 1] = y;
+            ++l->fresh_count;
+        }
+    }
+    u32 e = delaunay_find_edge(d, u, v);
+    d->constrained[e] = 1;
+    d->constrained[d->halfedges[e]] = 1;
+
+    b32 flipped = 1;
+    while (flipped) {
+        flipped = 0;
+        for (u32 i = 0; i < l->fresh_count; ++i) {
+            u32 a = l->fresh[i * 2], b = l->fresh[i * 2 + 1];
+            u32 edge = delaunay_find_edge(d, a, b);
+            if (edge == DELAUNAY_NONE || d->constrained[edge]) {
+                continue;
+            }
+            u32 f = d->halfedges[edge];
+            u32 x = d->triangles[delaunay_prev(edge)], y = d->triangles[delaunay_prev(f)];
+            if (delaunay_conflict(d, a, b, x, y)) {
+                delaunay_flip(d, edge);
+                l->fresh[i * 2] = x;
+                l->fresh[i * 2 + 1] = y;
+                flipped = 1;
+            }
+        }
+    }
+}
+
+// Forces the segments between the vertex pairs in edges into the
+// triangulation, keeping it Delaunay everywhere else. A segment through
+// other vertices is split at them. Returns 0 when a segment crosses an
+// earlier one or an endpoint is out of range; the segments before it
+// are in.
+b32 delaunay_constrain(delaunay* d, const u32* edges, const u32 edge_count) {
+    if (d->triangle_count == 0) {
+        return edge_count == 0;
+    }
+    u32 capacity = 3 * delaunay_triangle_capacity(d->point_capacity);
+    delaunay_lists l;
+    l.queue = d->scratch;
+    l.queue_capacity = capacity / 2;
+    l.head = l.tail = 0;
+    l.fresh = d->scratch + capacity;
+    l.segments = d->keys;
+    for (u32 i = 0; i < edge_count; ++i) {
+        if (edges[i * 2] >= d->point_count || edges[i * 2 + 1] >= d->point_count) {
+            return 0;
+        }
+        l.segments[0] = d->vertex_map[edges[i * 2]];
+        l.segments[1] = d->vertex_map[edges[i * 2 + 1]];
+        l.segment_count = 1;
+        while (l.segment_count > 0) {
+            --l.segment_count;
+            u32 u = l.segments[l.segment_count * 2], v = l.segments[l.segment_count * 2 + 1];
+            if (u == v) {
+                continue;
+            }
+            u32 e = delaunay_find_edge(d, u, v);
+            if (e != DELAUNAY_NONE) {
+                d->constrained[e] = 1;
+                d->constrained[d->halfedges[e]] = 1;
+                continue;
+            }
+            u32 w = delaunay_crossings(d, &l, u, v);
+            if (w == u) {
+                return 0;
+            }
+            if (w != DELAUNAY_NONE) {
+                // Each split leaves one more piece pending, at most one
+                // per vertex on the line.
+                l.segments[l.segment_count * 2] = w;
+                l.segments[l.segment_count * 2 + 1] = v;
+                l.segments[l.segment_count * 2 + 2] = u;
+                l.segments[l.segment_count * 2 + 3] = w;
+                l.segment_count += 2;
+                continue;
+            }
+            delaunay_insert_segment(d, &l, u, v);
+        }
+    }
+    return 1;
+}
+
+
+/*
+ * ==== TILES =======
+*/
+
+typedef struct delaunay_tiles_job {
+    delaunay* tiles;
+    const point2* const* points;
+    const u32* point_counts;
+    const u32* const* edges;
+    const u32* edge_counts;
+    u32 failed;
+} delaunay_tiles_job;
+
+static void delaunay_tiles_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    delaunay_tiles_job* job = (delaunay_tiles_job*)ctx;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        b32 ok = delaunay_build(&job->tiles[i], job->points[i], job->point_counts[i]);
+        if (ok && job->edges && job->edges[i]) {
+            ok = delaunay_constrain(&job->tiles[i], job->edges[i], job->edge_counts[i]);
+        }
+        if (!ok) {
+            atomic_add_u32(&job->failed, 1);
+        }
+    }
+}
+
+// Builds independent tiles in parallel, one task per tile, each with its
+// own points and optional constraints (edges may be null, as may any of
+// its entries). Every tile must have been created large enough. Returns
+// 0 when any tile failed.
+b32 delaunay_build_tiles(delaunay* tiles, const point2* const* points, const u32* point_counts,
+        const u32* const* edges, const u32* edge_counts, const u32 tile_count) {
+    delaunay_tiles_job job;
+    job.tiles = tiles;
+    job.points = points;
+    job.point_counts = point_counts;
+    job.edges = edges;
+    job.edge_counts = edge_counts;
+    job.failed = 0;
+    parallel_for(tile_count, 1, delaunay_tiles_task, &job);
+    return job.failed == 0;
+}
+
+#endif
+#endif
@@ -20,7 +20,19 @@
 #define PLATFORM 4
 #endif
 
+// Read-only view of a whole file mapped into memory. Platforms without a
+// known mapping API read the file into a heap buffer instead.
+typedef struct mapped_file {
+    void* data;
+    u64 size;
+    void* file_handle;   // Windows only
+    void* map_handle;    // Windows only
+} mapped_file;
+
 void read_file(b8* filePath, u64 bufLen, u8* buf);
+b32 write_file(const char* path, const void* data, u64 size);
+b32 map_file(mapped_file* f, const char* path);
+void unmap_file(mapped_file* f);
 
 #ifdef YS_FILE_IMPLEMENTATION
 
@@ -114,6 +126,151 @@ void read_file(b8* filePath, u64 bufLen, u8* buf) {
     read_file_windows(filePath, buflen,  buf);
     #endif
 }
+
+b32 write_file(const char* path, const void* data, u64 size) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Error opening file %s for write\n", path);
+        return 0;
+    }
+    b32 ok = fwrite(data, 1, size, f) == size;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Error writing file %s\n", path);
+    }
+    return ok;
+}
+
+#if PLATFORM == 0
+b32 map_file(mapped_file* f, const char* path) {
+    f->data = 0;
+    f->size = 0;
+    f->file_handle = 0;
+    f->map_handle = 0;
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        DisplayError(TEXT("CreateFile"));
+        return 0;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    if (!mapping) {
+        DisplayError(TEXT("CreateFileMapping"));
+        CloseHandle(file);
+        return 0;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        DisplayError(TEXT("MapViewOfFile"));
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return 0;
+    }
+    f->data = data;
+    f->size = (u64)size.QuadPart;
+    f->file_handle = file;
+    f->map_handle = mapping;
+    return 1;
+}
+
+void unmap_file(mapped_file* f) {
+    if (f->data) {
+        UnmapViewOfFile(f->data);
+        CloseHandle((HANDLE)f->map_handle);
+        CloseHandle((HANDLE)f->file_handle);
+    }
+    f->data = 0;
+    f->size = 0;
+}
+#elif PLATFORM != 4
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+b32 map_file(mapped_file* f, const char* path) {
+    f->data = 0;
+    f->size = 0;
+    f->file_handle = 0;
+    f->map_handle = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening file %s\n", path);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void* data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error mapping file %s\n", path);
+        return 0;
+    }
+    f->data = data;
+    f->size = (u64)st.st_size;
+    return 1;
+}
+
+void unmap_file(mapped_file* f) {
+    if (f->data) {
+        munmap(f->data, (size_t)f->size);
+    }
+    f->data = 0;
+    f->size = 0;
+}
+#else
+#include <stdlib.h>
+
+// No mapping API known here: read the whole file into a heap buffer.
+b32 map_file(mapped_file* f, const char* path) {
+    f->data = 0;
+    f->size = 0;
+    f->file_handle = 0;
+    f->map_handle = 0;
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening file %s\n", path);
+        return 0;
+    }
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    if (size <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return 0;
+    }
+    void* data = malloc((size_t)size);
+    if (!data || fread(data, 1, (size_t)size, file) != (size_t)size) {
+        fprintf(stderr, "Error reading file %s\n", path);
+        free(data);
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    f->data = data;
+    f->size = (u64)size;
+    return 1;
+}
+
+void unmap_file(mapped_file* f) {
+    free(f->data);
+    f->data = 0;
+    f->size = 0;
+}
+#endif
 #endif
 
 #endif
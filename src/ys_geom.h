@@ -1,6 +1,7 @@
 #ifndef YS_GEOM_H
 #define YS_GEOM_H
 
+#include <float.h>
 #include "ys_math.h"
 
 typedef struct ray2 {
@@ -18,4 +19,1594 @@ typedef struct ray4 {
     vec4 dir;
 } ray4;
 
+typedef struct aabb3 {
+    point3 min;
+    point3 max;
+} aabb3;
+
+typedef struct ray3_hit {
+    f32 t;
+    f32 u;      // barycentric coordinates of the hit
+    f32 v;
+    u32 prim;
+} ray3_hit;
+
+typedef struct sphere {
+    point3 center;
+    f32 radius;
+} sphere;
+
+// Points p with dot(normal, p) == d.
+typedef struct plane {
+    vec3 normal;
+    f32 d;
+} plane;
+
+// Six planes with normals pointing inside: left, right, bottom, top,
+// near, far. A point is inside when dot(normal, p) >= d for all of them.
+typedef struct frustum {
+    plane planes[6];
+} frustum;
+
+typedef struct disk {
+    point3 center;
+    vec3 normal;
+    f32 radius;
+} disk;
+
+typedef struct capsule {
+    point3 a;
+    point3 b;
+    f32 radius;
+} capsule;
+
+// Structure of arrays views used by the batch queries. The arrays are
+// owned by the caller.
+typedef struct sphere_soa {
+    f32* x;
+    f32* y;
+    f32* z;
+    f32* radius;
+    u32 count;
+} sphere_soa;
+
+typedef struct plane_soa {
+    f32* nx;
+    f32* ny;
+    f32* nz;
+    f32* d;
+    u32 count;
+} plane_soa;
+
+typedef struct disk_soa {
+    f32* x;
+    f32* y;
+    f32* z;
+    f32* nx;
+    f32* ny;
+    f32* nz;
+    f32* radius;
+    u32 count;
+} disk_soa;
+
+typedef struct capsule_soa {
+    f32* ax;
+    f32* ay;
+    f32* az;
+    f32* bx;
+    f32* by;
+    f32* bz;
+    f32* radius;
+    u32 count;
+} capsule_soa;
+
+typedef struct point3_soa {
+    f32* x;
+    f32* y;
+    f32* z;
+    u32 count;
+} point3_soa;
+
+typedef struct triangle_soa {
+    f32* ax;
+    f32* ay;
+    f32* az;
+    f32* bx;
+    f32* by;
+    f32* bz;
+    f32* cx;
+    f32* cy;
+    f32* cz;
+    u32 count;
+} triangle_soa;
+
+typedef struct segment_soa {
+    f32* ax;
+    f32* ay;
+    f32* az;
+    f32* bx;
+    f32* by;
+    f32* bz;
+    u32 count;
+} segment_soa;
+
+// Oriented box. Column i of `axes` is the unit local axis i, scaled by
+// half.e[i] on each side of the center.
+typedef struct obb {
+    point3 center;
+    mat3 axes;
+    vec3 half;
+} obb;
+
+// Convex hull given by its points, owned by the caller.
+typedef struct hull {
+    const point3* points;
+    u32 count;
+} hull;
+
+enum { CONVEX_SPHERE, CONVEX_BOX, CONVEX_CAPSULE, CONVEX_HULL, CONVEX_OBB };
+
+// Shapes the GJK and EPA queries accept, tagged by `type`.
+typedef struct convex {
+    u32 type;
+    union {
+        sphere s;
+        aabb3 box;
+        capsule cap;
+        hull h;
+        obb o;
+    };
+} convex;
+
+// Penetration of two convex shapes. Moving b by normal * depth separates
+// them; point_a and point_b are the deepest points on each shape.
+typedef struct contact3 {
+    vec3 normal;
+    f32 depth;
+    point3 point_a;
+    point3 point_b;
+} contact3;
+
+
+/*
+ * === AABB3 INTERFACE ===
+*/
+aabb3 aabb3_empty(void);
+aabb3 aabb3_union(const aabb3 a, const aabb3 b);
+aabb3 aabb3_grow(const aabb3 a, const point3 p);
+aabb3 aabb3_triangle(const point3 p0, const point3 p1, const point3 p2);
+point3 aabb3_center(const aabb3 a);
+vec3 aabb3_extent(const aabb3 a);
+f32 aabb3_area(const aabb3 a);
+b32 aabb3_overlaps(const aabb3 a, const aabb3 b);
+b32 aabb3_triangle_overlaps(const aabb3 box, const point3 p0, const point3 p1, const point3 p2);
+
+
+/*
+ * === FRUSTUM INTERFACE ===
+*/
+frustum frustum_from_mat4(const mat4 view_proj);
+b32 frustum_aabb3(const frustum* f, const aabb3 box);
+
+
+/*
+ * === RAY3 INTERFACE ===
+*/
+vec3 ray3_inv_dir(const ray3 r);
+point3 ray3_at(const ray3 r, const f32 t);
+b32 ray3_aabb3(const ray3 r, const vec3 inv_dir, const aabb3 box, const f32 t_max, f32* t_near);
+b32 ray3_triangle(const ray3 r, const point3 p0, const point3 p1, const point3 p2, f32* t, f32* u, f32* v);
+b32 ray3_sphere(const ray3 r, const sphere s, const f32 t_max, f32* t);
+b32 ray3_plane(const ray3 r, const plane p, const f32 t_max, f32* t);
+b32 ray3_disk(const ray3 r, const disk d, const f32 t_max, f32* t);
+b32 ray3_capsule(const ray3 r, const capsule c, const f32 t_max, f32* t);
+
+
+/*
+ * === RAY3 BATCH INTERFACE ===
+*/
+u32 ray3_spheres(const ray3 r, const sphere_soa* s, const f32 t_max, u32* mask, f32* t);
+u32 ray3_planes(const ray3 r, const plane_soa* p, const f32 t_max, u32* mask, f32* t);
+u32 ray3_disks(const ray3 r, const disk_soa* d, const f32 t_max, u32* mask, f32* t);
+u32 ray3_capsules(const ray3 r, const capsule_soa* c, const f32 t_max, u32* mask, f32* t);
+
+
+/*
+ * === CLOSEST POINT INTERFACE ===
+*/
+point3 closest_point_triangle(const point3 p, const point3 a, const point3 b, const point3 c);
+point3 closest_point_triangle_bary(const point3 p, const point3 a, const point3 b, const point3 c, f32 bary[3]);
+f32 segment_segment_closest(const point3 p1, const point3 q1, const point3 p2, const point3 q2, f32* s, f32* t);
+point3 closest_point_aabb3(const point3 p, const aabb3 box);
+f32 point_aabb3_dist_sq(const point3 p, const aabb3 box);
+
+
+/*
+ * === CLOSEST POINT BATCH INTERFACE ===
+*/
+void closest_points_triangles(const point3_soa* p, const triangle_soa* tri, point3_soa* out, f32* dist_sq);
+void segments_closest(const segment_soa* a, const segment_soa* b, f32* s, f32* t, f32* dist_sq);
+void points_aabb3_dist_sq(const point3_soa* p, const aabb3 box, f32* dist_sq);
+
+
+/*
+ * === CONVEX INTERFACE ===
+*/
+point3 convex_support(const convex* c, const vec3 dir);
+f32 gjk_distance(const convex* a, const convex* b, point3* point_a, point3* point_b);
+b32 gjk_overlap(const convex* a, const convex* b);
+u32 gjk_overlap8(const convex* a, const convex* b, const u32 count);
+b32 epa_penetration(const convex* a, const convex* b, contact3* c);
+
+
+/*
+ * === OBB INTERFACE ===
+*/
+u32 obb_separating_axis(const obb* a, const obb* b, const u32 first);
+b32 obb_overlap(const obb* a, const obb* b);
+u32 obb_overlap8(const obb* a, const obb* b, const u32 count);
+
+
+#ifdef YS_GEOM_IMPLEMENTATION
+
+/*
+ * ==== AABB3 IMPLEMENTATION =======
+*/
+
+// An empty box has min > max on every axis so that growing it by any
+// point or box yields exactly that point or box.
+inline aabb3 aabb3_empty(void) {
+    aabb3 r;
+    r.min.x = r.min.y = r.min.z = FLT_MAX;
+    r.max.x = r.max.y = r.max.z = -FLT_MAX;
+    return r;
+}
+
+inline aabb3 aabb3_union(const aabb3 a, const aabb3 b) {
+    aabb3 r;
+    r.min.x = a.min.x < b.min.x ? a.min.x : b.min.x;
+    r.min.y = a.min.y < b.min.y ? a.min.y : b.min.y;
+    r.min.z = a.min.z < b.min.z ? a.min.z : b.min.z;
+    r.max.x = a.max.x > b.max.x ? a.max.x : b.max.x;
+    r.max.y = a.max.y > b.max.y ? a.max.y : b.max.y;
+    r.max.z = a.max.z > b.max.z ? a.max.z : b.max.z;
+    return r;
+}
+
+inline aabb3 aabb3_grow(const aabb3 a, const point3 p) {
+    aabb3 r;
+    r.min.x = a.min.x < p.x ? a.min.x : p.x;
+    r.min.y = a.min.y < p.y ? a.min.y : p.y;
+    r.min.z = a.min.z < p.z ? a.min.z : p.z;
+    r.max.x = a.max.x > p.x ? a.max.x : p.x;
+    r.max.y = a.max.y > p.y ? a.max.y : p.y;
+    r.max.z = a.max.z > p.z ? a.max.z : p.z;
+    return r;
+}
+
+inline aabb3 aabb3_triangle(const point3 p0, const point3 p1, const point3 p2) {
+    aabb3 r = aabb3_empty();
+    r = aabb3_grow(r, p0);
+    r = aabb3_grow(r, p1);
+    r = aabb3_grow(r, p2);
+    return r;
+}
+
+inline point3 aabb3_center(const aabb3 a) {
+    point3 r;
+    r.x = (a.min.x + a.max.x) * 0.5f;
+    r.y = (a.min.y + a.max.y) * 0.5f;
+    r.z = (a.min.z + a.max.z) * 0.5f;
+    return r;
+}
+
+inline vec3 aabb3_extent(const aabb3 a) {
+    return vec3_sub(a.max, a.min);
+}
+
+// Surface area, used as the hit probability in SAH cost estimates.
+// Empty boxes report zero.
+inline f32 aabb3_area(const aabb3 a) {
+    vec3 e = aabb3_extent(a);
+    if (e.x < 0 || e.y < 0 || e.z < 0) {
+        return 0;
+    }
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+inline b32 aabb3_overlaps(const aabb3 a, const aabb3 b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x
+        && a.min.y <= b.max.y && a.max.y >= b.min.y
+        && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// Separating axis test of a triangle against a box (Akenine-Moller): the
+// triangle plane, the 9 cross products of the edges with the box axes and
+// the box faces. Touching counts as overlap. The plane goes first since
+// it rejects most of the boxes near a triangle in voxelization.
+inline b32 aabb3_triangle_overlaps(const aabb3 box, const point3 p0, const point3 p1, const point3 p2) {
+    point3 c = aabb3_center(box);
+    vec3 h = vec3_mul_s(aabb3_extent(box), 0.5f);
+    vec3 v[3] = {vec3_sub(p0, c), vec3_sub(p1, c), vec3_sub(p2, c)};
+    vec3 e[3] = {vec3_sub(v[1], v[0]), vec3_sub(v[2], v[1]), vec3_sub(v[0], v[2])};
+
+    vec3 n = vec3_cross(e[0], e[1]);
+    f32 r = h.x * fabsf(n.x) + h.y * fabsf(n.y) + h.z * fabsf(n.z);
+    if (fabsf(vec3_dot(n, v[0])) > r) {
+        return 0;
+    }
+    for (int i = 0; i < 3; ++i) {
+        f32 lo = v[0].e[i], hi = v[0].e[i];
+        for (int k = 1; k < 3; ++k) {
+            lo = v[k].e[i] < lo ? v[k].e[i] : lo;
+            hi = v[k].e[i] > hi ? v[k].e[i] : hi;
+        }
+        if (lo > h.e[i] || hi < -h.e[i]) {
+            return 0;
+        }
+    }
+    // Axis box_i x e_j. Two of the vertices project to the same value, so
+    // only the two distinct projections are compared.
+    for (int j = 0; j < 3; ++j) {
+        for (int i = 0; i < 3; ++i) {
+            int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+            vec3 a = {{0.0f, 0.0f, 0.0f}};
+            a.e[i1] = -e[j].e[i2];
+            a.e[i2] = e[j].e[i1];
+            f32 q0 = vec3_dot(a, v[j]);
+            f32 q1 = vec3_dot(a, v[(j + 2) % 3]);
+            f32 lo = q0 < q1 ? q0 : q1;
+            f32 hi = q0 < q1 ? q1 : q0;
+            f32 rad = h.e[i1] * fabsf(a.e[i1]) + h.e[i2] * fabsf(a.e[i2]);
+            if (lo > rad || hi < -rad) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+
+/*
+ * ==== FRUSTUM IMPLEMENTATION =======
+*/
+
+// Gribb-Hartmann plane extraction for a column vector view-projection
+// matrix with OpenGL style clip depth in [-w, w]. Planes are not
+// normalized, which is fine for inside tests.
+inline frustum frustum_from_mat4(const mat4 m) {
+    f32 rows[4][4] = {
+        {m.m00, m.m01, m.m02, m.m03},
+        {m.m10, m.m11, m.m12, m.m13},
+        {m.m20, m.m21, m.m22, m.m23},
+        {m.m30, m.m31, m.m32, m.m33},
+    };
+    frustum f;
+    for (int i = 0; i < 6; ++i) {
+        const f32* r = rows[i / 2];
+        f32 sign = i % 2 ? -1.0f : 1.0f;
+        f.planes[i].normal.x = rows[3][0] + sign * r[0];
+        f.planes[i].normal.y = rows[3][1] + sign * r[1];
+        f.planes[i].normal.z = rows[3][2] + sign * r[2];
+        f.planes[i].d = -(rows[3][3] + sign * r[3]);
+    }
+    return f;
+}
+
+// Conservative: 0 only when the box is fully outside one plane. Boxes
+// near frustum corners may be reported as visible.
+inline b32 frustum_aabb3(const frustum* f, const aabb3 box) {
+    for (int i = 0; i < 6; ++i) {
+        plane p = f->planes[i];
+        // Box corner furthest along the plane normal.
+        f32 x = p.normal.x >= 0 ? box.max.x : box.min.x;
+        f32 y = p.normal.y >= 0 ? box.max.y : box.min.y;
+        f32 z = p.normal.z >= 0 ? box.max.z : box.min.z;
+        if (p.normal.x * x + p.normal.y * y + p.normal.z * z < p.d) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/*
+ * ==== RAY3 IMPLEMENTATION =======
+*/
+
+// Reciprocal of the ray direction for slab tests. Zero components are
+// nudged to a tiny value so the slab math never sees 0 * inf.
+inline vec3 ray3_inv_dir(const ray3 r) {
+    vec3 inv;
+    for (int i = 0; i < 3; ++i) {
+        f32 d = r.dir.e[i];
+        if (d > -1e-12f && d < 1e-12f) {
+            d = d < 0 ? -1e-12f : 1e-12f;
+        }
+        inv.e[i] = 1.0f / d;
+    }
+    return inv;
+}
+
+inline point3 ray3_at(const ray3 r, const f32 t) {
+    return vec3_add(r.origin, vec3_mul_s(r.dir, t));
+}
+
+inline b32 ray3_aabb3(const ray3 r, const vec3 inv_dir, const aabb3 box, const f32 t_max, f32* t_near) {
+    f32 t0 = 0;
+    f32 t1 = t_max;
+    for (int i = 0; i < 3; ++i) {
+        f32 a = (box.min.e[i] - r.origin.e[i]) * inv_dir.e[i];
+        f32 b = (box.max.e[i] - r.origin.e[i]) * inv_dir.e[i];
+        if (a > b) {
+            f32 tmp = a;
+            a = b;
+            b = tmp;
+        }
+        t0 = a > t0 ? a : t0;
+        t1 = b < t1 ? b : t1;
+    }
+    *t_near = t0;
+    return t0 <= t1;
+}
+
+// Moller-Trumbore. Reports hits in front of the origin only; both faces
+// count as hits.
+inline b32 ray3_triangle(const ray3 r, const point3 p0, const point3 p1, const point3 p2, f32* t, f32* u, f32* v) {
+    vec3 e1 = vec3_sub(p1, p0);
+    vec3 e2 = vec3_sub(p2, p0);
+    vec3 p = vec3_cross(r.dir, e2);
+    f32 det = vec3_dot(e1, p);
+    if (det == 0) {
+        return 0;
+    }
+    f32 inv_det = 1.0f / det;
+    vec3 s = vec3_sub(r.origin, p0);
+    f32 bu = vec3_dot(s, p) * inv_det;
+    if (bu < 0 || bu > 1) {
+        return 0;
+    }
+    vec3 q = vec3_cross(s, e1);
+    f32 bv = vec3_dot(r.dir, q) * inv_det;
+    if (bv < 0 || bu + bv > 1) {
+        return 0;
+    }
+    f32 bt = vec3_dot(e2, q) * inv_det;
+    if (bt <= 0) {
+        return 0;
+    }
+    *t = bt;
+    *u = bu;
+    *v = bv;
+    return 1;
+}
+
+
+/*
+ * ==== ANALYTIC PRIMITIVES =======
+*/
+
+// The analytic tests report the first surface crossing in (0, t_max).
+// Rays that start inside a solid (sphere, capsule) hit at t = 0. The ray
+// direction does not need to be normalized.
+//
+// Each test is written once as a branch free kernel on plain floats and
+// shared by the scalar and the batch entry points, so the batch loops
+// vectorize and both forms always agree.
+
+static f32 ray3_sphere_kernel(const f32 ox, const f32 oy, const f32 oz,
+        const f32 dx, const f32 dy, const f32 dz,
+        const f32 cx, const f32 cy, const f32 cz, const f32 radius) {
+    f32 px = ox - cx;
+    f32 py = oy - cy;
+    f32 pz = oz - cz;
+    f32 a = dx * dx + dy * dy + dz * dz;
+    f32 b = px * dx + py * dy + pz * dz;
+    f32 c = px * px + py * py + pz * pz - radius * radius;
+    f32 h = b * b - a * c;
+    f32 t = (-b - SQRTF(h > 0 ? h : 0)) / a;
+    t = h >= 0 ? t : -1.0f;
+    return c <= 0 ? 0.0f : t;
+}
+
+static f32 ray3_plane_kernel(const f32 ox, const f32 oy, const f32 oz,
+        const f32 dx, const f32 dy, const f32 dz,
+        const f32 nx, const f32 ny, const f32 nz, const f32 d) {
+    f32 denom = nx * dx + ny * dy + nz * dz;
+    f32 t = (d - (nx * ox + ny * oy + nz * oz)) / (denom != 0 ? denom : 1.0f);
+    return denom != 0 ? t : -1.0f;
+}
+
+static f32 ray3_disk_kernel(const f32 ox, const f32 oy, const f32 oz,
+        const f32 dx, const f32 dy, const f32 dz,
+        const f32 cx, const f32 cy, const f32 cz,
+        const f32 nx, const f32 ny, const f32 nz, const f32 radius) {
+    f32 d = nx * cx + ny * cy + nz * cz;
+    f32 t = ray3_plane_kernel(ox, oy, oz, dx, dy, dz, nx, ny, nz, d);
+    f32 px = ox + dx * t - cx;
+    f32 py = oy + dy * t - cy;
+    f32 pz = oz + dz * t - cz;
+    return px * px + py * py + pz * pz <= radius * radius ? t : -1.0f;
+}
+
+// The capsule is the union of a finite cylinder and two end spheres, so
+// the first hit is the nearest of the three.
+static f32 ray3_capsule_kernel(const f32 ox, const f32 oy, const f32 oz,
+        const f32 dx, const f32 dy, const f32 dz,
+        const f32 ax, const f32 ay, const f32 az,
+        const f32 bx, const f32 by, const f32 bz, const f32 radius) {
+    f32 bax = bx - ax;
+    f32 bay = by - ay;
+    f32 baz = bz - az;
+    f32 oax = ox - ax;
+    f32 oay = oy - ay;
+    f32 oaz = oz - az;
+    f32 baba = bax * bax + bay * bay + baz * baz;
+    f32 bard = bax * dx + bay * dy + baz * dz;
+    f32 baoa = bax * oax + bay * oay + baz * oaz;
+    f32 rdoa = dx * oax + dy * oay + dz * oaz;
+    f32 oaoa = oax * oax + oay * oay + oaz * oaz;
+    f32 rdrd = dx * dx + dy * dy + dz * dz;
+
+    f32 a = baba * rdrd - bard * bard;
+    f32 b = baba * rdoa - baoa * bard;
+    f32 c = baba * oaoa - baoa * baoa - radius * radius * baba;
+    f32 h = b * b - a * c;
+    f32 t = (-b - SQRTF(h > 0 ? h : 0)) / (a > 0 ? a : 1.0f);
+    f32 y = baoa + t * bard;
+    t = (a > 0 && h >= 0 && y > 0 && y < baba) ? t : FLT_MAX;
+
+    f32 ta = ray3_sphere_kernel(ox, oy, oz, dx, dy, dz, ax, ay, az, radius);
+    f32 tb = ray3_sphere_kernel(ox, oy, oz, dx, dy, dz, bx, by, bz, radius);
+    ta = ta >= 0 ? ta : FLT_MAX;
+    tb = tb >= 0 ? tb : FLT_MAX;
+    t = ta < t ? ta : t;
+    t = tb < t ? tb : t;
+
+    // Inside the cylinder part but outside both end spheres.
+    f32 s = baoa / (baba > 0 ? baba : 1.0f);
+    s = s < 0 ? 0 : s > 1 ? 1 : s;
+    f32 qx = oax - bax * s;
+    f32 qy = oay - bay * s;
+    f32 qz = oaz - baz * s;
+    t = qx * qx + qy * qy + qz * qz <= radius * radius ? 0.0f : t;
+    return t < FLT_MAX ? t : -1.0f;
+}
+
+inline b32 ray3_sphere(const ray3 r, const sphere s, const f32 t_max, f32* t) {
+    *t = ray3_sphere_kernel(r.origin.x, r.origin.y, r.origin.z, r.dir.x, r.dir.y, r.dir.z,
+        s.center.x, s.center.y, s.center.z, s.radius);
+    return *t >= 0 && *t < t_max;
+}
+
+inline b32 ray3_plane(const ray3 r, const plane p, const f32 t_max, f32* t) {
+    *t = ray3_plane_kernel(r.origin.x, r.origin.y, r.origin.z, r.dir.x, r.dir.y, r.dir.z,
+        p.normal.x, p.normal.y, p.normal.z, p.d);
+    return *t > 0 && *t < t_max;
+}
+
+inline b32 ray3_disk(const ray3 r, const disk d, const f32 t_max, f32* t) {
+    *t = ray3_disk_kernel(r.origin.x, r.origin.y, r.origin.z, r.dir.x, r.dir.y, r.dir.z,
+        d.center.x, d.center.y, d.center.z, d.normal.x, d.normal.y, d.normal.z, d.radius);
+    return *t > 0 && *t < t_max;
+}
+
+inline b32 ray3_capsule(const ray3 r, const capsule c, const f32 t_max, f32* t) {
+    *t = ray3_capsule_kernel(r.origin.x, r.origin.y, r.origin.z, r.dir.x, r.dir.y, r.dir.z,
+        c.a.x, c.a.y, c.a.z, c.b.x, c.b.y, c.b.z, c.radius);
+    return *t >= 0 && *t < t_max;
+}
+
+
+/*
+ * ==== RAY3 BATCH IMPLEMENTATION =======
+*/
+
+// The batch queries test one ray against every primitive of a SoA set.
+// t[i] receives the hit distance, or t_max on a miss, and bit i % 32 of
+// mask[i / 32] is set for hits, so mask needs (count + 31) / 32 words.
+// Returns the number of hits.
+
+u32 ray3_spheres(const ray3 r, const sphere_soa* s, const f32 t_max, u32* mask, f32* t) {
+    u32 hits = 0;
+    for (u32 base = 0; base < s->count; base += 32) {
+        u32 n = s->count - base < 32 ? s->count - base : 32;
+        u32 bits = 0;
+        for (u32 j = 0; j < n; ++j) {
+            u32 i = base + j;
+            f32 ti = ray3_sphere_kernel(r.origin.x, r.origin.y, r.origin.z, r.dir.x, r.dir.y, r.dir.z,
+                s->x[i], s->y[i], s->z[i], s->radius[i]);
+            b32 hit = ti >= 0 && ti < t_max;
+            t[i] = hit ? ti : t_max;
+            bits |= (u32)hit << j;
+            hits += hit;
+        }
+        mask[base >> 5] = bits;
+    }
+    return hits;
+}
+
+u32 ray3_planes(const ray3 r, const plane_soa* p, const f32 t_max, u32* mask, f32* t) {
+    u32 hits = 0;
+    for (u32 base = 0; base < p->count; base += 32) {
+        u32 n = p->count - base < 32 ? p->count - base : 32;
+        u32 bits = 0;
+        for (u32 j = 0; j < n; ++j) {
+            u32 i = base + j;
+            f32 ti = ray3_plane_kernel(r.origin.x, r.origin.y, r.origin.z, r.dir.x, r.dir.y, r.dir.z,
+                p->nx[i], p->ny[i], p->nz[i], p->d[i]);
+            b32 hit = ti > 0 && ti < t_max;
+            t[i] = hit ? ti : t_max;
+            bits |= (u32)hit << j;
+            hits += hit;
+        }
+        mask[base >> 5] = bits;
+    }
+    return hits;
+}
+
+u32 ray3_disks(const ray3 r, const disk_soa* d, const f32 t_max, u32* mask, f32* t) {
+    u32 hits = 0;
+    for (u32 base = 0; base < d->count; base += 32) {
+        u32 n = d->count - base < 32 ? d->count - base : 32;
+        u32 bits = 0;
+        for (u32 j = 0; j < n; ++j) {
+            u32 i = base + j;
+            f32 ti = ray3_disk_kernel(r.origin.x, r.origin.y, r.origin.z, r.dir.x, r.dir.y, r.dir.z,
+                d->x[i], d->y[i], d->z[i], d->nx[i], d->ny[i], d->nz[i], d->radius[i]);
+            b32 hit = ti > 0 && ti < t_max;
+            t[i] = hit ? ti : t_max;
+            bits |= (u32)hit << j;
+            hits += hit;
+        }
+        mask[base >> 5] = bits;
+    }
+    return hits;
+}
+
+u32 ray3_capsules(const ray3 r, const capsule_soa* c, const f32 t_max, u32* mask, f32* t) {
+    u32 hits = 0;
+    for (u32 base = 0; base < c->count; base += 32) {
+        u32 n = c->count - base < 32 ? c->count - base : 32;
+        u32 bits = 0;
+        for (u32 j = 0; j < n; ++j) {
+            u32 i = base + j;
+            f32 ti = ray3_capsule_kernel(r.origin.x, r.origin.y, r.origin.z, r.dir.x, r.dir.y, r.dir.z,
+                c->ax[i], c->ay[i], c->az[i], c->bx[i], c->by[i], c->bz[i], c->radius[i]);
+            b32 hit = ti >= 0 && ti < t_max;
+            t[i] = hit ? ti : t_max;
+            bits |= (u32)hit << j;
+            hits += hit;
+        }
+        mask[base >> 5] = bits;
+    }
+    return hits;
+}
+
+
+/*
+ * ==== CLOSEST POINTS =======
+*/
+
+// Squared lengths below this make a segment a point.
+#define SEGMENT_EPSILON 1e-12f
+// The batch queries run the kernels per block into local arrays, so the
+// kernel loops never need alias checks against the caller's arrays.
+#define CLOSEST_BLOCK 64
+
+// Like the ray tests, each query is one branch free kernel shared by the
+// scalar and the batch entry points. Every Voronoi region is evaluated and
+// the answer is picked with selects, so the batch loops vectorize and do
+// not depend on where the query points fall. GCC only if-converts the
+// selects with -fno-trapping-math.
+
+// Barycentric weights u, v, w of a, b and c for the closest point of
+// triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5). The
+// regions are selected lowest priority first: face, edges, vertices.
+// Weights outside the selected feature are exactly zero.
+static inline void closest_triangle_kernel(const f32 px, const f32 py, const f32 pz,
+        const f32 ax, const f32 ay, const f32 az,
+        const f32 bx, const f32 by, const f32 bz,
+        const f32 cx, const f32 cy, const f32 cz, f32* u_out, f32* v_out, f32* w_out) {
+    f32 abx = bx - ax;
+    f32 aby = by - ay;
+    f32 abz = bz - az;
+    f32 acx = cx - ax;
+    f32 acy = cy - ay;
+    f32 acz = cz - az;
+    f32 d1 = abx * (px - ax) + aby * (py - ay) + abz * (pz - az);
+    f32 d2 = acx * (px - ax) + acy * (py - ay) + acz * (pz - az);
+    f32 d3 = abx * (px - bx) + aby * (py - by) + abz * (pz - bz);
+    f32 d4 = acx * (px - bx) + acy * (py - by) + acz * (pz - bz);
+    f32 d5 = abx * (px - cx) + aby * (py - cy) + abz * (pz - cz);
+    f32 d6 = acx * (px - cx) + acy * (py - cy) + acz * (pz - cz);
+    f32 va = d3 * d6 - d5 * d4;
+    f32 vb = d5 * d2 - d1 * d6;
+    f32 vc = d1 * d4 - d3 * d2;
+
+    f32 sum = va + vb + vc;
+    f32 inv = 1.0f / (sum != 0 ? sum : 1.0f);
+    f32 v = vb * inv;
+    f32 w = vc * inv;
+    f32 u = 1.0f - v - w;
+
+    f32 e_bc = (d4 - d3) + (d5 - d6);
+    f32 w_bc = (d4 - d3) / (e_bc != 0 ? e_bc : 1.0f);
+    b32 in_bc = va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0;
+    u = in_bc ? 0.0f : u;
+    v = in_bc ? 1.0f - w_bc : v;
+    w = in_bc ? w_bc : w;
+
+    f32 e_ac = d2 - d6;
+    f32 w_ac = d2 / (e_ac != 0 ? e_ac : 1.0f);
+    b32 in_ac = vb <= 0 && d2 >= 0 && d6 <= 0;
+    u = in_ac ? 1.0f - w_ac : u;
+    v = in_ac ? 0.0f : v;
+    w = in_ac ? w_ac : w;
+
+    b32 in_c = d6 >= 0 && d5 <= d6;
+    u = in_c ? 0.0f : u;
+    v = in_c ? 0.0f : v;
+    w = in_c ? 1.0f : w;
+
+    f32 e_ab = d1 - d3;
+    f32 v_ab = d1 / (e_ab != 0 ? e_ab : 1.0f);
+    b32 in_ab = vc <= 0 && d1 >= 0 && d3 <= 0;
+    u = in_ab ? 1.0f - v_ab : u;
+    v = in_ab ? v_ab : v;
+    w = in_ab ? 0.0f : w;
+
+    b32 in_b = d3 >= 0 && d4 <= d3;
+    u = in_b ? 0.0f : u;
+    v = in_b ? 1.0f : v;
+    w = in_b ? 0.0f : w;
+
+    b32 in_a = d1 <= 0 && d2 <= 0;
+    *u_out = in_a ? 1.0f : u;
+    *v_out = in_a ? 0.0f : v;
+    *w_out = in_a ? 0.0f : w;
+}
+
+static f32 closest_clamp01(f32 x) {
+    x = x > 0 ? x : 0.0f;
+    return x < 1 ? x : 1.0f;
+}
+
+// Parameters s, t of the closest points p1 + s * (q1 - p1) and
+// p2 + t * (q2 - p2) of two segments, and their squared distance
+// (Ericson 5.1.9). Degenerate segments are handled as points.
+static inline f32 segment_segment_kernel(const f32 p1x, const f32 p1y, const f32 p1z,
+        const f32 q1x, const f32 q1y, const f32 q1z,
+        const f32 p2x, const f32 p2y, const f32 p2z,
+        const f32 q2x, const f32 q2y, const f32 q2z, f32* s_out, f32* t_out) {
+    f32 d1x = q1x - p1x;
+    f32 d1y = q1y - p1y;
+    f32 d1z = q1z - p1z;
+    f32 d2x = q2x - p2x;
+    f32 d2y = q2y - p2y;
+    f32 d2z = q2z - p2z;
+    f32 rx = p1x - p2x;
+    f32 ry = p1y - p2y;
+    f32 rz = p1z - p2z;
+    f32 a = d1x * d1x + d1y * d1y + d1z * d1z;
+    f32 e = d2x * d2x + d2y * d2y + d2z * d2z;
+    f32 b = d1x * d2x + d1y * d2y + d1z * d2z;
+    f32 c = d1x * rx + d1y * ry + d1z * rz;
+    f32 f = d2x * rx + d2y * ry + d2z * rz;
+    b32 point1 = a <= SEGMENT_EPSILON;
+    b32 point2 = e <= SEGMENT_EPSILON;
+    f32 inv_a = 1.0f / (point1 ? 1.0f : a);
+    f32 inv_e = 1.0f / (point2 ? 1.0f : e);
+
+    // Parallel segments start from s = 0.
+    f32 denom = a * e - b * b;
+    f32 s = closest_clamp01((b * f - c * e) / (denom > 0 ? denom : 1.0f));
+    s = denom > 0 ? s : 0.0f;
+    f32 t = (b * s + f) * inv_e;
+    f32 t_clamped = closest_clamp01(t);
+    f32 s_clamped = closest_clamp01((b * t_clamped - c) * inv_a);
+    s = t != t_clamped ? s_clamped : s;
+    t = t_clamped;
+
+    f32 s_point2 = closest_clamp01(-c * inv_a);
+    f32 t_point1 = closest_clamp01(f * inv_e);
+    s = point2 ? s_point2 : s;
+    s = point1 ? 0.0f : s;
+    t = point1 ? t_point1 : t;
+    t = point2 ? 0.0f : t;
+
+    f32 dx = rx + d1x * s - d2x * t;
+    f32 dy = ry + d1y * s - d2y * t;
+    f32 dz = rz + d1z * s - d2z * t;
+    *s_out = s;
+    *t_out = t;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+static f32 point_aabb3_kernel(const f32 px, const f32 py, const f32 pz, const aabb3 box) {
+    f32 dx = box.min.x - px > px - box.max.x ? box.min.x - px : px - box.max.x;
+    f32 dy = box.min.y - py > py - box.max.y ? box.min.y - py : py - box.max.y;
+    f32 dz = box.min.z - pz > pz - box.max.z ? box.min.z - pz : pz - box.max.z;
+    dx = dx > 0 ? dx : 0.0f;
+    dy = dy > 0 ? dy : 0.0f;
+    dz = dz > 0 ? dz : 0.0f;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+inline point3 closest_point_triangle(const point3 p, const point3 a, const point3 b, const point3 c) {
+    f32 u, v, w;
+    closest_triangle_kernel(p.x, p.y, p.z, a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z, &u, &v, &w);
+    return vec3_add(a, vec3_add(vec3_mul_s(vec3_sub(b, a), v), vec3_mul_s(vec3_sub(c, a), w)));
+}
+
+// Also writes the barycentric weights of a, b and c. On an edge or a
+// vertex the weights of the other vertices are exactly zero, so the
+// feature holding the point can be read from them.
+inline point3 closest_point_triangle_bary(const point3 p, const point3 a, const point3 b, const point3 c,
+        f32 bary[3]) {
+    closest_triangle_kernel(p.x, p.y, p.z, a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z, &bary[0], &bary[1], &bary[2]);
+    return vec3_add(a, vec3_add(vec3_mul_s(vec3_sub(b, a), bary[1]), vec3_mul_s(vec3_sub(c, a), bary[2])));
+}
+
+// Returns the squared distance of the segments p1q1 and p2q2; s and t
+// locate the closest points on each.
+inline f32 segment_segment_closest(const point3 p1, const point3 q1, const point3 p2, const point3 q2,
+        f32* s, f32* t) {
+    return segment_segment_kernel(p1.x, p1.y, p1.z, q1.x, q1.y, q1.z, p2.x, p2.y, p2.z, q2.x, q2.y, q2.z,
+        s, t);
+}
+
+inline point3 closest_point_aabb3(const point3 p, const aabb3 box) {
+    point3 q;
+    q.x = p.x < box.min.x ? box.min.x : p.x > box.max.x ? box.max.x : p.x;
+    q.y = p.y < box.min.y ? box.min.y : p.y > box.max.y ? box.max.y : p.y;
+    q.z = p.z < box.min.z ? box.min.z : p.z > box.max.z ? box.max.z : p.z;
+    return q;
+}
+
+// Zero for points inside the box.
+inline f32 point_aabb3_dist_sq(const point3 p, const aabb3 box) {
+    return point_aabb3_kernel(p.x, p.y, p.z, box);
+}
+
+
+/*
+ * ==== CLOSEST POINT BATCH IMPLEMENTATION =======
+*/
+
+// Point i against triangle i. out receives the closest points and dist_sq
+// their squared distances; out->count is left to the caller.
+void closest_points_triangles(const point3_soa* p, const triangle_soa* tri, point3_soa* out, f32* dist_sq) {
+    f32 qx[CLOSEST_BLOCK], qy[CLOSEST_BLOCK], qz[CLOSEST_BLOCK], d[CLOSEST_BLOCK];
+    for (u32 base = 0; base < p->count; base += CLOSEST_BLOCK) {
+        u32 n = p->count - base < CLOSEST_BLOCK ? p->count - base : CLOSEST_BLOCK;
+        const f32 *px = p->x + base, *py = p->y + base, *pz = p->z + base;
+        const f32 *ax = tri->ax + base, *ay = tri->ay + base, *az = tri->az + base;
+        const f32 *bx = tri->bx + base, *by = tri->by + base, *bz = tri->bz + base;
+        const f32 *cx = tri->cx + base, *cy = tri->cy + base, *cz = tri->cz + base;
+        for (u32 i = 0; i < n; ++i) {
+            f32 u, v, w;
+            closest_triangle_kernel(px[i], py[i], pz[i], ax[i], ay[i], az[i], bx[i], by[i], bz[i],
+                cx[i], cy[i], cz[i], &u, &v, &w);
+            qx[i] = ax[i] + (bx[i] - ax[i]) * v + (cx[i] - ax[i]) * w;
+            qy[i] = ay[i] + (by[i] - ay[i]) * v + (cy[i] - ay[i]) * w;
+            qz[i] = az[i] + (bz[i] - az[i]) * v + (cz[i] - az[i]) * w;
+            d[i] = (px[i] - qx[i]) * (px[i] - qx[i]) + (py[i] - qy[i]) * (py[i] - qy[i])
+                + (pz[i] - qz[i]) * (pz[i] - qz[i]);
+        }
+        f32 *ox = out->x + base, *oy = out->y + base, *oz = out->z + base, *od = dist_sq + base;
+        for (u32 i = 0; i < n; ++i) {
+            ox[i] = qx[i];
+            oy[i] = qy[i];
+            oz[i] = qz[i];
+            od[i] = d[i];
+        }
+    }
+}
+
+// Segment i of a against segment i of b.
+void segments_closest(const segment_soa* a, const segment_soa* b, f32* s, f32* t, f32* dist_sq) {
+    f32 bs[CLOSEST_BLOCK], bt[CLOSEST_BLOCK], d[CLOSEST_BLOCK];
+    for (u32 base = 0; base < a->count; base += CLOSEST_BLOCK) {
+        u32 n = a->count - base < CLOSEST_BLOCK ? a->count - base : CLOSEST_BLOCK;
+        const f32 *p1x = a->ax + base, *p1y = a->ay + base, *p1z = a->az + base;
+        const f32 *q1x = a->bx + base, *q1y = a->by + base, *q1z = a->bz + base;
+        const f32 *p2x = b->ax + base, *p2y = b->ay + base, *p2z = b->az + base;
+        const f32 *q2x = b->bx + base, *q2y = b->by + base, *q2z = b->bz + base;
+        for (u32 i = 0; i < n; ++i) {
+            d[i] = segment_segment_kernel(p1x[i], p1y[i], p1z[i], q1x[i], q1y[i], q1z[i],
+                p2x[i], p2y[i], p2z[i], q2x[i], q2y[i], q2z[i], &bs[i], &bt[i]);
+        }
+        f32 *os = s + base, *ot = t + base, *od = dist_sq + base;
+        for (u32 i = 0; i < n; ++i) {
+            os[i] = bs[i];
+            ot[i] = bt[i];
+            od[i] = d[i];
+        }
+    }
+}
+
+void points_aabb3_dist_sq(const point3_soa* p, const aabb3 box, f32* dist_sq) {
+    const f32 *px = p->x, *py = p->y, *pz = p->z;
+    u32 count = p->count;
+    for (u32 i = 0; i < count; ++i) {
+        dist_sq[i] = point_aabb3_kernel(px[i], py[i], pz[i], box);
+    }
+}
+
+
+/*
+ * ==== GJK =======
+*/
+
+#define GJK_MAX_ITERATIONS 32
+#define GJK_EPSILON 1e-6f
+#define GJK_LANES 8
+
+// Minkowski difference vertex w = a - b with the shape points behind it.
+typedef struct gjk_vertex {
+    point3 w;
+    point3 a;
+    point3 b;
+} gjk_vertex;
+
+typedef struct gjk_simplex {
+    gjk_vertex v[4];
+    f32 bary[4];
+    u32 count;
+} gjk_simplex;
+
+// Spheres and capsules run as their point or segment core plus a margin,
+// which GJK handles exactly and without slow convergence on round shapes.
+static point3 convex_core_support(const convex* c, const vec3 d) {
+    switch (c->type) {
+    case CONVEX_SPHERE:
+        return c->s.center;
+    case CONVEX_BOX: {
+        point3 p;
+        p.x = d.x >= 0 ? c->box.max.x : c->box.min.x;
+        p.y = d.y >= 0 ? c->box.max.y : c->box.min.y;
+        p.z = d.z >= 0 ? c->box.max.z : c->box.min.z;
+        return p;
+    }
+    case CONVEX_CAPSULE:
+        return vec3_dot(d, vec3_sub(c->cap.b, c->cap.a)) >= 0 ? c->cap.b : c->cap.a;
+    case CONVEX_OBB: {
+        point3 p = c->o.center;
+        for (int i = 0; i < 3; ++i) {
+            vec3 axis = {{c->o.axes.m[i][0], c->o.axes.m[i][1], c->o.axes.m[i][2]}};
+            f32 e = vec3_dot(d, axis) >= 0 ? c->o.half.e[i] : -c->o.half.e[i];
+            p = vec3_add(p, vec3_mul_s(axis, e));
+        }
+        return p;
+    }
+    default: {
+        u32 best = 0;
+        f32 best_dot = -FLT_MAX;
+        for (u32 i = 0; i < c->h.count; ++i) {
+            f32 dot = vec3_dot(c->h.points[i], d);
+            if (dot > best_dot) {
+                best_dot = dot;
+                best = i;
+            }
+        }
+        return c->h.points[best];
+    }
+    }
+}
+
+static f32 convex_margin(const convex* c) {
+    return c->type == CONVEX_SPHERE ? c->s.radius : c->type == CONVEX_CAPSULE ? c->cap.radius : 0.0f;
+}
+
+// Point of the shape furthest along `dir`.
+inline point3 convex_support(const convex* c, const vec3 dir) {
+    point3 p = convex_core_support(c, dir);
+    f32 margin = convex_margin(c);
+    f32 len = vec3_len(dir);
+    if (margin > 0 && len > 0) {
+        p = vec3_add(p, vec3_mul_s(dir, margin / len));
+    }
+    return p;
+}
+
+static gjk_vertex gjk_support(const convex* a, const convex* b, const vec3 d, const b32 core) {
+    gjk_vertex v;
+    v.a = core ? convex_core_support(a, d) : convex_support(a, d);
+    v.b = core ? convex_core_support(b, vec3_neg(d)) : convex_support(b, vec3_neg(d));
+    v.w = vec3_sub(v.a, v.b);
+    return v;
+}
+
+// Drops the vertices with zero weight.
+static void gjk_compact(gjk_simplex* s) {
+    u32 n = 0;
+    for (u32 i = 0; i < s->count; ++i) {
+        if (s->bary[i] > 0) {
+            s->v[n] = s->v[i];
+            s->bary[n] = s->bary[i];
+            ++n;
+        }
+    }
+    s->count = n;
+}
+
+// Reduces the simplex to the smallest subset holding the point closest
+// to the origin and returns that point. Returns 1 when the origin lies
+// inside a full tetrahedron.
+static b32 gjk_solve(gjk_simplex* s, vec3* v) {
+    point3 origin = {{0.0f, 0.0f, 0.0f}};
+    if (s->count == 1) {
+        s->bary[0] = 1.0f;
+        *v = s->v[0].w;
+        return 0;
+    }
+    if (s->count == 2) {
+        vec3 ab = vec3_sub(s->v[1].w, s->v[0].w);
+        f32 len_sq = vec3_len_sq(ab);
+        f32 t = len_sq > 0 ? -vec3_dot(s->v[0].w, ab) / len_sq : 0.0f;
+        t = t < 0 ? 0 : t > 1 ? 1 : t;
+        s->bary[0] = 1.0f - t;
+        s->bary[1] = t;
+        gjk_compact(s);
+        *v = vec3_add(vec3_mul_s(s->v[0].w, s->bary[0]), s->count > 1 ? vec3_mul_s(s->v[1].w, s->bary[1]) : origin);
+        return 0;
+    }
+    if (s->count == 3) {
+        *v = closest_point_triangle_bary(origin, s->v[0].w, s->v[1].w, s->v[2].w, s->bary);
+        gjk_compact(s);
+        return 0;
+    }
+
+    // Tetrahedron: keep the closest face the origin lies outside of.
+    static const u32 faces[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0}};
+    f32 best = FLT_MAX;
+    gjk_simplex best_s = *s;
+    b32 inside = 1;
+    for (u32 f = 0; f < 4; ++f) {
+        point3 a = s->v[faces[f][0]].w;
+        point3 b = s->v[faces[f][1]].w;
+        point3 c = s->v[faces[f][2]].w;
+        point3 d = s->v[faces[f][3]].w;
+        vec3 n = vec3_cross(vec3_sub(b, a), vec3_sub(c, a));
+        f32 side_origin = -vec3_dot(n, a);
+        f32 side_d = vec3_dot(n, vec3_sub(d, a));
+        // Degenerate tetrahedra, with d (nearly) in the face plane, test
+        // every face: the sign of side_d is rounding noise there.
+        b32 flat = side_d * side_d <= GJK_EPSILON * vec3_len_sq(n) * vec3_len_sq(vec3_sub(d, a));
+        if (side_origin * side_d > 0 && !flat) {
+            continue;
+        }
+        inside = 0;
+        f32 bary[3];
+        vec3 p = closest_point_triangle_bary(origin, a, b, c, bary);
+        f32 dist = vec3_len_sq(p);
+        if (dist < best) {
+            best = dist;
+            *v = p;
+            best_s.count = 3;
+            for (u32 i = 0; i < 3; ++i) {
+                best_s.v[i] = s->v[faces[f][i]];
+                best_s.bary[i] = bary[i];
+            }
+        }
+    }
+    if (inside) {
+        v->x = v->y = v->z = 0.0f;
+        return 1;
+    }
+    *s = best_s;
+    gjk_compact(s);
+    return 0;
+}
+
+// Runs GJK on the shape cores. Returns the core distance, 0 when the
+// cores overlap, and leaves the final simplex in `s`. With `early` set it
+// stops as soon as the distance is known to be on one side of `margin`.
+static f32 gjk_core(const convex* a, const convex* b, gjk_simplex* s, const b32 early, const f32 margin) {
+    vec3 x = {{1.0f, 0.0f, 0.0f}};
+    s->count = 1;
+    s->v[0] = gjk_support(a, b, x, 1);
+    s->bary[0] = 1.0f;
+    vec3 v = s->v[0].w;
+    for (u32 iter = 0; iter < GJK_MAX_ITERATIONS; ++iter) {
+        f32 v_sq = vec3_len_sq(v);
+        if (v_sq <= GJK_EPSILON * GJK_EPSILON || (early && v_sq <= margin * margin)) {
+            return SQRTF(v_sq);
+        }
+        gjk_vertex w = gjk_support(a, b, vec3_neg(v), 1);
+        f32 vw = vec3_dot(v, w.w);
+        // w bounds the distance from below: a separating plane was found.
+        if (early && vw > 0 && vw * vw > margin * margin * v_sq) {
+            return vw / SQRTF(v_sq);
+        }
+        // No progress towards the origin: v is the closest point.
+        if (v_sq - vw <= GJK_EPSILON * v_sq) {
+            break;
+        }
+        s->v[s->count++] = w;
+        if (gjk_solve(s, &v)) {
+            return 0.0f;
+        }
+    }
+    return vec3_len(v);
+}
+
+// Closest points on the full shapes from the core simplex.
+static void gjk_witness(const gjk_simplex* s, const convex* a, const convex* b, point3* point_a, point3* point_b) {
+    point3 pa = {{0.0f, 0.0f, 0.0f}};
+    point3 pb = pa;
+    for (u32 i = 0; i < s->count; ++i) {
+        pa = vec3_add(pa, vec3_mul_s(s->v[i].a, s->bary[i]));
+        pb = vec3_add(pb, vec3_mul_s(s->v[i].b, s->bary[i]));
+    }
+    vec3 n = vec3_sub(pb, pa);
+    f32 len = vec3_len(n);
+    if (len > 0) {
+        pa = vec3_add(pa, vec3_mul_s(n, convex_margin(a) / len));
+        pb = vec3_sub(pb, vec3_mul_s(n, convex_margin(b) / len));
+    }
+    *point_a = pa;
+    *point_b = pb;
+}
+
+// Distance between two convex shapes and their closest points. Returns 0
+// and leaves the points untouched when they overlap.
+f32 gjk_distance(const convex* a, const convex* b, point3* point_a, point3* point_b) {
+    gjk_simplex s;
+    f32 dist = gjk_core(a, b, &s, 0, 0.0f) - convex_margin(a) - convex_margin(b);
+    if (dist <= 0) {
+        return 0.0f;
+    }
+    gjk_witness(&s, a, b, point_a, point_b);
+    return dist;
+}
+
+b32 gjk_overlap(const convex* a, const convex* b) {
+    gjk_simplex s;
+    f32 margin = convex_margin(a) + convex_margin(b);
+    return gjk_core(a, b, &s, 1, margin) <= margin;
+}
+
+// Overlap tests for up to GJK_LANES pairs in lockstep, pair i being a[i]
+// and b[i]. Search directions and the termination tests live in lane
+// arrays and vectorize; supports and simplex reduction run per lane.
+// Returns a mask with bit i set when pair i overlaps.
+u32 gjk_overlap8(const convex* a, const convex* b, const u32 count) {
+    gjk_simplex s[GJK_LANES];
+    f32 vx[GJK_LANES] = {0}, vy[GJK_LANES] = {0}, vz[GJK_LANES] = {0};
+    f32 wx[GJK_LANES] = {0}, wy[GJK_LANES] = {0}, wz[GJK_LANES] = {0};
+    f32 margin_sq[GJK_LANES] = {0}, v_sq[GJK_LANES], vw[GJK_LANES];
+    gjk_vertex w[GJK_LANES];
+    vec3 x = {{1.0f, 0.0f, 0.0f}};
+    u32 n = count < GJK_LANES ? count : GJK_LANES;
+    u32 active = 0;
+    u32 result = 0;
+    for (u32 i = 0; i < n; ++i) {
+        f32 margin = convex_margin(&a[i]) + convex_margin(&b[i]);
+        margin_sq[i] = margin * margin > GJK_EPSILON * GJK_EPSILON ? margin * margin : GJK_EPSILON * GJK_EPSILON;
+        s[i].count = 1;
+        s[i].v[0] = gjk_support(&a[i], &b[i], x, 1);
+        s[i].bary[0] = 1.0f;
+        vx[i] = s[i].v[0].w.x;
+        vy[i] = s[i].v[0].w.y;
+        vz[i] = s[i].v[0].w.z;
+        active |= 1u << i;
+    }
+
+    for (u32 iter = 0; iter < GJK_MAX_ITERATIONS && active; ++iter) {
+        for (u32 i = 0; i < GJK_LANES; ++i) {
+            v_sq[i] = vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i];
+        }
+        for (u32 i = 0; i < n; ++i) {
+            if ((active >> i) & 1) {
+                if (v_sq[i] <= margin_sq[i]) {
+                    result |= 1u << i;
+                    active &= ~(1u << i);
+                    continue;
+                }
+                vec3 d = {{-vx[i], -vy[i], -vz[i]}};
+                w[i] = gjk_support(&a[i], &b[i], d, 1);
+                wx[i] = w[i].w.x;
+                wy[i] = w[i].w.y;
+                wz[i] = w[i].w.z;
+            }
+        }
+        for (u32 i = 0; i < GJK_LANES; ++i) {
+            vw[i] = vx[i] * wx[i] + vy[i] * wy[i] + vz[i] * wz[i];
+        }
+        for (u32 i = 0; i < n; ++i) {
+            if (!((active >> i) & 1)) {
+                continue;
+            }
+            // Separating plane found, or no more progress while still
+            // further apart than the margins.
+            if ((vw[i] > 0 && vw[i] * vw[i] > margin_sq[i] * v_sq[i]) || v_sq[i] - vw[i] <= GJK_EPSILON * v_sq[i]) {
+                active &= ~(1u << i);
+                continue;
+            }
+            vec3 v;
+            s[i].v[s[i].count++] = w[i];
+            if (gjk_solve(&s[i], &v)) {
+                result |= 1u << i;
+                active &= ~(1u << i);
+                continue;
+            }
+            vx[i] = v.x;
+            vy[i] = v.y;
+            vz[i] = v.z;
+        }
+    }
+    for (u32 i = 0; i < n; ++i) {
+        if (((active >> i) & 1) && vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i] <= margin_sq[i]) {
+            result |= 1u << i;
+        }
+    }
+    return result;
+}
+
+
+/*
+ * ==== EPA =======
+*/
+
+#define EPA_MAX_VERTICES 64
+#define EPA_MAX_FACES 128
+#define EPA_TOLERANCE 1e-4f
+// Faces w lies this close to (relative to its support distance) count as
+// not visible, so rounding never carves a hole next to a coplanar face.
+#define EPA_VISIBLE_EPSILON 1e-5f
+
+typedef struct epa_face {
+    u32 v[3];
+    vec3 n;       // outward unit normal
+    f32 d;        // distance of the face plane from the origin
+} epa_face;
+
+static b32 epa_face_init(epa_face* f, const gjk_vertex* verts, const u32 a, const u32 b, const u32 c) {
+    vec3 n = vec3_cross(vec3_sub(verts[b].w, verts[a].w), vec3_sub(verts[c].w, verts[a].w));
+    f32 len = vec3_len(n);
+    if (len < 1e-12f) {
+        return 0;
+    }
+    f->v[0] = a;
+    f->v[1] = b;
+    f->v[2] = c;
+    f->n = vec3_mul_s(n, 1.0f / len);
+    f->d = vec3_dot(f->n, verts[a].w);
+    return 1;
+}
+
+// Grows the GJK simplex into a tetrahedron with full shape supports, for
+// the cases where GJK stopped with the origin on a vertex, edge or face.
+static b32 epa_tetrahedron(const convex* a, const convex* b, gjk_simplex* s) {
+    static const vec3 axes[6] = {{{1, 0, 0}}, {{-1, 0, 0}}, {{0, 1, 0}}, {{0, -1, 0}}, {{0, 0, 1}}, {{0, 0, -1}}};
+    const f32 eps = 1e-6f;
+    if (s->count == 1) {
+        for (u32 i = 0; i < 6 && s->count == 1; ++i) {
+            gjk_vertex w = gjk_support(a, b, axes[i], 0);
+            if (vec3_len_sq(vec3_sub(w.w, s->v[0].w)) > eps) {
+                s->v[s->count++] = w;
+            }
+        }
+    }
+    if (s->count == 2) {
+        vec3 line = vec3_sub(s->v[1].w, s->v[0].w);
+        u32 axis = fabsf(line.x) < fabsf(line.y) ? (fabsf(line.x) < fabsf(line.z) ? 0 : 4)
+            : (fabsf(line.y) < fabsf(line.z) ? 2 : 4);
+        vec3 d = vec3_cross(line, axes[axis]);
+        for (u32 i = 0; i < 4 && s->count == 2; ++i) {
+            gjk_vertex w = gjk_support(a, b, d, 0);
+            vec3 off = vec3_cross(vec3_sub(w.w, s->v[0].w), line);
+            if (vec3_len_sq(off) > eps * vec3_len_sq(line)) {
+                s->v[s->count++] = w;
+            }
+            d = i % 2 ? vec3_cross(line, d) : vec3_neg(d);
+        }
+    }
+    if (s->count == 3) {
+        vec3 n = vec3_cross(vec3_sub(s->v[1].w, s->v[0].w), vec3_sub(s->v[2].w, s->v[0].w));
+        for (u32 i = 0; i < 2 && s->count == 3; ++i) {
+            gjk_vertex w = gjk_support(a, b, n, 0);
+            f32 side = vec3_dot(n, vec3_sub(w.w, s->v[0].w));
+            if (side * side > eps * vec3_len_sq(n)) {
+                s->v[s->count++] = w;
+            }
+            n = vec3_neg(n);
+        }
+    }
+    return s->count == 4;
+}
+
+// Expands the polytope towards the boundary of the Minkowski difference
+// until the face nearest the origin stops moving.
+static b32 epa_expand(const convex* a, const convex* b, const gjk_simplex* s, contact3* c) {
+    gjk_vertex verts[EPA_MAX_VERTICES];
+    epa_face faces[EPA_MAX_FACES];
+    u32 edges[EPA_MAX_FACES * 3][2];
+    u32 vert_count = 4;
+    u32 face_count = 0;
+    static const u32 tet[4][3] = {{0, 1, 2}, {0, 3, 1}, {0, 2, 3}, {1, 3, 2}};
+    point3 centroid = {{0.0f, 0.0f, 0.0f}};
+    for (u32 i = 0; i < 4; ++i) {
+        verts[i] = s->v[i];
+        centroid = vec3_add(centroid, vec3_mul_s(s->v[i].w, 0.25f));
+    }
+    for (u32 i = 0; i < 4; ++i) {
+        u32 i0 = tet[i][0], i1 = tet[i][1], i2 = tet[i][2];
+        vec3 n = vec3_cross(vec3_sub(verts[i1].w, verts[i0].w), vec3_sub(verts[i2].w, verts[i0].w));
+        if (vec3_dot(n, vec3_sub(verts[i0].w, centroid)) < 0) {
+            u32 t = i1;
+            i1 = i2;
+            i2 = t;
+        }
+        if (!epa_face_init(&faces[face_count++], verts, i0, i1, i2)) {
+            return 0;
+        }
+    }
+
+    epa_face best = faces[0];
+    for (;;) {
+        u32 closest = 0;
+        for (u32 i = 1; i < face_count; ++i) {
+            if (faces[i].d < faces[closest].d) {
+                closest = i;
+            }
+        }
+        best = faces[closest];
+        gjk_vertex w = gjk_support(a, b, best.n, 0);
+        f32 dist = vec3_dot(w.w, best.n);
+        if (dist - best.d <= EPA_TOLERANCE * (best.d > 1.0f ? best.d : 1.0f) || vert_count == EPA_MAX_VERTICES) {
+            break;
+        }
+
+        // Remove every face that sees w, keeping the boundary of the hole.
+        f32 visible = EPA_VISIBLE_EPSILON * (dist > 1.0f ? dist : 1.0f);
+        u32 edge_count = 0;
+        for (u32 i = 0; i < face_count;) {
+            if (vec3_dot(faces[i].n, vec3_sub(w.w, verts[faces[i].v[0]].w)) <= visible) {
+                ++i;
+                continue;
+            }
+            for (u32 e = 0; e < 3; ++e) {
+                u32 e0 = faces[i].v[e];
+                u32 e1 = faces[i].v[(e + 1) % 3];
+                u32 j = 0;
+                while (j < edge_count && !(edges[j][0] == e1 && edges[j][1] == e0)) {
+                    ++j;
+                }
+                if (j < edge_count) {
+                    edges[j][0] = edges[edge_count - 1][0];
+                    edges[j][1] = edges[edge_count - 1][1];
+                    --edge_count;
+                } else {
+                    edges[edge_count][0] = e0;
+                    edges[edge_count][1] = e1;
+                    ++edge_count;
+                }
+            }
+            faces[i] = faces[--face_count];
+        }
+        if (face_count + edge_count > EPA_MAX_FACES) {
+            break;
+        }
+        verts[vert_count] = w;
+        for (u32 e = 0; e < edge_count; ++e) {
+            if (epa_face_init(&faces[face_count], verts, edges[e][0], edges[e][1], vert_count)) {
+                ++face_count;
+            }
+        }
+        ++vert_count;
+        if (face_count == 0) {
+            break;
+        }
+    }
+
+    f32 bary[3];
+    point3 p = vec3_mul_s(best.n, best.d);
+    closest_point_triangle_bary(p, verts[best.v[0]].w, verts[best.v[1]].w, verts[best.v[2]].w, bary);
+    c->normal = best.n;
+    c->depth = best.d;
+    point3 origin = {{0.0f, 0.0f, 0.0f}};
+    c->point_a = c->point_b = origin;
+    for (u32 i = 0; i < 3; ++i) {
+        c->point_a = vec3_add(c->point_a, vec3_mul_s(verts[best.v[i]].a, bary[i]));
+        c->point_b = vec3_add(c->point_b, vec3_mul_s(verts[best.v[i]].b, bary[i]));
+    }
+    return 1;
+}
+
+// Penetration depth and direction of two overlapping shapes. Returns 0
+// when they do not overlap. Shapes whose cores stay apart and only touch
+// through their radius are resolved from the GJK closest points.
+b32 epa_penetration(const convex* a, const convex* b, contact3* c) {
+    gjk_simplex s;
+    f32 margin_a = convex_margin(a);
+    f32 margin_b = convex_margin(b);
+    f32 dist = gjk_core(a, b, &s, 0, 0.0f);
+    // Cores within GJK_EPSILON are touching and go to EPA.
+    if (dist > margin_a + margin_b && dist > GJK_EPSILON) {
+        return 0;
+    }
+    if (dist > GJK_EPSILON) {
+        point3 pa = {{0.0f, 0.0f, 0.0f}};
+        point3 pb = pa;
+        for (u32 i = 0; i < s.count; ++i) {
+            pa = vec3_add(pa, vec3_mul_s(s.v[i].a, s.bary[i]));
+            pb = vec3_add(pb, vec3_mul_s(s.v[i].b, s.bary[i]));
+        }
+        // Cores are apart, so b sits along pb - pa.
+        c->normal = vec3_mul_s(vec3_sub(pb, pa), 1.0f / dist);
+        c->depth = margin_a + margin_b - dist;
+        c->point_a = vec3_add(pa, vec3_mul_s(c->normal, margin_a));
+        c->point_b = vec3_sub(pb, vec3_mul_s(c->normal, margin_b));
+        return 1;
+    }
+    if (!epa_tetrahedron(a, b, &s) || !epa_expand(a, b, &s, c)) {
+        // Flat Minkowski difference, nothing to push along.
+        vec3 up = {{0.0f, 1.0f, 0.0f}};
+        c->normal = up;
+        c->depth = margin_a + margin_b;
+        c->point_a = c->point_b = convex_core_support(a, up);
+    }
+    return 1;
+}
+
+
+
+/*
+ * ==== OBB =======
+*/
+
+// SAT axes: 0-2 face normals of a, 3-5 of b, then a_i x b_j at 6 + 3i + j.
+#define OBB_AXES 15
+#define OBB_NO_AXIS 0xFFFFFFFFu
+#define OBB_LANES 8
+// Keeps near parallel edge pairs, whose cross product vanishes, from
+// reporting a false separation.
+#define OBB_EPSILON 1e-6f
+
+typedef struct obb_frame {
+    f32 r[3][3];      // r[i][j] = dot(a axis i, b axis j)
+    f32 abs_r[3][3];
+    f32 t[3];         // b center - a center in a's frame
+} obb_frame;
+
+static obb_frame obb_relative(const obb* a, const obb* b) {
+    obb_frame f;
+    vec3 d = vec3_sub(b->center, a->center);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            f.r[i][j] = a->axes.m[i][0] * b->axes.m[j][0] + a->axes.m[i][1] * b->axes.m[j][1]
+                + a->axes.m[i][2] * b->axes.m[j][2];
+            f.abs_r[i][j] = fabsf(f.r[i][j]) + OBB_EPSILON;
+        }
+        f.t[i] = d.x * a->axes.m[i][0] + d.y * a->axes.m[i][1] + d.z * a->axes.m[i][2];
+    }
+    return f;
+}
+
+// Whether axis k separates the boxes (Ericson, Real-Time Collision
+// Detection 4.4.1).
+static b32 obb_axis_separates(const obb_frame* f, const vec3 ea, const vec3 eb, const u32 k) {
+    f32 ra, rb, dist;
+    if (k < 3) {
+        ra = ea.e[k];
+        rb = eb.e[0] * f->abs_r[k][0] + eb.e[1] * f->abs_r[k][1] + eb.e[2] * f->abs_r[k][2];
+        dist = f->t[k];
+    } else if (k < 6) {
+        u32 j = k - 3;
+        ra = ea.e[0] * f->abs_r[0][j] + ea.e[1] * f->abs_r[1][j] + ea.e[2] * f->abs_r[2][j];
+        rb = eb.e[j];
+        dist = f->t[0] * f->r[0][j] + f->t[1] * f->r[1][j] + f->t[2] * f->r[2][j];
+    } else {
+        u32 i = (k - 6) / 3, j = (k - 6) % 3;
+        u32 i1 = (i + 1) % 3, i2 = (i + 2) % 3, j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+        ra = ea.e[i1] * f->abs_r[i2][j] + ea.e[i2] * f->abs_r[i1][j];
+        rb = eb.e[j1] * f->abs_r[i][j2] + eb.e[j2] * f->abs_r[i][j1];
+        dist = f->t[i2] * f->r[i1][j] - f->t[i1] * f->r[i2][j];
+    }
+    return fabsf(dist) > ra + rb;
+}
+
+// Index of an axis separating the boxes, or OBB_NO_AXIS when they
+// overlap. Axis `first` is tested before the rest: passing the axis that
+// separated a pair last frame usually ends the test after one axis. The
+// others go face axes first, which find most separations.
+inline u32 obb_separating_axis(const obb* a, const obb* b, const u32 first) {
+    obb_frame f = obb_relative(a, b);
+    if (first < OBB_AXES && obb_axis_separates(&f, a->half, b->half, first)) {
+        return first;
+    }
+    for (u32 k = 0; k < OBB_AXES; ++k) {
+        if (k != first && obb_axis_separates(&f, a->half, b->half, k)) {
+            return k;
+        }
+    }
+    return OBB_NO_AXIS;
+}
+
+inline b32 obb_overlap(const obb* a, const obb* b) {
+    return obb_separating_axis(a, b, OBB_NO_AXIS) == OBB_NO_AXIS;
+}
+
+// Up to OBB_LANES pairs a[i], b[i] at once. The boxes are transposed into
+// lane arrays and every axis is evaluated for all lanes without branches;
+// the cross axes are skipped when a face axis already separated every
+// pair. Returns a mask with bit i set when pair i overlaps.
+inline u32 obb_overlap8(const obb* a, const obb* b, const u32 count) {
+    f32 ua[3][3][OBB_LANES], ub[3][3][OBB_LANES], ea[3][OBB_LANES], eb[3][OBB_LANES], d[3][OBB_LANES];
+    f32 r[3][3][OBB_LANES], ar[3][3][OBB_LANES], t[3][OBB_LANES];
+    u32 sep[OBB_LANES];
+    u32 n = count < OBB_LANES ? count : OBB_LANES;
+    for (u32 l = 0; l < OBB_LANES; ++l) {
+        // Unused lanes repeat the first pair so they stay finite.
+        u32 src = l < n ? l : 0;
+        for (u32 i = 0; i < 3; ++i) {
+            for (u32 k = 0; k < 3; ++k) {
+                ua[i][k][l] = n ? a[src].axes.m[i][k] : 0.0f;
+                ub[i][k][l] = n ? b[src].axes.m[i][k] : 0.0f;
+            }
+            ea[i][l] = n ? a[src].half.e[i] : 0.0f;
+            eb[i][l] = n ? b[src].half.e[i] : 0.0f;
+            d[i][l] = n ? b[src].center.e[i] - a[src].center.e[i] : 0.0f;
+        }
+        sep[l] = 0;
+    }
+    if (!n) {
+        return 0;
+    }
+
+    for (u32 i = 0; i < 3; ++i) {
+        for (u32 j = 0; j < 3; ++j) {
+            for (u32 l = 0; l < OBB_LANES; ++l) {
+                r[i][j][l] = ua[i][0][l] * ub[j][0][l] + ua[i][1][l] * ub[j][1][l] + ua[i][2][l] * ub[j][2][l];
+                ar[i][j][l] = fabsf(r[i][j][l]) + OBB_EPSILON;
+            }
+        }
+        for (u32 l = 0; l < OBB_LANES; ++l) {
+            t[i][l] = d[0][l] * ua[i][0][l] + d[1][l] * ua[i][1][l] + d[2][l] * ua[i][2][l];
+        }
+    }
+
+    for (u32 i = 0; i < 3; ++i) {
+        for (u32 l = 0; l < OBB_LANES; ++l) {
+            f32 rb = eb[0][l] * ar[i][0][l] + eb[1][l] * ar[i][1][l] + eb[2][l] * ar[i][2][l];
+            sep[l] |= fabsf(t[i][l]) > ea[i][l] + rb;
+        }
+    }
+    for (u32 j = 0; j < 3; ++j) {
+        for (u32 l = 0; l < OBB_LANES; ++l) {
+            f32 ra = ea[0][l] * ar[0][j][l] + ea[1][l] * ar[1][j][l] + ea[2][l] * ar[2][j][l];
+            f32 dist = t[0][l] * r[0][j][l] + t[1][l] * r[1][j][l] + t[2][l] * r[2][j][l];
+            sep[l] |= fabsf(dist) > ra + eb[j][l];
+        }
+    }
+    u32 all = 1;
+    for (u32 l = 0; l < OBB_LANES; ++l) {
+        all &= sep[l];
+    }
+    if (!all) {
+        for (u32 i = 0; i < 3; ++i) {
+            u32 i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+            for (u32 j = 0; j < 3; ++j) {
+                u32 j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+                for (u32 l = 0; l < OBB_LANES; ++l) {
+                    f32 ra = ea[i1][l] * ar[i2][j][l] + ea[i2][l] * ar[i1][j][l];
+                    f32 rb = eb[j1][l] * ar[i][j2][l] + eb[j2][l] * ar[i][j1][l];
+                    f32 dist = t[i2][l] * r[i1][j][l] - t[i1][l] * r[i2][j][l];
+                    sep[l] |= fabsf(dist) > ra + rb;
+                }
+            }
+        }
+    }
+
+    u32 mask = 0;
+    for (u32 l = 0; l < n; ++l) {
+        mask |= (sep[l] ^ 1) << l;
+    }
+    return mask;
+}
+
+#endif
 #endif
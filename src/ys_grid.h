@@ -0,0 +1,500 @@
+#ifndef YS_GRID_H
+#define YS_GRID_H
+
+#include "ys_geom.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Voxels per side of a brick in a brick_grid. A brick is 8x8x8 bits.
+#define BRICK_SIZE 8
+#define BRICK_WORDS (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE / 64)
+#define BRICK_EMPTY 0xFFFFFFFFu
+
+// Rays walked in lockstep by voxel_grid_raycast_batch.
+#define GRID_LANES 8
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Amanatides-Woo traversal state. `cell` is the current cell and `t` the
+// ray distance at which the ray entered it.
+typedef struct grid_dda {
+    i32 cell[3];
+    i32 step[3];
+    i32 dims[3];
+    f32 t_next[3];   // distance to the next cell boundary on each axis
+    f32 t_delta[3];  // distance between boundaries on each axis
+    f32 t;
+    f32 t_end;
+} grid_dda;
+
+// Dense bit-packed occupancy grid, x fastest.
+typedef struct voxel_grid {
+    u64* bits;
+    i32 dims[3];
+    point3 origin;
+    f32 cell_size;
+} voxel_grid;
+
+// Sparse two level occupancy grid: a coarse grid of BRICK_SIZE^3 bricks
+// where only bricks with occupied voxels are stored. Empty bricks are
+// skipped by the coarse traversal without touching voxel data.
+typedef struct brick_grid {
+    u32* bricks;      // brick slot per coarse cell or BRICK_EMPTY
+    u64* brick_bits;  // BRICK_WORDS per allocated brick
+    u32 brick_count;
+    u32 brick_capacity;
+    i32 dims[3];      // in bricks
+    point3 origin;
+    f32 cell_size;    // voxel size
+} brick_grid;
+
+// Height samples over the xz plane, one column per cell.
+typedef struct heightfield {
+    f32* heights;     // x fastest
+    i32 dims[2];      // cells along x and z
+    point3 origin;
+    f32 cell_size;
+} heightfield;
+
+
+/*
+ * === GRID DDA INTERFACE ===
+*/
+b32 grid_dda_init(grid_dda* d, const i32 dims[3], const point3 origin, const f32 cell_size,
+        const ray3 r, const f32 t_max);
+b32 grid_dda_step(grid_dda* d);
+f32 grid_dda_exit(const grid_dda* d);
+
+
+/*
+ * === VOXEL GRID INTERFACE ===
+*/
+b32 voxel_grid_create(voxel_grid* g, const i32 dims[3], const point3 origin, const f32 cell_size);
+void voxel_grid_free(voxel_grid* g);
+b32 voxel_grid_get(const voxel_grid* g, const i32 x, const i32 y, const i32 z);
+void voxel_grid_set(voxel_grid* g, const i32 x, const i32 y, const i32 z);
+void voxel_grid_clear(voxel_grid* g, const i32 x, const i32 y, const i32 z);
+b32 voxel_grid_raycast(const voxel_grid* g, const ray3 r, const f32 t_max, f32* t_hit, i32 cell[3]);
+b32 voxel_grid_visible(const voxel_grid* g, const point3 a, const point3 b);
+u32 voxel_grid_raycast_batch(const voxel_grid* g, const ray3* rays, const u32 count, const f32 t_max,
+        u32* mask, f32* t);
+
+
+/*
+ * === BRICK GRID INTERFACE ===
+*/
+b32 brick_grid_create(brick_grid* g, const i32 dims[3], const point3 origin, const f32 cell_size,
+        const u32 max_bricks);
+void brick_grid_free(brick_grid* g);
+b32 brick_grid_get(const brick_grid* g, const i32 x, const i32 y, const i32 z);
+b32 brick_grid_set(brick_grid* g, const i32 x, const i32 y, const i32 z);
+b32 brick_grid_raycast(const brick_grid* g, const ray3 r, const f32 t_max, f32* t_hit, i32 cell[3]);
+
+
+/*
+ * === HEIGHTFIELD INTERFACE ===
+*/
+b32 heightfield_raycast(const heightfield* h, const ray3 r, const f32 t_max, f32* t_hit);
+
+
+#ifdef YS_GRID_IMPLEMENTATION
+
+/*
+ * ==== GRID DDA =======
+*/
+
+// Clips the ray to the grid box and sets up the walk from the first cell
+// it enters. Returns 0 when the ray misses the grid within t_max.
+b32 grid_dda_init(grid_dda* d, const i32 dims[3], const point3 origin, const f32 cell_size,
+        const ray3 r, const f32 t_max) {
+    aabb3 box;
+    box.min = origin;
+    box.max.x = origin.x + dims[0] * cell_size;
+    box.max.y = origin.y + dims[1] * cell_size;
+    box.max.z = origin.z + dims[2] * cell_size;
+    vec3 inv = ray3_inv_dir(r);
+    f32 t_enter;
+    if (!ray3_aabb3(r, inv, box, t_max, &t_enter)) {
+        return 0;
+    }
+
+    d->t = t_enter;
+    d->t_end = t_max;
+    point3 p = ray3_at(r, t_enter);
+    f32 inv_cell = 1.0f / cell_size;
+    for (int i = 0; i < 3; ++i) {
+        d->dims[i] = dims[i];
+        i32 c = (i32)floorf((p.e[i] - origin.e[i]) * inv_cell);
+        c = c < 0 ? 0 : c >= dims[i] ? dims[i] - 1 : c;
+        d->cell[i] = c;
+
+        f32 dir = r.dir.e[i];
+        if (dir > 0) {
+            d->step[i] = 1;
+            d->t_delta[i] = cell_size / dir;
+            d->t_next[i] = (origin.e[i] + (c + 1) * cell_size - r.origin.e[i]) / dir;
+        } else if (dir < 0) {
+            d->step[i] = -1;
+            d->t_delta[i] = -cell_size / dir;
+            d->t_next[i] = (origin.e[i] + c * cell_size - r.origin.e[i]) / dir;
+        } else {
+            d->step[i] = 0;
+            d->t_delta[i] = FLT_MAX;
+            d->t_next[i] = FLT_MAX;
+        }
+    }
+    return 1;
+}
+
+// Moves to the next cell along the ray. Returns 0 once the ray leaves
+// the grid or passes t_max.
+b32 grid_dda_step(grid_dda* d) {
+    int axis = d->t_next[0] < d->t_next[1]
+        ? (d->t_next[0] < d->t_next[2] ? 0 : 2)
+        : (d->t_next[1] < d->t_next[2] ? 1 : 2);
+    d->t = d->t_next[axis];
+    if (d->t > d->t_end) {
+        return 0;
+    }
+    d->cell[axis] += d->step[axis];
+    d->t_next[axis] += d->t_delta[axis];
+    return d->cell[axis] >= 0 && d->cell[axis] < d->dims[axis];
+}
+
+// Distance at which the ray leaves the current cell.
+f32 grid_dda_exit(const grid_dda* d) {
+    f32 t = d->t_next[0] < d->t_next[1] ? d->t_next[0] : d->t_next[1];
+    t = d->t_next[2] < t ? d->t_next[2] : t;
+    return t < d->t_end ? t : d->t_end;
+}
+
+
+/*
+ * ==== VOXEL GRID =======
+*/
+
+b32 voxel_grid_create(voxel_grid* g, const i32 dims[3], const point3 origin, const f32 cell_size) {
+    u64 voxels = (u64)dims[0] * dims[1] * dims[2];
+    u64 words = (voxels + 63) / 64;
+    g->bits = (u64*)YS_MALLOC(sizeof(u64) * (words > 0 ? words : 1));
+    if (!g->bits) {
+        return 0;
+    }
+    for (u64 i = 0; i < words; ++i) {
+        g->bits[i] = 0;
+    }
+    for (int i = 0; i < 3; ++i) {
+        g->dims[i] = dims[i];
+    }
+    g->origin = origin;
+    g->cell_size = cell_size;
+    return 1;
+}
+
+void voxel_grid_free(voxel_grid* g) {
+    YS_FREE(g->bits);
+    g->bits = 0;
+}
+
+inline b32 voxel_grid_get(const voxel_grid* g, const i32 x, const i32 y, const i32 z) {
+    u64 i = (u64)x + (u64)g->dims[0] * ((u64)y + (u64)g->dims[1] * z);
+    return (g->bits[i >> 6] >> (i & 63)) & 1;
+}
+
+inline void voxel_grid_set(voxel_grid* g, const i32 x, const i32 y, const i32 z) {
+    u64 i = (u64)x + (u64)g->dims[0] * ((u64)y + (u64)g->dims[1] * z);
+    g->bits[i >> 6] |= (u64)1 << (i & 63);
+}
+
+inline void voxel_grid_clear(voxel_grid* g, const i32 x, const i32 y, const i32 z) {
+    u64 i = (u64)x + (u64)g->dims[0] * ((u64)y + (u64)g->dims[1] * z);
+    g->bits[i >> 6] &= ~((u64)1 << (i & 63));
+}
+
+// First occupied voxel along the ray. t_hit is where the ray enters it.
+b32 voxel_grid_raycast(const voxel_grid* g, const ray3 r, const f32 t_max, f32* t_hit, i32 cell[3]) {
+    grid_dda d;
+    if (!grid_dda_init(&d, g->dims, g->origin, g->cell_size, r, t_max)) {
+        return 0;
+    }
+    do {
+        if (voxel_grid_get(g, d.cell[0], d.cell[1], d.cell[2])) {
+            *t_hit = d.t;
+            cell[0] = d.cell[0];
+            cell[1] = d.cell[1];
+            cell[2] = d.cell[2];
+            return 1;
+        }
+    } while (grid_dda_step(&d));
+    return 0;
+}
+
+// Line of sight between two points: no occupied voxel on the segment.
+b32 voxel_grid_visible(const voxel_grid* g, const point3 a, const point3 b) {
+    ray3 r;
+    r.origin = a;
+    r.dir = vec3_sub(b, a);
+    f32 t;
+    i32 cell[3];
+    return !voxel_grid_raycast(g, r, 1.0f, &t, cell);
+}
+
+// Walks GRID_LANES rays at a time, one cell per lane per iteration, with
+// the traversal state kept in lanes. Lanes that finish are refilled from
+// the remaining rays, so the loop stays full until the batch runs dry.
+// Output follows the ray3 batch queries in ys_geom.h: t[i] is the entry
+// distance of the first occupied voxel or t_max, and bit i % 32 of
+// mask[i / 32] is set for hits. Returns the number of hits.
+u32 voxel_grid_raycast_batch(const voxel_grid* g, const ray3* rays, const u32 count, const f32 t_max,
+        u32* mask, f32* t) {
+    i32 cx[GRID_LANES], cy[GRID_LANES], cz[GRID_LANES];
+    i32 sx[GRID_LANES], sy[GRID_LANES], sz[GRID_LANES];
+    f32 nx[GRID_LANES], ny[GRID_LANES], nz[GRID_LANES];
+    f32 dx[GRID_LANES], dy[GRID_LANES], dz[GRID_LANES];
+    f32 lt[GRID_LANES], lend[GRID_LANES];
+    u32 id[GRID_LANES];
+    b32 live[GRID_LANES];
+
+    for (u32 i = 0; i < (count + 31) / 32; ++i) {
+        mask[i] = 0;
+    }
+    u32 next = 0;
+    u32 hits = 0;
+    u32 live_count = 0;
+    for (u32 l = 0; l < GRID_LANES; ++l) {
+        cx[l] = cy[l] = cz[l] = sx[l] = sy[l] = sz[l] = 0;
+        nx[l] = ny[l] = nz[l] = dx[l] = dy[l] = dz[l] = lt[l] = lend[l] = 0;
+        id[l] = 0;
+        live[l] = 0;
+    }
+
+    for (;;) {
+        // Refill idle lanes.
+        for (u32 l = 0; l < GRID_LANES; ++l) {
+            while (!live[l] && next < count) {
+                u32 i = next++;
+                t[i] = t_max;
+                grid_dda d;
+                if (!grid_dda_init(&d, g->dims, g->origin, g->cell_size, rays[i], t_max)) {
+                    continue;
+                }
+                cx[l] = d.cell[0];
+                cy[l] = d.cell[1];
+                cz[l] = d.cell[2];
+                sx[l] = d.step[0];
+                sy[l] = d.step[1];
+                sz[l] = d.step[2];
+                nx[l] = d.t_next[0];
+                ny[l] = d.t_next[1];
+                nz[l] = d.t_next[2];
+                dx[l] = d.t_delta[0];
+                dy[l] = d.t_delta[1];
+                dz[l] = d.t_delta[2];
+                lt[l] = d.t;
+                lend[l] = d.t_end;
+                id[l] = i;
+                live[l] = 1;
+                ++live_count;
+            }
+        }
+        if (live_count == 0) {
+            break;
+        }
+
+        for (u32 l = 0; l < GRID_LANES; ++l) {
+            if (!live[l]) {
+                continue;
+            }
+            if (voxel_grid_get(g, cx[l], cy[l], cz[l])) {
+                u32 i = id[l];
+                t[i] = lt[l];
+                mask[i >> 5] |= 1u << (i & 31);
+                ++hits;
+                live[l] = 0;
+                --live_count;
+            }
+        }
+
+        // Branch free step of every lane along its nearest boundary.
+        for (u32 l = 0; l < GRID_LANES; ++l) {
+            b32 bx = nx[l] <= ny[l] && nx[l] <= nz[l];
+            b32 by = !bx && ny[l] <= nz[l];
+            b32 bz = !bx && !by;
+            lt[l] = bx ? nx[l] : by ? ny[l] : nz[l];
+            cx[l] += bx ? sx[l] : 0;
+            cy[l] += by ? sy[l] : 0;
+            cz[l] += bz ? sz[l] : 0;
+            nx[l] += bx ? dx[l] : 0;
+            ny[l] += by ? dy[l] : 0;
+            nz[l] += bz ? dz[l] : 0;
+        }
+
+        for (u32 l = 0; l < GRID_LANES; ++l) {
+            b32 inside = cx[l] >= 0 && cx[l] < g->dims[0]
+                && cy[l] >= 0 && cy[l] < g->dims[1]
+                && cz[l] >= 0 && cz[l] < g->dims[2]
+                && lt[l] <= lend[l];
+            if (live[l] && !inside) {
+                live[l] = 0;
+                --live_count;
+            }
+        }
+    }
+    return hits;
+}
+
+
+/*
+ * ==== BRICK GRID =======
+*/
+
+b32 brick_grid_create(brick_grid* g, const i32 dims[3], const point3 origin, const f32 cell_size,
+        const u32 max_bricks) {
+    u64 cells = (u64)dims[0] * dims[1] * dims[2];
+    g->bricks = (u32*)YS_MALLOC(sizeof(u32) * (cells > 0 ? cells : 1));
+    g->brick_bits = (u64*)YS_MALLOC(sizeof(u64) * BRICK_WORDS * (max_bricks > 0 ? max_bricks : 1));
+    if (!g->bricks || !g->brick_bits) {
+        brick_grid_free(g);
+        return 0;
+    }
+    for (u64 i = 0; i < cells; ++i) {
+        g->bricks[i] = BRICK_EMPTY;
+    }
+    for (int i = 0; i < 3; ++i) {
+        g->dims[i] = dims[i];
+    }
+    g->brick_count = 0;
+    g->brick_capacity = max_bricks;
+    g->origin = origin;
+    g->cell_size = cell_size;
+    return 1;
+}
+
+void brick_grid_free(brick_grid* g) {
+    YS_FREE(g->bricks);
+    YS_FREE(g->brick_bits);
+    g->bricks = 0;
+    g->brick_bits = 0;
+    g->brick_count = 0;
+}
+
+static u32 brick_grid_slot(const brick_grid* g, const i32 bx, const i32 by, const i32 bz) {
+    return g->bricks[(u64)bx + (u64)g->dims[0] * ((u64)by + (u64)g->dims[1] * bz)];
+}
+
+static b32 brick_get(const u64* bits, const i32 x, const i32 y, const i32 z) {
+    u32 i = (u32)(x + BRICK_SIZE * (y + BRICK_SIZE * z));
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+// x, y and z are voxel coordinates.
+b32 brick_grid_get(const brick_grid* g, const i32 x, const i32 y, const i32 z) {
+    u32 slot = brick_grid_slot(g, x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE);
+    if (slot == BRICK_EMPTY) {
+        return 0;
+    }
+    return brick_get(g->brick_bits + (u64)slot * BRICK_WORDS,
+        x % BRICK_SIZE, y % BRICK_SIZE, z % BRICK_SIZE);
+}
+
+// Returns 0 when the voxel needs a new brick and the grid is out of
+// brick capacity.
+b32 brick_grid_set(brick_grid* g, const i32 x, const i32 y, const i32 z) {
+    u64 cell = (u64)(x / BRICK_SIZE) + (u64)g->dims[0] * ((u64)(y / BRICK_SIZE) + (u64)g->dims[1] * (z / BRICK_SIZE));
+    u32 slot = g->bricks[cell];
+    if (slot == BRICK_EMPTY) {
+        if (g->brick_count == g->brick_capacity) {
+            return 0;
+        }
+        slot = g->brick_count++;
+        g->bricks[cell] = slot;
+        for (u32 i = 0; i < BRICK_WORDS; ++i) {
+            g->brick_bits[(u64)slot * BRICK_WORDS + i] = 0;
+        }
+    }
+    u32 i = (u32)(x % BRICK_SIZE + BRICK_SIZE * (y % BRICK_SIZE + BRICK_SIZE * (z % BRICK_SIZE)));
+    g->brick_bits[(u64)slot * BRICK_WORDS + (i >> 6)] |= (u64)1 << (i & 63);
+    return 1;
+}
+
+// Coarse DDA over bricks; only non-empty bricks start a fine DDA over
+// their voxels, limited to the span the ray spends inside the brick.
+b32 brick_grid_raycast(const brick_grid* g, const ray3 r, const f32 t_max, f32* t_hit, i32 cell[3]) {
+    f32 brick_size = g->cell_size * BRICK_SIZE;
+    grid_dda coarse;
+    if (!grid_dda_init(&coarse, g->dims, g->origin, brick_size, r, t_max)) {
+        return 0;
+    }
+    const i32 brick_dims[3] = {BRICK_SIZE, BRICK_SIZE, BRICK_SIZE};
+    do {
+        u32 slot = brick_grid_slot(g, coarse.cell[0], coarse.cell[1], coarse.cell[2]);
+        if (slot == BRICK_EMPTY) {
+            continue;
+        }
+        point3 brick_origin;
+        brick_origin.x = g->origin.x + coarse.cell[0] * brick_size;
+        brick_origin.y = g->origin.y + coarse.cell[1] * brick_size;
+        brick_origin.z = g->origin.z + coarse.cell[2] * brick_size;
+        const u64* bits = g->brick_bits + (u64)slot * BRICK_WORDS;
+
+        grid_dda fine;
+        if (!grid_dda_init(&fine, brick_dims, brick_origin, g->cell_size, r, grid_dda_exit(&coarse))) {
+            continue;
+        }
+        do {
+            if (brick_get(bits, fine.cell[0], fine.cell[1], fine.cell[2])) {
+                *t_hit = fine.t;
+                cell[0] = coarse.cell[0] * BRICK_SIZE + fine.cell[0];
+                cell[1] = coarse.cell[1] * BRICK_SIZE + fine.cell[1];
+                cell[2] = coarse.cell[2] * BRICK_SIZE + fine.cell[2];
+                return 1;
+            }
+        } while (grid_dda_step(&fine));
+    } while (grid_dda_step(&coarse));
+    return 0;
+}
+
+
+/*
+ * ==== HEIGHTFIELD =======
+*/
+
+// Walks the columns under the ray with the 3D DDA on a one cell thick
+// grid: dropping the y direction keeps t the same for x and z. A column
+// is hit once the ray dips below its height inside the column.
+b32 heightfield_raycast(const heightfield* h, const ray3 r, const f32 t_max, f32* t_hit) {
+    const i32 dims[3] = {h->dims[0], 1, h->dims[1]};
+    ray3 flat = r;
+    flat.origin.y = h->origin.y + h->cell_size * 0.5f;
+    flat.dir.y = 0;
+
+    grid_dda d;
+    if (!grid_dda_init(&d, dims, h->origin, h->cell_size, flat, t_max)) {
+        return 0;
+    }
+    do {
+        f32 height = h->heights[d.cell[0] + h->dims[0] * d.cell[2]];
+        f32 t0 = d.t;
+        f32 t1 = grid_dda_exit(&d);
+        f32 y0 = r.origin.y + r.dir.y * t0;
+        f32 y1 = r.origin.y + r.dir.y * t1;
+        if (y0 <= height) {
+            *t_hit = t0;
+            return 1;
+        }
+        if (y1 <= height) {
+            *t_hit = t0 + (height - y0) / (y1 - y0) * (t1 - t0);
+            return 1;
+        }
+    } while (grid_dda_step(&d));
+    return 0;
+}
+
+#endif
+#endif
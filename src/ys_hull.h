@@ -0,0 +1,986 @@
+#ifndef YS_HULL_H
+#define YS_HULL_H
+
+#include "ys_geom.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+#define HULL_NONE 0xFFFFFFFFu
+
+// Points per parallel_for chunk of the prefilter passes.
+#define HULL_GRAIN 16384
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Half-edge of a hull face, running from `vertex` to the vertex of `next`.
+// Face f owns edges 3f, 3f + 1 and 3f + 2.
+typedef struct hull_edge {
+    u32 vertex;
+    u32 next;
+    u32 twin;
+    u32 face;
+} hull_edge;
+
+// Plane normals point out of the hull.
+typedef struct hull_face {
+    plane plane;
+    u32 edge;
+} hull_face;
+
+// Triangulated convex hull as a closed half-edge mesh, faces counter-
+// clockwise seen from outside. Everything, including the scratch space
+// of a build, lives in one arena sized for `point_capacity` input points,
+// so building never allocates. `vertices` and `vertex_count` can be fed
+// to a `hull` for the GJK queries.
+typedef struct hull_mesh {
+    point3* vertices;
+    u32* vertex_ids;     // input index of each vertex
+    hull_edge* edges;
+    hull_face* faces;
+    u32 vertex_count;
+    u32 edge_count;
+    u32 face_count;
+    u32 point_capacity;
+    u8* arena;
+    u64 arena_size;
+} hull_mesh;
+
+
+/*
+ * === HULL INTERFACE ===
+*/
+b32 hull_mesh_create(hull_mesh* h, const u32 max_points);
+void hull_mesh_free(hull_mesh* h);
+b32 quickhull3(hull_mesh* h, const point3* points, const u32 count);
+u32 quickhull2(const point2* points, const u32 count, u32* hull);
+
+
+#ifdef YS_HULL_IMPLEMENTATION
+
+// Points inside the hull of the extreme points along these directions
+// cannot be hull vertices. Seven axes give 14 extremes in 3D, four give
+// an octagon in 2D.
+#define HULL_DIRS3 7
+#define HULL_DIRS2 4
+#define HULL_MAX_PLANES (4 * HULL_DIRS3)
+#define HULL_BLOCK 64
+
+static const f32 hull_dirs3[HULL_DIRS3][3] = {
+    {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1},
+};
+
+static const f32 hull_dirs2[HULL_DIRS2][2] = {{1, 0}, {0, 1}, {1, 1}, {-1, 1}};
+
+
+typedef struct hull_state {
+    point3* points;      // candidate points
+    u32* ids;            // input index per candidate
+    u8* keep;            // prefilter result per input point
+    u32 count;
+    f32 epsilon;
+    u32* point_next;     // outside set links
+    plane* face_plane;
+    u32* face_outside;   // first outside point or HULL_NONE
+    u32* face_far;       // farthest outside point
+    f32* face_far_dist;
+    u32* pending_next;   // list of the faces with outside points
+    u32* pending_prev;
+    u32 pending;
+    u32* face_mark;
+    u8* face_alive;
+    u32* face_free;
+    u32 free_count;
+    u32 face_used;
+    u32 face_capacity;
+    hull_edge* edges;    // 3 per face slot
+    u32* stack;          // face, next edge and edges left per DFS entry
+    u32* visible;
+    u32* horizon_vertex;
+    u32* horizon_twin;
+    u32* new_faces;
+} hull_state;
+
+// Faces a hull of n points can hold while it grows, counting the new
+// faces of a step that are made before the visible ones are released.
+static u32 hull_face_capacity(const u32 n) {
+    return 3 * n + 8;
+}
+
+static void* hull_take(u8* base, u64* offset, const u64 size) {
+    u64 at = *offset;
+    *offset += (size + 15) & ~(u64)15;
+    return base ? base + at : 0;
+}
+
+// Lays the output and the scratch state out in the arena. With a null
+// arena it only measures. Returns the bytes used.
+static u64 hull_layout(hull_mesh* h, hull_state* s, u8* base, const u32 n) {
+    u32 faces = hull_face_capacity(n);
+    u64 offset = 0;
+    h->vertices = (point3*)hull_take(base, &offset, sizeof(point3) * n);
+    h->vertex_ids = (u32*)hull_take(base, &offset, sizeof(u32) * n);
+    h->edges = (hull_edge*)hull_take(base, &offset, sizeof(hull_edge) * 6 * n);
+    h->faces = (hull_face*)hull_take(base, &offset, sizeof(hull_face) * 2 * n);
+    s->points = (point3*)hull_take(base, &offset, sizeof(point3) * n);
+    s->ids = (u32*)hull_take(base, &offset, sizeof(u32) * n);
+    s->keep = (u8*)hull_take(base, &offset, n);
+    s->point_next = (u32*)hull_take(base, &offset, sizeof(u32) * n);
+    s->face_plane = (plane*)hull_take(base, &offset, sizeof(plane) * faces);
+    s->face_outside = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->face_far = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->face_far_dist = (f32*)hull_take(base, &offset, sizeof(f32) * faces);
+    s->pending_next = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->pending_prev = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->face_mark = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->face_alive = (u8*)hull_take(base, &offset, faces);
+    s->face_free = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->edges = (hull_edge*)hull_take(base, &offset, sizeof(hull_edge) * 3 * faces);
+    s->stack = (u32*)hull_take(base, &offset, sizeof(u32) * 3 * faces);
+    s->visible = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->horizon_vertex = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->horizon_twin = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->new_faces = (u32*)hull_take(base, &offset, sizeof(u32) * faces);
+    s->face_capacity = faces;
+    return offset;
+}
+
+// One allocation holds everything quickhull3 needs for up to max_points
+// input points.
+b32 hull_mesh_create(hull_mesh* h, const u32 max_points) {
+    hull_state s;
+    u32 n = max_points > 4 ? max_points : 4;
+    h->arena_size = hull_layout(h, &s, 0, n);
+    h->arena = (u8*)YS_MALLOC(h->arena_size);
+    h->point_capacity = n;
+    h->vertex_count = 0;
+    h->edge_count = 0;
+    h->face_count = 0;
+    if (!h->arena) {
+        hull_mesh_free(h);
+        return 0;
+    }
+    hull_layout(h, &s, h->arena, n);
+    return 1;
+}
+
+void hull_mesh_free(hull_mesh* h) {
+    YS_FREE(h->arena);
+    h->arena = 0;
+    h->arena_size = 0;
+    h->point_capacity = 0;
+    h->vertices = 0;
+    h->vertex_ids = 0;
+    h->edges = 0;
+    h->faces = 0;
+    h->vertex_count = 0;
+    h->edge_count = 0;
+    h->face_count = 0;
+}
+
+
+/*
+ * ==== PREFILTER =======
+*/
+
+// Extremes are kept per thread and merged after the pass; culling writes
+// one flag per point. Both passes copy blocks of points into plain
+// arrays so the per-direction and per-plane loops vectorize.
+typedef struct hull_job {
+    const f32* coords;   // x, y[, z] interleaved
+    u32 dims;
+    u32 dir_count;
+    const f32* dirs;
+    f32 best[YS_MAX_THREADS][2 * HULL_DIRS3];
+    u32 best_index[YS_MAX_THREADS][2 * HULL_DIRS3];
+    const plane* planes;
+    u32 plane_count;
+    f32 epsilon;
+    u8* keep;
+} hull_job;
+
+static void hull_job_init(hull_job* job, const f32* coords, const u32 dims, const f32* dirs, const u32 dir_count) {
+    job->coords = coords;
+    job->dims = dims;
+    job->dirs = dirs;
+    job->dir_count = dir_count;
+    for (u32 t = 0; t < YS_MAX_THREADS; ++t) {
+        for (u32 k = 0; k < 2 * dir_count; ++k) {
+            job->best[t][k] = -FLT_MAX;
+            job->best_index[t][k] = 0;
+        }
+    }
+}
+
+// Copies a block of points into x, y and z (z is zero in 2D).
+static void hull_load(const hull_job* job, const u32 base, const u32 n, f32* x, f32* y, f32* z) {
+    const f32* c = job->coords + (u64)base * job->dims;
+    for (u32 i = 0; i < n; ++i) {
+        x[i] = c[i * job->dims];
+        y[i] = c[i * job->dims + 1];
+        z[i] = job->dims == 3 ? c[i * job->dims + 2] : 0.0f;
+    }
+}
+
+// Max and min of the dot product with each direction. Blocks are only
+// scanned for the index when their max or min beats the thread's best.
+static void hull_extremes_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    hull_job* job = (hull_job*)ctx;
+    f32* best = job->best[thread];
+    u32* best_index = job->best_index[thread];
+    f32 x[HULL_BLOCK], y[HULL_BLOCK], z[HULL_BLOCK], d[HULL_BLOCK];
+    for (u32 base = begin; base < end; base += HULL_BLOCK) {
+        u32 n = end - base < HULL_BLOCK ? end - base : HULL_BLOCK;
+        hull_load(job, base, n, x, y, z);
+        for (u32 k = 0; k < job->dir_count; ++k) {
+            const f32* dir = job->dirs + k * job->dims;
+            f32 dx = dir[0], dy = dir[1], dz = job->dims == 3 ? dir[2] : 0.0f;
+            f32 hi = -FLT_MAX, lo = FLT_MAX;
+            for (u32 i = 0; i < n; ++i) {
+                d[i] = dx * x[i] + dy * y[i] + dz * z[i];
+                hi = d[i] > hi ? d[i] : hi;
+                lo = d[i] < lo ? d[i] : lo;
+            }
+            if (hi > best[2 * k]) {
+                u32 i = 0;
+                while (d[i] != hi) {
+                    ++i;
+                }
+                best[2 * k] = hi;
+                best_index[2 * k] = base + i;
+            }
+            if (-lo > best[2 * k + 1]) {
+                u32 i = 0;
+                while (d[i] != lo) {
+                    ++i;
+                }
+                best[2 * k + 1] = -lo;
+                best_index[2 * k + 1] = base + i;
+            }
+        }
+    }
+}
+
+// Index of the extreme point for each of the 2 * dir_count directions,
+// max then min per direction.
+static void hull_extremes(hull_job* job, const u32 count, u32* extremes) {
+    parallel_for(count, HULL_GRAIN, hull_extremes_task, job);
+    u32 threads = thread_count();
+    for (u32 k = 0; k < 2 * job->dir_count; ++k) {
+        u32 t_best = 0;
+        for (u32 t = 1; t < threads; ++t) {
+            t_best = job->best[t][k] > job->best[t_best][k] ? t : t_best;
+        }
+        extremes[k] = job->best_index[t_best][k];
+    }
+}
+
+// Keeps the points more than epsilon outside of some plane. Points on the
+// polytope within epsilon can only end up on a hull face, not as a
+// corner, so they go too; the extremes themselves are put back after.
+// Plane normals face out of the polytope; 2D edges leave z at zero.
+static void hull_cull_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    hull_job* job = (hull_job*)ctx;
+    (void)thread;
+    f32 x[HULL_BLOCK], y[HULL_BLOCK], z[HULL_BLOCK], d[HULL_BLOCK];
+    for (u32 base = begin; base < end; base += HULL_BLOCK) {
+        u32 n = end - base < HULL_BLOCK ? end - base : HULL_BLOCK;
+        hull_load(job, base, n, x, y, z);
+        for (u32 i = 0; i < n; ++i) {
+            d[i] = -FLT_MAX;
+        }
+        for (u32 k = 0; k < job->plane_count; ++k) {
+            plane p = job->planes[k];
+            for (u32 i = 0; i < n; ++i) {
+                f32 dist = p.normal.x * x[i] + p.normal.y * y[i] + p.normal.z * z[i] - p.d;
+                d[i] = dist > d[i] ? dist : d[i];
+            }
+        }
+        u8* keep = job->keep + base;
+        for (u32 i = 0; i < n; ++i) {
+            keep[i] = d[i] > job->epsilon;
+        }
+    }
+}
+
+// Scale aware tolerance from the largest coordinates (Gregorius, "Robust
+// Contact Creation for Physics Simulations").
+static f32 hull_epsilon(const f32* coords, const u32 dims, const u32* extremes) {
+    f32 sum = 0.0f;
+    for (u32 k = 0; k < dims; ++k) {
+        f32 hi = fabsf(coords[(u64)extremes[2 * k] * dims + k]);
+        f32 lo = fabsf(coords[(u64)extremes[2 * k + 1] * dims + k]);
+        sum += hi > lo ? hi : lo;
+    }
+    return 3.0f * FLT_EPSILON * sum;
+}
+
+
+/*
+ * ==== QUICKHULL 3D =======
+*/
+
+static f32 hull_dist(const plane p, const point3 v) {
+    return vec3_dot(p.normal, v) - p.d;
+}
+
+static void hull_pending_link(hull_state* s, const u32 f) {
+    s->pending_prev[f] = HULL_NONE;
+    s->pending_next[f] = s->pending;
+    if (s->pending != HULL_NONE) {
+        s->pending_prev[s->pending] = f;
+    }
+    s->pending = f;
+}
+
+static void hull_pending_unlink(hull_state* s, const u32 f) {
+    if (s->pending_prev[f] != HULL_NONE) {
+        s->pending_next[s->pending_prev[f]] = s->pending_next[f];
+    } else {
+        s->pending = s->pending_next[f];
+    }
+    if (s->pending_next[f] != HULL_NONE) {
+        s->pending_prev[s->pending_next[f]] = s->pending_prev[f];
+    }
+}
+
+// Sets up the edges and plane of face slot f. The normal comes from the
+// two shorter edges, which keeps it accurate for long thin faces.
+static void hull_set_face(hull_state* s, const u32 f, const u32 a, const u32 b, const u32 c) {
+    u32 v[3] = {a, b, c};
+    for (u32 k = 0; k < 3; ++k) {
+        hull_edge* e = &s->edges[3 * f + k];
+        e->vertex = v[k];
+        e->next = 3 * f + (k + 1) % 3;
+        e->twin = HULL_NONE;
+        e->face = f;
+    }
+    point3 pa = s->points[a], pb = s->points[b], pc = s->points[c];
+    vec3 ab = vec3_sub(pb, pa), bc = vec3_sub(pc, pb), ca = vec3_sub(pa, pc);
+    f32 lab = vec3_len_sq(ab), lbc = vec3_len_sq(bc), lca = vec3_len_sq(ca);
+    vec3 n;
+    if (lab >= lbc && lab >= lca) {
+        n = vec3_cross(bc, ca);
+    } else if (lbc >= lca) {
+        n = vec3_cross(ca, ab);
+    } else {
+        n = vec3_cross(ab, bc);
+    }
+    f32 len = vec3_len(n);
+    n = len > 0 ? vec3_mul_s(n, 1.0f / len) : n;
+    point3 centroid = vec3_mul_s(vec3_add(vec3_add(pa, pb), pc), 1.0f / 3.0f);
+    s->face_plane[f].normal = n;
+    s->face_plane[f].d = vec3_dot(n, centroid);
+    s->face_outside[f] = HULL_NONE;
+    s->face_far_dist[f] = 0.0f;
+    s->face_mark[f] = 0;
+    s->face_alive[f] = 1;
+}
+
+// Takes a face slot and sets it up. Returns HULL_NONE when the arena is
+// full.
+static u32 hull_add_face(hull_state* s, const u32 a, const u32 b, const u32 c) {
+    u32 f;
+    if (s->free_count > 0) {
+        f = s->face_free[--s->free_count];
+    } else if (s->face_used < s->face_capacity) {
+        f = s->face_used++;
+    } else {
+        return HULL_NONE;
+    }
+    hull_set_face(s, f, a, b, c);
+    return f;
+}
+
+// Puts point p in the outside set of the first face it is above. Points
+// below every face are inside the hull and dropped.
+static void hull_assign(hull_state* s, const u32 p, const u32* faces, const u32 face_count) {
+    for (u32 i = 0; i < face_count; ++i) {
+        u32 f = faces[i];
+        f32 d = hull_dist(s->face_plane[f], s->points[p]);
+        if (d > s->epsilon) {
+            if (s->face_outside[f] == HULL_NONE) {
+                hull_pending_link(s, f);
+            }
+            s->point_next[p] = s->face_outside[f];
+            s->face_outside[f] = p;
+            if (d > s->face_far_dist[f]) {
+                s->face_far_dist[f] = d;
+                s->face_far[f] = p;
+            }
+            return;
+        }
+    }
+}
+
+// Initial tetrahedron: the points farthest apart along an axis, the point
+// farthest from their line and the point farthest from that plane.
+// Returns 0 when the points are coplanar within epsilon.
+static b32 hull_simplex(hull_state* s) {
+    u32 lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+    for (u32 i = 1; i < s->count; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = s->points[i].e[k] < s->points[lo[k]].e[k] ? i : lo[k];
+            hi[k] = s->points[i].e[k] > s->points[hi[k]].e[k] ? i : hi[k];
+        }
+    }
+    int axis = 0;
+    for (int k = 1; k < 3; ++k) {
+        f32 spread = s->points[hi[k]].e[k] - s->points[lo[k]].e[k];
+        axis = spread > s->points[hi[axis]].e[axis] - s->points[lo[axis]].e[axis] ? k : axis;
+    }
+    u32 v0 = lo[axis], v1 = hi[axis];
+    point3 a = s->points[v0];
+    vec3 ab = vec3_sub(s->points[v1], a);
+    f32 ab_len = vec3_len(ab);
+    if (ab_len <= s->epsilon) {
+        return 0;
+    }
+
+    u32 v2 = v0;
+    f32 best = 0.0f;
+    for (u32 i = 0; i < s->count; ++i) {
+        f32 d = vec3_len_sq(vec3_cross(ab, vec3_sub(s->points[i], a)));
+        v2 = d > best ? i : v2;
+        best = d > best ? d : best;
+    }
+    vec3 n = vec3_cross(ab, vec3_sub(s->points[v2], a));
+    f32 len = vec3_len(n);
+    if (len <= s->epsilon * ab_len) {
+        return 0;
+    }
+    n = vec3_mul_s(n, 1.0f / len);
+
+    u32 v3 = v0;
+    best = 0.0f;
+    for (u32 i = 0; i < s->count; ++i) {
+        f32 d = fabsf(vec3_dot(n, vec3_sub(s->points[i], a)));
+        v3 = d > best ? i : v3;
+        best = d > best ? d : best;
+    }
+    if (best <= s->epsilon) {
+        return 0;
+    }
+    // Wind the base so that it faces away from v3.
+    if (vec3_dot(n, vec3_sub(s->points[v3], a)) > 0) {
+        u32 t = v1;
+        v1 = v2;
+        v2 = t;
+    }
+
+    u32 faces[4];
+    faces[0] = hull_add_face(s, v0, v1, v2);
+    faces[1] = hull_add_face(s, v0, v3, v1);
+    faces[2] = hull_add_face(s, v1, v3, v2);
+    faces[3] = hull_add_face(s, v2, v3, v0);
+    for (u32 i = 0; i < 12; ++i) {
+        hull_edge* e = &s->edges[i];
+        u32 to = s->edges[e->next].vertex;
+        for (u32 j = 0; j < 12; ++j) {
+            if (s->edges[j].vertex == to && s->edges[s->edges[j].next].vertex == e->vertex) {
+                e->twin = j;
+            }
+        }
+    }
+    for (u32 i = 0; i < s->count; ++i) {
+        if (i != v0 && i != v1 && i != v2 && i != v3) {
+            hull_assign(s, i, faces, 4);
+        }
+    }
+    return 1;
+}
+
+// True when the vertex that edge `from` leaves has an edge to w.
+static b32 hull_has_edge(const hull_state* s, const u32 from, const u32 w) {
+    u32 e = from;
+    do {
+        if (s->edges[s->edges[e].next].vertex == w) {
+            return 1;
+        }
+        e = s->edges[s->edges[e].twin].next;
+    } while (e != from);
+    return 0;
+}
+
+// Flips edge e, a -> b between faces (a, b, c) and (b, a, d), to c -> d
+// when the two faces fold inwards by more than epsilon. The fold is the
+// higher of the two apex heights: a thin face can sit within epsilon of
+// its wide neighbour and still tilt enough to cut points far away. The
+// new faces reuse both slots and take over their outside points: points
+// above neither lie in the tetrahedron that the flip adds to the hull.
+// Returns 0 when nothing changed.
+static b32 hull_flip(hull_state* s, const u32 e) {
+    u32 t = s->edges[e].twin;
+    u32 f = s->edges[e].face, g = s->edges[t].face;
+    u32 e1 = s->edges[e].next, e2 = s->edges[e1].next;
+    u32 t1 = s->edges[t].next, t2 = s->edges[t1].next;
+    u32 a = s->edges[e].vertex, b = s->edges[t].vertex;
+    u32 c = s->edges[e2].vertex, d = s->edges[t2].vertex;
+    f32 up = hull_dist(s->face_plane[f], s->points[d]);
+    f32 down = hull_dist(s->face_plane[g], s->points[c]);
+    if (c == d || (up > down ? up : down) <= s->epsilon || hull_has_edge(s, e2, d)) {
+        return 0;
+    }
+    u32 outer[4] = {s->edges[e2].twin, s->edges[t1].twin, s->edges[t2].twin, s->edges[e1].twin};
+    u32 points = HULL_NONE;
+    u32 faces[2] = {f, g};
+    for (u32 i = 0; i < 2; ++i) {
+        u32 q = s->face_outside[faces[i]];
+        if (q != HULL_NONE) {
+            hull_pending_unlink(s, faces[i]);
+            while (s->point_next[q] != HULL_NONE) {
+                q = s->point_next[q];
+            }
+            s->point_next[q] = points;
+            points = s->face_outside[faces[i]];
+        }
+    }
+    // (c, a, d) and (d, b, c), linked to the four outer edges and to each
+    // other across c -> d.
+    hull_set_face(s, f, c, a, d);
+    hull_set_face(s, g, d, b, c);
+    u32 inner[4] = {3 * f, 3 * f + 1, 3 * g, 3 * g + 1};
+    for (u32 i = 0; i < 4; ++i) {
+        s->edges[inner[i]].twin = outer[i];
+        s->edges[outer[i]].twin = inner[i];
+    }
+    s->edges[3 * f + 2].twin = 3 * g + 2;
+    s->edges[3 * g + 2].twin = 3 * f + 2;
+    for (u32 q = points; q != HULL_NONE;) {
+        u32 next = s->point_next[q];
+        hull_assign(s, q, faces, 2);
+        q = next;
+    }
+    return 1;
+}
+
+// Flips the edges around the new faces until none of them fold inwards.
+// A nearly coplanar horizon face or a thin fan face can leave a concave
+// edge behind, and later points would see the hull through it, so the
+// error grows step by step. Every flip adds a tetrahedron to the hull,
+// which ends the loop; the cap only guards against rounding.
+static void hull_make_convex(hull_state* s, const u32 face_count) {
+    u32 capacity = 3 * s->face_capacity;
+    u32 top = 0;
+    for (u32 i = 0; i < face_count; ++i) {
+        for (u32 k = 0; k < 3; ++k) {
+            s->stack[top++] = 3 * s->new_faces[i] + k;
+        }
+    }
+    u32 flips = 0;
+    while (top > 0 && flips < s->face_capacity) {
+        u32 e = s->stack[--top];
+        u32 f = s->edges[e].face;
+        u32 g = s->edges[s->edges[e].twin].face;
+        if (!hull_flip(s, e)) {
+            continue;
+        }
+        ++flips;
+        // The outer edges of the flipped pair.
+        u32 outer[4] = {3 * f, 3 * f + 1, 3 * g, 3 * g + 1};
+        for (u32 i = 0; i < 4 && top < capacity; ++i) {
+            s->stack[top++] = outer[i];
+        }
+    }
+}
+
+// Adds the farthest point of a pending face. The faces it can see are
+// walked depth first across edges, which leaves the horizon edges in
+// order around it (Gregorius, "Implementing Quickhull"). New faces fan
+// from the horizon to the point and take over the outside points of the
+// faces they replace. Returns 0 when the arena is full.
+static b32 hull_add_point(hull_state* s, const u32 mark) {
+    u32 f0 = s->pending;
+    u32 eye = s->face_far[f0];
+    point3 p = s->points[eye];
+
+    u32 visible = 0;
+    u32 horizon = 0;
+    s->face_mark[f0] = mark;
+    s->visible[visible++] = f0;
+    s->stack[0] = f0;
+    s->stack[1] = 3 * f0;
+    s->stack[2] = 3;
+    u32 top = 1;
+    while (top > 0) {
+        u32* entry = s->stack + 3 * (top - 1);
+        if (entry[2] == 0) {
+            --top;
+            continue;
+        }
+        u32 e = entry[1];
+        entry[1] = s->edges[e].next;
+        --entry[2];
+        u32 twin = s->edges[e].twin;
+        u32 f = s->edges[twin].face;
+        if (s->face_mark[f] == mark) {
+            continue;
+        }
+        if (hull_dist(s->face_plane[f], p) > s->epsilon) {
+            s->face_mark[f] = mark;
+            s->visible[visible++] = f;
+            u32* next = s->stack + 3 * top++;
+            next[0] = f;
+            next[1] = s->edges[twin].next;
+            next[2] = 2;
+        } else {
+            s->horizon_vertex[horizon] = s->edges[e].vertex;
+            s->horizon_twin[horizon] = twin;
+            ++horizon;
+        }
+    }
+
+    // Release the visible faces and gather their outside points.
+    u32 orphans = HULL_NONE;
+    for (u32 i = 0; i < visible; ++i) {
+        u32 f = s->visible[i];
+        u32 q = s->face_outside[f];
+        if (q != HULL_NONE) {
+            hull_pending_unlink(s, f);
+            while (s->point_next[q] != HULL_NONE) {
+                q = s->point_next[q];
+            }
+            s->point_next[q] = orphans;
+            orphans = s->face_outside[f];
+        }
+        s->face_alive[f] = 0;
+        s->face_free[s->free_count++] = f;
+    }
+
+    for (u32 i = 0; i < horizon; ++i) {
+        u32 twin = s->horizon_twin[i];
+        u32 f = hull_add_face(s, s->horizon_vertex[i], s->edges[twin].vertex, eye);
+        if (f == HULL_NONE) {
+            return 0;
+        }
+        s->new_faces[i] = f;
+        s->edges[3 * f].twin = twin;
+        s->edges[twin].twin = 3 * f;
+    }
+    for (u32 i = 0; i < horizon; ++i) {
+        u32 a = s->new_faces[i];
+        u32 b = s->new_faces[(i + 1) % horizon];
+        s->edges[3 * a + 1].twin = 3 * b + 2;
+        s->edges[3 * b + 2].twin = 3 * a + 1;
+    }
+
+    for (u32 q = orphans; q != HULL_NONE;) {
+        u32 next = s->point_next[q];
+        if (q != eye) {
+            hull_assign(s, q, s->new_faces, horizon);
+        }
+        q = next;
+    }
+    hull_make_convex(s, horizon);
+    return 1;
+}
+
+static b32 hull_build(hull_state* s) {
+    s->pending = HULL_NONE;
+    s->free_count = 0;
+    s->face_used = 0;
+    if (s->count < 4 || !hull_simplex(s)) {
+        return 0;
+    }
+    u32 mark = 0;
+    while (s->pending != HULL_NONE) {
+        if (!hull_add_point(s, ++mark)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Compacts the live faces, their edges and their vertices into the
+// output arrays.
+static void hull_output(hull_mesh* h, hull_state* s) {
+    u32* vertex_map = s->point_next;
+    u32* face_map = s->face_mark;
+    for (u32 i = 0; i < s->count; ++i) {
+        vertex_map[i] = HULL_NONE;
+    }
+    u32 faces = 0;
+    u32 vertices = 0;
+    for (u32 f = 0; f < s->face_used; ++f) {
+        if (!s->face_alive[f]) {
+            continue;
+        }
+        face_map[f] = faces++;
+        for (u32 k = 0; k < 3; ++k) {
+            u32 v = s->edges[3 * f + k].vertex;
+            if (vertex_map[v] == HULL_NONE) {
+                vertex_map[v] = vertices;
+                h->vertices[vertices] = s->points[v];
+                h->vertex_ids[vertices] = s->ids[v];
+                ++vertices;
+            }
+        }
+    }
+    for (u32 f = 0; f < s->face_used; ++f) {
+        if (!s->face_alive[f]) {
+            continue;
+        }
+        u32 out = face_map[f];
+        h->faces[out].plane = s->face_plane[f];
+        h->faces[out].edge = 3 * out;
+        for (u32 k = 0; k < 3; ++k) {
+            const hull_edge* e = &s->edges[3 * f + k];
+            hull_edge* o = &h->edges[3 * out + k];
+            o->vertex = vertex_map[e->vertex];
+            o->next = 3 * out + (k + 1) % 3;
+            o->twin = 3 * face_map[s->edges[e->twin].face] + e->twin % 3;
+            o->face = out;
+        }
+    }
+    h->vertex_count = vertices;
+    h->face_count = faces;
+    h->edge_count = 3 * faces;
+}
+
+// Convex hull of up to point_capacity points. The 14 extreme points along
+// the axes and diagonals are found in parallel, and every point inside
+// their hull is dropped in a second parallel pass before quickhull runs
+// on the rest. Points within a small scale aware epsilon of a face are
+// treated as inside. Faces stay triangles; coplanar ones are not merged,
+// but edges that fold inwards are flipped after every step, so no point
+// ends up more than about epsilon above a face. Returns 0 for too many
+// points or when all points are coplanar within epsilon.
+b32 quickhull3(hull_mesh* h, const point3* points, const u32 count) {
+    h->vertex_count = 0;
+    h->edge_count = 0;
+    h->face_count = 0;
+    if (count > h->point_capacity || count < 4) {
+        return 0;
+    }
+    hull_state s;
+    hull_layout(h, &s, h->arena, h->point_capacity);
+
+    hull_job job;
+    u32 extremes[2 * HULL_DIRS3];
+    hull_job_init(&job, &points[0].x, 3, &hull_dirs3[0][0], HULL_DIRS3);
+    hull_extremes(&job, count, extremes);
+    s.epsilon = hull_epsilon(&points[0].x, 3, extremes);
+
+    // Hull of the distinct extremes.
+    s.count = 0;
+    for (u32 k = 0; k < 2 * HULL_DIRS3; ++k) {
+        u32 i = 0;
+        while (i < s.count && s.ids[i] != extremes[k]) {
+            ++i;
+        }
+        if (i == s.count) {
+            s.points[s.count] = points[extremes[k]];
+            s.ids[s.count++] = extremes[k];
+        }
+    }
+    plane planes[HULL_MAX_PLANES];
+    job.plane_count = 0;
+    if (count > HULL_BLOCK && hull_build(&s)) {
+        for (u32 f = 0; f < s.face_used; ++f) {
+            if (s.face_alive[f]) {
+                planes[job.plane_count++] = s.face_plane[f];
+            }
+        }
+    }
+
+    s.count = 0;
+    if (job.plane_count > 0) {
+        job.planes = planes;
+        job.epsilon = s.epsilon;
+        job.keep = s.keep;
+        parallel_for(count, HULL_GRAIN, hull_cull_task, &job);
+        for (u32 k = 0; k < 2 * HULL_DIRS3; ++k) {
+            s.keep[extremes[k]] = 1;
+        }
+        for (u32 i = 0; i < count; ++i) {
+            if (s.keep[i]) {
+                s.points[s.count] = points[i];
+                s.ids[s.count++] = i;
+            }
+        }
+    } else {
+        for (u32 i = 0; i < count; ++i) {
+            s.points[i] = points[i];
+            s.ids[i] = i;
+        }
+        s.count = count;
+    }
+    if (!hull_build(&s)) {
+        return 0;
+    }
+    hull_output(h, &s);
+    return 1;
+}
+
+
+/*
+ * ==== QUICKHULL 2D =======
+*/
+
+static f32 hull2_side(const point2 a, const vec2 dir, const f32 inv_len, const point2 p) {
+    return (dir.x * (p.y - a.y) - dir.y * (p.x - a.x)) * inv_len;
+}
+
+// Moves the points of [begin, end) more than epsilon right of a -> b to
+// the front and returns where they stop.
+static u32 hull2_partition(const point2* points, u32* ids, const u32 begin, const u32 end, const u32 a,
+        const u32 b, const f32 epsilon) {
+    vec2 dir = vec2_sub(points[b], points[a]);
+    f32 len = vec2_len(dir);
+    f32 inv_len = len > 0 ? 1.0f / len : 0.0f;
+    u32 m = begin;
+    for (u32 i = begin; i < end; ++i) {
+        if (hull2_side(points[a], dir, inv_len, points[ids[i]]) < -epsilon) {
+            u32 t = ids[m];
+            ids[m++] = ids[i];
+            ids[i] = t;
+        }
+    }
+    return m;
+}
+
+// Convex hull of 2D points as input indices in counter-clockwise order,
+// starting at the leftmost point. `hull` needs room for `count` indices.
+// The octagon of extreme points culls the interior in parallel first, as
+// in quickhull3. Returns the number of hull points: 1 when every point is
+// the same, 2 for other collinear input, and 0 when scratch memory runs
+// out. Fewer than three points come back as they are.
+u32 quickhull2(const point2* points, const u32 count, u32* hull) {
+    if (count < 3) {
+        for (u32 i = 0; i < count; ++i) {
+            hull[i] = i;
+        }
+        return count;
+    }
+    u32* ids = (u32*)YS_MALLOC(sizeof(u32) * count);
+    u32* stack = (u32*)YS_MALLOC(sizeof(u32) * 4 * (2 * count + 4));
+    u8* keep = (u8*)YS_MALLOC(count);
+    if (!ids || !stack || !keep) {
+        YS_FREE(ids);
+        YS_FREE(stack);
+        YS_FREE(keep);
+        return 0;
+    }
+
+    hull_job job;
+    u32 extremes[2 * HULL_DIRS2];
+    hull_job_init(&job, &points[0].x, 2, &hull_dirs2[0][0], HULL_DIRS2);
+    hull_extremes(&job, count, extremes);
+    f32 epsilon = hull_epsilon(&points[0].x, 2, extremes);
+
+    // Extremes by the angle of their direction, every 45 degrees, give the
+    // octagon in CCW order. Minima are the maxima of the opposite angle.
+    static const u32 angle_order[2 * HULL_DIRS2] = {0, 4, 2, 6, 1, 5, 3, 7};
+    u32 octagon[2 * HULL_DIRS2];
+    u32 corners = 0;
+    for (u32 k = 0; k < 2 * HULL_DIRS2; ++k) {
+        u32 i = extremes[angle_order[k]];
+        if (corners == 0 || (points[i].x != points[octagon[corners - 1]].x
+                || points[i].y != points[octagon[corners - 1]].y)) {
+            octagon[corners++] = i;
+        }
+    }
+    while (corners > 1 && points[octagon[0]].x == points[octagon[corners - 1]].x
+            && points[octagon[0]].y == points[octagon[corners - 1]].y) {
+        --corners;
+    }
+    plane planes[2 * HULL_DIRS2];
+    job.plane_count = 0;
+    for (u32 k = 0; corners >= 3 && k < corners; ++k) {
+        point2 a = points[octagon[k]];
+        point2 b = points[octagon[(k + 1) % corners]];
+        vec2 e = vec2_sub(b, a);
+        f32 len = vec2_len(e);
+        // Outward normal of a CCW edge.
+        plane* p = &planes[job.plane_count++];
+        p->normal.x = e.y / len;
+        p->normal.y = -e.x / len;
+        p->normal.z = 0.0f;
+        p->d = p->normal.x * a.x + p->normal.y * a.y;
+    }
+
+    u32 n = 0;
+    if (count > HULL_BLOCK && job.plane_count >= 3) {
+        job.planes = planes;
+        job.epsilon = epsilon;
+        job.keep = keep;
+        parallel_for(count, HULL_GRAIN, hull_cull_task, &job);
+        for (u32 k = 0; k < 2 * HULL_DIRS2; ++k) {
+            keep[extremes[k]] = 1;
+        }
+        for (u32 i = 0; i < count; ++i) {
+            if (keep[i]) {
+                ids[n++] = i;
+            }
+        }
+    } else {
+        for (u32 i = 0; i < count; ++i) {
+            ids[n++] = i;
+        }
+    }
+
+    u32 left = ids[0], right = ids[0];
+    for (u32 i = 1; i < n; ++i) {
+        point2 p = points[ids[i]];
+        point2 l = points[left], r = points[right];
+        left = p.x < l.x || (p.x == l.x && p.y < l.y) ? ids[i] : left;
+        right = p.x > r.x || (p.x == r.x && p.y > r.y) ? ids[i] : right;
+    }
+    u32 out = 0;
+    hull[out++] = left;
+    if (left != right) {
+        // Below the line from left to right, then above it. An entry with
+        // HULL_NONE as its first index emits its second.
+        u32 lower = hull2_partition(points, ids, 0, n, left, right, epsilon);
+        u32 upper = hull2_partition(points, ids, lower, n, right, left, epsilon);
+        u32 top = 0;
+        u32* entry;
+        entry = stack + 4 * top++;
+        entry[0] = right, entry[1] = left, entry[2] = lower, entry[3] = upper;
+        entry = stack + 4 * top++;
+        entry[0] = HULL_NONE, entry[1] = right;
+        entry = stack + 4 * top++;
+        entry[0] = left, entry[1] = right, entry[2] = 0, entry[3] = lower;
+        while (top > 0) {
+            entry = stack + 4 * --top;
+            u32 a = entry[0], b = entry[1], begin = entry[2], end = entry[3];
+            if (a == HULL_NONE) {
+                hull[out++] = b;
+                continue;
+            }
+            if (begin == end) {
+                continue;
+            }
+            vec2 dir = vec2_sub(points[b], points[a]);
+            f32 inv_len = 1.0f / vec2_len(dir);
+            u32 c = ids[begin];
+            f32 best = 0.0f;
+            for (u32 i = begin; i < end; ++i) {
+                f32 d = hull2_side(points[a], dir, inv_len, points[ids[i]]);
+                c = d < best ? ids[i] : c;
+                best = d < best ? d : best;
+            }
+            u32 mid = hull2_partition(points, ids, begin, end, a, c, epsilon);
+            u32 last = hull2_partition(points, ids, mid, end, c, b, epsilon);
+            entry = stack + 4 * top++;
+            entry[0] = c, entry[1] = b, entry[2] = mid, entry[3] = last;
+            entry = stack + 4 * top++;
+            entry[0] = HULL_NONE, entry[1] = c;
+            entry = stack + 4 * top++;
+            entry[0] = a, entry[1] = c, entry[2] = begin, entry[3] = mid;
+        }
+    }
+    YS_FREE(ids);
+    YS_FREE(stack);
+    YS_FREE(keep);
+    return out;
+}
+
+#endif
+#endif
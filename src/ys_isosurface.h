@@ -0,0 +1,888 @@
+#ifndef YS_ISOSURFACE_H
+#define YS_ISOSURFACE_H
+
+#include <math.h>
+#include "ys_mesh.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Cells per side of a min/max pyramid leaf. Each level above doubles it,
+// and the top level nodes are the chunks extracted by one task each.
+#define ISOSURFACE_BLOCK 4
+#define ISOSURFACE_LEVELS 4
+#define ISOSURFACE_CHUNK (ISOSURFACE_BLOCK << (ISOSURFACE_LEVELS - 1))
+
+// Leaf blocks per parallel_for chunk when building the pyramid.
+#define ISOSURFACE_BLOCK_GRAIN 64
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Samples on the corners of a grid of cells, x fastest.
+typedef struct scalar_field {
+    f32* values;
+    i32 dims[3];      // samples per axis, one more than cells
+    point3 origin;    // position of sample 0
+    f32 cell_size;
+} scalar_field;
+
+// Min and max of the samples under every node of an octree over the
+// cells, level by level from ISOSURFACE_BLOCK^3 leaves up to chunks.
+// Nodes whose range does not straddle the iso value are skipped whole.
+typedef struct isosurface_pyramid {
+    f32* ranges;                      // min and max per node
+    u32 offsets[ISOSURFACE_LEVELS];   // first node of each level
+    i32 dims[ISOSURFACE_LEVELS][3];   // nodes per axis on each level
+} isosurface_pyramid;
+
+
+/*
+ * === SCALAR FIELD INTERFACE ===
+*/
+b32 scalar_field_create(scalar_field* f, const i32 dims[3], const point3 origin, const f32 cell_size);
+void scalar_field_free(scalar_field* f);
+
+
+/*
+ * === ISOSURFACE INTERFACE ===
+*/
+b32 isosurface_pyramid_create(isosurface_pyramid* p, const scalar_field* f);
+void isosurface_pyramid_free(isosurface_pyramid* p);
+void isosurface_pyramid_update(isosurface_pyramid* p, const scalar_field* f, const i32 lo[3], const i32 hi[3]);
+b32 isosurface_extract(mesh* m, const scalar_field* f, const isosurface_pyramid* p, const f32 iso);
+
+
+#ifdef YS_ISOSURFACE_IMPLEMENTATION
+
+#define ISOSURFACE_NO_KEY 0xFFFFFFFFFFFFFFFFull
+#define ISOSURFACE_MISSING 0xFFFFFFFFu
+#define ISOSURFACE_FOREIGN 0x80000000u
+
+/*
+ * ==== SCALAR FIELD =======
+*/
+
+b32 scalar_field_create(scalar_field* f, const i32 dims[3], const point3 origin, const f32 cell_size) {
+    u64 count = (u64)dims[0] * dims[1] * dims[2];
+    f->values = (f32*)YS_MALLOC(sizeof(f32) * (count > 0 ? count : 1));
+    f->dims[0] = dims[0];
+    f->dims[1] = dims[1];
+    f->dims[2] = dims[2];
+    f->origin = origin;
+    f->cell_size = cell_size;
+    if (!f->values) {
+        return 0;
+    }
+    for (u64 i = 0; i < count; ++i) {
+        f->values[i] = 0.0f;
+    }
+    return 1;
+}
+
+void scalar_field_free(scalar_field* f) {
+    YS_FREE(f->values);
+    f->values = 0;
+}
+
+static f32 scalar_field_at(const scalar_field* f, const i32 x, const i32 y, const i32 z) {
+    return f->values[x + (u64)f->dims[0] * (y + (u64)f->dims[1] * z)];
+}
+
+// Central differences, one sided on the border.
+static vec3 scalar_field_gradient(const scalar_field* f, const i32 x, const i32 y, const i32 z) {
+    i32 s[3] = {x, y, z};
+    vec3 g;
+    for (u32 k = 0; k < 3; ++k) {
+        i32 lo[3] = {x, y, z};
+        i32 hi[3] = {x, y, z};
+        lo[k] = s[k] > 0 ? s[k] - 1 : 0;
+        hi[k] = s[k] < f->dims[k] - 1 ? s[k] + 1 : s[k];
+        f32 step = (f32)(hi[k] - lo[k]);
+        g.e[k] = step > 0.0f ? (scalar_field_at(f, hi[0], hi[1], hi[2]) - scalar_field_at(f, lo[0], lo[1], lo[2])) / step
+            : 0.0f;
+    }
+    return g;
+}
+
+
+/*
+ * ==== PYRAMID =======
+*/
+
+typedef struct isosurface_pyramid_job {
+    isosurface_pyramid* p;
+    const scalar_field* f;
+    i32 lo[3];          // leaf blocks to rebuild
+    i32 size[3];
+} isosurface_pyramid_job;
+
+static void isosurface_leaf_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    isosurface_pyramid_job* job = (isosurface_pyramid_job*)ctx;
+    isosurface_pyramid* p = job->p;
+    const scalar_field* f = job->f;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        i32 b[3];
+        b[0] = job->lo[0] + (i32)(i % (u32)job->size[0]);
+        b[1] = job->lo[1] + (i32)(i / (u32)job->size[0] % (u32)job->size[1]);
+        b[2] = job->lo[2] + (i32)(i / ((u32)job->size[0] * (u32)job->size[1]));
+        i32 s0[3], s1[3];
+        for (u32 k = 0; k < 3; ++k) {
+            s0[k] = b[k] * ISOSURFACE_BLOCK;
+            s1[k] = s0[k] + ISOSURFACE_BLOCK < f->dims[k] - 1 ? s0[k] + ISOSURFACE_BLOCK : f->dims[k] - 1;
+        }
+        f32 lo = scalar_field_at(f, s0[0], s0[1], s0[2]);
+        f32 hi = lo;
+        for (i32 z = s0[2]; z <= s1[2]; ++z) {
+            for (i32 y = s0[1]; y <= s1[1]; ++y) {
+                const f32* row = f->values + (u64)f->dims[0] * (y + (u64)f->dims[1] * z);
+                for (i32 x = s0[0]; x <= s1[0]; ++x) {
+                    lo = row[x] < lo ? row[x] : lo;
+                    hi = row[x] > hi ? row[x] : hi;
+                }
+            }
+        }
+        u32 node = b[0] + p->dims[0][0] * (b[1] + p->dims[0][1] * b[2]);
+        p->ranges[node * 2] = lo;
+        p->ranges[node * 2 + 1] = hi;
+    }
+}
+
+b32 isosurface_pyramid_create(isosurface_pyramid* p, const scalar_field* f) {
+    u32 total = 0;
+    for (u32 l = 0; l < ISOSURFACE_LEVELS; ++l) {
+        for (u32 k = 0; k < 3; ++k) {
+            i32 cells = f->dims[k] > 1 ? f->dims[k] - 1 : 1;
+            p->dims[l][k] = l == 0 ? (cells + ISOSURFACE_BLOCK - 1) / ISOSURFACE_BLOCK : (p->dims[l - 1][k] + 1) / 2;
+        }
+        p->offsets[l] = total;
+        total += (u32)(p->dims[l][0] * p->dims[l][1] * p->dims[l][2]);
+    }
+    p->ranges = (f32*)YS_MALLOC(sizeof(f32) * 2 * total);
+    if (!p->ranges) {
+        return 0;
+    }
+    i32 lo[3] = {0, 0, 0};
+    i32 hi[3] = {f->dims[0] - 1, f->dims[1] - 1, f->dims[2] - 1};
+    isosurface_pyramid_update(p, f, lo, hi);
+    return 1;
+}
+
+void isosurface_pyramid_free(isosurface_pyramid* p) {
+    YS_FREE(p->ranges);
+    p->ranges = 0;
+}
+
+// Refreshes the nodes over the samples in [lo, hi], after an edit. Leaves
+// are rebuilt in parallel, the coarser levels from their children.
+void isosurface_pyramid_update(isosurface_pyramid* p, const scalar_field* f, const i32 lo[3], const i32 hi[3]) {
+    isosurface_pyramid_job job;
+    job.p = p;
+    job.f = f;
+    i32 first[3], last[3];
+    for (u32 k = 0; k < 3; ++k) {
+        // A sample on a block boundary belongs to the blocks on both sides.
+        first[k] = lo[k] > 0 ? (lo[k] - 1) / ISOSURFACE_BLOCK : 0;
+        last[k] = hi[k] / ISOSURFACE_BLOCK;
+        last[k] = last[k] < p->dims[0][k] - 1 ? last[k] : p->dims[0][k] - 1;
+        if (first[k] > last[k]) {
+            return;
+        }
+        job.lo[k] = first[k];
+        job.size[k] = last[k] - first[k] + 1;
+    }
+    parallel_for((u32)(job.size[0] * job.size[1] * job.size[2]), ISOSURFACE_BLOCK_GRAIN, isosurface_leaf_task, &job);
+
+    for (u32 l = 1; l < ISOSURFACE_LEVELS; ++l) {
+        const i32* child_dims = p->dims[l - 1];
+        const f32* children = p->ranges + 2 * p->offsets[l - 1];
+        f32* nodes = p->ranges + 2 * p->offsets[l];
+        for (u32 k = 0; k < 3; ++k) {
+            first[k] >>= 1;
+            last[k] >>= 1;
+        }
+        for (i32 z = first[2]; z <= last[2]; ++z) {
+            for (i32 y = first[1]; y <= last[1]; ++y) {
+                for (i32 x = first[0]; x <= last[0]; ++x) {
+                    f32 node_lo = INFINITY, node_hi = -INFINITY;
+                    for (u32 c = 0; c < 8; ++c) {
+                        i32 cx = x * 2 + (c & 1), cy = y * 2 + ((c >> 1) & 1), cz = z * 2 + (c >> 2);
+                        if (cx < child_dims[0] && cy < child_dims[1] && cz < child_dims[2]) {
+                            const f32* r = children + 2 * (cx + child_dims[0] * (cy + child_dims[1] * cz));
+                            node_lo = r[0] < node_lo ? r[0] : node_lo;
+                            node_hi = r[1] > node_hi ? r[1] : node_hi;
+                        }
+                    }
+                    f32* r = nodes + 2 * (x + p->dims[l][0] * (y + p->dims[l][1] * z));
+                    r[0] = node_lo;
+                    r[1] = node_hi;
+                }
+            }
+        }
+    }
+}
+
+
+/*
+ * ==== MARCHING CUBES =======
+*/
+
+// Corner i of a cell is offset by (i & 1, (i >> 1) & 1, i >> 2). Edge e
+// runs along axis e / 4 between these corners.
+static const u8 isosurface_edge_corners[12][2] = {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7},
+};
+
+// Triangles per cell case, as edge triples ending in -1; bit i of the case
+// is set when corner i is below the iso value. Generated by tracing the
+// crossings around each face, where a face with two diagonal corners
+// below always cuts those corners off, so neighbouring cells agree and
+// the surface is closed. Triangles face towards higher values.
+static const i8 isosurface_triangles[256][16] = {
+    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 9, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 8, 1, 8, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 1, 10, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 8, 1, 8, 9, 1, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 5, 11, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 11, 0, 11, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 9, 4, 9, 11, 4, 11, 1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 10, 5, 10, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 10, 5, 10, 8, 5, 8, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 11, 0, 11, 10, 0, 10, 4, -1, -1, -1, -1, -1, -1, -1},
+    {9, 11, 10, 9, 10, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 2, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 2, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 9, 5, 2, 5, 4, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 4, 2, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 6, 1, 6, 2, 1, 2, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 1, 10, 4, 2, 8, 6, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 6, 1, 6, 2, 1, 2, 9, 1, 9, 5, -1, -1, -1, -1},
+    {5, 11, 1, 2, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 2, 4, 2, 0, 5, 11, 1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 11, 0, 11, 1, 2, 8, 6, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 2, 4, 2, 9, 4, 9, 11, 4, 11, 1, -1, -1, -1, -1},
+    {2, 8, 6, 5, 11, 10, 5, 10, 4, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 10, 5, 10, 6, 5, 6, 2, 5, 2, 0, -1, -1, -1, -1},
+    {0, 9, 11, 0, 11, 10, 0, 10, 4, 2, 8, 6, -1, -1, -1, -1},
+    {2, 9, 11, 2, 11, 10, 2, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+    {7, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 7, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 2, 7, 0, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {7, 5, 4, 7, 4, 8, 7, 8, 2, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 4, 7, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 8, 1, 8, 0, 7, 9, 2, -1, -1, -1, -1, -1, -1, -1},
+    {0, 2, 7, 0, 7, 5, 1, 10, 4, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 8, 1, 8, 2, 1, 2, 7, 1, 7, 5, -1, -1, -1, -1},
+    {5, 11, 1, 7, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 5, 11, 1, 7, 9, 2, -1, -1, -1, -1, -1, -1, -1},
+    {0, 2, 7, 0, 7, 11, 0, 11, 1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 2, 4, 2, 7, 4, 7, 11, 4, 11, 1, -1, -1, -1, -1},
+    {7, 9, 2, 5, 11, 10, 5, 10, 4, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 10, 5, 10, 8, 5, 8, 0, 7, 9, 2, -1, -1, -1, -1},
+    {0, 2, 7, 0, 7, 11, 0, 11, 10, 0, 10, 4, -1, -1, -1, -1},
+    {7, 11, 10, 7, 10, 8, 7, 8, 2, -1, -1, -1, -1, -1, -1, -1},
+    {7, 9, 8, 7, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 7, 4, 7, 9, 4, 9, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 6, 0, 6, 7, 0, 7, 5, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 7, 4, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 4, 7, 9, 8, 7, 8, 6, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 6, 1, 6, 7, 1, 7, 9, 1, 9, 0, -1, -1, -1, -1},
+    {0, 8, 6, 0, 6, 7, 0, 7, 5, 1, 10, 4, -1, -1, -1, -1},
+    {1, 10, 6, 1, 6, 7, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 1, 7, 9, 8, 7, 8, 6, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 7, 4, 7, 9, 4, 9, 0, 5, 11, 1, -1, -1, -1, -1},
+    {0, 8, 6, 0, 6, 7, 0, 7, 11, 0, 11, 1, -1, -1, -1, -1},
+    {4, 6, 7, 4, 7, 11, 4, 11, 1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 10, 5, 10, 4, 7, 9, 8, 7, 8, 6, -1, -1, -1, -1},
+    {5, 11, 10, 5, 10, 6, 5, 6, 7, 5, 7, 9, 5, 9, 0, -1},
+    {0, 8, 6, 0, 6, 7, 0, 7, 11, 0, 11, 10, 0, 10, 4, -1},
+    {7, 11, 10, 7, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 10, 3, 4, 8, 9, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {1, 3, 6, 1, 6, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 3, 6, 1, 6, 8, 1, 8, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 1, 3, 6, 1, 6, 4, -1, -1, -1, -1, -1, -1, -1},
+    {1, 3, 6, 1, 6, 8, 1, 8, 9, 1, 9, 5, -1, -1, -1, -1},
+    {5, 11, 1, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 5, 11, 1, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 11, 0, 11, 1, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 9, 4, 9, 11, 4, 11, 1, 6, 10, 3, -1, -1, -1, -1},
+    {6, 4, 5, 6, 5, 11, 6, 11, 3, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 3, 5, 3, 6, 5, 6, 8, 5, 8, 0, -1, -1, -1, -1},
+    {0, 9, 11, 0, 11, 3, 0, 3, 6, 0, 6, 4, -1, -1, -1, -1},
+    {6, 8, 9, 6, 9, 11, 6, 11, 3, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 10, 2, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 10, 3, 4, 3, 2, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 2, 8, 10, 2, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {2, 9, 5, 2, 5, 4, 2, 4, 10, 2, 10, 3, -1, -1, -1, -1},
+    {1, 3, 2, 1, 2, 8, 1, 8, 4, -1, -1, -1, -1, -1, -1, -1},
+    {1, 3, 2, 1, 2, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 1, 3, 2, 1, 2, 8, 1, 8, 4, -1, -1, -1, -1},
+    {1, 3, 2, 1, 2, 9, 1, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 1, 2, 8, 10, 2, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {4, 10, 3, 4, 3, 2, 4, 2, 0, 5, 11, 1, -1, -1, -1, -1},
+    {0, 9, 11, 0, 11, 1, 2, 8, 10, 2, 10, 3, -1, -1, -1, -1},
+    {4, 10, 3, 4, 3, 2, 4, 2, 9, 4, 9, 11, 4, 11, 1, -1},
+    {2, 8, 4, 2, 4, 5, 2, 5, 11, 2, 11, 3, -1, -1, -1, -1},
+    {5, 11, 3, 5, 3, 2, 5, 2, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 11, 0, 11, 3, 0, 3, 2, 0, 2, 8, 0, 8, 4, -1},
+    {2, 9, 11, 2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {7, 9, 2, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 7, 9, 2, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {0, 2, 7, 0, 7, 5, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {7, 5, 4, 7, 4, 8, 7, 8, 2, 6, 10, 3, -1, -1, -1, -1},
+    {1, 3, 6, 1, 6, 4, 7, 9, 2, -1, -1, -1, -1, -1, -1, -1},
+    {1, 3, 6, 1, 6, 8, 1, 8, 0, 7, 9, 2, -1, -1, -1, -1},
+    {0, 2, 7, 0, 7, 5, 1, 3, 6, 1, 6, 4, -1, -1, -1, -1},
+    {1, 3, 6, 1, 6, 8, 1, 8, 2, 1, 2, 7, 1, 7, 5, -1},
+    {5, 11, 1, 7, 9, 2, 6, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 5, 11, 1, 7, 9, 2, 6, 10, 3, -1, -1, -1, -1},
+    {0, 2, 7, 0, 7, 11, 0, 11, 1, 6, 10, 3, -1, -1, -1, -1},
+    {4, 8, 2, 4, 2, 7, 4, 7, 11, 4, 11, 1, 6, 10, 3, -1},
+    {7, 9, 2, 6, 4, 5, 6, 5, 11, 6, 11, 3, -1, -1, -1, -1},
+    {5, 11, 3, 5, 3, 6, 5, 6, 8, 5, 8, 0, 7, 9, 2, -1},
+    {0, 2, 7, 0, 7, 11, 0, 11, 3, 0, 3, 6, 0, 6, 4, -1},
+    {7, 11, 3, 7, 3, 6, 7, 6, 8, 7, 8, 2, -1, -1, -1, -1},
+    {7, 9, 8, 7, 8, 10, 7, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {4, 10, 3, 4, 3, 7, 4, 7, 9, 4, 9, 0, -1, -1, -1, -1},
+    {0, 8, 10, 0, 10, 3, 0, 3, 7, 0, 7, 5, -1, -1, -1, -1},
+    {7, 5, 4, 7, 4, 10, 7, 10, 3, -1, -1, -1, -1, -1, -1, -1},
+    {1, 3, 7, 1, 7, 9, 1, 9, 8, 1, 8, 4, -1, -1, -1, -1},
+    {1, 3, 7, 1, 7, 9, 1, 9, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 4, 0, 4, 1, 0, 1, 3, 0, 3, 7, 0, 7, 5, -1},
+    {1, 3, 7, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 11, 1, 7, 9, 8, 7, 8, 10, 7, 10, 3, -1, -1, -1, -1},
+    {4, 10, 3, 4, 3, 7, 4, 7, 9, 4, 9, 0, 5, 11, 1, -1},
+    {0, 8, 10, 0, 10, 3, 0, 3, 7, 0, 7, 11, 0, 11, 1, -1},
+    {4, 10, 3, 4, 3, 7, 4, 7, 11, 4, 11, 1, -1, -1, -1, -1},
+    {7, 9, 8, 7, 8, 4, 7, 4, 5, 7, 5, 11, 7, 11, 3, -1},
+    {5, 11, 3, 5, 3, 7, 5, 7, 9, 5, 9, 0, -1, -1, -1, -1},
+    {0, 8, 4, 7, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {7, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {3, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {3, 11, 7, 4, 8, 9, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 4, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 8, 1, 8, 0, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 1, 10, 4, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 8, 1, 8, 9, 1, 9, 5, 3, 11, 7, -1, -1, -1, -1},
+    {5, 7, 3, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 5, 7, 3, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 7, 0, 7, 3, 0, 3, 1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 9, 4, 9, 7, 4, 7, 3, 4, 3, 1, -1, -1, -1, -1},
+    {3, 10, 4, 3, 4, 5, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1},
+    {5, 7, 3, 5, 3, 10, 5, 10, 8, 5, 8, 0, -1, -1, -1, -1},
+    {0, 9, 7, 0, 7, 3, 0, 3, 10, 0, 10, 4, -1, -1, -1, -1},
+    {3, 10, 8, 3, 8, 9, 3, 9, 7, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 6, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 2, 4, 2, 0, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 2, 8, 6, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {2, 9, 5, 2, 5, 4, 2, 4, 6, 3, 11, 7, -1, -1, -1, -1},
+    {1, 10, 4, 2, 8, 6, 3, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 6, 1, 6, 2, 1, 2, 0, 3, 11, 7, -1, -1, -1, -1},
+    {0, 9, 5, 1, 10, 4, 2, 8, 6, 3, 11, 7, -1, -1, -1, -1},
+    {1, 10, 6, 1, 6, 2, 1, 2, 9, 1, 9, 5, 3, 11, 7, -1},
+    {5, 7, 3, 5, 3, 1, 2, 8, 6, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 2, 4, 2, 0, 5, 7, 3, 5, 3, 1, -1, -1, -1, -1},
+    {0, 9, 7, 0, 7, 3, 0, 3, 1, 2, 8, 6, -1, -1, -1, -1},
+    {4, 6, 2, 4, 2, 9, 4, 9, 7, 4, 7, 3, 4, 3, 1, -1},
+    {2, 8, 6, 3, 10, 4, 3, 4, 5, 3, 5, 7, -1, -1, -1, -1},
+    {5, 7, 3, 5, 3, 10, 5, 10, 6, 5, 6, 2, 5, 2, 0, -1},
+    {0, 9, 7, 0, 7, 3, 0, 3, 10, 0, 10, 4, 2, 8, 6, -1},
+    {2, 9, 7, 2, 7, 3, 2, 3, 10, 2, 10, 6, -1, -1, -1, -1},
+    {3, 11, 9, 3, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 3, 11, 9, 3, 9, 2, -1, -1, -1, -1, -1, -1, -1},
+    {0, 2, 3, 0, 3, 11, 0, 11, 5, -1, -1, -1, -1, -1, -1, -1},
+    {3, 11, 5, 3, 5, 4, 3, 4, 8, 3, 8, 2, -1, -1, -1, -1},
+    {1, 10, 4, 3, 11, 9, 3, 9, 2, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 8, 1, 8, 0, 3, 11, 9, 3, 9, 2, -1, -1, -1, -1},
+    {0, 2, 3, 0, 3, 11, 0, 11, 5, 1, 10, 4, -1, -1, -1, -1},
+    {1, 10, 8, 1, 8, 2, 1, 2, 3, 1, 3, 11, 1, 11, 5, -1},
+    {5, 9, 2, 5, 2, 3, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 5, 9, 2, 5, 2, 3, 5, 3, 1, -1, -1, -1, -1},
+    {0, 2, 3, 0, 3, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 2, 4, 2, 3, 4, 3, 1, -1, -1, -1, -1, -1, -1, -1},
+    {3, 10, 4, 3, 4, 5, 3, 5, 9, 3, 9, 2, -1, -1, -1, -1},
+    {5, 9, 2, 5, 2, 3, 5, 3, 10, 5, 10, 8, 5, 8, 0, -1},
+    {0, 2, 3, 0, 3, 10, 0, 10, 4, -1, -1, -1, -1, -1, -1, -1},
+    {3, 10, 8, 3, 8, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {3, 11, 9, 3, 9, 8, 3, 8, 6, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 3, 4, 3, 11, 4, 11, 9, 4, 9, 0, -1, -1, -1, -1},
+    {0, 8, 6, 0, 6, 3, 0, 3, 11, 0, 11, 5, -1, -1, -1, -1},
+    {3, 11, 5, 3, 5, 4, 3, 4, 6, -1, -1, -1, -1, -1, -1, -1},
+    {1, 10, 4, 3, 11, 9, 3, 9, 8, 3, 8, 6, -1, -1, -1, -1},
+    {1, 10, 6, 1, 6, 3, 1, 3, 11, 1, 11, 9, 1, 9, 0, -1},
+    {0, 8, 6, 0, 6, 3, 0, 3, 11, 0, 11, 5, 1, 10, 4, -1},
+    {1, 10, 6, 1, 6, 3, 1, 3, 11, 1, 11, 5, -1, -1, -1, -1},
+    {5, 9, 8, 5, 8, 6, 5, 6, 3, 5, 3, 1, -1, -1, -1, -1},
+    {4, 6, 3, 4, 3, 1, 4, 1, 5, 4, 5, 9, 4, 9, 0, -1},
+    {0, 8, 6, 0, 6, 3, 0, 3, 1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 6, 3, 4, 3, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {3, 10, 4, 3, 4, 5, 3, 5, 9, 3, 9, 8, 3, 8, 6, -1},
+    {5, 9, 0, 3, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 6, 0, 6, 3, 0, 3, 10, 0, 10, 4, -1, -1, -1, -1},
+    {3, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 10, 11, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 6, 10, 11, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 6, 10, 11, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 9, 4, 9, 5, 6, 10, 11, 6, 11, 7, -1, -1, -1, -1},
+    {1, 11, 7, 1, 7, 6, 1, 6, 4, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 7, 1, 7, 6, 1, 6, 8, 1, 8, 0, -1, -1, -1, -1},
+    {0, 9, 5, 1, 11, 7, 1, 7, 6, 1, 6, 4, -1, -1, -1, -1},
+    {1, 11, 7, 1, 7, 6, 1, 6, 8, 1, 8, 9, 1, 9, 5, -1},
+    {5, 7, 6, 5, 6, 10, 5, 10, 1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 5, 7, 6, 5, 6, 10, 5, 10, 1, -1, -1, -1, -1},
+    {0, 9, 7, 0, 7, 6, 0, 6, 10, 0, 10, 1, -1, -1, -1, -1},
+    {4, 8, 9, 4, 9, 7, 4, 7, 6, 4, 6, 10, 4, 10, 1, -1},
+    {5, 7, 6, 5, 6, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 7, 6, 5, 6, 8, 5, 8, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 7, 0, 7, 6, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1},
+    {6, 8, 9, 6, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 10, 2, 10, 11, 2, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+    {4, 10, 11, 4, 11, 7, 4, 7, 2, 4, 2, 0, -1, -1, -1, -1},
+    {0, 9, 5, 2, 8, 10, 2, 10, 11, 2, 11, 7, -1, -1, -1, -1},
+    {2, 9, 5, 2, 5, 4, 2, 4, 10, 2, 10, 11, 2, 11, 7, -1},
+    {1, 11, 7, 1, 7, 2, 1, 2, 8, 1, 8, 4, -1, -1, -1, -1},
+    {1, 11, 7, 1, 7, 2, 1, 2, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 5, 1, 11, 7, 1, 7, 2, 1, 2, 8, 1, 8, 4, -1},
+    {1, 11, 7, 1, 7, 2, 1, 2, 9, 1, 9, 5, -1, -1, -1, -1},
+    {5, 7, 2, 5, 2, 8, 5, 8, 10, 5, 10, 1, -1, -1, -1, -1},
+    {4, 10, 1, 4, 1, 5, 4, 5, 7, 4, 7, 2, 4, 2, 0, -1},
+    {0, 9, 7, 0, 7, 2, 0, 2, 8, 0, 8, 10, 0, 10, 1, -1},
+    {4, 10, 1, 2, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 8, 4, 2, 4, 5, 2, 5, 7, -1, -1, -1, -1, -1, -1, -1},
+    {5, 7, 2, 5, 2, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 9, 7, 0, 7, 2, 0, 2, 8, 0, 8, 4, -1, -1, -1, -1},
+    {2, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 10, 11, 6, 11, 9, 6, 9, 2, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, 6, 10, 11, 6, 11, 9, 6, 9, 2, -1, -1, -1, -1},
+    {0, 2, 6, 0, 6, 10, 0, 10, 11, 0, 11, 5, -1, -1, -1, -1},
+    {6, 10, 11, 6, 11, 5, 6, 5, 4, 6, 4, 8, 6, 8, 2, -1},
+    {1, 11, 9, 1, 9, 2, 1, 2, 6, 1, 6, 4, -1, -1, -1, -1},
+    {1, 11, 9, 1, 9, 2, 1, 2, 6, 1, 6, 8, 1, 8, 0, -1},
+    {0, 2, 6, 0, 6, 4, 0, 4, 1, 0, 1, 11, 0, 11, 5, -1},
+    {1, 11, 5, 6, 8, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 9, 2, 5, 2, 6, 5, 6, 10, 5, 10, 1, -1, -1, -1, -1},
+    {4, 8, 0, 5, 9, 2, 5, 2, 6, 5, 6, 10, 5, 10, 1, -1},
+    {0, 2, 6, 0, 6, 10, 0, 10, 1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 2, 4, 2, 6, 4, 6, 10, 4, 10, 1, -1, -1, -1, -1},
+    {6, 4, 5, 6, 5, 9, 6, 9, 2, -1, -1, -1, -1, -1, -1, -1},
+    {5, 9, 2, 5, 2, 6, 5, 6, 8, 5, 8, 0, -1, -1, -1, -1},
+    {0, 2, 6, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 8, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {8, 10, 11, 8, 11, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 10, 11, 4, 11, 9, 4, 9, 0, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 10, 0, 10, 11, 0, 11, 5, -1, -1, -1, -1, -1, -1, -1},
+    {4, 10, 11, 4, 11, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 9, 1, 9, 8, 1, 8, 4, -1, -1, -1, -1, -1, -1, -1},
+    {1, 11, 9, 1, 9, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 4, 0, 4, 1, 0, 1, 11, 0, 11, 5, -1, -1, -1, -1},
+    {1, 11, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 9, 8, 5, 8, 10, 5, 10, 1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 10, 1, 4, 1, 5, 4, 5, 9, 4, 9, 0, -1, -1, -1, -1},
+    {0, 8, 10, 0, 10, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 10, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 9, 8, 5, 8, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {5, 9, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+};
+
+// Output of one chunk. Edge crossings are hashed by edge so each becomes
+// one vertex. A crossing on an edge owned by a neighbouring chunk is
+// recorded as a foreign reference and resolved once every chunk is done.
+typedef struct isosurface_chunk {
+    point3* positions;
+    vec3* normals;
+    u32* indices;         // local vertex, or ISOSURFACE_FOREIGN | foreign reference
+    u64* foreign;         // edge keys owned elsewhere
+    u64* keys;            // edge hash: base sample * 3 + axis
+    u32* slots;           // index value for each key
+    u32 vertex_count;
+    u32 vertex_capacity;
+    u32 index_count;
+    u32 index_capacity;
+    u32 foreign_count;
+    u32 foreign_capacity;
+    u32 hash_count;
+    u32 hash_capacity;    // power of two
+} isosurface_chunk;
+
+typedef struct isosurface_job {
+    const scalar_field* f;
+    const isosurface_pyramid* p;
+    mesh* m;
+    isosurface_chunk* chunks;
+    u32* vertex_base;
+    u32* index_base;
+    f32 iso;
+    u32 failed;
+} isosurface_job;
+
+// Copies into a buffer of twice the capacity. Returns 0 when out of
+// memory, leaving the old one.
+static b32 isosurface_grow(void** data, const u32 count, const u32 capacity, const u32 size) {
+    u8* grown = (u8*)YS_MALLOC((u64)capacity * 2 * size);
+    if (!grown) {
+        return 0;
+    }
+    const u8* old = (const u8*)*data;
+    for (u64 i = 0; i < (u64)count * size; ++i) {
+        grown[i] = old[i];
+    }
+    YS_FREE(*data);
+    *data = grown;
+    return 1;
+}
+
+static void isosurface_chunk_free(isosurface_chunk* c) {
+    YS_FREE(c->positions);
+    YS_FREE(c->normals);
+    YS_FREE(c->indices);
+    YS_FREE(c->foreign);
+    YS_FREE(c->keys);
+    YS_FREE(c->slots);
+}
+
+static u32 isosurface_hash(const u64 key, const u32 capacity) {
+    return (u32)((key * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
+
+static u32 isosurface_hash_find(const isosurface_chunk* c, const u64 key) {
+    if (c->hash_capacity == 0) {
+        return ISOSURFACE_MISSING;
+    }
+    for (u32 i = isosurface_hash(key, c->hash_capacity);; i = (i + 1) & (c->hash_capacity - 1)) {
+        if (c->keys[i] == key) {
+            return c->slots[i];
+        }
+        if (c->keys[i] == ISOSURFACE_NO_KEY) {
+            return ISOSURFACE_MISSING;
+        }
+    }
+}
+
+static void isosurface_hash_put(isosurface_chunk* c, const u64 key, const u32 slot) {
+    u32 i = isosurface_hash(key, c->hash_capacity);
+    while (c->keys[i] != ISOSURFACE_NO_KEY) {
+        i = (i + 1) & (c->hash_capacity - 1);
+    }
+    c->keys[i] = key;
+    c->slots[i] = slot;
+    ++c->hash_count;
+}
+
+// Keeps the table at most half full. Returns 0 when out of memory.
+static b32 isosurface_hash_reserve(isosurface_chunk* c) {
+    if ((c->hash_count + 1) * 2 <= c->hash_capacity) {
+        return 1;
+    }
+    u32 capacity = c->hash_capacity ? c->hash_capacity * 2 : 1024;
+    u64* keys = (u64*)YS_MALLOC(sizeof(u64) * capacity);
+    u32* slots = (u32*)YS_MALLOC(sizeof(u32) * capacity);
+    if (!keys || !slots) {
+        YS_FREE(keys);
+        YS_FREE(slots);
+        return 0;
+    }
+    u64* old_keys = c->keys;
+    u32* old_slots = c->slots;
+    u32 old_capacity = c->hash_capacity;
+    c->keys = keys;
+    c->slots = slots;
+    c->hash_capacity = capacity;
+    c->hash_count = 0;
+    for (u32 i = 0; i < capacity; ++i) {
+        keys[i] = ISOSURFACE_NO_KEY;
+    }
+    for (u32 i = 0; i < old_capacity; ++i) {
+        if (old_keys[i] != ISOSURFACE_NO_KEY) {
+            isosurface_hash_put(c, old_keys[i], old_slots[i]);
+        }
+    }
+    YS_FREE(old_keys);
+    YS_FREE(old_slots);
+    return 1;
+}
+
+// Chunk owning the edge from sample s: the one holding s, or the last one
+// for samples on the far border. It always holds a cell on the edge.
+static u32 isosurface_owner(const isosurface_pyramid* p, const i32 s[3]) {
+    const i32* dims = p->dims[ISOSURFACE_LEVELS - 1];
+    i32 c[3];
+    for (u32 k = 0; k < 3; ++k) {
+        c[k] = s[k] / ISOSURFACE_CHUNK;
+        c[k] = c[k] < dims[k] - 1 ? c[k] : dims[k] - 1;
+    }
+    return (u32)(c[0] + dims[0] * (c[1] + dims[1] * c[2]));
+}
+
+// Index value for the crossing on edge e of cell (x, y, z), creating the
+// vertex when this chunk owns the edge. Returns ISOSURFACE_MISSING when
+// out of memory.
+static u32 isosurface_edge_vertex(isosurface_job* job, isosurface_chunk* c, const u32 chunk,
+        const i32 cell[3], const u32 e, const f32 v[8]) {
+    const scalar_field* f = job->f;
+    u32 c0 = isosurface_edge_corners[e][0], c1 = isosurface_edge_corners[e][1];
+    u32 axis = e / 4;
+    i32 s[3] = {cell[0] + (i32)(c0 & 1), cell[1] + (i32)((c0 >> 1) & 1), cell[2] + (i32)(c0 >> 2)};
+    u64 key = ((u64)s[0] + (u64)f->dims[0] * ((u64)s[1] + (u64)f->dims[1] * s[2])) * 3 + axis;
+    u32 slot = isosurface_hash_find(c, key);
+    if (slot != ISOSURFACE_MISSING) {
+        return slot;
+    }
+    if (!isosurface_hash_reserve(c)) {
+        return ISOSURFACE_MISSING;
+    }
+    if (isosurface_owner(job->p, s) != chunk) {
+        if (c->foreign_count == c->foreign_capacity) {
+            if (!isosurface_grow((void**)&c->foreign, c->foreign_count, c->foreign_capacity, sizeof(u64))) {
+                return ISOSURFACE_MISSING;
+            }
+            c->foreign_capacity *= 2;
+        }
+        c->foreign[c->foreign_count] = key;
+        slot = ISOSURFACE_FOREIGN | c->foreign_count++;
+        isosurface_hash_put(c, key, slot);
+        return slot;
+    }
+
+    if (c->vertex_count == c->vertex_capacity) {
+        if (!isosurface_grow((void**)&c->positions, c->vertex_count, c->vertex_capacity, sizeof(point3))
+                || (job->m->normals
+                    && !isosurface_grow((void**)&c->normals, c->vertex_count, c->vertex_capacity, sizeof(vec3)))) {
+            return ISOSURFACE_MISSING;
+        }
+        c->vertex_capacity *= 2;
+    }
+    f32 t = (job->iso - v[c0]) / (v[c1] - v[c0]);
+    point3 p;
+    p.x = f->origin.x + (f32)s[0] * f->cell_size;
+    p.y = f->origin.y + (f32)s[1] * f->cell_size;
+    p.z = f->origin.z + (f32)s[2] * f->cell_size;
+    p.e[axis] += t * f->cell_size;
+    c->positions[c->vertex_count] = p;
+    if (job->m->normals) {
+        // The gradient points to higher values, which the triangles face.
+        i32 s1[3] = {s[0], s[1], s[2]};
+        ++s1[axis];
+        vec3 g0 = scalar_field_gradient(f, s[0], s[1], s[2]);
+        vec3 g1 = scalar_field_gradient(f, s1[0], s1[1], s1[2]);
+        vec3 n = vec3_add(vec3_mul_s(g0, 1.0f - t), vec3_mul_s(g1, t));
+        f32 len = vec3_len(n);
+        vec3 up = {{0.0f, 0.0f, 1.0f}};
+        c->normals[c->vertex_count] = len > 0.0f ? vec3_mul_s(n, 1.0f / len) : up;
+    }
+    slot = c->vertex_count++;
+    isosurface_hash_put(c, key, slot);
+    return slot;
+}
+
+// Triangulates the cells of leaf block b. Returns 0 when out of memory.
+static b32 isosurface_block(isosurface_job* job, isosurface_chunk* c, const u32 chunk, const i32 b[3]) {
+    const scalar_field* f = job->f;
+    i32 end[3];
+    for (u32 k = 0; k < 3; ++k) {
+        end[k] = (b[k] + 1) * ISOSURFACE_BLOCK;
+        end[k] = end[k] < f->dims[k] - 1 ? end[k] : f->dims[k] - 1;
+    }
+    u64 dx = 1, dy = (u64)f->dims[0], dz = (u64)f->dims[0] * f->dims[1];
+    i32 cell[3];
+    for (cell[2] = b[2] * ISOSURFACE_BLOCK; cell[2] < end[2]; ++cell[2]) {
+        for (cell[1] = b[1] * ISOSURFACE_BLOCK; cell[1] < end[1]; ++cell[1]) {
+            for (cell[0] = b[0] * ISOSURFACE_BLOCK; cell[0] < end[0]; ++cell[0]) {
+                const f32* base = f->values + cell[0] + dy * cell[1] + dz * cell[2];
+                f32 v[8] = {
+                    base[0], base[dx], base[dy], base[dx + dy],
+                    base[dz], base[dx + dz], base[dy + dz], base[dx + dy + dz],
+                };
+                u32 cube = 0;
+                for (u32 i = 0; i < 8; ++i) {
+                    cube |= (u32)(v[i] < job->iso) << i;
+                }
+                if (cube == 0 || cube == 255) {
+                    continue;
+                }
+                const i8* tris = isosurface_triangles[cube];
+                u32 n = 0;
+                while (n < 16 && tris[n] >= 0) {
+                    n += 3;
+                }
+                if (c->index_count + n > c->index_capacity) {
+                    if (!isosurface_grow((void**)&c->indices, c->index_count, c->index_capacity, sizeof(u32))) {
+                        return 0;
+                    }
+                    c->index_capacity *= 2;
+                }
+                u32 edge_slots[12];
+                for (u32 e = 0; e < 12; ++e) {
+                    edge_slots[e] = ISOSURFACE_MISSING;
+                }
+                for (u32 i = 0; i < n; ++i) {
+                    u32 e = (u32)tris[i];
+                    if (edge_slots[e] == ISOSURFACE_MISSING) {
+                        edge_slots[e] = isosurface_edge_vertex(job, c, chunk, cell, e, v);
+                        if (edge_slots[e] == ISOSURFACE_MISSING) {
+                            return 0;
+                        }
+                    }
+                    c->indices[c->index_count++] = edge_slots[e];
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+// Descends from a node to the leaf blocks whose range straddles the iso
+// value.
+static b32 isosurface_node(isosurface_job* job, isosurface_chunk* c, const u32 chunk, const u32 level,
+        const i32 x, const i32 y, const i32 z) {
+    const isosurface_pyramid* p = job->p;
+    const i32* dims = p->dims[level];
+    const f32* r = p->ranges + 2 * (p->offsets[level] + x + dims[0] * (y + dims[1] * z));
+    if (!(r[0] < job->iso && r[1] >= job->iso)) {
+        return 1;
+    }
+    if (level == 0) {
+        i32 b[3] = {x, y, z};
+        return isosurface_block(job, c, chunk, b);
+    }
+    const i32* child_dims = p->dims[level - 1];
+    for (u32 i = 0; i < 8; ++i) {
+        i32 cx = x * 2 + (i32)(i & 1), cy = y * 2 + (i32)((i >> 1) & 1), cz = z * 2 + (i32)(i >> 2);
+        if (cx < child_dims[0] && cy < child_dims[1] && cz < child_dims[2]
+                && !isosurface_node(job, c, chunk, level - 1, cx, cy, cz)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void isosurface_chunk_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    isosurface_job* job = (isosurface_job*)ctx;
+    const i32* dims = job->p->dims[ISOSURFACE_LEVELS - 1];
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        isosurface_chunk* c = &job->chunks[i];
+        c->vertex_capacity = 64;
+        c->index_capacity = 256;
+        c->foreign_capacity = 64;
+        c->positions = (point3*)YS_MALLOC(sizeof(point3) * c->vertex_capacity);
+        c->normals = job->m->normals ? (vec3*)YS_MALLOC(sizeof(vec3) * c->vertex_capacity) : 0;
+        c->indices = (u32*)YS_MALLOC(sizeof(u32) * c->index_capacity);
+        c->foreign = (u64*)YS_MALLOC(sizeof(u64) * c->foreign_capacity);
+        i32 x = (i32)(i % (u32)dims[0]);
+        i32 y = (i32)(i / (u32)dims[0] % (u32)dims[1]);
+        i32 z = (i32)(i / ((u32)dims[0] * (u32)dims[1]));
+        if (!c->positions || (job->m->normals && !c->normals) || !c->indices || !c->foreign
+                || !isosurface_node(job, c, i, ISOSURFACE_LEVELS - 1, x, y, z)) {
+            atomic_add_u32(&job->failed, 1);
+        }
+    }
+}
+
+// Copies a chunk into the mesh, turning foreign references into the
+// vertices their owners made.
+static void isosurface_merge_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    isosurface_job* job = (isosurface_job*)ctx;
+    mesh* m = job->m;
+    const scalar_field* f = job->f;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        const isosurface_chunk* c = &job->chunks[i];
+        u32 vertex_base = job->vertex_base[i];
+        for (u32 v = 0; v < c->vertex_count; ++v) {
+            m->positions[vertex_base + v] = c->positions[v];
+            if (m->normals) {
+                m->normals[vertex_base + v] = c->normals[v];
+            }
+        }
+        u32* out = m->indices + job->index_base[i];
+        for (u32 k = 0; k < c->index_count; ++k) {
+            u32 slot = c->indices[k];
+            if (!(slot & ISOSURFACE_FOREIGN)) {
+                out[k] = vertex_base + slot;
+                continue;
+            }
+            u64 key = c->foreign[slot & ~ISOSURFACE_FOREIGN];
+            u64 sample = key / 3;
+            i32 s[3];
+            s[0] = (i32)(sample % (u64)f->dims[0]);
+            s[1] = (i32)(sample / (u64)f->dims[0] % (u64)f->dims[1]);
+            s[2] = (i32)(sample / ((u64)f->dims[0] * f->dims[1]));
+            u32 owner = isosurface_owner(job->p, s);
+            out[k] = job->vertex_base[owner] + isosurface_hash_find(&job->chunks[owner], key);
+        }
+    }
+}
+
+// Extracts the surface where the field crosses `iso` into m as a welded,
+// closed where the field allows, indexed triangle mesh, with normals from
+// the field gradient when m has them. `p` must be up to date with `f`.
+// Chunks of ISOSURFACE_CHUNK^3 cells run in parallel and skip every
+// pyramid node the surface misses. Returns 0 when out of memory or when
+// the surface needs more than the capacity of m; m is then left as it
+// was.
+b32 isosurface_extract(mesh* m, const scalar_field* f, const isosurface_pyramid* p, const f32 iso) {
+    const i32* dims = p->dims[ISOSURFACE_LEVELS - 1];
+    u32 chunk_count = (u32)(dims[0] * dims[1] * dims[2]);
+    isosurface_job job;
+    job.f = f;
+    job.p = p;
+    job.m = m;
+    job.iso = iso;
+    job.failed = 0;
+    job.chunks = (isosurface_chunk*)YS_MALLOC(sizeof(isosurface_chunk) * chunk_count);
+    job.vertex_base = (u32*)YS_MALLOC(sizeof(u32) * chunk_count);
+    job.index_base = (u32*)YS_MALLOC(sizeof(u32) * chunk_count);
+    if (!job.chunks || !job.vertex_base || !job.index_base) {
+        YS_FREE(job.chunks);
+        YS_FREE(job.vertex_base);
+        YS_FREE(job.index_base);
+        return 0;
+    }
+    for (u32 i = 0; i < chunk_count; ++i) {
+        isosurface_chunk empty = {0};
+        job.chunks[i] = empty;
+    }
+    parallel_for(chunk_count, 1, isosurface_chunk_task, &job);
+
+    u64 vertex_count = 0, index_count = 0;
+    for (u32 i = 0; i < chunk_count; ++i) {
+        job.vertex_base[i] = (u32)vertex_count;
+        job.index_base[i] = (u32)index_count;
+        vertex_count += job.chunks[i].vertex_count;
+        index_count += job.chunks[i].index_count;
+    }
+    b32 fits = !job.failed && vertex_count <= m->vertex_capacity && index_count <= m->index_capacity;
+    if (fits) {
+        parallel_for(chunk_count, 1, isosurface_merge_task, &job);
+        m->vertex_count = (u32)vertex_count;
+        m->index_count = (u32)index_count;
+    }
+    for (u32 i = 0; i < chunk_count; ++i) {
+        isosurface_chunk_free(&job.chunks[i]);
+    }
+    YS_FREE(job.chunks);
+    YS_FREE(job.vertex_base);
+    YS_FREE(job.index_base);
+    return fits;
+}
+
+#endif
+#endif
@@ -0,0 +1,369 @@
+#ifndef YS_KDTREE_H
+#define YS_KDTREE_H
+
+#include <float.h>
+#include "ys_math.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Upper bound on points per leaf bucket. Leaves are scanned as a whole,
+// so 8-32 keeps the scan in a couple of cache lines.
+#ifndef KDTREE_LEAF_SIZE
+#define KDTREE_LEAF_SIZE 16
+#endif
+
+#define KDTREE_MAX_DEPTH 32
+#define KDTREE_NONE 0xFFFFFFFFu
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+typedef struct kdtree_node {
+    f32 split;
+    u32 axis;
+} kdtree_node;
+
+// Implicit balanced k-d tree. Every level splits its point range at the
+// median, so the tree is complete: the children of node i are 2i+1 and
+// 2i+2, and leaf ranges follow from the point count alone. Points are
+// stored SoA in tree order, `ids` maps a slot back to the input index.
+typedef struct kdtree {
+    f32* x;
+    f32* y;
+    f32* z;
+    u32* ids;
+    kdtree_node* nodes;  // (1 << depth) - 1 internal nodes
+    u32 point_count;
+    u32 depth;           // levels of internal nodes, 0 when the root is a leaf
+} kdtree;
+
+
+/*
+ * === KDTREE INTERFACE ===
+*/
+b32 kdtree_build(kdtree* t, const point3* points, const u32 count);
+void kdtree_free(kdtree* t);
+u32 kdtree_knn(const kdtree* t, const point3 q, const u32 k, u32* ids, f32* dist_sq);
+u32 kdtree_radius(const kdtree* t, const point3 q, const f32 radius, u32* ids, const u32 max_ids);
+void kdtree_knn_batch(const kdtree* t, const point3* queries, const u32 count, const u32 k,
+        u32* ids, f32* dist_sq);
+void kdtree_radius_batch(const kdtree* t, const point3* queries, const u32 count, const f32 radius,
+        const u32 max_ids, u32* ids, u32* counts);
+
+
+#ifdef YS_KDTREE_IMPLEMENTATION
+
+/*
+ * ==== BUILD =======
+*/
+
+// Partially sorts perm[begin, end) on `axis` so that slot nth holds the
+// median and everything before it is <= and everything after it is >=.
+static void kdtree_select(u32* perm, const point3* points, const u32 axis, u32 begin, u32 end,
+        const u32 nth) {
+    while (end - begin > 2) {
+        f32 a = points[perm[begin]].e[axis];
+        f32 b = points[perm[begin + (end - begin) / 2]].e[axis];
+        f32 c = points[perm[end - 1]].e[axis];
+        f32 pivot = a < b ? (b < c ? b : a < c ? c : a) : (a < c ? a : b < c ? c : b);
+
+        i64 i = begin;
+        i64 j = (i64)end - 1;
+        while (i <= j) {
+            while (points[perm[i]].e[axis] < pivot) {
+                ++i;
+            }
+            while (points[perm[j]].e[axis] > pivot) {
+                --j;
+            }
+            if (i <= j) {
+                u32 tmp = perm[i];
+                perm[i] = perm[j];
+                perm[j] = tmp;
+                ++i;
+                --j;
+            }
+        }
+        // [begin, j] <= pivot, (j, i) == pivot, [i, end) >= pivot
+        if ((i64)nth <= j) {
+            end = (u32)(j + 1);
+        } else if ((i64)nth >= i) {
+            begin = (u32)i;
+        } else {
+            return;
+        }
+    }
+    if (end - begin == 2 && points[perm[begin]].e[axis] > points[perm[begin + 1]].e[axis]) {
+        u32 tmp = perm[begin];
+        perm[begin] = perm[begin + 1];
+        perm[begin + 1] = tmp;
+    }
+}
+
+static void kdtree_build_node(kdtree* t, u32* perm, const point3* points, const u32 node,
+        const u32 level, const u32 begin, const u32 end) {
+    if (level == t->depth) {
+        return;
+    }
+    point3 lo = points[perm[begin]];
+    point3 hi = lo;
+    for (u32 i = begin + 1; i < end; ++i) {
+        point3 p = points[perm[i]];
+        for (int a = 0; a < 3; ++a) {
+            lo.e[a] = p.e[a] < lo.e[a] ? p.e[a] : lo.e[a];
+            hi.e[a] = p.e[a] > hi.e[a] ? p.e[a] : hi.e[a];
+        }
+    }
+    u32 axis = 0;
+    for (u32 a = 1; a < 3; ++a) {
+        if (hi.e[a] - lo.e[a] > hi.e[axis] - lo.e[axis]) {
+            axis = a;
+        }
+    }
+
+    u32 mid = begin + (end - begin) / 2;
+    kdtree_select(perm, points, axis, begin, end, mid);
+    t->nodes[node].split = points[perm[mid]].e[axis];
+    t->nodes[node].axis = axis;
+    kdtree_build_node(t, perm, points, 2 * node + 1, level + 1, begin, mid);
+    kdtree_build_node(t, perm, points, 2 * node + 2, level + 1, mid, end);
+}
+
+b32 kdtree_build(kdtree* t, const point3* points, const u32 count) {
+    // Halving a range of n leaves ceil(n / 2^depth) points per leaf at most.
+    u32 depth = 0;
+    while (depth < KDTREE_MAX_DEPTH && ((u64)count + (1ull << depth) - 1) >> depth > KDTREE_LEAF_SIZE) {
+        ++depth;
+    }
+    u32 node_count = (1u << depth) - 1;
+
+    t->x = (f32*)YS_MALLOC(sizeof(f32) * (count ? count : 1));
+    t->y = (f32*)YS_MALLOC(sizeof(f32) * (count ? count : 1));
+    t->z = (f32*)YS_MALLOC(sizeof(f32) * (count ? count : 1));
+    t->ids = (u32*)YS_MALLOC(sizeof(u32) * (count ? count : 1));
+    t->nodes = (kdtree_node*)YS_MALLOC(sizeof(kdtree_node) * (node_count ? node_count : 1));
+    t->point_count = count;
+    t->depth = depth;
+    if (!t->x || !t->y || !t->z || !t->ids || !t->nodes) {
+        kdtree_free(t);
+        return 0;
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+        t->ids[i] = i;
+    }
+    if (count) {
+        kdtree_build_node(t, t->ids, points, 0, 0, 0, count);
+    }
+    for (u32 i = 0; i < count; ++i) {
+        point3 p = points[t->ids[i]];
+        t->x[i] = p.x;
+        t->y[i] = p.y;
+        t->z[i] = p.z;
+    }
+    return 1;
+}
+
+void kdtree_free(kdtree* t) {
+    YS_FREE(t->x);
+    YS_FREE(t->y);
+    YS_FREE(t->z);
+    YS_FREE(t->ids);
+    YS_FREE(t->nodes);
+    t->x = t->y = t->z = 0;
+    t->ids = 0;
+    t->nodes = 0;
+    t->point_count = 0;
+    t->depth = 0;
+}
+
+
+/*
+ * ==== QUERIES =======
+*/
+
+typedef struct kdtree_entry {
+    u32 node;
+    u32 level;
+    u32 begin;
+    u32 end;
+    f32 dist_sq;  // lower bound on the distance to any point below
+} kdtree_entry;
+
+// Squared distances from q to a whole leaf. Fixed layout, no branches, so
+// the compiler turns it into SIMD over the SoA arrays.
+static u32 kdtree_scan_leaf(const kdtree* t, const point3 q, const u32 begin, const u32 end,
+        f32 d[KDTREE_LEAF_SIZE]) {
+    const f32* x = t->x + begin;
+    const f32* y = t->y + begin;
+    const f32* z = t->z + begin;
+    u32 n = end - begin;
+    for (u32 i = 0; i < n; ++i) {
+        f32 dx = x[i] - q.x;
+        f32 dy = y[i] - q.y;
+        f32 dz = z[i] - q.z;
+        d[i] = dx * dx + dy * dy + dz * dz;
+    }
+    return n;
+}
+
+// Pops the stack until a leaf within `bound` comes up, pushing children
+// near side last so it is visited first. Returns 0 when the stack is done.
+static b32 kdtree_next_leaf(const kdtree* t, const point3 q, kdtree_entry* stack, u32* top,
+        const f32 bound, kdtree_entry* leaf) {
+    while (*top) {
+        kdtree_entry e = stack[--*top];
+        if (e.dist_sq > bound) {
+            continue;
+        }
+        if (e.level == t->depth) {
+            *leaf = e;
+            return 1;
+        }
+        kdtree_node n = t->nodes[e.node];
+        u32 mid = e.begin + (e.end - e.begin) / 2;
+        f32 diff = q.e[n.axis] - n.split;
+        kdtree_entry left = {2 * e.node + 1, e.level + 1, e.begin, mid, e.dist_sq};
+        kdtree_entry right = {2 * e.node + 2, e.level + 1, mid, e.end, e.dist_sq};
+        f32 far_sq = diff * diff;
+        if (diff < 0) {
+            right.dist_sq = far_sq > e.dist_sq ? far_sq : e.dist_sq;
+            stack[(*top)++] = right;
+            stack[(*top)++] = left;
+        } else {
+            left.dist_sq = far_sq > e.dist_sq ? far_sq : e.dist_sq;
+            stack[(*top)++] = left;
+            stack[(*top)++] = right;
+        }
+    }
+    return 0;
+}
+
+// Finds the k nearest points to q. Writes up to k input indices and their
+// squared distances nearest first and returns how many were found.
+u32 kdtree_knn(const kdtree* t, const point3 q, const u32 k, u32* ids, f32* dist_sq) {
+    if (!t->point_count || !k) {
+        return 0;
+    }
+    kdtree_entry stack[KDTREE_MAX_DEPTH + 2];
+    kdtree_entry root = {0, 0, 0, t->point_count, 0.0f};
+    u32 top = 0;
+    stack[top++] = root;
+
+    u32 found = 0;
+    f32 worst = FLT_MAX;
+    f32 d[KDTREE_LEAF_SIZE];
+    kdtree_entry leaf;
+    while (kdtree_next_leaf(t, q, stack, &top, worst, &leaf)) {
+        u32 n = kdtree_scan_leaf(t, q, leaf.begin, leaf.end, d);
+        for (u32 i = 0; i < n; ++i) {
+            if (d[i] >= worst) {
+                continue;
+            }
+            // Insertion into the sorted result list.
+            u32 j = found < k ? found++ : k - 1;
+            while (j > 0 && dist_sq[j - 1] > d[i]) {
+                dist_sq[j] = dist_sq[j - 1];
+                ids[j] = ids[j - 1];
+                --j;
+            }
+            dist_sq[j] = d[i];
+            ids[j] = t->ids[leaf.begin + i];
+            if (found == k) {
+                worst = dist_sq[k - 1];
+            }
+        }
+    }
+    return found;
+}
+
+// Finds every point within `radius` of q. Writes the first max_ids input
+// indices found, in no particular order, and returns the total count.
+u32 kdtree_radius(const kdtree* t, const point3 q, const f32 radius, u32* ids, const u32 max_ids) {
+    if (!t->point_count) {
+        return 0;
+    }
+    kdtree_entry stack[KDTREE_MAX_DEPTH + 2];
+    kdtree_entry root = {0, 0, 0, t->point_count, 0.0f};
+    u32 top = 0;
+    stack[top++] = root;
+
+    f32 radius_sq = radius * radius;
+    u32 found = 0;
+    f32 d[KDTREE_LEAF_SIZE];
+    kdtree_entry leaf;
+    while (kdtree_next_leaf(t, q, stack, &top, radius_sq, &leaf)) {
+        u32 n = kdtree_scan_leaf(t, q, leaf.begin, leaf.end, d);
+        for (u32 i = 0; i < n; ++i) {
+            if (d[i] <= radius_sq) {
+                if (found < max_ids) {
+                    ids[found] = t->ids[leaf.begin + i];
+                }
+                ++found;
+            }
+        }
+    }
+    return found;
+}
+
+
+/*
+ * ==== BATCH QUERIES =======
+*/
+
+typedef struct kdtree_batch {
+    const kdtree* t;
+    const point3* queries;
+    u32 k;          // neighbours or ids per query
+    f32 radius;
+    u32* ids;
+    f32* dist_sq;
+    u32* counts;
+} kdtree_batch;
+
+static void kdtree_knn_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    kdtree_batch* b = (kdtree_batch*)ctx;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        u32* ids = b->ids + (u64)i * b->k;
+        f32* dist_sq = b->dist_sq + (u64)i * b->k;
+        u32 found = kdtree_knn(b->t, b->queries[i], b->k, ids, dist_sq);
+        for (u32 j = found; j < b->k; ++j) {
+            ids[j] = KDTREE_NONE;
+            dist_sq[j] = FLT_MAX;
+        }
+    }
+}
+
+static void kdtree_radius_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    kdtree_batch* b = (kdtree_batch*)ctx;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        b->counts[i] = kdtree_radius(b->t, b->queries[i], b->radius, b->ids + (u64)i * b->k, b->k);
+    }
+}
+
+// kNN for many queries across all threads. Results for query i are at
+// ids[i * k] and dist_sq[i * k]; unused slots hold KDTREE_NONE and FLT_MAX.
+void kdtree_knn_batch(const kdtree* t, const point3* queries, const u32 count, const u32 k,
+        u32* ids, f32* dist_sq) {
+    kdtree_batch b = {t, queries, k, 0.0f, ids, dist_sq, 0};
+    parallel_for(count, 64, kdtree_knn_task, &b);
+}
+
+// Radius search for many queries across all threads. Query i writes up to
+// max_ids indices at ids[i * max_ids] and its total count to counts[i].
+void kdtree_radius_batch(const kdtree* t, const point3* queries, const u32 count, const f32 radius,
+        const u32 max_ids, u32* ids, u32* counts) {
+    kdtree_batch b = {t, queries, max_ids, radius, ids, 0, counts};
+    parallel_for(count, 64, kdtree_radius_task, &b);
+}
+
+#endif
+#endif
@@ -0,0 +1,488 @@
+#ifndef YS_MESH_H
+#define YS_MESH_H
+
+#include <math.h>
+#include "ys_geom.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Optional vertex streams, positions are always present.
+#define MESH_NORMALS 0x1u
+#define MESH_UVS 0x2u
+#define MESH_TANGENTS 0x4u
+
+#define MESH_NONE 0xFFFFFFFFu
+
+// Post-transform cache size the reordering targets. Tipsify is not very
+// sensitive to it; 16 suits most GPUs of the last decade.
+#define MESH_CACHE_SIZE 16
+
+// Triangles and vertices per parallel_for chunk when computing normals.
+#define MESH_FACE_GRAIN 4096
+#define MESH_VERTEX_GRAIN 4096
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Indexed triangle mesh with one array per vertex attribute, so passes
+// that only need positions stream through positions alone. Streams not
+// requested at creation are null. Fill the arrays and set the counts
+// directly, up to the capacities.
+typedef struct mesh {
+    point3* positions;
+    vec3* normals;
+    vec2* uvs;
+    vec4* tangents;      // w is the bitangent sign
+    u32* indices;        // 3 per triangle
+    u32 vertex_count;
+    u32 index_count;
+    u32 vertex_capacity;
+    u32 index_capacity;
+    u32 streams;
+} mesh;
+
+// Triangles around each vertex, as offsets into one list. It depends only
+// on the indices, so a deforming mesh builds it once.
+typedef struct mesh_adjacency {
+    u32* offsets;        // vertex_count + 1
+    u32* triangles;
+    u32 vertex_count;
+} mesh_adjacency;
+
+
+/*
+ * === MESH INTERFACE ===
+*/
+b32 mesh_create(mesh* m, const u32 max_vertices, const u32 max_indices, const u32 streams);
+void mesh_free(mesh* m);
+b32 mesh_adjacency_create(mesh_adjacency* a, const mesh* m);
+void mesh_adjacency_free(mesh_adjacency* a);
+b32 mesh_compute_normals(mesh* m, const mesh_adjacency* a);
+b32 mesh_optimize_vertex_cache(mesh* m, const u32 cache_size);
+b32 mesh_optimize_vertex_fetch(mesh* m);
+f32 mesh_acmr(const u32* indices, const u32 index_count, const u32 vertex_count, const u32 cache_size);
+
+
+#ifdef YS_MESH_IMPLEMENTATION
+
+b32 mesh_create(mesh* m, const u32 max_vertices, const u32 max_indices, const u32 streams) {
+    u32 vertices = max_vertices > 0 ? max_vertices : 1;
+    m->positions = (point3*)YS_MALLOC(sizeof(point3) * vertices);
+    m->normals = streams & MESH_NORMALS ? (vec3*)YS_MALLOC(sizeof(vec3) * vertices) : 0;
+    m->uvs = streams & MESH_UVS ? (vec2*)YS_MALLOC(sizeof(vec2) * vertices) : 0;
+    m->tangents = streams & MESH_TANGENTS ? (vec4*)YS_MALLOC(sizeof(vec4) * vertices) : 0;
+    m->indices = (u32*)YS_MALLOC(sizeof(u32) * (max_indices > 0 ? max_indices : 1));
+    m->vertex_count = 0;
+    m->index_count = 0;
+    m->vertex_capacity = max_vertices;
+    m->index_capacity = max_indices;
+    m->streams = streams;
+    if (!m->positions || !m->indices || ((streams & MESH_NORMALS) && !m->normals)
+            || ((streams & MESH_UVS) && !m->uvs) || ((streams & MESH_TANGENTS) && !m->tangents)) {
+        mesh_free(m);
+        return 0;
+    }
+    return 1;
+}
+
+void mesh_free(mesh* m) {
+    YS_FREE(m->positions);
+    YS_FREE(m->normals);
+    YS_FREE(m->uvs);
+    YS_FREE(m->tangents);
+    YS_FREE(m->indices);
+    m->positions = 0;
+    m->normals = 0;
+    m->uvs = 0;
+    m->tangents = 0;
+    m->indices = 0;
+    m->vertex_count = 0;
+    m->index_count = 0;
+    m->vertex_capacity = 0;
+    m->index_capacity = 0;
+}
+
+
+/*
+ * ==== ADJACENCY =======
+*/
+
+// Counting sort of the triangle corners by vertex. Returns 0 when out of
+// memory.
+b32 mesh_adjacency_create(mesh_adjacency* a, const mesh* m) {
+    u32 vertex_count = m->vertex_count;
+    u32 index_count = m->index_count / 3 * 3;
+    a->offsets = (u32*)YS_MALLOC(sizeof(u32) * (vertex_count + 1));
+    a->triangles = (u32*)YS_MALLOC(sizeof(u32) * (index_count > 0 ? index_count : 1));
+    a->vertex_count = vertex_count;
+    if (!a->offsets || !a->triangles) {
+        mesh_adjacency_free(a);
+        return 0;
+    }
+    for (u32 v = 0; v <= vertex_count; ++v) {
+        a->offsets[v] = 0;
+    }
+    for (u32 i = 0; i < index_count; ++i) {
+        ++a->offsets[m->indices[i] + 1];
+    }
+    for (u32 v = 0; v < vertex_count; ++v) {
+        a->offsets[v + 1] += a->offsets[v];
+    }
+    for (u32 i = 0; i < index_count; ++i) {
+        a->triangles[a->offsets[m->indices[i]]++] = i / 3;
+    }
+    for (u32 v = vertex_count; v > 0; --v) {
+        a->offsets[v] = a->offsets[v - 1];
+    }
+    a->offsets[0] = 0;
+    return 1;
+}
+
+void mesh_adjacency_free(mesh_adjacency* a) {
+    YS_FREE(a->offsets);
+    YS_FREE(a->triangles);
+    a->offsets = 0;
+    a->triangles = 0;
+    a->vertex_count = 0;
+}
+
+
+/*
+ * ==== NORMALS AND TANGENTS =======
+*/
+
+// Area weighted face vectors are written per triangle, then each vertex
+// sums its own triangles through the adjacency. No two threads write the
+// same output, so neither pass needs atomics.
+typedef struct mesh_normals_job {
+    mesh* m;
+    const mesh_adjacency* a;
+    vec3* face_normals;
+    vec3* face_tangents;     // null without tangents
+    vec3* face_bitangents;
+} mesh_normals_job;
+
+static void mesh_face_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    mesh_normals_job* job = (mesh_normals_job*)ctx;
+    const mesh* m = job->m;
+    (void)thread;
+    for (u32 t = begin; t < end; ++t) {
+        const u32* tri = m->indices + t * 3;
+        vec3 e1 = vec3_sub(m->positions[tri[1]], m->positions[tri[0]]);
+        vec3 e2 = vec3_sub(m->positions[tri[2]], m->positions[tri[0]]);
+        vec3 n = vec3_cross(e1, e2);
+        job->face_normals[t] = n;
+        if (!job->face_tangents) {
+            continue;
+        }
+        // Directions of increasing u and v over the triangle (Lengyel),
+        // rescaled to the triangle area so that, like the normals, large
+        // triangles count more and uv scale does not.
+        vec2 d1 = vec2_sub(m->uvs[tri[1]], m->uvs[tri[0]]);
+        vec2 d2 = vec2_sub(m->uvs[tri[2]], m->uvs[tri[0]]);
+        f32 r = d1.x * d2.y - d2.x * d1.y;
+        vec3 tu = vec3_sub(vec3_mul_s(e1, d2.y), vec3_mul_s(e2, d1.y));
+        vec3 tv = vec3_sub(vec3_mul_s(e2, d1.x), vec3_mul_s(e1, d2.x));
+        f32 tu_len = vec3_len(tu);
+        f32 tv_len = vec3_len(tv);
+        f32 area = r < 0.0f ? -vec3_len(n) : r > 0.0f ? vec3_len(n) : 0.0f;
+        job->face_tangents[t] = vec3_mul_s(tu, tu_len > 0.0f ? area / tu_len : 0.0f);
+        job->face_bitangents[t] = vec3_mul_s(tv, tv_len > 0.0f ? area / tv_len : 0.0f);
+    }
+}
+
+static void mesh_vertex_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    mesh_normals_job* job = (mesh_normals_job*)ctx;
+    mesh* m = job->m;
+    const mesh_adjacency* a = job->a;
+    (void)thread;
+    for (u32 v = begin; v < end; ++v) {
+        vec3 n = {{0.0f, 0.0f, 0.0f}};
+        vec3 tu = {{0.0f, 0.0f, 0.0f}};
+        vec3 tv = {{0.0f, 0.0f, 0.0f}};
+        for (u32 i = a->offsets[v]; i < a->offsets[v + 1]; ++i) {
+            u32 t = a->triangles[i];
+            n = vec3_add(n, job->face_normals[t]);
+            if (job->face_tangents) {
+                tu = vec3_add(tu, job->face_tangents[t]);
+                tv = vec3_add(tv, job->face_bitangents[t]);
+            }
+        }
+        // Unused or fully degenerate vertices get +z.
+        f32 len = vec3_len(n);
+        if (len > 0.0f) {
+            n = vec3_mul_s(n, 1.0f / len);
+        } else {
+            n.x = 0.0f;
+            n.y = 0.0f;
+            n.z = 1.0f;
+        }
+        m->normals[v] = n;
+        if (!job->face_tangents) {
+            continue;
+        }
+
+        // Gram-Schmidt against the normal, or any perpendicular when the
+        // uvs give no direction.
+        tu = vec3_sub(tu, vec3_mul_s(n, vec3_dot(n, tu)));
+        len = vec3_len(tu);
+        if (len > 1e-20f) {
+            tu = vec3_mul_s(tu, 1.0f / len);
+        } else {
+            vec3 axis = {{0.0f, 0.0f, 0.0f}};
+            axis.e[fabsf(n.x) < 0.9f ? 0 : 1] = 1.0f;
+            tu = vec3_normal(vec3_cross(vec3_cross(n, axis), n));
+        }
+        vec4 tangent;
+        tangent.x = tu.x;
+        tangent.y = tu.y;
+        tangent.z = tu.z;
+        tangent.w = vec3_dot(vec3_cross(n, tu), tv) < 0.0f ? -1.0f : 1.0f;
+        m->tangents[v] = tangent;
+    }
+}
+
+// Recomputes the smooth normals, and the tangents when the mesh has uv and
+// tangent streams, from the current positions. `a` must come from the
+// current indices. Both passes run in parallel. Returns 0 when the mesh
+// has no normals or memory runs out.
+b32 mesh_compute_normals(mesh* m, const mesh_adjacency* a) {
+    u32 tri_count = m->index_count / 3;
+    b32 tangents = m->tangents && m->uvs;
+    if (!m->normals || a->vertex_count != m->vertex_count) {
+        return 0;
+    }
+    mesh_normals_job job;
+    job.m = m;
+    job.a = a;
+    job.face_normals = (vec3*)YS_MALLOC(sizeof(vec3) * (tri_count > 0 ? tri_count : 1) * (tangents ? 3 : 1));
+    if (!job.face_normals) {
+        return 0;
+    }
+    job.face_tangents = tangents ? job.face_normals + tri_count : 0;
+    job.face_bitangents = tangents ? job.face_normals + 2 * tri_count : 0;
+    parallel_for(tri_count, MESH_FACE_GRAIN, mesh_face_task, &job);
+    parallel_for(m->vertex_count, MESH_VERTEX_GRAIN, mesh_vertex_task, &job);
+    YS_FREE(job.face_normals);
+    return 1;
+}
+
+
+/*
+ * ==== VERTEX CACHE =======
+*/
+
+// Reorders the triangles for the post-transform vertex cache with Tipsify
+// (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+// Locality and Reduced Overdraw"). It emits every triangle around one
+// vertex at a time and moves on to the oldest neighbour that stays cached
+// while its own fan is emitted, in time linear in the mesh. Returns 0 when
+// out of memory, leaving the mesh as it was.
+b32 mesh_optimize_vertex_cache(mesh* m, const u32 cache_size) {
+    u32 vertex_count = m->vertex_count;
+    u32 tri_count = m->index_count / 3;
+    mesh_adjacency adj;
+    if (!mesh_adjacency_create(&adj, m)) {
+        return 0;
+    }
+    u32* live = (u32*)YS_MALLOC(sizeof(u32) * (vertex_count > 0 ? vertex_count : 1));
+    u32* stamp = (u32*)YS_MALLOC(sizeof(u32) * (vertex_count > 0 ? vertex_count : 1));
+    u8* emitted = (u8*)YS_MALLOC(tri_count > 0 ? tri_count : 1);
+    u32* dead_end = (u32*)YS_MALLOC(sizeof(u32) * (tri_count * 3 + 1));
+    u32* candidates = (u32*)YS_MALLOC(sizeof(u32) * (tri_count * 3 + 1));
+    u32* out = (u32*)YS_MALLOC(sizeof(u32) * (tri_count * 3 + 1));
+    if (!live || !stamp || !emitted || !dead_end || !candidates || !out) {
+        mesh_adjacency_free(&adj);
+        YS_FREE(live);
+        YS_FREE(stamp);
+        YS_FREE(emitted);
+        YS_FREE(dead_end);
+        YS_FREE(candidates);
+        YS_FREE(out);
+        return 0;
+    }
+    for (u32 v = 0; v < vertex_count; ++v) {
+        live[v] = adj.offsets[v + 1] - adj.offsets[v];
+        stamp[v] = 0;
+    }
+    for (u32 t = 0; t < tri_count; ++t) {
+        emitted[t] = 0;
+    }
+
+    u32 time = cache_size + 1;
+    u32 out_count = 0;
+    u32 dead_count = 0;
+    u32 cursor = 0;
+    u32 fan = tri_count > 0 ? m->indices[0] : MESH_NONE;
+    while (fan != MESH_NONE) {
+        u32 candidate_count = 0;
+        for (u32 i = adj.offsets[fan]; i < adj.offsets[fan + 1]; ++i) {
+            u32 t = adj.triangles[i];
+            if (emitted[t]) {
+                continue;
+            }
+            emitted[t] = 1;
+            for (u32 k = 0; k < 3; ++k) {
+                u32 v = m->indices[t * 3 + k];
+                out[out_count++] = v;
+                dead_end[dead_count++] = v;
+                candidates[candidate_count++] = v;
+                --live[v];
+                if (time - stamp[v] > cache_size) {
+                    stamp[v] = time++;
+                }
+            }
+        }
+
+        // Candidate still in the cache after its remaining triangles are
+        // emitted, oldest first; otherwise a dead end.
+        fan = MESH_NONE;
+        u32 best = 0;
+        for (u32 i = 0; i < candidate_count; ++i) {
+            u32 v = candidates[i];
+            if (live[v] == 0) {
+                continue;
+            }
+            u32 priority = 0;
+            if (time - stamp[v] + 2 * live[v] <= cache_size) {
+                priority = time - stamp[v];
+            }
+            if (priority > best) {
+                fan = v;
+                best = priority;
+            }
+        }
+        while (fan == MESH_NONE && dead_count > 0) {
+            u32 v = dead_end[--dead_count];
+            fan = live[v] > 0 ? v : MESH_NONE;
+        }
+        while (fan == MESH_NONE && cursor < vertex_count) {
+            fan = live[cursor] > 0 ? cursor : MESH_NONE;
+            ++cursor;
+        }
+    }
+
+    for (u32 i = 0; i < out_count; ++i) {
+        m->indices[i] = out[i];
+    }
+    mesh_adjacency_free(&adj);
+    YS_FREE(live);
+    YS_FREE(stamp);
+    YS_FREE(emitted);
+    YS_FREE(dead_end);
+    YS_FREE(candidates);
+    YS_FREE(out);
+    return 1;
+}
+
+// Average cache miss ratio: vertices transformed per triangle with a FIFO
+// cache of `cache_size` entries. 0.5 is the ideal for large grids, 3 the
+// worst case. Returns a negative value when out of memory.
+f32 mesh_acmr(const u32* indices, const u32 index_count, const u32 vertex_count, const u32 cache_size) {
+    u32* stamp = (u32*)YS_MALLOC(sizeof(u32) * (vertex_count > 0 ? vertex_count : 1));
+    if (!stamp) {
+        return -1.0f;
+    }
+    for (u32 v = 0; v < vertex_count; ++v) {
+        stamp[v] = 0;
+    }
+    // A vertex is cached while fewer than cache_size misses happened
+    // since its own.
+    u32 time = cache_size + 1;
+    u32 misses = 0;
+    for (u32 i = 0; i < index_count; ++i) {
+        u32 v = indices[i];
+        if (time - stamp[v] > cache_size) {
+            stamp[v] = time++;
+            ++misses;
+        }
+    }
+    YS_FREE(stamp);
+    return index_count >= 3 ? (f32)misses / (f32)(index_count / 3) : 0.0f;
+}
+
+
+/*
+ * ==== VERTEX FETCH =======
+*/
+
+// Renumbers the vertices in the order the indices first use them and
+// permutes every stream to match, so a pass over the indices reads the
+// vertex streams front to back. Unreferenced vertices are dropped and
+// vertex_count shrinks. Run it after the triangle order is final.
+// Returns 0 when out of memory, leaving the mesh as it was.
+b32 mesh_optimize_vertex_fetch(mesh* m) {
+    u32 vertex_count = m->vertex_count;
+    u32* remap = (u32*)YS_MALLOC(sizeof(u32) * (vertex_count > 0 ? vertex_count : 1));
+    vec4* scratch = (vec4*)YS_MALLOC(sizeof(vec4) * (vertex_count > 0 ? vertex_count : 1));
+    if (!remap || !scratch) {
+        YS_FREE(remap);
+        YS_FREE(scratch);
+        return 0;
+    }
+    for (u32 v = 0; v < vertex_count; ++v) {
+        remap[v] = MESH_NONE;
+    }
+    u32 next = 0;
+    for (u32 i = 0; i < m->index_count; ++i) {
+        u32 v = m->indices[i];
+        if (remap[v] == MESH_NONE) {
+            remap[v] = next++;
+        }
+        m->indices[i] = remap[v];
+    }
+
+    vec3* vectors = (vec3*)scratch;
+    for (u32 v = 0; v < vertex_count; ++v) {
+        if (remap[v] != MESH_NONE) {
+            vectors[remap[v]] = m->positions[v];
+        }
+    }
+    for (u32 v = 0; v < next; ++v) {
+        m->positions[v] = vectors[v];
+    }
+    if (m->normals) {
+        for (u32 v = 0; v < vertex_count; ++v) {
+            if (remap[v] != MESH_NONE) {
+                vectors[remap[v]] = m->normals[v];
+            }
+        }
+        for (u32 v = 0; v < next; ++v) {
+            m->normals[v] = vectors[v];
+        }
+    }
+    if (m->uvs) {
+        vec2* uvs = (vec2*)scratch;
+        for (u32 v = 0; v < vertex_count; ++v) {
+            if (remap[v] != MESH_NONE) {
+                uvs[remap[v]] = m->uvs[v];
+            }
+        }
+        for (u32 v = 0; v < next; ++v) {
+            m->uvs[v] = uvs[v];
+        }
+    }
+    if (m->tangents) {
+        for (u32 v = 0; v < vertex_count; ++v) {
+            if (remap[v] != MESH_NONE) {
+                scratch[remap[v]] = m->tangents[v];
+            }
+        }
+        for (u32 v = 0; v < next; ++v) {
+            m->tangents[v] = scratch[v];
+        }
+    }
+    m->vertex_count = next;
+    YS_FREE(remap);
+    YS_FREE(scratch);
+    return 1;
+}
+
+#endif
+#endif
@@ -0,0 +1,299 @@
+#ifndef YS_MORTON_H
+#define YS_MORTON_H
+
+#include "ys_math.h"
+
+// Morton and Hilbert keys use 16 bits per axis in 2D and 21 in 3D.
+#define MORTON2_BITS 16
+#define MORTON3_BITS 21
+
+/*
+ * === MORTON INTERFACE ===
+*/
+u32 morton2_encode(const u32 x, const u32 y);
+void morton2_decode(const u32 key, u32* x, u32* y);
+u64 morton3_encode(const u32 x, const u32 y, const u32 z);
+void morton3_decode(const u64 key, u32* x, u32* y, u32* z);
+void morton2_encode_points(const point2* points, const u32 count, const point2 min, const point2 max,
+        u32* keys);
+void morton3_encode_points(const point3* points, const u32 count, const point3 min, const point3 max,
+        u64* keys);
+
+
+/*
+ * === HILBERT INTERFACE ===
+*/
+u32 hilbert2_encode(const u32 x, const u32 y);
+void hilbert2_decode(const u32 key, u32* x, u32* y);
+u64 hilbert3_encode(const u32 x, const u32 y, const u32 z);
+void hilbert3_decode(const u64 key, u32* x, u32* y, u32* z);
+void hilbert2_encode_points(const point2* points, const u32 count, const point2 min, const point2 max,
+        u32* keys);
+void hilbert3_encode_points(const point3* points, const u32 count, const point3 min, const point3 max,
+        u64* keys);
+
+
+#ifdef YS_MORTON_IMPLEMENTATION
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#define MORTON2_MASK_X 0x55555555u
+#define MORTON2_MASK_Y 0xAAAAAAAAu
+#define MORTON3_MASK_X 0x1249249249249249ull
+#define MORTON3_MASK_Y 0x2492492492492492ull
+#define MORTON3_MASK_Z 0x4924924924924924ull
+
+// Points quantized per block before encoding, so the quantize loop runs
+// over plain arrays and vectorizes.
+#define MORTON_BLOCK 64
+
+/*
+ * ==== MORTON =======
+*/
+
+#if !defined(__BMI2__)
+// Spreads the low 16 bits of v to the even bits.
+static u32 morton_part1by1(u32 v) {
+    v &= 0x0000FFFFu;
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+static u32 morton_compact1by1(u32 v) {
+    v &= 0x55555555u;
+    v = (v | (v >> 1)) & 0x33333333u;
+    v = (v | (v >> 2)) & 0x0F0F0F0Fu;
+    v = (v | (v >> 4)) & 0x00FF00FFu;
+    v = (v | (v >> 8)) & 0x0000FFFFu;
+    return v;
+}
+
+// Spreads the low 21 bits of v to every third bit.
+static u64 morton_part1by2(u64 v) {
+    v &= 0x1FFFFFull;
+    v = (v | (v << 32)) & 0x001F00000000FFFFull;
+    v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+    v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+    v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+static u32 morton_compact1by2(u64 v) {
+    v &= 0x1249249249249249ull;
+    v = (v | (v >> 2)) & 0x10C30C30C30C30C3ull;
+    v = (v | (v >> 4)) & 0x100F00F00F00F00Full;
+    v = (v | (v >> 8)) & 0x001F0000FF0000FFull;
+    v = (v | (v >> 16)) & 0x001F00000000FFFFull;
+    v = (v | (v >> 32)) & 0x1FFFFFull;
+    return (u32)v;
+}
+#endif
+
+// x lands on bit 0. Only the low MORTON2_BITS of each axis are used.
+u32 morton2_encode(const u32 x, const u32 y) {
+#if defined(__BMI2__)
+    return _pdep_u32(x, MORTON2_MASK_X) | _pdep_u32(y, MORTON2_MASK_Y);
+#else
+    return morton_part1by1(x) | (morton_part1by1(y) << 1);
+#endif
+}
+
+void morton2_decode(const u32 key, u32* x, u32* y) {
+#if defined(__BMI2__)
+    *x = _pext_u32(key, MORTON2_MASK_X);
+    *y = _pext_u32(key, MORTON2_MASK_Y);
+#else
+    *x = morton_compact1by1(key);
+    *y = morton_compact1by1(key >> 1);
+#endif
+}
+
+u64 morton3_encode(const u32 x, const u32 y, const u32 z) {
+#if defined(__BMI2__)
+    return _pdep_u64(x, MORTON3_MASK_X) | _pdep_u64(y, MORTON3_MASK_Y) | _pdep_u64(z, MORTON3_MASK_Z);
+#else
+    return morton_part1by2(x) | (morton_part1by2(y) << 1) | (morton_part1by2(z) << 2);
+#endif
+}
+
+void morton3_decode(const u64 key, u32* x, u32* y, u32* z) {
+#if defined(__BMI2__)
+    *x = (u32)_pext_u64(key, MORTON3_MASK_X);
+    *y = (u32)_pext_u64(key, MORTON3_MASK_Y);
+    *z = (u32)_pext_u64(key, MORTON3_MASK_Z);
+#else
+    *x = morton_compact1by2(key);
+    *y = morton_compact1by2(key >> 1);
+    *z = morton_compact1by2(key >> 2);
+#endif
+}
+
+
+/*
+ * ==== HILBERT =======
+*/
+
+// Skilling's in-place conversion between axis coordinates and the
+// "transposed" Hilbert index, for n axes of `bits` bits each. The index
+// bits are then interleaved with axis 0 as the most significant.
+static void hilbert_axes_to_transpose(u32* v, const u32 n, const u32 bits) {
+    u32 m = 1u << (bits - 1);
+    for (u32 q = m; q > 1; q >>= 1) {
+        u32 p = q - 1;
+        for (u32 i = 0; i < n; ++i) {
+            if (v[i] & q) {
+                v[0] ^= p;
+            } else {
+                u32 t = (v[0] ^ v[i]) & p;
+                v[0] ^= t;
+                v[i] ^= t;
+            }
+        }
+    }
+    for (u32 i = 1; i < n; ++i) {
+        v[i] ^= v[i - 1];
+    }
+    u32 t = 0;
+    for (u32 q = m; q > 1; q >>= 1) {
+        if (v[n - 1] & q) {
+            t ^= q - 1;
+        }
+    }
+    for (u32 i = 0; i < n; ++i) {
+        v[i] ^= t;
+    }
+}
+
+static void hilbert_transpose_to_axes(u32* v, const u32 n, const u32 bits) {
+    u32 end = 2u << (bits - 1);
+    u32 t = v[n - 1] >> 1;
+    for (u32 i = n - 1; i > 0; --i) {
+        v[i] ^= v[i - 1];
+    }
+    v[0] ^= t;
+    for (u32 q = 2; q != end; q <<= 1) {
+        u32 p = q - 1;
+        for (u32 i = n; i-- > 0;) {
+            if (v[i] & q) {
+                v[0] ^= p;
+            } else {
+                t = (v[0] ^ v[i]) & p;
+                v[0] ^= t;
+                v[i] ^= t;
+            }
+        }
+    }
+}
+
+u32 hilbert2_encode(const u32 x, const u32 y) {
+    u32 v[2] = {x & 0xFFFFu, y & 0xFFFFu};
+    hilbert_axes_to_transpose(v, 2, MORTON2_BITS);
+    return morton2_encode(v[1], v[0]);
+}
+
+void hilbert2_decode(const u32 key, u32* x, u32* y) {
+    u32 v[2];
+    morton2_decode(key, &v[1], &v[0]);
+    hilbert_transpose_to_axes(v, 2, MORTON2_BITS);
+    *x = v[0];
+    *y = v[1];
+}
+
+u64 hilbert3_encode(const u32 x, const u32 y, const u32 z) {
+    u32 v[3] = {x & 0x1FFFFFu, y & 0x1FFFFFu, z & 0x1FFFFFu};
+    hilbert_axes_to_transpose(v, 3, MORTON3_BITS);
+    return morton3_encode(v[2], v[1], v[0]);
+}
+
+void hilbert3_decode(const u64 key, u32* x, u32* y, u32* z) {
+    u32 v[3];
+    morton3_decode(key, &v[2], &v[1], &v[0]);
+    hilbert_transpose_to_axes(v, 3, MORTON3_BITS);
+    *x = v[0];
+    *y = v[1];
+    *z = v[2];
+}
+
+
+/*
+ * ==== BATCH =======
+*/
+
+// Maps [min, max] of each axis onto [0, 2^bits - 1]; values outside are
+// clamped. Writes MORTON_BLOCK (or fewer) quantized coordinates per axis.
+static void morton_quantize(const f32* v, const u32 stride, const u32 count, const f32 min, const f32 max,
+        const u32 bits, u32* out) {
+    f32 cells = (f32)(1u << bits);
+    f32 extent = max - min;
+    f32 scale = extent > 0 ? cells / extent : 0.0f;
+    f32 top = cells - 1.0f;
+    for (u32 i = 0; i < count; ++i) {
+        f32 q = (v[i * stride] - min) * scale;
+        q = q < 0 ? 0 : q;
+        q = q > top ? top : q;
+        out[i] = (u32)q;
+    }
+}
+
+void morton2_encode_points(const point2* points, const u32 count, const point2 min, const point2 max,
+        u32* keys) {
+    u32 qx[MORTON_BLOCK], qy[MORTON_BLOCK];
+    for (u32 base = 0; base < count; base += MORTON_BLOCK) {
+        u32 n = count - base < MORTON_BLOCK ? count - base : MORTON_BLOCK;
+        morton_quantize(&points[base].x, 2, n, min.x, max.x, MORTON2_BITS, qx);
+        morton_quantize(&points[base].y, 2, n, min.y, max.y, MORTON2_BITS, qy);
+        for (u32 i = 0; i < n; ++i) {
+            keys[base + i] = morton2_encode(qx[i], qy[i]);
+        }
+    }
+}
+
+void morton3_encode_points(const point3* points, const u32 count, const point3 min, const point3 max,
+        u64* keys) {
+    u32 qx[MORTON_BLOCK], qy[MORTON_BLOCK], qz[MORTON_BLOCK];
+    for (u32 base = 0; base < count; base += MORTON_BLOCK) {
+        u32 n = count - base < MORTON_BLOCK ? count - base : MORTON_BLOCK;
+        morton_quantize(&points[base].x, 3, n, min.x, max.x, MORTON3_BITS, qx);
+        morton_quantize(&points[base].y, 3, n, min.y, max.y, MORTON3_BITS, qy);
+        morton_quantize(&points[base].z, 3, n, min.z, max.z, MORTON3_BITS, qz);
+        for (u32 i = 0; i < n; ++i) {
+            keys[base + i] = morton3_encode(qx[i], qy[i], qz[i]);
+        }
+    }
+}
+
+void hilbert2_encode_points(const point2* points, const u32 count, const point2 min, const point2 max,
+        u32* keys) {
+    u32 qx[MORTON_BLOCK], qy[MORTON_BLOCK];
+    for (u32 base = 0; base < count; base += MORTON_BLOCK) {
+        u32 n = count - base < MORTON_BLOCK ? count - base : MORTON_BLOCK;
+        morton_quantize(&points[base].x, 2, n, min.x, max.x, MORTON2_BITS, qx);
+        morton_quantize(&points[base].y, 2, n, min.y, max.y, MORTON2_BITS, qy);
+        for (u32 i = 0; i < n; ++i) {
+            keys[base + i] = hilbert2_encode(qx[i], qy[i]);
+        }
+    }
+}
+
+void hilbert3_encode_points(const point3* points, const u32 count, const point3 min, const point3 max,
+        u64* keys) {
+    u32 qx[MORTON_BLOCK], qy[MORTON_BLOCK], qz[MORTON_BLOCK];
+    for (u32 base = 0; base < count; base += MORTON_BLOCK) {
+        u32 n = count - base < MORTON_BLOCK ? count - base : MORTON_BLOCK;
+        morton_quantize(&points[base].x, 3, n, min.x, max.x, MORTON3_BITS, qx);
+        morton_quantize(&points[base].y, 3, n, min.y, max.y, MORTON3_BITS, qy);
+        morton_quantize(&points[base].z, 3, n, min.z, max.z, MORTON3_BITS, qz);
+        for (u32 i = 0; i < n; ++i) {
+            keys[base + i] = hilbert3_encode(qx[i], qy[i], qz[i]);
+        }
+    }
+}
+
+#endif
+#endif
@@ -0,0 +1,557 @@
+#ifndef YS_OCTREE_H
+#define YS_OCTREE_H
+
+#include "ys_geom.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+#define OCTREE_MAX_DEPTH 16
+#define OCTREE_NONE 0xFFFFFFFFu
+// Items per task for the parallel descent of octree_insert_batch.
+#define OCTREE_INSERT_GRAIN 1024
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// A node's cell is center +- half_size. Its loose bounds are twice that,
+// center +- 2 * half_size, so an item only has to fit by its center and
+// size and never straddles a split plane.
+typedef struct octree_node {
+    point3 center;
+    f32 half_size;
+    u32 children;    // first of 8 consecutive nodes or OCTREE_NONE
+    u32 parent;
+    u32 items;       // first item stored in this node or OCTREE_NONE
+    u32 count;       // items in this subtree
+} octree_node;
+
+typedef struct octree_item {
+    aabb3 bounds;
+    u32 node;        // OCTREE_NONE when the slot is free
+    u32 next;        // next item in the node, or next free slot
+    u32 prev;
+} octree_item;
+
+// Loose octree over AABBs with fixed size pools. Items are referenced by
+// the handle octree_insert returns. Children are allocated 8 at a time
+// and blocks are recycled when a subtree empties, so a tree that churns
+// stays inside the same few cache lines of the pool.
+typedef struct octree {
+    octree_node* nodes;
+    octree_item* items;
+    u32 node_capacity;
+    u32 item_capacity;
+    u32 node_used;     // high water mark of the node pool
+    u32 free_block;    // recycled child blocks, linked through `items`
+    u32 free_item;
+    u32 max_depth;
+} octree;
+
+// Called for items whose box the ray enters before t_max. Return 1 and
+// the distance to the actual object in `t` to accept a hit.
+typedef b32 (*octree_ray_fn)(void* ctx, u32 item, const ray3 r, const f32 t_max, f32* t);
+
+
+/*
+ * === OCTREE INTERFACE ===
+*/
+b32 octree_create(octree* o, const point3 center, const f32 half_size, const u32 max_depth,
+        const u32 max_items, const u32 max_nodes);
+void octree_free(octree* o);
+u32 octree_insert(octree* o, const aabb3 bounds);
+u32 octree_insert_batch(octree* o, const aabb3* bounds, const u32 count, u32* handles);
+void octree_remove(octree* o, const u32 item);
+void octree_update(octree* o, const u32 item, const aabb3 bounds);
+u32 octree_query_aabb3(const octree* o, const aabb3 box, u32* items, const u32 max_items);
+u32 octree_query_frustum(const octree* o, const frustum* f, u32* items, const u32 max_items);
+u32 octree_raycast(const octree* o, const ray3 r, const f32 t_max, octree_ray_fn fn, void* ctx, f32* t_hit);
+
+
+#ifdef YS_OCTREE_IMPLEMENTATION
+
+// Most nodes a traversal stack can hold: 7 siblings pending per level.
+#define OCTREE_STACK (OCTREE_MAX_DEPTH * 7 + 8)
+
+static void octree_init_node(octree_node* n, const point3 center, const f32 half_size, const u32 parent) {
+    n->center = center;
+    n->half_size = half_size;
+    n->children = OCTREE_NONE;
+    n->parent = parent;
+    n->items = OCTREE_NONE;
+    n->count = 0;
+}
+
+// `max_nodes` is rounded to the root plus whole blocks of 8.
+b32 octree_create(octree* o, const point3 center, const f32 half_size, const u32 max_depth,
+        const u32 max_items, const u32 max_nodes) {
+    u32 blocks = max_nodes > 1 ? (max_nodes - 1) / 8 : 0;
+    o->node_capacity = 1 + blocks * 8;
+    o->item_capacity = max_items;
+    o->nodes = (octree_node*)YS_MALLOC(sizeof(octree_node) * o->node_capacity);
+    o->items = (octree_item*)YS_MALLOC(sizeof(octree_item) * (max_items ? max_items : 1));
+    o->node_used = 1;
+    o->free_block = OCTREE_NONE;
+    o->free_item = max_items ? 0 : OCTREE_NONE;
+    o->max_depth = max_depth > OCTREE_MAX_DEPTH ? OCTREE_MAX_DEPTH : max_depth;
+    if (!o->nodes || !o->items) {
+        octree_free(o);
+        return 0;
+    }
+    octree_init_node(&o->nodes[0], center, half_size, OCTREE_NONE);
+    for (u32 i = 0; i < max_items; ++i) {
+        o->items[i].node = OCTREE_NONE;
+        o->items[i].next = i + 1 < max_items ? i + 1 : OCTREE_NONE;
+    }
+    return 1;
+}
+
+void octree_free(octree* o) {
+    YS_FREE(o->nodes);
+    YS_FREE(o->items);
+    o->nodes = 0;
+    o->items = 0;
+    o->node_capacity = 0;
+    o->item_capacity = 0;
+}
+
+// Takes a block of 8 children for node n. Returns 0 when the pool is full.
+static b32 octree_split(octree* o, const u32 n) {
+    u32 block = o->free_block;
+    if (block != OCTREE_NONE) {
+        o->free_block = o->nodes[block].items;
+    } else if (o->node_used + 8 <= o->node_capacity) {
+        block = o->node_used;
+        o->node_used += 8;
+    } else {
+        return 0;
+    }
+    octree_node parent = o->nodes[n];
+    f32 h = parent.half_size * 0.5f;
+    for (u32 i = 0; i < 8; ++i) {
+        point3 c;
+        c.x = parent.center.x + (i & 1 ? h : -h);
+        c.y = parent.center.y + (i & 2 ? h : -h);
+        c.z = parent.center.z + (i & 4 ? h : -h);
+        octree_init_node(&o->nodes[block + i], c, h, n);
+    }
+    o->nodes[n].children = block;
+    return 1;
+}
+
+// Largest half extent of the box.
+static f32 octree_extent(const aabb3 bounds) {
+    vec3 e = aabb3_extent(bounds);
+    return 0.5f * (e.x > e.y ? (e.x > e.z ? e.x : e.z) : (e.y > e.z ? e.y : e.z));
+}
+
+static b32 octree_in_cell(const octree_node* n, const point3 p) {
+    f32 h = n->half_size;
+    return p.x >= n->center.x - h && p.x <= n->center.x + h
+        && p.y >= n->center.y - h && p.y <= n->center.y + h
+        && p.z >= n->center.z - h && p.z <= n->center.z + h;
+}
+
+// Deepest node whose loose bounds hold the box, splitting on the way.
+static u32 octree_find_node(octree* o, const aabb3 bounds) {
+    point3 c = aabb3_center(bounds);
+    f32 extent = octree_extent(bounds);
+    u32 n = 0;
+    if (!octree_in_cell(&o->nodes[0], c)) {
+        return 0;
+    }
+    for (u32 depth = 0; depth < o->max_depth; ++depth) {
+        octree_node* node = &o->nodes[n];
+        // A child's loose bounds reach half its cell past the cell.
+        if (extent > node->half_size * 0.5f) {
+            break;
+        }
+        if (node->children == OCTREE_NONE && !octree_split(o, n)) {
+            break;
+        }
+        node = &o->nodes[n];
+        u32 child = (c.x >= node->center.x) | (c.y >= node->center.y) << 1 | (c.z >= node->center.z) << 2;
+        n = node->children + child;
+    }
+    return n;
+}
+
+// Puts the item at the head of the node's list, leaving the counts alone.
+static void octree_push(octree* o, const u32 item, const u32 n) {
+    octree_item* it = &o->items[item];
+    it->node = n;
+    it->prev = OCTREE_NONE;
+    it->next = o->nodes[n].items;
+    if (it->next != OCTREE_NONE) {
+        o->items[it->next].prev = item;
+    }
+    o->nodes[n].items = item;
+}
+
+static void octree_link(octree* o, const u32 item, const u32 n) {
+    octree_push(o, item, n);
+    for (u32 i = n; i != OCTREE_NONE; i = o->nodes[i].parent) {
+        o->nodes[i].count++;
+    }
+}
+
+// Unlinks the item and hands the child blocks of emptied nodes back.
+static void octree_unlink(octree* o, const u32 item) {
+    octree_item* it = &o->items[item];
+    if (it->prev != OCTREE_NONE) {
+        o->items[it->prev].next = it->next;
+    } else {
+        o->nodes[it->node].items = it->next;
+    }
+    if (it->next != OCTREE_NONE) {
+        o->items[it->next].prev = it->prev;
+    }
+    for (u32 i = it->node; i != OCTREE_NONE; i = o->nodes[i].parent) {
+        octree_node* n = &o->nodes[i];
+        if (--n->count == 0 && n->children != OCTREE_NONE) {
+            o->nodes[n->children].items = o->free_block;
+            o->free_block = n->children;
+            n->children = OCTREE_NONE;
+        }
+    }
+    it->node = OCTREE_NONE;
+}
+
+// Returns the item handle, or OCTREE_NONE when the item pool is full.
+// Boxes centered outside the root cell are kept in the root.
+u32 octree_insert(octree* o, const aabb3 bounds) {
+    u32 item = o->free_item;
+    if (item == OCTREE_NONE) {
+        return OCTREE_NONE;
+    }
+    o->free_item = o->items[item].next;
+    o->items[item].bounds = bounds;
+    octree_link(o, item, octree_find_node(o, bounds));
+    return item;
+}
+
+// Set on a pending batch slot whose descent stopped at a leaf to split.
+#define OCTREE_SPLIT 0x80000000u
+
+typedef struct octree_batch_job {
+    octree* o;
+    const u32* handles;
+    u32* pending;    // batch slots still descending, OCTREE_SPLIT when blocked
+    u32* depth;      // per slot, depth of the item's current node
+} octree_batch_job;
+
+// One round of the batch descent. Reads the nodes only, so it runs in
+// parallel: each pending item walks down from its current node until it
+// reaches its final node or a leaf that has to be split first.
+static void octree_descend_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    octree_batch_job* job = (octree_batch_job*)ctx;
+    const octree* o = job->o;
+    (void)thread;
+    for (u32 p = begin; p < end; ++p) {
+        u32 slot = job->pending[p] & ~OCTREE_SPLIT;
+        octree_item* it = &o->items[job->handles[slot]];
+        point3 c = aabb3_center(it->bounds);
+        f32 extent = octree_extent(it->bounds);
+        u32 n = it->node;
+        u32 depth = job->depth[slot];
+        u32 split = 0;
+        for (; depth < o->max_depth; ++depth) {
+            const octree_node* node = &o->nodes[n];
+            if (extent > node->half_size * 0.5f) {
+                break;
+            }
+            if (node->children == OCTREE_NONE) {
+                split = OCTREE_SPLIT;
+                break;
+            }
+            u32 child = (c.x >= node->center.x) | (c.y >= node->center.y) << 1 | (c.z >= node->center.z) << 2;
+            n = node->children + child;
+        }
+        it->node = n;
+        job->depth[slot] = depth;
+        job->pending[p] = slot | split;
+    }
+}
+
+// Inserts count boxes and writes their handles. The descent runs over
+// parallel_for in rounds, with the splits it runs into made serially in
+// between, so items land in the same cells as with octree_insert unless
+// the node pool runs out.
+// Items are then linked per node and the ancestor counts are updated
+// once per node that received items instead of once per item. Returns
+// how many were inserted, fewer than count when the item pool runs out.
+u32 octree_insert_batch(octree* o, const aabb3* bounds, const u32 count, u32* handles) {
+    u32 n = 0;
+    for (; n < count && o->free_item != OCTREE_NONE; ++n) {
+        u32 item = o->free_item;
+        o->free_item = o->items[item].next;
+        o->items[item].bounds = bounds[n];
+        o->items[item].node = 0;
+        handles[n] = item;
+    }
+    u32* scratch = (u32*)YS_MALLOC(sizeof(u32) * ((u64)n * 2 + 1));
+    if (!scratch) {
+        for (u32 i = 0; i < n; ++i) {
+            octree_link(o, handles[i], octree_find_node(o, bounds[i]));
+        }
+        return n;
+    }
+    octree_batch_job job;
+    job.o = o;
+    job.handles = handles;
+    job.pending = scratch;
+    job.depth = scratch + n;
+    u32 pending = 0;
+    for (u32 i = 0; i < n; ++i) {
+        job.depth[i] = 0;
+        if (octree_in_cell(&o->nodes[0], aabb3_center(bounds[i]))) {
+            job.pending[pending++] = i;
+        }
+    }
+    while (pending) {
+        parallel_for(pending, OCTREE_INSERT_GRAIN, octree_descend_task, &job);
+        // Split the blocking leaves and keep those items going. Items
+        // whose leaf cannot split because the pool is full stay there.
+        u32 kept = 0;
+        for (u32 p = 0; p < pending; ++p) {
+            if (!(job.pending[p] & OCTREE_SPLIT)) {
+                continue;
+            }
+            u32 slot = job.pending[p] & ~OCTREE_SPLIT;
+            u32 node = o->items[handles[slot]].node;
+            if (o->nodes[node].children != OCTREE_NONE || octree_split(o, node)) {
+                job.pending[kept++] = slot;
+            }
+        }
+        pending = kept;
+    }
+
+    // Splits may have grown the pool, so size the per node totals now.
+    YS_FREE(scratch);
+    u32* added = (u32*)YS_MALLOC(sizeof(u32) * o->node_used);
+    if (!added) {
+        for (u32 i = 0; i < n; ++i) {
+            octree_link(o, handles[i], o->items[handles[i]].node);
+        }
+        return n;
+    }
+    for (u32 i = 0; i < o->node_used; ++i) {
+        added[i] = 0;
+    }
+    for (u32 i = 0; i < n; ++i) {
+        u32 node = o->items[handles[i]].node;
+        octree_push(o, handles[i], node);
+        added[node]++;
+    }
+    for (u32 i = 0; i < o->node_used; ++i) {
+        if (added[i]) {
+            for (u32 j = i; j != OCTREE_NONE; j = o->nodes[j].parent) {
+                o->nodes[j].count += added[i];
+            }
+        }
+    }
+    YS_FREE(added);
+    return n;
+}
+
+void octree_remove(octree* o, const u32 item) {
+    octree_unlink(o, item);
+    o->items[item].next = o->free_item;
+    o->free_item = item;
+}
+
+// Moves an item. Stays in place while it still fits the loose bounds of
+// its node and could not go deeper, the common case for small motion.
+void octree_update(octree* o, const u32 item, const aabb3 bounds) {
+    octree_item* it = &o->items[item];
+    const octree_node* n = &o->nodes[it->node];
+    it->bounds = bounds;
+    f32 extent = octree_extent(bounds);
+    b32 in_cell = octree_in_cell(n, aabb3_center(bounds));
+    b32 fits = it->node == 0 || (in_cell && extent <= n->half_size);
+    b32 deeper = in_cell && extent <= n->half_size * 0.5f && n->children != OCTREE_NONE;
+    if (fits && !deeper) {
+        return;
+    }
+    octree_unlink(o, item);
+    octree_link(o, item, octree_find_node(o, bounds));
+}
+
+
+/*
+ * ==== QUERIES =======
+*/
+
+static aabb3 octree_loose_bounds(const octree_node* n) {
+    f32 h = n->half_size * 2.0f;
+    aabb3 box;
+    box.min.x = n->center.x - h;
+    box.min.y = n->center.y - h;
+    box.min.z = n->center.z - h;
+    box.max.x = n->center.x + h;
+    box.max.y = n->center.y + h;
+    box.max.z = n->center.z + h;
+    return box;
+}
+
+// Items overlapping the box. Writes the first max_items handles and
+// returns the total count.
+u32 octree_query_aabb3(const octree* o, const aabb3 box, u32* items, const u32 max_items) {
+    u32 stack[OCTREE_STACK];
+    u32 top = 0;
+    u32 found = 0;
+    stack[top++] = 0;
+    while (top) {
+        u32 i = stack[--top];
+        const octree_node* n = &o->nodes[i];
+        // The root also holds items centered outside its cell, never cull it.
+        if (n->count == 0 || (i != 0 && !aabb3_overlaps(octree_loose_bounds(n), box))) {
+            continue;
+        }
+        for (u32 it = n->items; it != OCTREE_NONE; it = o->items[it].next) {
+            if (aabb3_overlaps(o->items[it].bounds, box)) {
+                if (found < max_items) {
+                    items[found] = it;
+                }
+                ++found;
+            }
+        }
+        if (n->children != OCTREE_NONE) {
+            for (u32 c = 0; c < 8; ++c) {
+                stack[top++] = n->children + c;
+            }
+        }
+    }
+    return found;
+}
+
+// 1 when the box is inside every plane of the frustum.
+static b32 octree_frustum_contains(const frustum* f, const aabb3 box) {
+    for (int i = 0; i < 6; ++i) {
+        plane p = f->planes[i];
+        // Box corner least far along the plane normal.
+        f32 x = p.normal.x >= 0 ? box.min.x : box.max.x;
+        f32 y = p.normal.y >= 0 ? box.min.y : box.max.y;
+        f32 z = p.normal.z >= 0 ? box.min.z : box.max.z;
+        if (p.normal.x * x + p.normal.y * y + p.normal.z * z < p.d) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Items whose box is at least partly inside the frustum. Subtrees whose
+// loose bounds are fully inside are gathered without further plane tests:
+// every item below the root lies within the loose bounds of its node.
+u32 octree_query_frustum(const octree* o, const frustum* f, u32* items, const u32 max_items) {
+    u32 stack[OCTREE_STACK];
+    b8 inside[OCTREE_STACK];
+    u32 top = 0;
+    u32 found = 0;
+    stack[top] = 0;
+    inside[top++] = 0;
+    while (top) {
+        --top;
+        u32 i = stack[top];
+        b32 in = inside[top];
+        const octree_node* n = &o->nodes[i];
+        if (n->count == 0) {
+            continue;
+        }
+        // The root also holds items centered outside its cell, never cull it.
+        if (!in && i != 0) {
+            aabb3 loose = octree_loose_bounds(n);
+            if (!frustum_aabb3(f, loose)) {
+                continue;
+            }
+            in = octree_frustum_contains(f, loose);
+        }
+        for (u32 it = n->items; it != OCTREE_NONE; it = o->items[it].next) {
+            if (in || frustum_aabb3(f, o->items[it].bounds)) {
+                if (found < max_items) {
+                    items[found] = it;
+                }
+                ++found;
+            }
+        }
+        if (n->children != OCTREE_NONE) {
+            for (u32 c = 0; c < 8; ++c) {
+                stack[top] = n->children + c;
+                inside[top++] = (b8)in;
+            }
+        }
+    }
+    return found;
+}
+
+// Closest item along the ray. Children are visited near to far and
+// anything starting past the current hit is skipped. Without `fn` the
+// item boxes themselves are hit. Returns the item or OCTREE_NONE.
+u32 octree_raycast(const octree* o, const ray3 r, const f32 t_max, octree_ray_fn fn, void* ctx, f32* t_hit) {
+    vec3 inv = ray3_inv_dir(r);
+    u32 stack[OCTREE_STACK];
+    f32 stack_t[OCTREE_STACK];
+    u32 top = 0;
+    u32 best = OCTREE_NONE;
+    f32 best_t = t_max;
+    stack[top] = 0;
+    stack_t[top++] = 0.0f;
+    while (top) {
+        --top;
+        u32 i = stack[top];
+        if (stack_t[top] > best_t) {
+            continue;
+        }
+        const octree_node* n = &o->nodes[i];
+        for (u32 it = n->items; it != OCTREE_NONE; it = o->items[it].next) {
+            f32 t;
+            if (!ray3_aabb3(r, inv, o->items[it].bounds, best_t, &t)) {
+                continue;
+            }
+            if (fn && !fn(ctx, it, r, best_t, &t)) {
+                continue;
+            }
+            if (t <= best_t) {
+                best_t = t;
+                best = it;
+            }
+        }
+        if (n->children == OCTREE_NONE) {
+            continue;
+        }
+        // Push the hit children far to near so the nearest pops first.
+        u32 child[8];
+        f32 child_t[8];
+        u32 hits = 0;
+        for (u32 c = 0; c < 8; ++c) {
+            const octree_node* cn = &o->nodes[n->children + c];
+            f32 t;
+            if (cn->count && ray3_aabb3(r, inv, octree_loose_bounds(cn), best_t, &t)) {
+                u32 j = hits++;
+                while (j > 0 && child_t[j - 1] < t) {
+                    child[j] = child[j - 1];
+                    child_t[j] = child_t[j - 1];
+                    --j;
+                }
+                child[j] = n->children + c;
+                child_t[j] = t;
+            }
+        }
+        for (u32 j = 0; j < hits; ++j) {
+            stack[top] = child[j];
+            stack_t[top++] = child_t[j];
+        }
+    }
+    if (best != OCTREE_NONE) {
+        *t_hit = best_t;
+    }
+    return best;
+}
+
+#endif
+#endif
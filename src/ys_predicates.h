@@ -0,0 +1,515 @@
+#ifndef YS_PREDICATES_H
+#define YS_PREDICATES_H
+
+#include <math.h>
+#include "ys_math.h"
+
+/*
+ * === PREDICATES INTERFACE ===
+*/
+// The sign of each result is exact; the magnitude is only an estimate.
+// orient2d > 0 when a, b, c turn counterclockwise.
+f64 orient2d(const point2 a, const point2 b, const point2 c);
+// orient3d > 0 when d lies below the plane of a, b, c, seen from above
+// as counterclockwise; that is, the sign of det(a - d, b - d, c - d).
+f64 orient3d(const point3 a, const point3 b, const point3 c, const point3 d);
+// incircle > 0 when d is inside the circle through counterclockwise a, b, c.
+f64 incircle(const point2 a, const point2 b, const point2 c, const point2 d);
+// insphere > 0 when e is inside the sphere through a, b, c, d, with
+// orient3d(a, b, c, d) > 0.
+f64 insphere(const point3 a, const point3 b, const point3 c, const point3 d, const point3 e);
+
+// Signs of many queries, each given by 3, 4, 4 and 5 indices into points.
+void orient2d_batch(const point2* points, const u32 point_count, const u32* indices, const u32 count, i8* signs);
+void orient3d_batch(const point3* points, const u32 point_count, const u32* indices, const u32 count, i8* signs);
+void incircle_batch(const point2* points, const u32 point_count, const u32* indices, const u32 count, i8* signs);
+void insphere_batch(const point3* points, const u32 point_count, const u32* indices, const u32 count, i8* signs);
+
+
+#ifdef YS_PREDICATES_IMPLEMENTATION
+
+/*
+ * ==== EXPANSIONS =======
+*/
+
+// Exact arithmetic on expansions: sums of doubles sorted by increasing
+// magnitude that do not overlap, so the last one carries the sign (see
+// Shewchuk, Adaptive Precision Floating-Point Arithmetic and Fast Robust
+// Geometric Predicates). Inputs are f32, so no product of up to five
+// coordinates or their differences can overflow or underflow a double.
+
+// Relative error bounds of the plain double evaluation.
+#define PREDICATE_EPSILON 1.1102230246251565e-16   // 2^-53
+#define ORIENT2D_BOUND ((3.0 + 16.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON)
+#define ORIENT3D_BOUND ((7.0 + 56.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON)
+#define INCIRCLE_BOUND ((10.0 + 96.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON)
+#define INSPHERE_BOUND ((16.0 + 224.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON)
+
+static f64 predicate_two_sum(const f64 a, const f64 b, f64* err) {
+    f64 x = a + b;
+    f64 bv = x - a;
+    f64 av = x - bv;
+    *err = (a - av) + (b - bv);
+    return x;
+}
+
+// Needs |a| >= |b|.
+static f64 predicate_fast_two_sum(const f64 a, const f64 b, f64* err) {
+    f64 x = a + b;
+    *err = b - (x - a);
+    return x;
+}
+
+// fma keeps the error term exact even where the compiler contracts.
+static f64 predicate_two_product(const f64 a, const f64 b, f64* err) {
+    f64 x = a * b;
+    *err = fma(a, b, -x);
+    return x;
+}
+
+// h = e + f, at most elen + flen terms.
+static u32 predicate_sum(const f64* e, const u32 elen, const f64* f, const u32 flen, f64* h) {
+    u32 ei = 0, fi = 0, hi = 0;
+    f64 enow = e[0], fnow = f[0];
+    f64 q, err;
+    if ((fnow > enow) == (fnow > -enow)) {
+        q = enow;
+        enow = ++ei < elen ? e[ei] : 0.0;
+    } else {
+        q = fnow;
+        fnow = ++fi < flen ? f[fi] : 0.0;
+    }
+    if (ei < elen && fi < flen) {
+        if ((fnow > enow) == (fnow > -enow)) {
+            q = predicate_fast_two_sum(enow, q, &err);
+            enow = ++ei < elen ? e[ei] : 0.0;
+        } else {
+            q = predicate_fast_two_sum(fnow, q, &err);
+            fnow = ++fi < flen ? f[fi] : 0.0;
+        }
+        if (err != 0.0) {
+            h[hi++] = err;
+        }
+        while (ei < elen && fi < flen) {
+            if ((fnow > enow) == (fnow > -enow)) {
+                q = predicate_two_sum(q, enow, &err);
+                enow = ++ei < elen ? e[ei] : 0.0;
+            } else {
+                q = predicate_two_sum(q, fnow, &err);
+                fnow = ++fi < flen ? f[fi] : 0.0;
+            }
+            if (err != 0.0) {
+                h[hi++] = err;
+            }
+        }
+    }
+    while (ei < elen) {
+        q = predicate_two_sum(q, enow, &err);
+        enow = ++ei < elen ? e[ei] : 0.0;
+        if (err != 0.0) {
+            h[hi++] = err;
+        }
+    }
+    while (fi < flen) {
+        q = predicate_two_sum(q, fnow, &err);
+        fnow = ++fi < flen ? f[fi] : 0.0;
+        if (err != 0.0) {
+            h[hi++] = err;
+        }
+    }
+    if (q != 0.0 || hi == 0) {
+        h[hi++] = q;
+    }
+    return hi;
+}
+
+// h = e * b, at most 2 * elen terms.
+static u32 predicate_scale(const f64* e, const u32 elen, const f64 b, f64* h) {
+    u32 hi = 0;
+    f64 err, product_err, sum;
+    f64 q = predicate_two_product(e[0], b, &err);
+    if (err != 0.0) {
+        h[hi++] = err;
+    }
+    for (u32 i = 1; i < elen; ++i) {
+        f64 product = predicate_two_product(e[i], b, &product_err);
+        sum = predicate_two_sum(q, product_err, &err);
+        if (err != 0.0) {
+            h[hi++] = err;
+        }
+        q = predicate_fast_two_sum(product, sum, &err);
+        if (err != 0.0) {
+            h[hi++] = err;
+        }
+    }
+    if (q != 0.0 || hi == 0) {
+        h[hi++] = q;
+    }
+    return hi;
+}
+
+// acc += sign * e, where scratch holds acc_len + elen terms.
+static u32 predicate_add(f64* acc, const u32 acc_len, f64* e, const u32 elen, const f64 sign, f64* scratch) {
+    if (sign < 0.0) {
+        for (u32 i = 0; i < elen; ++i) {
+            e[i] = -e[i];
+        }
+    }
+    u32 len = predicate_sum(acc, acc_len, e, elen, scratch);
+    for (u32 i = 0; i < len; ++i) {
+        acc[i] = scratch[i];
+    }
+    return len;
+}
+
+// h = e * f, at most 2 * elen * flen terms; scratch holds 2 * elen plus
+// as many as h.
+static u32 predicate_mul(const f64* e, const u32 elen, const f64* f, const u32 flen, f64* h, f64* scratch) {
+    u32 len = predicate_scale(e, elen, f[0], h);
+    for (u32 i = 1; i < flen; ++i) {
+        u32 scaled = predicate_scale(e, elen, f[i], scratch);
+        len = predicate_add(h, len, scratch, scaled, 1.0, scratch + 2 * elen);
+    }
+    return len;
+}
+
+// px * qy - qx * py, 4 terms.
+static u32 predicate_minor2(const f64* p, const f64* q, f64* h) {
+    f64 a[2], b[2];
+    a[1] = predicate_two_product(p[0], q[1], &a[0]);
+    b[1] = predicate_two_product(-q[0], p[1], &b[0]);
+    return predicate_sum(a, 2, b, 2, h);
+}
+
+// The determinant of the rows p, q, r of x, y, z; 24 terms.
+static u32 predicate_minor3(const f64* p, const f64* q, const f64* r, f64* h) {
+    f64 minor[4], scaled[8], scratch[24];
+    u32 len = predicate_scale(minor, predicate_minor2(q, r, minor), p[2], h);
+    len = predicate_add(h, len, scaled, predicate_scale(minor, predicate_minor2(p, r, minor), q[2], scaled), -1.0,
+        scratch);
+    return predicate_add(h, len, scaled, predicate_scale(minor, predicate_minor2(p, q, minor), r[2], scaled), 1.0,
+        scratch);
+}
+
+// x^2 + y^2 (+ z^2), 4 or 6 terms.
+static u32 predicate_lift(const f64* p, const u32 dims, f64* h) {
+    f64 square[2], scratch[6];
+    h[1] = predicate_two_product(p[0], p[0], &h[0]);
+    u32 len = 2;
+    for (u32 k = 1; k < dims; ++k) {
+        square[1] = predicate_two_product(p[k], p[k], &square[0]);
+        len = predicate_add(h, len, square, 2, 1.0, scratch);
+    }
+    return len;
+}
+
+// The exact forms expand the determinants over the raw coordinates, with
+// a column of ones, instead of the translated ones the filters use.
+
+static f64 orient2d_exact(const f64* a, const f64* b, const f64* c) {
+    f64 det[12], minor[4], scratch[12];
+    u32 len = predicate_minor2(b, c, det);
+    len = predicate_add(det, len, minor, predicate_minor2(a, c, minor), -1.0, scratch);
+    len = predicate_add(det, len, minor, predicate_minor2(a, b, minor), 1.0, scratch);
+    return det[len - 1];
+}
+
+static f64 orient3d_exact(const f64* a, const f64* b, const f64* c, const f64* d) {
+    f64 det[96], minor[24], scratch[96];
+    u32 len = predicate_minor3(a, b, c, det);
+    len = predicate_add(det, len, minor, predicate_minor3(a, b, d, minor), -1.0, scratch);
+    len = predicate_add(det, len, minor, predicate_minor3(a, c, d, minor), 1.0, scratch);
+    len = predicate_add(det, len, minor, predicate_minor3(b, c, d, minor), -1.0, scratch);
+    return det[len - 1];
+}
+
+// The determinant of the rows p, q, r of x, y, x^2 + y^2; 96 terms.
+static u32 incircle_minor(const f64* p, const f64* q, const f64* r, f64* h) {
+    const f64* rows[3] = {p, q, r};
+    f64 lift[4], minor[4], term[32], scratch[96];
+    u32 len = 0;
+    for (u32 i = 0; i < 3; ++i) {
+        u32 lift_len = predicate_lift(rows[i], 2, lift);
+        u32 minor_len = predicate_minor2(rows[i == 0 ? 1 : 0], rows[i == 2 ? 1 : 2], minor);
+        u32 term_len = predicate_mul(minor, minor_len, lift, lift_len, term, scratch);
+        if (i == 0) {
+            for (u32 k = 0; k < term_len; ++k) {
+                h[k] = term[k];
+            }
+            len = term_len;
+        } else {
+            len = predicate_add(h, len, term, term_len, i == 1 ? -1.0 : 1.0, scratch);
+        }
+    }
+    return len;
+}
+
+static f64 incircle_exact(const f64* a, const f64* b, const f64* c, const f64* d) {
+    f64 det[384], minor[96], scratch[384];
+    u32 len = incircle_minor(a, b, c, det);
+    len = predicate_add(det, len, minor, incircle_minor(a, b, d, minor), -1.0, scratch);
+    len = predicate_add(det, len, minor, incircle_minor(a, c, d, minor), 1.0, scratch);
+    len = predicate_add(det, len, minor, incircle_minor(b, c, d, minor), -1.0, scratch);
+    return det[len - 1];
+}
+
+// The determinant of the rows p, q, r, s of x, y, z, x^2 + y^2 + z^2;
+// 1152 terms.
+static u32 insphere_minor(const f64* p, const f64* q, const f64* r, const f64* s, f64* h) {
+    const f64* rows[4] = {p, q, r, s};
+    f64 lift[6], minor[24], term[288], scratch[1152];
+    u32 len = 0;
+    for (u32 i = 0; i < 4; ++i) {
+        const f64* others[3];
+        for (u32 j = 0, k = 0; j < 4; ++j) {
+            if (j != i) {
+                others[k++] = rows[j];
+            }
+        }
+        u32 lift_len = predicate_lift(rows[i], 3, lift);
+        u32 minor_len = predicate_minor3(others[0], others[1], others[2], minor);
+        u32 term_len = predicate_mul(minor, minor_len, lift, lift_len, term, scratch);
+        // Cofactor signs down the last column: -, +, -, +.
+        f64 sign = i & 1 ? 1.0 : -1.0;
+        if (i == 0) {
+            for (u32 k = 0; k < term_len; ++k) {
+                h[k] = -term[k];
+            }
+            len = term_len;
+        } else {
+            len = predicate_add(h, len, term, term_len, sign, scratch);
+        }
+    }
+    return len;
+}
+
+static f64 insphere_exact(const f64* a, const f64* b, const f64* c, const f64* d, const f64* e) {
+    const f64* rows[5] = {a, b, c, d, e};
+    f64 det[5760], minor[1152], scratch[5760];
+    u32 len = 0;
+    for (u32 i = 0; i < 5; ++i) {
+        const f64* others[4];
+        for (u32 j = 0, k = 0; j < 5; ++j) {
+            if (j != i) {
+                others[k++] = rows[j];
+            }
+        }
+        u32 minor_len = insphere_minor(others[0], others[1], others[2], others[3], minor);
+        if (i == 0) {
+            for (u32 k = 0; k < minor_len; ++k) {
+                det[k] = minor[k];
+            }
+            len = minor_len;
+        } else {
+            len = predicate_add(det, len, minor, minor_len, i & 1 ? -1.0 : 1.0, scratch);
+        }
+    }
+    return det[len - 1];
+}
+
+
+/*
+ * ==== PREDICATES =======
+*/
+
+// Each predicate evaluates its determinant in doubles and returns it when
+// it is farther from zero than the error bound scaled by the permanent
+// (the same sum with absolute values). Only near degenerate input reaches
+// the exact expansion.
+
+f64 orient2d(const point2 a, const point2 b, const point2 c) {
+    f64 left = ((f64)a.x - c.x) * ((f64)b.y - c.y);
+    f64 right = ((f64)a.y - c.y) * ((f64)b.x - c.x);
+    f64 det = left - right;
+    f64 permanent;
+    if (left > 0.0) {
+        if (right <= 0.0) {
+            return det;
+        }
+        permanent = left + right;
+    } else if (left < 0.0) {
+        if (right >= 0.0) {
+            return det;
+        }
+        permanent = -left - right;
+    } else {
+        return det;
+    }
+    f64 bound = ORIENT2D_BOUND * permanent;
+    if (det >= bound || -det >= bound) {
+        return det;
+    }
+    f64 pa[2] = {a.x, a.y}, pb[2] = {b.x, b.y}, pc[2] = {c.x, c.y};
+    return orient2d_exact(pa, pb, pc);
+}
+
+f64 orient3d(const point3 a, const point3 b, const point3 c, const point3 d) {
+    f64 adx = (f64)a.x - d.x, ady = (f64)a.y - d.y, adz = (f64)a.z - d.z;
+    f64 bdx = (f64)b.x - d.x, bdy = (f64)b.y - d.y, bdz = (f64)b.z - d.z;
+    f64 cdx = (f64)c.x - d.x, cdy = (f64)c.y - d.y, cdz = (f64)c.z - d.z;
+    f64 bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    f64 cdxady = cdx * ady, adxcdy = adx * cdy;
+    f64 adxbdy = adx * bdy, bdxady = bdx * ady;
+    f64 det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+    f64 permanent = (fabs(bdxcdy) + fabs(cdxbdy)) * fabs(adz) + (fabs(cdxady) + fabs(adxcdy)) * fabs(bdz)
+        + (fabs(adxbdy) + fabs(bdxady)) * fabs(cdz);
+    f64 bound = ORIENT3D_BOUND * permanent;
+    if (det > bound || -det > bound) {
+        return det;
+    }
+    f64 pa[3] = {a.x, a.y, a.z}, pb[3] = {b.x, b.y, b.z}, pc[3] = {c.x, c.y, c.z}, pd[3] = {d.x, d.y, d.z};
+    return orient3d_exact(pa, pb, pc, pd);
+}
+
+f64 incircle(const point2 a, const point2 b, const point2 c, const point2 d) {
+    f64 adx = (f64)a.x - d.x, ady = (f64)a.y - d.y;
+    f64 bdx = (f64)b.x - d.x, bdy = (f64)b.y - d.y;
+    f64 cdx = (f64)c.x - d.x, cdy = (f64)c.y - d.y;
+    f64 bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    f64 cdxady = cdx * ady, adxcdy = adx * cdy;
+    f64 adxbdy = adx * bdy, bdxady = bdx * ady;
+    f64 alift = adx * adx + ady * ady;
+    f64 blift = bdx * bdx + bdy * bdy;
+    f64 clift = cdx * cdx + cdy * cdy;
+    f64 det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+    f64 permanent = (fabs(bdxcdy) + fabs(cdxbdy)) * alift + (fabs(cdxady) + fabs(adxcdy)) * blift
+        + (fabs(adxbdy) + fabs(bdxady)) * clift;
+    f64 bound = INCIRCLE_BOUND * permanent;
+    if (det > bound || -det > bound) {
+        return det;
+    }
+    f64 pa[2] = {a.x, a.y}, pb[2] = {b.x, b.y}, pc[2] = {c.x, c.y}, pd[2] = {d.x, d.y};
+    return incircle_exact(pa, pb, pc, pd);
+}
+
+f64 insphere(const point3 a, const point3 b, const point3 c, const point3 d, const point3 e) {
+    f64 aex = (f64)a.x - e.x, aey = (f64)a.y - e.y, aez = (f64)a.z - e.z;
+    f64 bex = (f64)b.x - e.x, bey = (f64)b.y - e.y, bez = (f64)b.z - e.z;
+    f64 cex = (f64)c.x - e.x, cey = (f64)c.y - e.y, cez = (f64)c.z - e.z;
+    f64 dex = (f64)d.x - e.x, dey = (f64)d.y - e.y, dez = (f64)d.z - e.z;
+    f64 aexbey = aex * bey, bexaey = bex * aey;
+    f64 bexcey = bex * cey, cexbey = cex * bey;
+    f64 cexdey = cex * dey, dexcey = dex * cey;
+    f64 dexaey = dex * aey, aexdey = aex * dey;
+    f64 aexcey = aex * cey, cexaey = cex * aey;
+    f64 bexdey = bex * dey, dexbey = dex * bey;
+    f64 ab = aexbey - bexaey, bc = bexcey - cexbey, cd = cexdey - dexcey;
+    f64 da = dexaey - aexdey, ac = aexcey - cexaey, bd = bexdey - dexbey;
+    f64 abc = aez * bc - bez * ac + cez * ab;
+    f64 bcd = bez * cd - cez * bd + dez * bc;
+    f64 cda = cez * da + dez * ac + aez * cd;
+    f64 dab = dez * ab + aez * bd + bez * da;
+    f64 alift = aex * aex + aey * aey + aez * aez;
+    f64 blift = bex * bex + bey * bey + bez * bez;
+    f64 clift = cex * cex + cey * cey + cez * cez;
+    f64 dlift = dex * dex + dey * dey + dez * dez;
+    f64 det = (dlift * abc - clift * dab) + (blift * cda - alift * bcd);
+
+    f64 az = fabs(aez), bz = fabs(bez), cz = fabs(cez), dz = fabs(dez);
+    f64 ab_plus = fabs(aexbey) + fabs(bexaey), bc_plus = fabs(bexcey) + fabs(cexbey);
+    f64 cd_plus = fabs(cexdey) + fabs(dexcey), da_plus = fabs(dexaey) + fabs(aexdey);
+    f64 ac_plus = fabs(aexcey) + fabs(cexaey), bd_plus = fabs(bexdey) + fabs(dexbey);
+    f64 permanent = (cd_plus * bz + bd_plus * cz + bc_plus * dz) * alift
+        + (da_plus * cz + ac_plus * dz + cd_plus * az) * blift
+        + (ab_plus * dz + bd_plus * az + da_plus * bz) * clift
+        + (bc_plus * az + ac_plus * bz + ab_plus * cz) * dlift;
+    f64 bound = INSPHERE_BOUND * permanent;
+    if (det > bound || -det > bound) {
+        return det;
+    }
+    f64 pa[3] = {a.x, a.y, a.z}, pb[3] = {b.x, b.y, b.z}, pc[3] = {c.x, c.y, c.z};
+    f64 pd[3] = {d.x, d.y, d.z}, pe[3] = {e.x, e.y, e.z};
+    return insphere_exact(pa, pb, pc, pd, pe);
+}
+
+
+/*
+ * ==== BATCHES =======
+*/
+
+// A batch first bounds every coordinate of its points by m. Differences are
+// then at most 2m, so the permanent is at most the number of its terms
+// times the largest possible term: 2 * 4m^2, 6 * 8m^3, 6 * 32m^4 and
+// 24 * 96m^5. Queries past that static bound skip the permanent; the
+// rest go through the full predicate. The slack covers the rounding of
+// the bound itself.
+#define PREDICATE_SLACK (1.0 + 1e-10)
+
+static i8 predicate_sign(const f64 det) {
+    return (i8)((det > 0.0) - (det < 0.0));
+}
+
+// Largest magnitude among n floats, in one pass the compiler vectorizes.
+static f64 predicate_max(const f32* coords, const u32 n) {
+    f32 m = 0.0f;
+    for (u32 i = 0; i < n; ++i) {
+        f32 c = fabsf(coords[i]);
+        m = c > m ? c : m;
+    }
+    return m;
+}
+
+void orient2d_batch(const point2* points, const u32 point_count, const u32* indices, const u32 count, i8* signs) {
+    f64 m = predicate_max(points->e, point_count * 2);
+    f64 bound = ORIENT2D_BOUND * 8.0 * m * m * PREDICATE_SLACK;
+    for (u32 i = 0; i < count; ++i) {
+        const u32* q = indices + i * 3;
+        point2 a = points[q[0]], b = points[q[1]], c = points[q[2]];
+        f64 det = ((f64)a.x - c.x) * ((f64)b.y - c.y) - ((f64)a.y - c.y) * ((f64)b.x - c.x);
+        signs[i] = predicate_sign(det > bound || -det > bound ? det : orient2d(a, b, c));
+    }
+}
+
+void orient3d_batch(const point3* points, const u32 point_count, const u32* indices, const u32 count, i8* signs) {
+    f64 m = predicate_max(points->e, point_count * 3);
+    f64 bound = ORIENT3D_BOUND * 48.0 * m * m * m * PREDICATE_SLACK;
+    for (u32 i = 0; i < count; ++i) {
+        const u32* q = indices + i * 4;
+        point3 a = points[q[0]], b = points[q[1]], c = points[q[2]], d = points[q[3]];
+        f64 adx = (f64)a.x - d.x, ady = (f64)a.y - d.y, adz = (f64)a.z - d.z;
+        f64 bdx = (f64)b.x - d.x, bdy = (f64)b.y - d.y, bdz = (f64)b.z - d.z;
+        f64 cdx = (f64)c.x - d.x, cdy = (f64)c.y - d.y, cdz = (f64)c.z - d.z;
+        f64 det = adz * (bdx * cdy - cdx * bdy) + bdz * (cdx * ady - adx * cdy) + cdz * (adx * bdy - bdx * ady);
+        signs[i] = predicate_sign(det > bound || -det > bound ? det : orient3d(a, b, c, d));
+    }
+}
+
+void incircle_batch(const point2* points, const u32 point_count, const u32* indices, const u32 count, i8* signs) {
+    f64 m = predicate_max(points->e, point_count * 2);
+    f64 bound = INCIRCLE_BOUND * 192.0 * m * m * m * m * PREDICATE_SLACK;
+    for (u32 i = 0; i < count; ++i) {
+        const u32* q = indices + i * 4;
+        point2 a = points[q[0]], b = points[q[1]], c = points[q[2]], d = points[q[3]];
+        f64 adx = (f64)a.x - d.x, ady = (f64)a.y - d.y;
+        f64 bdx = (f64)b.x - d.x, bdy = (f64)b.y - d.y;
+        f64 cdx = (f64)c.x - d.x, cdy = (f64)c.y - d.y;
+        f64 det = (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy) + (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy)
+            + (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+        signs[i] = predicate_sign(det > bound || -det > bound ? det : incircle(a, b, c, d));
+    }
+}
+
+void insphere_batch(const point3* points, const u32 point_count, const u32* indices, const u32 count, i8* signs) {
+    f64 m = predicate_max(points->e, point_count * 3);
+    f64 bound = INSPHERE_BOUND * 2304.0 * m * m * m * m * m * PREDICATE_SLACK;
+    for (u32 i = 0; i < count; ++i) {
+        const u32* q = indices + i * 5;
+        point3 a = points[q[0]], b = points[q[1]], c = points[q[2]], d = points[q[3]], e = points[q[4]];
+        f64 aex = (f64)a.x - e.x, aey = (f64)a.y - e.y, aez = (f64)a.z - e.z;
+        f64 bex = (f64)b.x - e.x, bey = (f64)b.y - e.y, bez = (f64)b.z - e.z;
+        f64 cex = (f64)c.x - e.x, cey = (f64)c.y - e.y, cez = (f64)c.z - e.z;
+        f64 dex = (f64)d.x - e.x, dey = (f64)d.y - e.y, dez = (f64)d.z - e.z;
+        f64 ab = aex * bey - bex * aey, bc = bex * cey - cex * bey, cd = cex * dey - dex * cey;
+        f64 da = dex * aey - aex * dey, ac = aex * cey - cex * aey, bd = bex * dey - dex * bey;
+        f64 abc = aez * bc - bez * ac + cez * ab;
+        f64 bcd = bez * cd - cez * bd + dez * bc;
+        f64 cda = cez * da + dez * ac + aez * cd;
+        f64 dab = dez * ab + aez * bd + bez * da;
+        f64 det = ((dex * dex + dey * dey + dez * dez) * abc - (cex * cex + cey * cey + cez * cez) * dab)
+            + ((bex * bex + bey * bey + bez * bez) * cda - (aex * aex + aey * aey + aez * aez) * bcd);
+        signs[i] = predicate_sign(det > bound || -det > bound ? det : insphere(a, b, c, d, e));
+    }
+}
+
+#endif
+#endif
@@ -0,0 +1,843 @@
+#ifndef YS_RASTER_H
+#define YS_RASTER_H
+
+#include <math.h>
+#include "ys_clip.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+#define RASTER_COLOR4 0x1u
+#define RASTER_RGBA8 0x2u
+#define RASTER_DEPTH 0x4u
+
+// Edge functions run on 32-bit integers within a tile, which holds for
+// targets up to this size with RASTER_SUBPIXEL_BITS of precision and
+// vertices inside the guard band.
+#define RASTER_MAX_SIZE 4096
+#define RASTER_SUBPIXEL_BITS 4
+#define RASTER_SUBPIXEL (1 << RASTER_SUBPIXEL_BITS)
+// Triangles reaching further than this many pixels from the center of
+// the target are clipped; the rest are cut at the tile borders instead.
+#define RASTER_GUARD_BAND 8192
+#define RASTER_TILE_SIZE 64
+#define RASTER_VERTEX_GRAIN 4096
+// Triangles per setup task, and per binning chunk.
+#define RASTER_TRIANGLE_GRAIN 1024
+#define RASTER_SCAN_GRAIN 64
+// Binned triangles fetched ahead while drawing a tile.
+#define RASTER_PREFETCH 8
+// Tile range of a triangle that covers no pixel.
+#define RASTER_CULLED 0xFFu
+// Interpolated planes: depth, 1 / w, then the color over w.
+#define RASTER_PLANE_COUNT 6
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Render target. Pixels are row major with y down, as images are stored.
+typedef struct raster_target {
+    color4* color;       // RASTER_COLOR4
+    u32* rgba8;          // RASTER_RGBA8, red in the low byte
+    f32* depth;          // RASTER_DEPTH, 0 at the near plane and 1 at the far one
+    u32 width;
+    u32 height;
+} raster_target;
+
+// A triangle after setup, in target pixels. Edge i is a x + b y + c over
+// subpixel sample positions, with the fill rule folded into c, and a
+// pixel is covered when all three are >= 0.
+typedef struct raster_triangle {
+    i32 edge_a[3];
+    i32 edge_b[3];
+    i64 edge_c[3];
+    i32 bounds[4];       // min x, min y, max x, max y of covered pixels; empty when culled
+    f32 origin[2];       // pixel position the planes are relative to
+    f32 planes[RASTER_PLANE_COUNT][3]; // value at origin, d/dx, d/dy
+} raster_triangle;
+
+// Binned tile rasterizer. Triangles are transformed, classified with the
+// ys_clip pre-pass and set up in parallel, binned into tiles of
+// RASTER_TILE_SIZE pixels, then each tile is drawn by one worker, so no
+// two threads ever touch the same pixel.
+typedef struct rasterizer {
+    vec4* clip;              // clip space position of each vertex
+    u8* codes;               // clip outcodes of each vertex
+    u8* guard;               // outcodes against the guard band
+    u8* masks;               // per input triangle, from clip_classify
+    raster_triangle* triangles; // one per input triangle, then clipped fans
+    u32* tiles;              // per triangle: first and last tile on x and y, a byte each
+    u32* order;              // triangles to bin, each fan where its input triangle was
+    u32* bin_counts;         // per chunk and tile: counts, then write cursors
+    u32* bin_offsets;        // start of each tile's list, tile count + 1
+    u32* bins;               // triangles of each tile, in submission order
+    u32 vertex_capacity;
+    u32 triangle_capacity;
+    u32 record_capacity;
+    u32 tile_capacity;
+    u32 count_capacity;
+    u32 offset_capacity;
+    u32 bin_capacity;
+    u32 order_capacity;
+    u32 record_count;
+    u32 order_count;
+} rasterizer;
+
+
+/*
+ * === RASTER INTERFACE ===
+*/
+b32 raster_target_create(raster_target* t, const u32 width, const u32 height, const u32 flags);
+void raster_target_free(raster_target* t);
+void raster_target_clear(raster_target* t, const color4 color, const f32 depth);
+b32 rasterizer_create(rasterizer* r, const u32 max_vertices, const u32 max_triangles);
+void rasterizer_free(rasterizer* r);
+b32 rasterizer_draw(rasterizer* r, raster_target* t, const mat4 mvp, const point3* positions, const color4* colors,
+        const u32 vertex_count, const u32* indices, const u32 triangle_count);
+
+
+#ifdef YS_RASTER_IMPLEMENTATION
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * ==== TARGET =======
+*/
+
+b32 raster_target_create(raster_target* t, const u32 width, const u32 height, const u32 flags) {
+    u64 pixels = (u64)width * height > 0 ? (u64)width * height : 1;
+    t->color = flags & RASTER_COLOR4 ? (color4*)YS_MALLOC(sizeof(color4) * pixels) : 0;
+    t->rgba8 = flags & RASTER_RGBA8 ? (u32*)YS_MALLOC(sizeof(u32) * pixels) : 0;
+    t->depth = flags & RASTER_DEPTH ? (f32*)YS_MALLOC(sizeof(f32) * pixels) : 0;
+    t->width = width;
+    t->height = height;
+    if (((flags & RASTER_COLOR4) && !t->color) || ((flags & RASTER_RGBA8) && !t->rgba8)
+            || ((flags & RASTER_DEPTH) && !t->depth)) {
+        raster_target_free(t);
+        return 0;
+    }
+    return 1;
+}
+
+void raster_target_free(raster_target* t) {
+    YS_FREE(t->color);
+    YS_FREE(t->rgba8);
+    YS_FREE(t->depth);
+    t->color = 0;
+    t->rgba8 = 0;
+    t->depth = 0;
+    t->width = 0;
+    t->height = 0;
+}
+
+static u32 raster_pack_rgba8(const f32* c) {
+    u32 packed = 0;
+    for (u32 k = 0; k < 4; ++k) {
+        f32 v = c[k] < 0.0f ? 0.0f : (c[k] > 1.0f ? 1.0f : c[k]);
+        packed |= (u32)(v * 255.0f + 0.5f) << (8 * k);
+    }
+    return packed;
+}
+
+void raster_target_clear(raster_target* t, const color4 color, const f32 depth) {
+    u64 pixels = (u64)t->width * t->height;
+    u32 packed = raster_pack_rgba8(color.e);
+    for (u64 i = 0; i < pixels; ++i) {
+        if (t->color) {
+            t->color[i] = color;
+        }
+        if (t->rgba8) {
+            t->rgba8[i] = packed;
+        }
+        if (t->depth) {
+            t->depth[i] = depth;
+        }
+    }
+}
+
+
+/*
+ * ==== RASTERIZER =======
+*/
+
+b32 rasterizer_create(rasterizer* r, const u32 max_vertices, const u32 max_triangles) {
+    u32 vertices = max_vertices > 0 ? max_vertices : 1;
+    u32 triangles = max_triangles > 0 ? max_triangles : 1;
+    r->clip = (vec4*)YS_MALLOC(sizeof(vec4) * vertices);
+    r->codes = (u8*)YS_MALLOC(vertices);
+    r->guard = (u8*)YS_MALLOC(vertices);
+    r->masks = (u8*)YS_MALLOC(triangles);
+    r->triangles = (raster_triangle*)YS_MALLOC(sizeof(raster_triangle) * triangles);
+    r->tiles = (u32*)YS_MALLOC(sizeof(u32) * triangles);
+    r->order = (u32*)YS_MALLOC(sizeof(u32) * triangles);
+    r->bin_counts = 0;
+    r->bin_offsets = 0;
+    r->bins = 0;
+    r->vertex_capacity = max_vertices;
+    r->triangle_capacity = max_triangles;
+    r->record_capacity = triangles;
+    r->tile_capacity = triangles;
+    r->count_capacity = 0;
+    r->offset_capacity = 0;
+    r->bin_capacity = 0;
+    r->order_capacity = triangles;
+    r->record_count = 0;
+    r->order_count = 0;
+    if (!r->clip || !r->codes || !r->guard || !r->masks || !r->triangles || !r->tiles || !r->order) {
+        rasterizer_free(r);
+        return 0;
+    }
+    return 1;
+}
+
+void rasterizer_free(rasterizer* r) {
+    YS_FREE(r->clip);
+    YS_FREE(r->codes);
+    YS_FREE(r->guard);
+    YS_FREE(r->masks);
+    YS_FREE(r->triangles);
+    YS_FREE(r->tiles);
+    YS_FREE(r->order);
+    YS_FREE(r->bin_counts);
+    YS_FREE(r->bin_offsets);
+    YS_FREE(r->bins);
+    r->clip = 0;
+    r->codes = 0;
+    r->guard = 0;
+    r->masks = 0;
+    r->triangles = 0;
+    r->tiles = 0;
+    r->order = 0;
+    r->bin_counts = 0;
+    r->bin_offsets = 0;
+    r->bins = 0;
+    r->vertex_capacity = 0;
+    r->triangle_capacity = 0;
+    r->record_capacity = 0;
+    r->tile_capacity = 0;
+    r->count_capacity = 0;
+    r->offset_capacity = 0;
+    r->bin_capacity = 0;
+    r->order_capacity = 0;
+    r->record_count = 0;
+    r->order_count = 0;
+}
+
+// Makes room for `needed` items, keeping the first `count`. Returns 0
+// when out of memory, leaving the old buffer.
+static b32 raster_reserve(void** data, u32* capacity, const u32 count, const u64 needed, const u32 size) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    u64 grown_capacity = (u64)*capacity * 2 > needed ? (u64)*capacity * 2 : needed;
+    if (grown_capacity > 0xFFFFFFFFu) {
+        return 0;
+    }
+    u8* grown = (u8*)YS_MALLOC(grown_capacity * size);
+    if (!grown) {
+        return 0;
+    }
+    const u8* old = (const u8*)*data;
+    for (u64 i = 0; i < (u64)count * size; ++i) {
+        grown[i] = old[i];
+    }
+    YS_FREE(*data);
+    *data = grown;
+    *capacity = (u32)grown_capacity;
+    return 1;
+}
+
+typedef struct raster_job {
+    rasterizer* r;
+    raster_target* t;
+    mat4 mvp;
+    const point3* positions;
+    const color4* colors;
+    const u32* indices;
+    f32 guard_x;         // guard band half extents in clip space units of w
+    f32 guard_y;
+    u32 tiles_x;
+    u32 tile_count;
+    u32 chunk_count;
+} raster_job;
+
+static void raster_vertex_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    raster_job* job = (raster_job*)ctx;
+    rasterizer* r = job->r;
+    const mat4 m = job->mvp;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        point3 p = job->positions[i];
+        vec4 v;
+        v.x = m.m00 * p.x + m.m01 * p.y + m.m02 * p.z + m.m03;
+        v.y = m.m10 * p.x + m.m11 * p.y + m.m12 * p.z + m.m13;
+        v.z = m.m20 * p.x + m.m21 * p.y + m.m22 * p.z + m.m23;
+        v.w = m.m30 * p.x + m.m31 * p.y + m.m32 * p.z + m.m33;
+        r->clip[i] = v;
+        f32 gx = job->guard_x * v.w;
+        f32 gy = job->guard_y * v.w;
+        r->guard[i] = (u8)((v.x < -gx) | (v.x > gx) << 1 | (v.y < -gy) << 2 | (v.y > gy) << 3);
+    }
+    clip_outcodes(r->clip + begin, end - begin, r->codes + begin);
+}
+
+// Fits a plane through three values at the vertices of a triangle in
+// pixels, relative to the first vertex.
+static void raster_plane(f32* plane, const f32* x, const f32* y, const f32 v0, const f32 v1, const f32 v2) {
+    f32 dx1 = x[1] - x[0], dy1 = y[1] - y[0];
+    f32 dx2 = x[2] - x[0], dy2 = y[2] - y[0];
+    f32 inv_det = 1.0f / (dx1 * dy2 - dx2 * dy1);
+    plane[0] = v0;
+    plane[1] = ((v1 - v0) * dy2 - (v2 - v0) * dy1) * inv_det;
+    plane[2] = ((v2 - v0) * dx1 - (v1 - v0) * dx2) * inv_det;
+}
+
+// Snaps a triangle inside the guard band to the subpixel grid and builds
+// its edge functions and planes. Returns 0, with empty bounds, when it
+// covers no pixel center.
+static b32 raster_setup(const raster_target* t, raster_triangle* out, const vec4* p, const color4* c) {
+    f32 hw = 0.5f * (f32)t->width;
+    f32 hh = 0.5f * (f32)t->height;
+    i32 x[3], y[3];
+    f32 z[3], inv_w[3];
+    out->bounds[0] = 1;
+    out->bounds[2] = 0;
+    for (u32 i = 0; i < 3; ++i) {
+        if (!(p[i].w > 0.0f)) {
+            return 0;
+        }
+        inv_w[i] = 1.0f / p[i].w;
+        x[i] = (i32)floorf((p[i].x * inv_w[i] * hw + hw) * RASTER_SUBPIXEL + 0.5f);
+        y[i] = (i32)floorf((hh - p[i].y * inv_w[i] * hh) * RASTER_SUBPIXEL + 0.5f);
+        z[i] = p[i].z * inv_w[i] * 0.5f + 0.5f;
+    }
+    i64 area = (i64)(x[1] - x[0]) * (y[2] - y[0]) - (i64)(x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0) {
+        return 0;
+    }
+    // Both windings are drawn; the edges are ordered for a positive area.
+    u32 o[3] = {0, 1, 2};
+    if (area < 0) {
+        o[1] = 2;
+        o[2] = 1;
+    }
+
+    // Pixel px is sampled at px * RASTER_SUBPIXEL + RASTER_SUBPIXEL / 2.
+    i32 min_x = x[0], min_y = y[0], max_x = x[0], max_y = y[0];
+    for (u32 i = 1; i < 3; ++i) {
+        min_x = x[i] < min_x ? x[i] : min_x;
+        min_y = y[i] < min_y ? y[i] : min_y;
+        max_x = x[i] > max_x ? x[i] : max_x;
+        max_y = y[i] > max_y ? y[i] : max_y;
+    }
+    i32 half = RASTER_SUBPIXEL / 2;
+    i32 bx0 = (min_x - half + RASTER_SUBPIXEL - 1) >> RASTER_SUBPIXEL_BITS;
+    i32 by0 = (min_y - half + RASTER_SUBPIXEL - 1) >> RASTER_SUBPIXEL_BITS;
+    i32 bx1 = (max_x - half) >> RASTER_SUBPIXEL_BITS;
+    i32 by1 = (max_y - half) >> RASTER_SUBPIXEL_BITS;
+    bx0 = bx0 > 0 ? bx0 : 0;
+    by0 = by0 > 0 ? by0 : 0;
+    bx1 = bx1 < (i32)t->width - 1 ? bx1 : (i32)t->width - 1;
+    by1 = by1 < (i32)t->height - 1 ? by1 : (i32)t->height - 1;
+    if (bx0 > bx1 || by0 > by1) {
+        return 0;
+    }
+
+    for (u32 i = 0; i < 3; ++i) {
+        u32 u = o[i], v = o[(i + 1) % 3];
+        i32 a = y[u] - y[v];
+        i32 b = x[v] - x[u];
+        i64 e = -((i64)a * x[u] + (i64)b * y[u]);
+        // Top-left rule: samples exactly on an edge belong to the triangle
+        // only on its top or left edges, so shared edges are drawn once.
+        if (!(a > 0 || (a == 0 && b > 0))) {
+            e -= 1;
+        }
+        out->edge_a[i] = a;
+        out->edge_b[i] = b;
+        out->edge_c[i] = e;
+    }
+
+    f32 px[3], py[3];
+    for (u32 i = 0; i < 3; ++i) {
+        px[i] = (f32)x[o[i]] / RASTER_SUBPIXEL;
+        py[i] = (f32)y[o[i]] / RASTER_SUBPIXEL;
+    }
+    out->origin[0] = px[0];
+    out->origin[1] = py[0];
+    raster_plane(out->planes[0], px, py, z[o[0]], z[o[1]], z[o[2]]);
+    raster_plane(out->planes[1], px, py, inv_w[o[0]], inv_w[o[1]], inv_w[o[2]]);
+    if (c) {
+        for (u32 k = 0; k < 4; ++k) {
+            raster_plane(out->planes[2 + k], px, py, c[o[0]].e[k] * inv_w[o[0]], c[o[1]].e[k] * inv_w[o[1]],
+                c[o[2]].e[k] * inv_w[o[2]]);
+        }
+    }
+    out->bounds[0] = bx0;
+    out->bounds[1] = by0;
+    out->bounds[2] = bx1;
+    out->bounds[3] = by1;
+    return 1;
+}
+
+// Tiles under the bounds of a triangle, packed for the binning passes so
+// they need not touch the setup data.
+static u32 raster_tile_range(const raster_triangle* tri) {
+    if (tri->bounds[0] > tri->bounds[2]) {
+        return RASTER_CULLED;
+    }
+    return (u32)tri->bounds[0] / RASTER_TILE_SIZE | (u32)tri->bounds[1] / RASTER_TILE_SIZE << 8
+        | (u32)tri->bounds[2] / RASTER_TILE_SIZE << 16 | (u32)tri->bounds[3] / RASTER_TILE_SIZE << 24;
+}
+
+// Classifies each triangle and sets up the ones that need no clipping.
+static void raster_setup_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    raster_job* job = (raster_job*)ctx;
+    rasterizer* r = job->r;
+    (void)thread;
+    clip_classify(r->codes, job->indices + (u64)begin * 3, end - begin, CLIP_NEAR | CLIP_FAR, r->masks + begin);
+    for (u32 t = begin; t < end; ++t) {
+        const u32* tri = job->indices + (u64)t * 3;
+        u8 mask = r->masks[t];
+        if (mask != CLIP_REJECT) {
+            mask |= (r->guard[tri[0]] | r->guard[tri[1]] | r->guard[tri[2]]) & CLIP_ALL;
+            r->masks[t] = mask;
+        }
+        raster_triangle* out = &r->triangles[t];
+        out->bounds[0] = 1;
+        out->bounds[2] = 0;
+        if (mask == 0) {
+            vec4 p[3] = {r->clip[tri[0]], r->clip[tri[1]], r->clip[tri[2]]};
+            color4 c[3];
+            if (job->colors) {
+                c[0] = job->colors[tri[0]];
+                c[1] = job->colors[tri[1]];
+                c[2] = job->colors[tri[2]];
+            }
+            raster_setup(job->t, out, p, job->colors ? c : 0);
+        }
+        r->tiles[t] = raster_tile_range(out);
+    }
+}
+
+// Clips triangle t and appends its fan after the other records. Once
+// clipping starts the polygon is also cut to the sides of the target, so
+// every fan vertex lands inside the guard band. Returns 0 when out of
+// memory.
+static b32 raster_clip(raster_job* job, const u32 t) {
+    rasterizer* r = job->r;
+    const u32* tri = job->indices + (u64)t * 3;
+    clip_vertex polygon[CLIP_MAX_VERTICES];
+    u8 planes = (u8)(r->masks[t] | CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP);
+    u32 n = clip_triangle(r->clip[tri[0]], r->clip[tri[1]], r->clip[tri[2]], planes, polygon);
+    for (u32 i = 1; i + 1 < n; ++i) {
+        if (!raster_reserve((void**)&r->triangles, &r->record_capacity, r->record_count, (u64)r->record_count + 1,
+                sizeof(raster_triangle))
+                || !raster_reserve((void**)&r->tiles, &r->tile_capacity, r->record_count, (u64)r->record_count + 1,
+                    sizeof(u32))) {
+            return 0;
+        }
+        u32 fan[3] = {0, i, i + 1};
+        vec4 p[3];
+        color4 c[3];
+        for (u32 k = 0; k < 3; ++k) {
+            const clip_vertex* v = &polygon[fan[k]];
+            p[k] = v->position;
+            if (job->colors) {
+                c[k] = vec4_add(vec4_add(vec4_mul_s(job->colors[tri[0]], v->weights.x),
+                    vec4_mul_s(job->colors[tri[1]], v->weights.y)), vec4_mul_s(job->colors[tri[2]], v->weights.z));
+            }
+        }
+        raster_triangle* out = &r->triangles[r->record_count];
+        if (raster_setup(job->t, out, p, job->colors ? c : 0)) {
+            r->tiles[r->record_count++] = raster_tile_range(out);
+        }
+    }
+    return 1;
+}
+
+
+/*
+ * ==== BINNING =======
+*/
+
+// Counts the triangles of one chunk of the draw order per tile.
+static void raster_count_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    raster_job* job = (raster_job*)ctx;
+    rasterizer* r = job->r;
+    (void)thread;
+    for (u32 chunk = begin; chunk < end; ++chunk) {
+        u32* counts = r->bin_counts + (u64)chunk * job->tile_count;
+        for (u32 i = 0; i < job->tile_count; ++i) {
+            counts[i] = 0;
+        }
+        u32 last = (chunk + 1) * RASTER_TRIANGLE_GRAIN < r->order_count ? (chunk + 1) * RASTER_TRIANGLE_GRAIN
+            : r->order_count;
+        for (u32 i = chunk * RASTER_TRIANGLE_GRAIN; i < last; ++i) {
+            u32 t = r->order[i];
+            u32 range = r->tiles[t];
+            for (u32 ty = range >> 8 & 0xFF; ty <= range >> 24; ++ty) {
+                for (u32 tx = range & 0xFF; tx <= (range >> 16 & 0xFF); ++tx) {
+                    ++counts[ty * job->tiles_x + tx];
+                }
+            }
+        }
+    }
+}
+
+// Turns the counts of each tile into offsets of each chunk within the
+// tile's list, chunks in order, and stores the tile's total.
+static void raster_scan_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    raster_job* job = (raster_job*)ctx;
+    rasterizer* r = job->r;
+    (void)thread;
+    for (u32 tile = begin; tile < end; ++tile) {
+        u32 sum = 0;
+        for (u32 chunk = 0; chunk < job->chunk_count; ++chunk) {
+            u32* count = &r->bin_counts[(u64)chunk * job->tile_count + tile];
+            u32 c = *count;
+            *count = sum;
+            sum += c;
+        }
+        r->bin_offsets[tile + 1] = sum;
+    }
+}
+
+static void raster_bin_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    raster_job* job = (raster_job*)ctx;
+    rasterizer* r = job->r;
+    (void)thread;
+    for (u32 chunk = begin; chunk < end; ++chunk) {
+        u32* cursors = r->bin_counts + (u64)chunk * job->tile_count;
+        u32 last = (chunk + 1) * RASTER_TRIANGLE_GRAIN < r->order_count ? (chunk + 1) * RASTER_TRIANGLE_GRAIN
+            : r->order_count;
+        for (u32 i = chunk * RASTER_TRIANGLE_GRAIN; i < last; ++i) {
+            u32 t = r->order[i];
+            u32 range = r->tiles[t];
+            for (u32 ty = range >> 8 & 0xFF; ty <= range >> 24; ++ty) {
+                for (u32 tx = range & 0xFF; tx <= (range >> 16 & 0xFF); ++tx) {
+                    u32 tile = ty * job->tiles_x + tx;
+                    r->bins[r->bin_offsets[tile] + cursors[tile]++] = t;
+                }
+            }
+        }
+    }
+}
+
+
+/*
+ * ==== TILES =======
+*/
+
+#if !defined(__SSE2__)
+// Writes one covered pixel that passed the depth test. color is null for
+// depth only draws.
+static void raster_write(raster_target* t, const u64 i, const f32 z, const f32* color) {
+    if (t->depth) {
+        t->depth[i] = z;
+    }
+    if (color) {
+        if (t->color) {
+            t->color[i].r = color[0];
+            t->color[i].g = color[1];
+            t->color[i].b = color[2];
+            t->color[i].a = color[3];
+        }
+        if (t->rgba8) {
+            t->rgba8[i] = raster_pack_rgba8(color);
+        }
+    }
+}
+#endif
+
+// Draws the part of a triangle inside the tile at (tile_x, tile_y).
+// Edges that hold over the whole tile are dropped, and the others fit in
+// 32 bits there since they change sign inside it.
+static void raster_draw_tile(raster_target* t, const raster_triangle* tri, const i32 tile_x, const i32 tile_y,
+        const b32 shade) {
+    i32 x0 = tri->bounds[0] > tile_x ? tri->bounds[0] : tile_x;
+    i32 y0 = tri->bounds[1] > tile_y ? tri->bounds[1] : tile_y;
+    i32 x1 = tri->bounds[2] < tile_x + RASTER_TILE_SIZE - 1 ? tri->bounds[2] : tile_x + RASTER_TILE_SIZE - 1;
+    i32 y1 = tri->bounds[3] < tile_y + RASTER_TILE_SIZE - 1 ? tri->bounds[3] : tile_y + RASTER_TILE_SIZE - 1;
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+    i64 sx = (i64)x0 * RASTER_SUBPIXEL + RASTER_SUBPIXEL / 2;
+    i64 sy = (i64)y0 * RASTER_SUBPIXEL + RASTER_SUBPIXEL / 2;
+    i32 e0[3], step_x[3], step_y[3];
+    for (u32 i = 0; i < 3; ++i) {
+        i64 e = tri->edge_a[i] * sx + tri->edge_b[i] * sy + tri->edge_c[i];
+        i64 dx = (i64)tri->edge_a[i] * RASTER_SUBPIXEL * (x1 - x0);
+        i64 dy = (i64)tri->edge_b[i] * RASTER_SUBPIXEL * (y1 - y0);
+        i64 lo = e + (dx < 0 ? dx : 0) + (dy < 0 ? dy : 0);
+        i64 hi = e + (dx > 0 ? dx : 0) + (dy > 0 ? dy : 0);
+        if (hi < 0) {
+            return;
+        }
+        b32 covered = lo >= 0;
+        e0[i] = covered ? 0 : (i32)e;
+        step_x[i] = covered ? 0 : tri->edge_a[i] * RASTER_SUBPIXEL;
+        step_y[i] = covered ? 0 : tri->edge_b[i] * RASTER_SUBPIXEL;
+    }
+
+    // Plane values at the first pixel center.
+    u32 planes = shade ? RASTER_PLANE_COUNT : 1;
+    f32 base[RASTER_PLANE_COUNT], ddx[RASTER_PLANE_COUNT], ddy[RASTER_PLANE_COUNT];
+    f32 ox = (f32)x0 + 0.5f - tri->origin[0];
+    f32 oy = (f32)y0 + 0.5f - tri->origin[1];
+    for (u32 k = 0; k < planes; ++k) {
+        base[k] = tri->planes[k][0] + tri->planes[k][1] * ox + tri->planes[k][2] * oy;
+        ddx[k] = tri->planes[k][1];
+        ddy[k] = tri->planes[k][2];
+    }
+
+#if defined(__SSE2__)
+    // Four pixels of a row at a time.
+    __m128i lane_e[3], step4_e[3];
+    for (u32 i = 0; i < 3; ++i) {
+        lane_e[i] = _mm_set_epi32(3 * step_x[i], 2 * step_x[i], step_x[i], 0);
+        step4_e[i] = _mm_set1_epi32(4 * step_x[i]);
+    }
+    const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128i lane_bits = _mm_set_epi32(8, 4, 2, 1);
+    for (i32 y = y0; y <= y1; ++y) {
+        i32 dy = y - y0;
+        __m128i e[3];
+        for (u32 i = 0; i < 3; ++i) {
+            e[i] = _mm_add_epi32(_mm_set1_epi32(e0[i] + step_y[i] * dy), lane_e[i]);
+        }
+        f32 row[RASTER_PLANE_COUNT];
+        for (u32 k = 0; k < planes; ++k) {
+            row[k] = base[k] + ddy[k] * (f32)dy;
+        }
+        u64 line = (u64)y * t->width;
+        for (i32 x = x0; x <= x1; x += 4) {
+            __m128i outside = _mm_or_si128(_mm_or_si128(e[0], e[1]), e[2]);
+            u32 valid = x1 - x >= 3 ? 0xFu : (1u << (x1 - x + 1)) - 1;
+            u32 mask = ~(u32)_mm_movemask_ps(_mm_castsi128_ps(outside)) & valid;
+            for (u32 i = 0; i < 3; ++i) {
+                e[i] = _mm_add_epi32(e[i], step4_e[i]);
+            }
+            if (!mask) {
+                continue;
+            }
+            __m128 dx = _mm_add_ps(_mm_set1_ps((f32)(x - x0)), lanes);
+            __m128 z = _mm_add_ps(_mm_set1_ps(row[0]), _mm_mul_ps(_mm_set1_ps(ddx[0]), dx));
+            b32 full = valid == 0xFu;
+            f32* depth = t->depth ? t->depth + line + x : 0;
+            __m128 d = _mm_setzero_ps();
+            if (depth) {
+                if (full) {
+                    d = _mm_loadu_ps(depth);
+                } else {
+                    f32 gathered[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                    for (i32 l = 0; l <= x1 - x; ++l) {
+                        gathered[l] = depth[l];
+                    }
+                    d = _mm_loadu_ps(gathered);
+                }
+                mask &= (u32)_mm_movemask_ps(_mm_cmplt_ps(z, d));
+                if (!mask) {
+                    continue;
+                }
+            }
+            // Whole blocks are blended and stored at once, the ragged end
+            // of a row one pixel at a time.
+            __m128i keep = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((i32)mask), lane_bits), lane_bits);
+            f32 zs[4];
+            _mm_storeu_ps(zs, z);
+            if (depth && full && mask == 0xFu) {
+                _mm_storeu_ps(depth, z);
+            } else if (depth && full) {
+                __m128 k = _mm_castsi128_ps(keep);
+                _mm_storeu_ps(depth, _mm_or_ps(_mm_and_ps(k, z), _mm_andnot_ps(k, d)));
+            } else if (depth) {
+                for (u32 l = 0; l < 4; ++l) {
+                    if (mask & (1u << l)) {
+                        depth[l] = zs[l];
+                    }
+                }
+            }
+            if (!shade) {
+                continue;
+            }
+            // Perspective correct: interpolate c / w and 1 / w, divide.
+            __m128 inv_w = _mm_add_ps(_mm_set1_ps(row[1]), _mm_mul_ps(_mm_set1_ps(ddx[1]), dx));
+            __m128 w = _mm_div_ps(_mm_set1_ps(1.0f), inv_w);
+            __m128 c[4];
+            for (u32 k = 0; k < 4; ++k) {
+                c[k] = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(row[2 + k]), _mm_mul_ps(_mm_set1_ps(ddx[2 + k]), dx)), w);
+            }
+            if (t->rgba8) {
+                __m128i packed = _mm_setzero_si128();
+                for (u32 k = 0; k < 4; ++k) {
+                    __m128 v = _mm_min_ps(_mm_max_ps(c[k], _mm_setzero_ps()), _mm_set1_ps(1.0f));
+                    __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+                    packed = _mm_or_si128(packed, _mm_slli_epi32(b, 8 * k));
+                }
+                u32* rgba8 = t->rgba8 + line + x;
+                if (full) {
+                    __m128i old = _mm_loadu_si128((const __m128i*)rgba8);
+                    packed = _mm_or_si128(_mm_and_si128(keep, packed), _mm_andnot_si128(keep, old));
+                    _mm_storeu_si128((__m128i*)rgba8, packed);
+                } else {
+                    u32 lanes_out[4];
+                    _mm_storeu_si128((__m128i*)lanes_out, packed);
+                    for (u32 l = 0; l < 4; ++l) {
+                        if (mask & (1u << l)) {
+                            rgba8[l] = lanes_out[l];
+                        }
+                    }
+                }
+            }
+            if (t->color) {
+                _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+                for (u32 l = 0; l < 4; ++l) {
+                    if (mask & (1u << l)) {
+                        _mm_storeu_ps(t->color[line + x + l].e, c[l]);
+                    }
+                }
+            }
+        }
+    }
+#else
+    for (i32 y = y0; y <= y1; ++y) {
+        i32 dy = y - y0;
+        i32 e[3];
+        for (u32 i = 0; i < 3; ++i) {
+            e[i] = e0[i] + step_y[i] * dy;
+        }
+        u64 line = (u64)y * t->width;
+        for (i32 x = x0; x <= x1; ++x) {
+            b32 inside = (e[0] | e[1] | e[2]) >= 0;
+            for (u32 i = 0; i < 3; ++i) {
+                e[i] += step_x[i];
+            }
+            if (!inside) {
+                continue;
+            }
+            f32 dx = (f32)(x - x0);
+            f32 z = base[0] + ddx[0] * dx + ddy[0] * (f32)dy;
+            if (t->depth && !(z < t->depth[line + x])) {
+                continue;
+            }
+            f32 color[4];
+            if (shade) {
+                // Perspective correct: interpolate c / w and 1 / w, divide.
+                f32 w = 1.0f / (base[1] + ddx[1] * dx + ddy[1] * (f32)dy);
+                for (u32 k = 0; k < 4; ++k) {
+                    color[k] = (base[2 + k] + ddx[2 + k] * dx + ddy[2 + k] * (f32)dy) * w;
+                }
+            }
+            raster_write(t, line + x, z, shade ? color : 0);
+        }
+    }
+#endif
+}
+
+static void raster_tile_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    raster_job* job = (raster_job*)ctx;
+    rasterizer* r = job->r;
+    b32 shade = job->colors && (job->t->color || job->t->rgba8);
+    (void)thread;
+    for (u32 tile = begin; tile < end; ++tile) {
+        i32 tile_x = (i32)(tile % job->tiles_x) * RASTER_TILE_SIZE;
+        i32 tile_y = (i32)(tile / job->tiles_x) * RASTER_TILE_SIZE;
+        u32 end_bin = r->bin_offsets[tile + 1];
+        for (u32 i = r->bin_offsets[tile]; i < end_bin; ++i) {
+#if defined(__GNUC__)
+            // Triangles of a tile are spread over the whole setup array.
+            if (i + RASTER_PREFETCH < end_bin) {
+                const char* ahead = (const char*)&r->triangles[r->bins[i + RASTER_PREFETCH]];
+                for (u32 b = 0; b < sizeof(raster_triangle); b += 64) {
+                    __builtin_prefetch(ahead + b);
+                }
+            }
+#endif
+            raster_draw_tile(job->t, &r->triangles[r->bins[i]], tile_x, tile_y, shade);
+        }
+    }
+}
+
+// Draws indexed triangles transformed by mvp into clip space, depth
+// tested against t->depth when present. colors, interpolated perspective
+// correct, may be null for depth only draws such as occlusion buffers.
+// Triangles are drawn from both sides. Returns 0 when the counts exceed
+// the rasterizer's capacity, the target is larger than RASTER_MAX_SIZE,
+// or out of memory.
+b32 rasterizer_draw(rasterizer* r, raster_target* t, const mat4 mvp, const point3* positions, const color4* colors,
+        const u32 vertex_count, const u32* indices, const u32 triangle_count) {
+    if (vertex_count > r->vertex_capacity || triangle_count > r->triangle_capacity || t->width == 0
+            || t->height == 0 || t->width > RASTER_MAX_SIZE || t->height > RASTER_MAX_SIZE) {
+        return 0;
+    }
+    raster_job job;
+    job.r = r;
+    job.t = t;
+    job.mvp = mvp;
+    job.positions = positions;
+    job.colors = colors;
+    job.indices = indices;
+    job.guard_x = (f32)RASTER_GUARD_BAND / (0.5f * (f32)t->width);
+    job.guard_y = (f32)RASTER_GUARD_BAND / (0.5f * (f32)t->height);
+    job.tiles_x = (t->width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    job.tile_count = job.tiles_x * ((t->height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE);
+
+    parallel_for(vertex_count, RASTER_VERTEX_GRAIN, raster_vertex_task, &job);
+    parallel_for(triangle_count, RASTER_TRIANGLE_GRAIN, raster_setup_task, &job);
+
+    // Few triangles get past the pre-pass into the clipper, so their fans
+    // are appended serially. The draw order lists each fan in place of its
+    // triangle, which keeps every tile in submission order.
+    r->record_count = triangle_count;
+    r->order_count = 0;
+    for (u32 i = 0; i < triangle_count; ++i) {
+        if (r->masks[i] == 0 || r->masks[i] == CLIP_REJECT) {
+            r->order[r->order_count++] = i;
+            continue;
+        }
+        u32 first = r->record_count;
+        if (!raster_clip(&job, i)) {
+            return 0;
+        }
+        u32 fans = r->record_count - first;
+        // Room for the fan and every triangle still to come.
+        if (!raster_reserve((void**)&r->order, &r->order_capacity, r->order_count,
+                (u64)r->order_count + fans + (triangle_count - 1 - i), sizeof(u32))) {
+            return 0;
+        }
+        for (u32 k = 0; k < fans; ++k) {
+            r->order[r->order_count++] = first + k;
+        }
+    }
+
+    job.chunk_count = (r->order_count + RASTER_TRIANGLE_GRAIN - 1) / RASTER_TRIANGLE_GRAIN;
+    if (!raster_reserve((void**)&r->bin_counts, &r->count_capacity, 0, (u64)job.chunk_count * job.tile_count,
+                sizeof(u32))
+            || !raster_reserve((void**)&r->bin_offsets, &r->offset_capacity, 0, (u64)job.tile_count + 1,
+                sizeof(u32))) {
+        return 0;
+    }
+    parallel_for(job.chunk_count, 1, raster_count_task, &job);
+    parallel_for(job.tile_count, RASTER_SCAN_GRAIN, raster_scan_task, &job);
+    r->bin_offsets[0] = 0;
+    for (u32 tile = 0; tile < job.tile_count; ++tile) {
+        r->bin_offsets[tile + 1] += r->bin_offsets[tile];
+    }
+    if (!raster_reserve((void**)&r->bins, &r->bin_capacity, 0, r->bin_offsets[job.tile_count], sizeof(u32))) {
+        return 0;
+    }
+    parallel_for(job.chunk_count, 1, raster_bin_task, &job);
+    parallel_for(job.tile_count, 1, raster_tile_task, &job);
+    return 1;
+}
+
+#endif
+#endif
@@ -0,0 +1,357 @@
+#ifndef YS_SAP_H
+#define YS_SAP_H
+
+#include "ys_geom.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Insertion sort swaps allowed per body before a frame is treated as
+// incoherent and radix sorted instead.
+#define SAP_SWAP_BUDGET 32
+#define SAP_RADIX_CHUNKS 64
+#define SAP_GRAIN 2048
+// Pairs collected per worker before reserving room in the output.
+#define SAP_PAIR_BATCH 64
+// Candidates tested together in the sweep.
+#define SAP_SWEEP_BLOCK 16
+// Sorted bounds rows: min and max on the sweep axis, then on the other two.
+#define SAP_SORTED_ROWS 6
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Overlapping bodies, a < b.
+typedef struct sap_pair {
+    u32 a;
+    u32 b;
+} sap_pair;
+
+// Sweep and prune along one axis. The body order from the last frame is
+// kept, so for coherent motion the sort is a short insertion sort pass.
+typedef struct sap {
+    u32* order;        // body per sorted slot
+    u32* keys;         // sortable bits of the box min on `axis`
+    u32* order_tmp;
+    u32* keys_tmp;
+    f32* sorted;       // bounds in sorted order, SAP_SORTED_ROWS rows of capacity
+    u32 count;
+    u32 capacity;
+    u32 axis;
+    b32 valid;         // order holds a previous frame
+    b32 full_sort;     // last update needed the radix sort
+} sap;
+
+
+/*
+ * === SAP INTERFACE ===
+*/
+b32 sap_create(sap* s, const u32 max_bodies);
+void sap_free(sap* s);
+u32 sap_update(sap* s, const aabb3* bounds, const u32 count, sap_pair* pairs, const u32 max_pairs);
+
+
+#ifdef YS_SAP_IMPLEMENTATION
+
+b32 sap_create(sap* s, const u32 max_bodies) {
+    u32 n = max_bodies ? max_bodies : 1;
+    s->order = (u32*)YS_MALLOC(sizeof(u32) * n);
+    s->keys = (u32*)YS_MALLOC(sizeof(u32) * n);
+    s->order_tmp = (u32*)YS_MALLOC(sizeof(u32) * n);
+    s->keys_tmp = (u32*)YS_MALLOC(sizeof(u32) * n);
+    s->sorted = (f32*)YS_MALLOC(sizeof(f32) * SAP_SORTED_ROWS * n);
+    s->count = 0;
+    s->capacity = max_bodies;
+    s->axis = 0;
+    s->valid = 0;
+    s->full_sort = 0;
+    if (!s->order || !s->keys || !s->order_tmp || !s->keys_tmp || !s->sorted) {
+        sap_free(s);
+        return 0;
+    }
+    return 1;
+}
+
+void sap_free(sap* s) {
+    YS_FREE(s->order);
+    YS_FREE(s->keys);
+    YS_FREE(s->order_tmp);
+    YS_FREE(s->keys_tmp);
+    YS_FREE(s->sorted);
+    s->order = s->keys = s->order_tmp = s->keys_tmp = 0;
+    s->sorted = 0;
+    s->capacity = 0;
+    s->count = 0;
+    s->valid = 0;
+}
+
+// Float bits that sort as unsigned integers in the same order.
+static u32 sap_key(const f32 v) {
+    union { f32 f; u32 u; } bits;
+    bits.f = v;
+    return bits.u ^ ((bits.u >> 31) ? 0xFFFFFFFFu : 0x80000000u);
+}
+
+// Axis with the largest spread of box centers.
+static u32 sap_choose_axis(const aabb3* bounds, const u32 count) {
+    f64 sum[3] = {0, 0, 0};
+    f64 sum_sq[3] = {0, 0, 0};
+    for (u32 i = 0; i < count; ++i) {
+        for (int a = 0; a < 3; ++a) {
+            f64 c = 0.5 * ((f64)bounds[i].min.e[a] + bounds[i].max.e[a]);
+            sum[a] += c;
+            sum_sq[a] += c * c;
+        }
+    }
+    u32 axis = 0;
+    f64 best = -1.0;
+    for (u32 a = 0; a < 3; ++a) {
+        f64 variance = sum_sq[a] - sum[a] * sum[a] / (count ? count : 1);
+        if (variance > best) {
+            best = variance;
+            axis = a;
+        }
+    }
+    return axis;
+}
+
+
+/*
+ * ==== SORT =======
+*/
+
+typedef struct sap_job {
+    sap* s;
+    const aabb3* bounds;
+    sap_pair* pairs;
+    u32 max_pairs;
+    u32 pair_count;
+    u32 shift;
+    u32 chunk_size;
+    u32 (*histograms)[256];
+} sap_job;
+
+static void sap_keys_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    sap_job* job = (sap_job*)ctx;
+    sap* s = job->s;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        s->keys[i] = sap_key(job->bounds[s->order[i]].min.e[s->axis]);
+    }
+}
+
+static void sap_histogram_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    sap_job* job = (sap_job*)ctx;
+    sap* s = job->s;
+    (void)thread;
+    for (u32 c = begin; c < end; ++c) {
+        u32* h = job->histograms[c];
+        for (u32 d = 0; d < 256; ++d) {
+            h[d] = 0;
+        }
+        u32 first = c * job->chunk_size;
+        u32 last = first + job->chunk_size < s->count ? first + job->chunk_size : s->count;
+        for (u32 i = first; i < last; ++i) {
+            h[(s->keys[i] >> job->shift) & 0xFF]++;
+        }
+    }
+}
+
+static void sap_scatter_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    sap_job* job = (sap_job*)ctx;
+    sap* s = job->s;
+    (void)thread;
+    for (u32 c = begin; c < end; ++c) {
+        u32* offset = job->histograms[c];
+        u32 first = c * job->chunk_size;
+        u32 last = first + job->chunk_size < s->count ? first + job->chunk_size : s->count;
+        for (u32 i = first; i < last; ++i) {
+            u32 key = s->keys[i];
+            u32 dst = offset[(key >> job->shift) & 0xFF]++;
+            s->keys_tmp[dst] = key;
+            s->order_tmp[dst] = s->order[i];
+        }
+    }
+}
+
+// Stable LSD radix sort of (keys, order), 8 bits per pass. Chunks count
+// and scatter in parallel; passes where every key shares the digit are
+// skipped.
+static void sap_radix_sort(sap_job* job) {
+    sap* s = job->s;
+    u32 histograms[SAP_RADIX_CHUNKS][256];
+    u32 chunks = s->count < SAP_RADIX_CHUNKS * 256 ? 1 : SAP_RADIX_CHUNKS;
+    job->chunk_size = (s->count + chunks - 1) / chunks;
+    job->histograms = histograms;
+    for (job->shift = 0; job->shift < 32; job->shift += 8) {
+        parallel_for(chunks, 1, sap_histogram_task, job);
+        b32 skip = 0;
+        u32 offset = 0;
+        for (u32 d = 0; d < 256; ++d) {
+            u32 digit_start = offset;
+            for (u32 c = 0; c < chunks; ++c) {
+                u32 n = histograms[c][d];
+                histograms[c][d] = offset;
+                offset += n;
+            }
+            skip |= offset - digit_start == s->count;
+        }
+        if (skip) {
+            continue;
+        }
+        parallel_for(chunks, 1, sap_scatter_task, job);
+        u32* tmp = s->keys;
+        s->keys = s->keys_tmp;
+        s->keys_tmp = tmp;
+        tmp = s->order;
+        s->order = s->order_tmp;
+        s->order_tmp = tmp;
+    }
+}
+
+// Insertion sort from the previous frame's order. Returns 0 once the swap
+// budget runs out, leaving a valid but partly sorted order.
+static b32 sap_insertion_sort(sap* s) {
+    u64 budget = (u64)s->count * SAP_SWAP_BUDGET;
+    for (u32 i = 1; i < s->count; ++i) {
+        u32 key = s->keys[i];
+        u32 body = s->order[i];
+        u32 j = i;
+        while (j > 0 && s->keys[j - 1] > key) {
+            s->keys[j] = s->keys[j - 1];
+            s->order[j] = s->order[j - 1];
+            --j;
+        }
+        s->keys[j] = key;
+        s->order[j] = body;
+        if (i - j > budget) {
+            return 0;
+        }
+        budget -= i - j;
+    }
+    return 1;
+}
+
+
+/*
+ * ==== SWEEP =======
+*/
+
+static void sap_gather_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    sap_job* job = (sap_job*)ctx;
+    sap* s = job->s;
+    (void)thread;
+    for (u32 r = 0; r < SAP_SORTED_ROWS; ++r) {
+        u32 axis = (s->axis + r / 2) % 3;
+        f32* row = s->sorted + (u64)r * s->capacity;
+        for (u32 i = begin; i < end; ++i) {
+            const aabb3* box = &job->bounds[s->order[i]];
+            row[i] = r & 1 ? box->max.e[axis] : box->min.e[axis];
+        }
+    }
+}
+
+static void sap_flush(sap_job* job, const sap_pair* batch, const u32 n) {
+    u32 first = atomic_add_u32(&job->pair_count, n);
+    for (u32 i = 0; i < n && first + i < job->max_pairs; ++i) {
+        job->pairs[first + i] = batch[i];
+    }
+}
+
+// Each body is tested against the run of following ones whose min on
+// the sweep axis is before its max. Candidates are tested in fixed size
+// blocks without branches so the loop vectorizes.
+static void sap_sweep_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    sap_job* job = (sap_job*)ctx;
+    sap* s = job->s;
+    const f32* min_s = s->sorted;
+    const f32* max_s = s->sorted + s->capacity;
+    const f32* min_a = s->sorted + 2 * (u64)s->capacity;
+    const f32* max_a = s->sorted + 3 * (u64)s->capacity;
+    const f32* min_b = s->sorted + 4 * (u64)s->capacity;
+    const f32* max_b = s->sorted + 5 * (u64)s->capacity;
+    sap_pair batch[SAP_PAIR_BATCH];
+    u32 hit[SAP_SWEEP_BLOCK];
+    u32 n = 0;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        f32 limit = max_s[i];
+        f32 lo_a = min_a[i];
+        f32 hi_a = max_a[i];
+        f32 lo_b = min_b[i];
+        f32 hi_b = max_b[i];
+        for (u32 first = i + 1; first < s->count; first += SAP_SWEEP_BLOCK) {
+            u32 m = s->count - first < SAP_SWEEP_BLOCK ? s->count - first : SAP_SWEEP_BLOCK;
+            u32 any = 0;
+            for (u32 k = 0; k < m; ++k) {
+                u32 j = first + k;
+                hit[k] = (min_s[j] <= limit) & (lo_a <= max_a[j]) & (hi_a >= min_a[j])
+                    & (lo_b <= max_b[j]) & (hi_b >= min_b[j]);
+                any |= hit[k];
+            }
+            for (u32 k = 0; any && k < m; ++k) {
+                if (!hit[k]) {
+                    continue;
+                }
+                u32 a = s->order[i];
+                u32 b = s->order[first + k];
+                batch[n].a = a < b ? a : b;
+                batch[n].b = a < b ? b : a;
+                if (++n == SAP_PAIR_BATCH) {
+                    sap_flush(job, batch, n);
+                    n = 0;
+                }
+            }
+            // Sorted on min, so the rest of the run starts past the limit.
+            if (min_s[first + m - 1] > limit) {
+                break;
+            }
+        }
+    }
+    if (n) {
+        sap_flush(job, batch, n);
+    }
+}
+
+// Sorts the bodies and writes the overlapping pairs, in no particular
+// order. Body indices must stay the same from frame to frame; a change in
+// count starts over. Returns the total number of pairs, of which the
+// first max_pairs are written.
+u32 sap_update(sap* s, const aabb3* bounds, const u32 count, sap_pair* pairs, const u32 max_pairs) {
+    if (count > s->capacity) {
+        return 0;
+    }
+    sap_job job;
+    job.s = s;
+    job.bounds = bounds;
+    job.pairs = pairs;
+    job.max_pairs = max_pairs;
+    job.pair_count = 0;
+
+    b32 restart = !s->valid || count != s->count;
+    if (restart) {
+        s->count = count;
+        s->axis = sap_choose_axis(bounds, count);
+        for (u32 i = 0; i < count; ++i) {
+            s->order[i] = i;
+        }
+    }
+    parallel_for(count, SAP_GRAIN, sap_keys_task, &job);
+    s->full_sort = restart || !sap_insertion_sort(s);
+    if (s->full_sort) {
+        sap_radix_sort(&job);
+    }
+    s->valid = 1;
+
+    parallel_for(count, SAP_GRAIN, sap_gather_task, &job);
+    parallel_for(count, SAP_GRAIN, sap_sweep_task, &job);
+    return job.pair_count;
+}
+
+#endif
+#endif
@@ -0,0 +1,477 @@
+#ifndef YS_SDF_H
+#define YS_SDF_H
+
+#include <math.h>
+#include "ys_bvh.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Cells per side of a brick. A brick stores (SDF_BRICK_SIZE + 1)^3 samples
+// on the cell corners: the last row repeats the first row of the next
+// brick, so interpolation never has to leave the brick.
+#define SDF_BRICK_SIZE 8
+#define SDF_BRICK_SAMPLES (SDF_BRICK_SIZE + 1)
+#define SDF_BRICK_VALUES (SDF_BRICK_SAMPLES * SDF_BRICK_SAMPLES * SDF_BRICK_SAMPLES)
+#define SDF_BRICK_EMPTY 0xFFFFFFFFu
+
+// Sphere tracing gives up after SDF_MAX_STEPS and reports a hit closer
+// than SDF_HIT_EPSILON cells to the surface.
+#define SDF_MAX_STEPS 256
+#define SDF_HIT_EPSILON 0.05f
+
+// Coarse cells and bricks per parallel_for chunk while baking.
+#define SDF_CELL_GRAIN 16
+#define SDF_BRICK_GRAIN 1
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Sparse signed distance volume over a coarse grid of bricks, laid out
+// like brick_grid. Only bricks the surface may come within `band` of
+// store samples; every other coarse cell keeps a single conservative
+// value: the distance of its closest point to the surface, signed by
+// the side it is on. Distances are negative inside the mesh.
+typedef struct sdf_volume {
+    u32* bricks;      // brick slot per coarse cell or SDF_BRICK_EMPTY
+    f32* coarse;      // bound per coarse cell without a brick
+    f32* values;      // SDF_BRICK_VALUES per allocated brick, x fastest
+    u32 brick_count;
+    u32 brick_capacity;
+    i32 dims[3];      // in bricks
+    point3 origin;
+    f32 cell_size;    // distance between samples
+    f32 band;
+} sdf_volume;
+
+
+/*
+ * === SDF INTERFACE ===
+*/
+b32 sdf_create(sdf_volume* s, const i32 dims[3], const point3 origin, const f32 cell_size, const f32 band,
+        const u32 max_bricks);
+void sdf_free(sdf_volume* s);
+b32 sdf_bake(sdf_volume* s, const bvh* b, const point3* positions, const u32 vertex_count,
+        const u32* indices, const u32 tri_count);
+f32 sdf_distance(const sdf_volume* s, const point3 p);
+vec3 sdf_gradient(const sdf_volume* s, const point3 p);
+b32 sdf_raycast(const sdf_volume* s, const ray3 r, const f32 t_max, f32* t_hit);
+f32 sdf_soft_shadow(const sdf_volume* s, const ray3 r, const f32 t_min, const f32 t_max, const f32 k);
+
+
+#ifdef YS_SDF_IMPLEMENTATION
+
+b32 sdf_create(sdf_volume* s, const i32 dims[3], const point3 origin, const f32 cell_size, const f32 band,
+        const u32 max_bricks) {
+    u64 cells = (u64)dims[0] * dims[1] * dims[2];
+    s->bricks = (u32*)YS_MALLOC(sizeof(u32) * (cells > 0 ? cells : 1));
+    s->coarse = (f32*)YS_MALLOC(sizeof(f32) * (cells > 0 ? cells : 1));
+    s->values = (f32*)YS_MALLOC(sizeof(f32) * SDF_BRICK_VALUES * (max_bricks > 0 ? max_bricks : 1));
+    if (!s->bricks || !s->coarse || !s->values) {
+        sdf_free(s);
+        return 0;
+    }
+    for (u64 i = 0; i < cells; ++i) {
+        s->bricks[i] = SDF_BRICK_EMPTY;
+        s->coarse[i] = FLT_MAX;
+    }
+    for (int i = 0; i < 3; ++i) {
+        s->dims[i] = dims[i];
+    }
+    s->brick_count = 0;
+    s->brick_capacity = max_bricks;
+    s->origin = origin;
+    s->cell_size = cell_size;
+    s->band = band;
+    return 1;
+}
+
+void sdf_free(sdf_volume* s) {
+    YS_FREE(s->bricks);
+    YS_FREE(s->coarse);
+    YS_FREE(s->values);
+    s->bricks = 0;
+    s->coarse = 0;
+    s->values = 0;
+    s->brick_count = 0;
+}
+
+static aabb3 sdf_bounds(const sdf_volume* s) {
+    f32 size = s->cell_size * SDF_BRICK_SIZE;
+    aabb3 box;
+    box.min = s->origin;
+    box.max.x = s->origin.x + s->dims[0] * size;
+    box.max.y = s->origin.y + s->dims[1] * size;
+    box.max.z = s->origin.z + s->dims[2] * size;
+    return box;
+}
+
+
+/*
+ * ==== PSEUDO NORMALS =======
+*/
+
+// Angle weighted pseudo normals (Baerentzen and Aanaes) of the faces, the
+// edges and the vertices of the mesh. The sign of p is the side of the
+// pseudo normal of the feature holding its closest point, which is exact
+// for closed, consistently wound meshes even at edges and vertices.
+typedef struct sdf_normals {
+    vec3* face;     // per triangle
+    vec3* edge;     // per triangle corner, for the edge opposite of it
+    vec3* vertex;   // per vertex
+} sdf_normals;
+
+static void sdf_normals_free(sdf_normals* n) {
+    YS_FREE(n->face);
+    YS_FREE(n->edge);
+    YS_FREE(n->vertex);
+}
+
+static u32 sdf_edge_hash(const u64 key, const u32 mask) {
+    return (u32)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+// Triangles are expected counter-clockwise seen from outside.
+static b32 sdf_normals_build(sdf_normals* n, const point3* positions, const u32 vertex_count,
+        const u32* indices, const u32 tri_count) {
+    u32 table_size = 1;
+    while (table_size < tri_count * 6 && table_size < 0x80000000u) {
+        table_size <<= 1;
+    }
+    n->face = (vec3*)YS_MALLOC(sizeof(vec3) * (tri_count > 0 ? tri_count : 1));
+    n->edge = (vec3*)YS_MALLOC(sizeof(vec3) * 3 * (tri_count > 0 ? tri_count : 1));
+    n->vertex = (vec3*)YS_MALLOC(sizeof(vec3) * (vertex_count > 0 ? vertex_count : 1));
+    u64* keys = (u64*)YS_MALLOC(sizeof(u64) * table_size);
+    vec3* sums = (vec3*)YS_MALLOC(sizeof(vec3) * table_size);
+    u32* slots = (u32*)YS_MALLOC(sizeof(u32) * 3 * (tri_count > 0 ? tri_count : 1));
+    if (!n->face || !n->edge || !n->vertex || !keys || !sums || !slots) {
+        sdf_normals_free(n);
+        YS_FREE(keys);
+        YS_FREE(sums);
+        YS_FREE(slots);
+        return 0;
+    }
+
+    vec3 zero = {{0.0f, 0.0f, 0.0f}};
+    for (u32 i = 0; i < vertex_count; ++i) {
+        n->vertex[i] = zero;
+    }
+    for (u32 i = 0; i < table_size; ++i) {
+        keys[i] = ~0ull;
+        sums[i] = zero;
+    }
+    for (u32 t = 0; t < tri_count; ++t) {
+        const u32* tri = indices + t * 3;
+        vec3 normal = vec3_cross(vec3_sub(positions[tri[1]], positions[tri[0]]),
+            vec3_sub(positions[tri[2]], positions[tri[0]]));
+        f32 len = vec3_len(normal);
+        normal = len > 0 ? vec3_mul_s(normal, 1.0f / len) : zero;
+        n->face[t] = normal;
+        for (u32 k = 0; k < 3; ++k) {
+            // Corner angle for the vertex normal.
+            vec3 e1 = vec3_sub(positions[tri[(k + 1) % 3]], positions[tri[k]]);
+            vec3 e2 = vec3_sub(positions[tri[(k + 2) % 3]], positions[tri[k]]);
+            f32 l1 = vec3_len(e1);
+            f32 l2 = vec3_len(e2);
+            f32 c = l1 > 0 && l2 > 0 ? vec3_dot(e1, e2) / (l1 * l2) : 1.0f;
+            c = c < -1.0f ? -1.0f : c > 1.0f ? 1.0f : c;
+            n->vertex[tri[k]] = vec3_add(n->vertex[tri[k]], vec3_mul_s(normal, acosf(c)));
+
+            // Both faces of an edge add to one entry; the pi weights cancel.
+            u32 a = tri[(k + 1) % 3];
+            u32 b = tri[(k + 2) % 3];
+            u64 key = a < b ? (u64)a | ((u64)b << 32) : (u64)b | ((u64)a << 32);
+            u32 slot = sdf_edge_hash(key, table_size - 1);
+            while (keys[slot] != key && keys[slot] != ~0ull) {
+                slot = (slot + 1) & (table_size - 1);
+            }
+            keys[slot] = key;
+            sums[slot] = vec3_add(sums[slot], normal);
+            slots[t * 3 + k] = slot;
+        }
+    }
+    for (u32 i = 0; i < tri_count * 3; ++i) {
+        n->edge[i] = sums[slots[i]];
+    }
+    YS_FREE(keys);
+    YS_FREE(sums);
+    YS_FREE(slots);
+    return 1;
+}
+
+// Signed distance from the closest point query of p. A zero weight puts
+// the point on the opposite edge, two put it on the remaining vertex.
+static f32 sdf_signed(const sdf_normals* n, const u32* indices, const bvh_point_hit* hit, const point3 p) {
+    u32 zeros = (hit->bary[0] == 0) + (hit->bary[1] == 0) + (hit->bary[2] == 0);
+    vec3 pseudo = n->face[hit->prim];
+    if (zeros == 1) {
+        u32 k = hit->bary[0] == 0 ? 0 : hit->bary[1] == 0 ? 1 : 2;
+        pseudo = n->edge[hit->prim * 3 + k];
+    } else if (zeros >= 2) {
+        u32 k = hit->bary[0] != 0 ? 0 : hit->bary[1] != 0 ? 1 : 2;
+        pseudo = n->vertex[indices[hit->prim * 3 + k]];
+    }
+    f32 d = SQRTF(hit->dist_sq);
+    return vec3_dot(vec3_sub(p, hit->point), pseudo) < 0 ? -d : d;
+}
+
+
+/*
+ * ==== BAKE =======
+*/
+
+typedef struct sdf_job {
+    sdf_volume* s;
+    const bvh* b;
+    const point3* positions;
+    const u32* indices;
+    sdf_normals normals;
+    u32* brick_cells;   // coarse cell of each allocated brick
+} sdf_job;
+
+// Signed distance at p, FLT_MAX without triangles.
+static f32 sdf_query(const sdf_job* job, const point3 p) {
+    bvh_point_hit hit;
+    if (!bvh_closest_point(job->b, job->positions, job->indices, p, FLT_MAX, &hit)) {
+        return FLT_MAX;
+    }
+    return sdf_signed(&job->normals, job->indices, &hit, p);
+}
+
+// Distance at the center of every coarse cell. Cells the surface may be
+// within `band` of get a brick. Every cell keeps the center distance
+// shrunk by the half diagonal, a bound for every point of the cell, which
+// is what a volume left without bricks answers with.
+static void sdf_cell_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    sdf_job* job = (sdf_job*)ctx;
+    sdf_volume* s = job->s;
+    (void)thread;
+    f32 size = s->cell_size * SDF_BRICK_SIZE;
+    f32 half_diagonal = 0.5f * SQRTF(3.0f) * size;
+    for (u32 i = begin; i < end; ++i) {
+        u32 x = i % (u32)s->dims[0];
+        u32 y = (i / (u32)s->dims[0]) % (u32)s->dims[1];
+        u32 z = i / ((u32)s->dims[0] * (u32)s->dims[1]);
+        point3 center;
+        center.x = s->origin.x + (x + 0.5f) * size;
+        center.y = s->origin.y + (y + 0.5f) * size;
+        center.z = s->origin.z + (z + 0.5f) * size;
+        f32 d = sdf_query(job, center);
+        f32 bound = fabsf(d) - half_diagonal;
+        s->bricks[i] = bound < s->band ? 0 : SDF_BRICK_EMPTY;
+        bound = bound > 0 ? bound : 0.0f;
+        s->coarse[i] = d < 0 ? -bound : bound;
+    }
+}
+
+static void sdf_brick_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    sdf_job* job = (sdf_job*)ctx;
+    sdf_volume* s = job->s;
+    (void)thread;
+    for (u32 slot = begin; slot < end; ++slot) {
+        u32 cell = job->brick_cells[slot];
+        u32 bx = cell % (u32)s->dims[0];
+        u32 by = (cell / (u32)s->dims[0]) % (u32)s->dims[1];
+        u32 bz = cell / ((u32)s->dims[0] * (u32)s->dims[1]);
+        f32* values = s->values + (u64)slot * SDF_BRICK_VALUES;
+        for (u32 z = 0; z < SDF_BRICK_SAMPLES; ++z) {
+            for (u32 y = 0; y < SDF_BRICK_SAMPLES; ++y) {
+                for (u32 x = 0; x < SDF_BRICK_SAMPLES; ++x) {
+                    point3 p;
+                    p.x = s->origin.x + (bx * SDF_BRICK_SIZE + x) * s->cell_size;
+                    p.y = s->origin.y + (by * SDF_BRICK_SIZE + y) * s->cell_size;
+                    p.z = s->origin.z + (bz * SDF_BRICK_SIZE + z) * s->cell_size;
+                    values[x + SDF_BRICK_SAMPLES * (y + SDF_BRICK_SAMPLES * z)] = sdf_query(job, p);
+                }
+            }
+        }
+    }
+}
+
+// Bakes the indexed triangles, with `b` built over their bounds, into the
+// volume. Cells and bricks are filled in parallel. Returns 0 when the
+// surface needs more than max_bricks bricks or memory runs out; the
+// volume is then left without bricks, answering with the conservative
+// per cell bounds.
+b32 sdf_bake(sdf_volume* s, const bvh* b, const point3* positions, const u32 vertex_count,
+        const u32* indices, const u32 tri_count) {
+    sdf_job job;
+    job.s = s;
+    job.b = b;
+    job.positions = positions;
+    job.indices = indices;
+    job.brick_cells = 0;
+    if (!sdf_normals_build(&job.normals, positions, vertex_count, indices, tri_count)) {
+        return 0;
+    }
+
+    u32 cells = (u32)s->dims[0] * (u32)s->dims[1] * (u32)s->dims[2];
+    parallel_for(cells, SDF_CELL_GRAIN, sdf_cell_task, &job);
+    u32 count = 0;
+    for (u32 i = 0; i < cells; ++i) {
+        count += s->bricks[i] != SDF_BRICK_EMPTY;
+    }
+    if (count <= s->brick_capacity) {
+        job.brick_cells = (u32*)YS_MALLOC(sizeof(u32) * (count > 0 ? count : 1));
+    }
+    if (!job.brick_cells) {
+        for (u32 i = 0; i < cells; ++i) {
+            s->bricks[i] = SDF_BRICK_EMPTY;
+        }
+        s->brick_count = 0;
+        sdf_normals_free(&job.normals);
+        return 0;
+    }
+
+    s->brick_count = 0;
+    for (u32 i = 0; i < cells; ++i) {
+        if (s->bricks[i] != SDF_BRICK_EMPTY) {
+            job.brick_cells[s->brick_count] = i;
+            s->bricks[i] = s->brick_count++;
+        }
+    }
+    parallel_for(s->brick_count, SDF_BRICK_GRAIN, sdf_brick_task, &job);
+    YS_FREE(job.brick_cells);
+    sdf_normals_free(&job.normals);
+    return 1;
+}
+
+
+/*
+ * ==== QUERIES =======
+*/
+
+// Trilinear sample inside the volume; p is clamped to the volume box.
+static f32 sdf_sample(const sdf_volume* s, const point3 p) {
+    f32 inv_cell = 1.0f / s->cell_size;
+    i32 cell[3];
+    f32 frac[3];
+    i32 local[3];
+    for (int i = 0; i < 3; ++i) {
+        f32 f = (p.e[i] - s->origin.e[i]) * inv_cell;
+        f32 top = (f32)(s->dims[i] * SDF_BRICK_SIZE);
+        f = f < 0 ? 0 : f > top ? top : f;
+        i32 v = (i32)f;
+        v = v > s->dims[i] * SDF_BRICK_SIZE - 1 ? s->dims[i] * SDF_BRICK_SIZE - 1 : v;
+        cell[i] = v / SDF_BRICK_SIZE;
+        local[i] = v % SDF_BRICK_SIZE;
+        frac[i] = f - (f32)v;
+    }
+    u64 c = (u64)cell[0] + (u64)s->dims[0] * ((u64)cell[1] + (u64)s->dims[1] * cell[2]);
+    u32 slot = s->bricks[c];
+    if (slot == SDF_BRICK_EMPTY) {
+        return s->coarse[c];
+    }
+    const f32* v = s->values + (u64)slot * SDF_BRICK_VALUES
+        + local[0] + SDF_BRICK_SAMPLES * (local[1] + SDF_BRICK_SAMPLES * local[2]);
+    const u32 sy = SDF_BRICK_SAMPLES;
+    const u32 sz = SDF_BRICK_SAMPLES * SDF_BRICK_SAMPLES;
+    f32 c00 = v[0] + (v[1] - v[0]) * frac[0];
+    f32 c10 = v[sy] + (v[sy + 1] - v[sy]) * frac[0];
+    f32 c01 = v[sz] + (v[sz + 1] - v[sz]) * frac[0];
+    f32 c11 = v[sz + sy] + (v[sz + sy + 1] - v[sz + sy]) * frac[0];
+    f32 c0 = c00 + (c10 - c00) * frac[1];
+    f32 c1 = c01 + (c11 - c01) * frac[1];
+    return c0 + (c1 - c0) * frac[2];
+}
+
+// Signed distance at p, negative inside. Inside a brick it is interpolated
+// from the samples; elsewhere it is a bound that never overestimates the
+// distance, so it is always a safe sphere tracing step. Outside the
+// volume it stays a bound, assuming the surface lies inside the volume.
+f32 sdf_distance(const sdf_volume* s, const point3 p) {
+    aabb3 box = sdf_bounds(s);
+    f32 outside = point_aabb3_dist_sq(p, box);
+    if (outside > 0) {
+        outside = SQRTF(outside);
+        f32 inner = sdf_sample(s, closest_point_aabb3(p, box)) - outside;
+        return inner > outside ? inner : outside;
+    }
+    return sdf_sample(s, p);
+}
+
+// Central differences half a cell apart; not normalized.
+vec3 sdf_gradient(const sdf_volume* s, const point3 p) {
+    f32 h = 0.5f * s->cell_size;
+    vec3 g;
+    for (int i = 0; i < 3; ++i) {
+        point3 a = p;
+        point3 b = p;
+        a.e[i] += h;
+        b.e[i] -= h;
+        g.e[i] = (sdf_distance(s, a) - sdf_distance(s, b)) / (2.0f * h);
+    }
+    return g;
+}
+
+// Range of t where the ray is inside the volume box, up to t_max.
+static b32 sdf_clip(const sdf_volume* s, const ray3 r, const f32 t_max, f32* t_enter, f32* t_exit) {
+    aabb3 box = sdf_bounds(s);
+    vec3 inv = ray3_inv_dir(r);
+    if (!ray3_aabb3(r, inv, box, t_max, t_enter)) {
+        return 0;
+    }
+    *t_exit = t_max;
+    for (int i = 0; i < 3; ++i) {
+        f32 a = (box.min.e[i] - r.origin.e[i]) * inv.e[i];
+        f32 b = (box.max.e[i] - r.origin.e[i]) * inv.e[i];
+        f32 exit = a > b ? a : b;
+        *t_exit = exit < *t_exit ? exit : *t_exit;
+    }
+    return 1;
+}
+
+// Sphere traces the ray through the volume. t_hit is where the ray first
+// comes within SDF_HIT_EPSILON cells of the surface; rays starting inside
+// the mesh hit at their first step.
+b32 sdf_raycast(const sdf_volume* s, const ray3 r, const f32 t_max, f32* t_hit) {
+    f32 t, t_end;
+    if (!sdf_clip(s, r, t_max, &t, &t_end)) {
+        return 0;
+    }
+
+    f32 inv_len = 1.0f / vec3_len(r.dir);
+    f32 eps = SDF_HIT_EPSILON * s->cell_size;
+    for (u32 i = 0; i < SDF_MAX_STEPS && t <= t_end; ++i) {
+        f32 d = sdf_distance(s, ray3_at(r, t));
+        if (d < eps) {
+            *t_hit = t;
+            return 1;
+        }
+        t += d * inv_len;
+    }
+    return 0;
+}
+
+// Penumbra estimate in [0, 1] along a shadow ray: 0 when the ray hits the
+// surface, otherwise the smallest k * d / t seen while sphere tracing, so
+// rays grazing the surface give soft edges. Larger k gives harder
+// shadows; t_min keeps the ray off the surface it starts on. Only the
+// part of the ray inside the volume is traced.
+f32 sdf_soft_shadow(const sdf_volume* s, const ray3 r, const f32 t_min, const f32 t_max, const f32 k) {
+    f32 len = vec3_len(r.dir);
+    f32 eps = SDF_HIT_EPSILON * s->cell_size;
+    f32 shade = 1.0f;
+    f32 t, t_end;
+    if (!sdf_clip(s, r, t_max, &t, &t_end)) {
+        return shade;
+    }
+    t = t < t_min ? t_min : t;
+    for (u32 i = 0; i < SDF_MAX_STEPS && t < t_end; ++i) {
+        f32 d = sdf_distance(s, ray3_at(r, t));
+        if (d < eps) {
+            return 0.0f;
+        }
+        f32 penumbra = k * d / (t * len);
+        shade = penumbra < shade ? penumbra : shade;
+        t += d / len;
+    }
+    return shade;
+}
+
+#endif
+#endif
@@ -0,0 +1,746 @@
+#ifndef YS_SIMPLIFY_H
+#define YS_SIMPLIFY_H
+
+#include <math.h>
+#include "ys_mesh.h"
+#include "ys_morton.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Triangles per partition of the parallel pass. Meshes with fewer than two
+// partitions worth are simplified in one piece.
+#define SIMPLIFY_PARTITION_TRIS 8192
+
+// Weight of the planes that hold open borders in place, relative to the
+// faces along them.
+#define SIMPLIFY_BOUNDARY_WEIGHT 10.0f
+
+// Cosine of the largest turn a triangle may take in one collapse. Flips
+// and slivers turn further.
+#define SIMPLIFY_MIN_COS 0.25f
+
+// Vertices with more neighbours than this are never collapsed.
+#define SIMPLIFY_MAX_RING 64
+
+// Vertices per parallel_for chunk when building the quadrics.
+#define SIMPLIFY_VERTEX_GRAIN 4096
+
+/*
+ * === SIMPLIFY INTERFACE ===
+*/
+b32 simplify_mesh(mesh* m, const u32 target_index_count, const f32 max_error);
+
+
+#ifdef YS_SIMPLIFY_IMPLEMENTATION
+
+#define SIMPLIFY_REMOVED 0xFFFFFFFFu
+#define SIMPLIFY_SHARED 0xFFFFFFFEu
+#define SIMPLIFY_ANY 0xFFFFFFFDu
+
+// Morton key bits used to bin triangles into partitions.
+#define SIMPLIFY_BUCKET_BITS 12
+
+/*
+ * ==== QUADRICS =======
+*/
+
+// Garland-Heckbert error quadric: the upper triangle of the symmetric mat4
+// summing n n^T over the planes n = (a, b, c, d), so 10 floats instead of
+// 16. `area` is the total face area, to turn the sum into a mean squared
+// distance.
+typedef struct simplify_quadric {
+    f32 xx, xy, xz, xw;
+    f32 yy, yz, yw;
+    f32 zz, zw;
+    f32 ww;
+    f32 area;
+} simplify_quadric;
+
+static void simplify_quadric_add_plane(simplify_quadric* q, const vec3 n, const f32 d, const f32 w) {
+    q->xx += w * n.x * n.x;
+    q->xy += w * n.x * n.y;
+    q->xz += w * n.x * n.z;
+    q->xw += w * n.x * d;
+    q->yy += w * n.y * n.y;
+    q->yz += w * n.y * n.z;
+    q->yw += w * n.y * d;
+    q->zz += w * n.z * n.z;
+    q->zw += w * n.z * d;
+    q->ww += w * d * d;
+}
+
+static simplify_quadric simplify_quadric_add(const simplify_quadric* a, const simplify_quadric* b) {
+    simplify_quadric r;
+    r.xx = a->xx + b->xx;
+    r.xy = a->xy + b->xy;
+    r.xz = a->xz + b->xz;
+    r.xw = a->xw + b->xw;
+    r.yy = a->yy + b->yy;
+    r.yz = a->yz + b->yz;
+    r.yw = a->yw + b->yw;
+    r.zz = a->zz + b->zz;
+    r.zw = a->zw + b->zw;
+    r.ww = a->ww + b->ww;
+    r.area = a->area + b->area;
+    return r;
+}
+
+// Sum of squared distances to the planes, weighted, at p.
+static f32 simplify_quadric_eval(const simplify_quadric* q, const point3 p) {
+    f32 e = q->xx * p.x * p.x + q->yy * p.y * p.y + q->zz * p.z * p.z
+        + 2.0f * (q->xy * p.x * p.y + q->xz * p.x * p.z + q->yz * p.y * p.z)
+        + 2.0f * (q->xw * p.x + q->yw * p.y + q->zw * p.z) + q->ww;
+    return e > 0.0f ? e : 0.0f;
+}
+
+// The product of the 3x3 part with v.
+static vec3 simplify_quadric_mul(const simplify_quadric* q, const vec3 v) {
+    vec3 r;
+    r.x = q->xx * v.x + q->xy * v.y + q->xz * v.z;
+    r.y = q->xy * v.x + q->yy * v.y + q->yz * v.z;
+    r.z = q->xz * v.x + q->yz * v.y + q->zz * v.z;
+    return r;
+}
+
+// Position minimizing q for the collapse of edge ab. Solves the 3x3
+// system by Cramer's rule when it is well conditioned and the minimum is
+// near the edge; flat and creased regions are singular, and then the
+// minimum along the edge is taken instead.
+static point3 simplify_quadric_optimize(const simplify_quadric* q, const point3 a, const point3 b) {
+    f32 c00 = q->yy * q->zz - q->yz * q->yz;
+    f32 c01 = q->xz * q->yz - q->xy * q->zz;
+    f32 c02 = q->xy * q->yz - q->xz * q->yy;
+    f32 det = q->xx * c00 + q->xy * c01 + q->xz * c02;
+    f32 trace = q->xx + q->yy + q->zz;
+    vec3 d = vec3_sub(b, a);
+    if (fabsf(det) > 1e-3f * trace * trace * trace) {
+        f32 c11 = q->xx * q->zz - q->xz * q->xz;
+        f32 c12 = q->xy * q->xz - q->xx * q->yz;
+        f32 c22 = q->xx * q->yy - q->xy * q->xy;
+        f32 inv = -1.0f / det;
+        point3 p;
+        p.x = (c00 * q->xw + c01 * q->yw + c02 * q->zw) * inv;
+        p.y = (c01 * q->xw + c11 * q->yw + c12 * q->zw) * inv;
+        p.z = (c02 * q->xw + c12 * q->yw + c22 * q->zw) * inv;
+        vec3 mid = vec3_sub(p, vec3_mul_s(vec3_add(a, b), 0.5f));
+        if (vec3_len_sq(mid) <= 4.0f * vec3_len_sq(d)) {
+            return p;
+        }
+    }
+    // f(a + t d) is a parabola in t.
+    vec3 w = {{q->xw, q->yw, q->zw}};
+    vec3 grad = vec3_add(simplify_quadric_mul(q, a), w);
+    f32 curvature = vec3_dot(d, simplify_quadric_mul(q, d));
+    f32 t = curvature > 0.0f ? -vec3_dot(grad, d) / curvature : 0.5f;
+    t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+    return vec3_add(a, vec3_mul_s(d, t));
+}
+
+
+/*
+ * ==== COLLAPSE =======
+*/
+
+typedef struct simplify_job {
+    point3* points;          // positions centered and scaled to a unit box
+    simplify_quadric* quadrics;
+    u32* tris;               // corners, rewritten as vertices collapse
+    u8* dead;
+    u32* corner_next;        // per vertex lists of corners
+    u32* corner_head;
+    u32* corner_tail;
+    u32* versions;           // bumped on every collapse, SIMPLIFY_REMOVED once gone
+    u32* owner;              // partition of a vertex, or SIMPLIFY_SHARED
+    u32* part_tris;
+    u32* part_start;
+    u32* part_targets;
+    const mesh_adjacency* a;
+    f32 max_cost;            // max_error squared
+    u32 failed;
+} simplify_job;
+
+typedef struct simplify_edge {
+    f32 cost;
+    u32 u;
+    u32 v;
+    u32 version_u;
+    u32 version_v;
+} simplify_edge;
+
+// Binary min heap on cost. Entries are never updated: a collapse bumps
+// the versions of its vertices, and entries with older versions are
+// skipped when they come up.
+typedef struct simplify_heap {
+    simplify_edge* edges;
+    u32 count;
+    u32 capacity;
+} simplify_heap;
+
+static void simplify_heap_sift_down(simplify_heap* h, u32 i) {
+    simplify_edge e = h->edges[i];
+    for (;;) {
+        u32 child = i * 2 + 1;
+        if (child >= h->count) {
+            break;
+        }
+        if (child + 1 < h->count && h->edges[child + 1].cost < h->edges[child].cost) {
+            ++child;
+        }
+        if (h->edges[child].cost >= e.cost) {
+            break;
+        }
+        h->edges[i] = h->edges[child];
+        i = child;
+    }
+    h->edges[i] = e;
+}
+
+static b32 simplify_heap_push(simplify_heap* h, const simplify_edge e) {
+    if (h->count == h->capacity) {
+        u32 capacity = h->capacity * 2;
+        simplify_edge* edges = (simplify_edge*)YS_MALLOC(sizeof(simplify_edge) * capacity);
+        if (!edges) {
+            return 0;
+        }
+        for (u32 i = 0; i < h->count; ++i) {
+            edges[i] = h->edges[i];
+        }
+        YS_FREE(h->edges);
+        h->edges = edges;
+        h->capacity = capacity;
+    }
+    u32 i = h->count++;
+    while (i > 0 && h->edges[(i - 1) / 2].cost > e.cost) {
+        h->edges[i] = h->edges[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->edges[i] = e;
+    return 1;
+}
+
+static simplify_edge simplify_heap_pop(simplify_heap* h) {
+    simplify_edge top = h->edges[0];
+    h->edges[0] = h->edges[--h->count];
+    if (h->count > 0) {
+        simplify_heap_sift_down(h, 0);
+    }
+    return top;
+}
+
+static b32 simplify_eligible(const simplify_job* job, const u32 x, const u32 part) {
+    return job->versions[x] != SIMPLIFY_REMOVED && (part == SIMPLIFY_ANY || job->owner[x] == part);
+}
+
+// The cost of a collapse is the quadric error at the new position over
+// the face area of both quadrics: the area weighted mean squared distance
+// to the planes of the faces around u and v, plus the border terms.
+static simplify_edge simplify_edge_make(const simplify_job* job, const u32 u, const u32 v) {
+    simplify_quadric q = simplify_quadric_add(&job->quadrics[u], &job->quadrics[v]);
+    point3 p = simplify_quadric_optimize(&q, job->points[u], job->points[v]);
+    simplify_edge e;
+    e.cost = simplify_quadric_eval(&q, p) / (q.area > 0.0f ? q.area : 1.0f);
+    e.u = u;
+    e.v = v;
+    e.version_u = job->versions[u];
+    e.version_v = job->versions[v];
+    return e;
+}
+
+// Neighbours of a vertex over its live triangles, each with the number of
+// triangles sharing that edge: 1 on an open border.
+typedef struct simplify_ring {
+    u32 vertices[SIMPLIFY_MAX_RING];
+    u32 counts[SIMPLIFY_MAX_RING];
+    u32 count;
+    b32 boundary;
+} simplify_ring;
+
+static b32 simplify_ring_build(const simplify_job* job, const u32 x, simplify_ring* r) {
+    r->count = 0;
+    r->boundary = 0;
+    for (u32 c = job->corner_head[x]; c != SIMPLIFY_REMOVED; c = job->corner_next[c]) {
+        u32 t = c / 3;
+        if (job->dead[t]) {
+            continue;
+        }
+        for (u32 k = 1; k < 3; ++k) {
+            u32 w = job->tris[t * 3 + (c % 3 + k) % 3];
+            u32 i = 0;
+            while (i < r->count && r->vertices[i] != w) {
+                ++i;
+            }
+            if (i == r->count) {
+                if (r->count == SIMPLIFY_MAX_RING) {
+                    return 0;
+                }
+                r->vertices[r->count] = w;
+                r->counts[r->count++] = 0;
+            }
+            ++r->counts[i];
+        }
+    }
+    for (u32 i = 0; i < r->count; ++i) {
+        r->boundary |= r->counts[i] == 1;
+    }
+    return 1;
+}
+
+static u32 simplify_ring_find(const simplify_ring* r, const u32 w) {
+    for (u32 i = 0; i < r->count; ++i) {
+        if (r->vertices[i] == w) {
+            return i;
+        }
+    }
+    return SIMPLIFY_REMOVED;
+}
+
+// No triangle around x, other than those on edge uv, may turn by more
+// than acos(SIMPLIFY_MIN_COS) or degenerate when x moves to p.
+static b32 simplify_keeps_orientation(const simplify_job* job, const u32 x, const u32 u, const u32 v,
+        const point3 p) {
+    for (u32 c = job->corner_head[x]; c != SIMPLIFY_REMOVED; c = job->corner_next[c]) {
+        u32 t = c / 3;
+        const u32* tri = job->tris + t * 3;
+        if (job->dead[t] || ((tri[0] == u || tri[1] == u || tri[2] == u)
+                && (tri[0] == v || tri[1] == v || tri[2] == v))) {
+            continue;
+        }
+        point3 a = job->points[tri[c % 3]];
+        point3 b = job->points[tri[(c % 3 + 1) % 3]];
+        point3 d = job->points[tri[(c % 3 + 2) % 3]];
+        vec3 before = vec3_cross(vec3_sub(b, a), vec3_sub(d, a));
+        vec3 after = vec3_cross(vec3_sub(b, p), vec3_sub(d, p));
+        f32 cos_sq = vec3_dot(before, after);
+        cos_sq = cos_sq > 0.0f ? cos_sq * cos_sq : 0.0f;
+        if (cos_sq <= SIMPLIFY_MIN_COS * SIMPLIFY_MIN_COS * vec3_len_sq(before) * vec3_len_sq(after)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Moves v onto u at the optimal position when the collapse keeps the
+// surface manifold and no triangle turns too far. Returns the triangles
+// removed.
+static u32 simplify_collapse(simplify_job* job, const u32 u, const u32 v) {
+    simplify_ring ru, rv;
+    if (!simplify_ring_build(job, u, &ru) || !simplify_ring_build(job, v, &rv)) {
+        return 0;
+    }
+    u32 i = simplify_ring_find(&ru, v);
+    u32 shared = i != SIMPLIFY_REMOVED ? ru.counts[i] : 0;
+    if (shared == 0 || shared > 2 || (shared == 2 && ru.boundary && rv.boundary)) {
+        return 0;
+    }
+    // Link condition: the only common neighbours are the opposite corners
+    // of the triangles on the edge, and a closed fan keeps three or more.
+    u32 common = 0;
+    for (u32 k = 0; k < ru.count; ++k) {
+        common += ru.vertices[k] != v && simplify_ring_find(&rv, ru.vertices[k]) != SIMPLIFY_REMOVED;
+    }
+    if (common != shared || (!ru.boundary && !rv.boundary && ru.count + rv.count - common - 2 < 3)) {
+        return 0;
+    }
+
+    simplify_quadric q = simplify_quadric_add(&job->quadrics[u], &job->quadrics[v]);
+    point3 p = simplify_quadric_optimize(&q, job->points[u], job->points[v]);
+    if (!simplify_keeps_orientation(job, u, u, v, p) || !simplify_keeps_orientation(job, v, u, v, p)) {
+        return 0;
+    }
+
+    u32 removed = 0;
+    for (u32 c = job->corner_head[v]; c != SIMPLIFY_REMOVED; c = job->corner_next[c]) {
+        u32 t = c / 3;
+        u32* tri = job->tris + t * 3;
+        if (job->dead[t]) {
+            continue;
+        }
+        if (tri[0] == u || tri[1] == u || tri[2] == u) {
+            job->dead[t] = 1;
+            ++removed;
+        } else {
+            tri[c % 3] = u;
+        }
+    }
+    // Both lists become the list of u, without the dead triangles that
+    // would otherwise pile up on the survivors.
+    u32 head = SIMPLIFY_REMOVED, tail = SIMPLIFY_REMOVED;
+    for (u32 list = 0; list < 2; ++list) {
+        u32 c = job->corner_head[list == 0 ? u : v];
+        while (c != SIMPLIFY_REMOVED) {
+            u32 next = job->corner_next[c];
+            if (!job->dead[c / 3]) {
+                if (tail == SIMPLIFY_REMOVED) {
+                    head = c;
+                } else {
+                    job->corner_next[tail] = c;
+                }
+                tail = c;
+            }
+            c = next;
+        }
+    }
+    if (tail != SIMPLIFY_REMOVED) {
+        job->corner_next[tail] = SIMPLIFY_REMOVED;
+    }
+    job->corner_head[u] = head;
+    job->corner_tail[u] = tail;
+    job->corner_head[v] = SIMPLIFY_REMOVED;
+    job->points[u] = p;
+    job->quadrics[u] = q;
+    ++job->versions[u];
+    job->versions[v] = SIMPLIFY_REMOVED;
+    return removed;
+}
+
+// Greedy cheapest-first collapses among the live triangles listed, until
+// `target` remain or the next collapse costs more than max_cost. Only
+// vertices eligible for `part` move.
+static void simplify_pass(simplify_job* job, const u32* tris, const u32 tri_count, const u32 part,
+        const u32 target) {
+    simplify_heap h;
+    h.count = 0;
+    h.capacity = tri_count * 3 + 16;
+    h.edges = (simplify_edge*)YS_MALLOC(sizeof(simplify_edge) * h.capacity);
+    if (!h.edges) {
+        atomic_add_u32(&job->failed, 1);
+        return;
+    }
+    // Every edge once per triangle; the second copy finds stale versions
+    // or fails the same checks.
+    for (u32 i = 0; i < tri_count; ++i) {
+        const u32* tri = job->tris + tris[i] * 3;
+        for (u32 k = 0; k < 3; ++k) {
+            u32 a = tri[k], b = tri[(k + 1) % 3];
+            if (simplify_eligible(job, a, part) && simplify_eligible(job, b, part)) {
+                h.edges[h.count++] = simplify_edge_make(job, a < b ? a : b, a < b ? b : a);
+            }
+        }
+    }
+    for (u32 i = h.count / 2; i > 0; --i) {
+        simplify_heap_sift_down(&h, i - 1);
+    }
+
+    u32 live = tri_count;
+    while (live > target && h.count > 0) {
+        simplify_edge e = simplify_heap_pop(&h);
+        if (e.cost > job->max_cost) {
+            break;
+        }
+        if (job->versions[e.u] != e.version_u || job->versions[e.v] != e.version_v) {
+            continue;
+        }
+        u32 removed = simplify_collapse(job, e.u, e.v);
+        if (removed == 0) {
+            continue;
+        }
+        live -= removed;
+        simplify_ring r;
+        if (!simplify_ring_build(job, e.u, &r)) {
+            continue;
+        }
+        for (u32 i = 0; i < r.count; ++i) {
+            u32 w = r.vertices[i];
+            if (simplify_eligible(job, w, part)
+                    && !simplify_heap_push(&h, simplify_edge_make(job, e.u < w ? e.u : w, e.u < w ? w : e.u))) {
+                atomic_add_u32(&job->failed, 1);
+                YS_FREE(h.edges);
+                return;
+            }
+        }
+    }
+    YS_FREE(h.edges);
+}
+
+
+/*
+ * ==== PARALLEL =======
+*/
+
+// Sums the plane of every triangle around a vertex, weighted by area, and
+// a plane perpendicular to each open border edge at the vertex.
+static void simplify_quadric_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    simplify_job* job = (simplify_job*)ctx;
+    const mesh_adjacency* a = job->a;
+    (void)thread;
+    for (u32 v = begin; v < end; ++v) {
+        simplify_quadric q = {0};
+        for (u32 i = a->offsets[v]; i < a->offsets[v + 1]; ++i) {
+            const u32* tri = job->tris + a->triangles[i] * 3;
+            point3 p0 = job->points[tri[0]];
+            vec3 n = vec3_cross(vec3_sub(job->points[tri[1]], p0), vec3_sub(job->points[tri[2]], p0));
+            f32 len = vec3_len(n);
+            if (len == 0.0f) {
+                continue;
+            }
+            n = vec3_mul_s(n, 1.0f / len);
+            simplify_quadric_add_plane(&q, n, -vec3_dot(n, p0), 0.5f * len);
+            q.area += 0.5f * len;
+
+            u32 corner = tri[0] == v ? 0 : tri[1] == v ? 1 : 2;
+            for (u32 k = 1; k < 3; ++k) {
+                u32 w = tri[(corner + k) % 3];
+                u32 uses = 0;
+                for (u32 j = a->offsets[v]; j < a->offsets[v + 1]; ++j) {
+                    const u32* other = job->tris + a->triangles[j] * 3;
+                    uses += other[0] == w || other[1] == w || other[2] == w;
+                }
+                if (uses == 1) {
+                    vec3 e = vec3_sub(job->points[w], job->points[v]);
+                    vec3 b = vec3_cross(e, n);
+                    f32 b_len = vec3_len(b);
+                    if (b_len > 0.0f) {
+                        b = vec3_mul_s(b, 1.0f / b_len);
+                        simplify_quadric_add_plane(&q, b, -vec3_dot(b, job->points[v]),
+                            SIMPLIFY_BOUNDARY_WEIGHT * vec3_len_sq(e));
+                    }
+                }
+            }
+        }
+        job->quadrics[v] = q;
+    }
+}
+
+static void simplify_part_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    simplify_job* job = (simplify_job*)ctx;
+    (void)thread;
+    for (u32 p = begin; p < end; ++p) {
+        simplify_pass(job, job->part_tris + job->part_start[p], job->part_start[p + 1] - job->part_start[p],
+            p, job->part_targets[p]);
+    }
+}
+
+// Sorts the triangles along a Morton curve through their centroids, by
+// the top bits of the key, and cuts the order into partitions of about
+// equal size. A vertex used by one partition only belongs to it; the
+// others are shared and stay put during the parallel pass. Returns the
+// partition count, or 0 when out of memory.
+static u32 simplify_partition(simplify_job* job, const u32 tri_count, const u32 vertex_count, const u32 target) {
+    u32 buckets = 1u << SIMPLIFY_BUCKET_BITS;
+    u32 parts = tri_count / SIMPLIFY_PARTITION_TRIS;
+    parts = parts > buckets ? buckets : parts;
+    point3* centroids = (point3*)YS_MALLOC(sizeof(point3) * tri_count);
+    u64* keys = (u64*)YS_MALLOC(sizeof(u64) * tri_count);
+    u32* bucket_start = (u32*)YS_MALLOC(sizeof(u32) * (buckets + 1));
+    job->part_start = (u32*)YS_MALLOC(sizeof(u32) * (parts + 1));
+    job->part_targets = (u32*)YS_MALLOC(sizeof(u32) * parts);
+    if (!centroids || !keys || !bucket_start || !job->part_start || !job->part_targets) {
+        YS_FREE(centroids);
+        YS_FREE(keys);
+        YS_FREE(bucket_start);
+        return 0;
+    }
+    point3 lo = {{FLT_MAX, FLT_MAX, FLT_MAX}};
+    point3 hi = {{-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+    for (u32 t = 0; t < tri_count; ++t) {
+        const u32* tri = job->tris + t * 3;
+        point3 c = vec3_mul_s(vec3_add(vec3_add(job->points[tri[0]], job->points[tri[1]]), job->points[tri[2]]),
+            1.0f / 3.0f);
+        centroids[t] = c;
+        for (u32 k = 0; k < 3; ++k) {
+            lo.e[k] = c.e[k] < lo.e[k] ? c.e[k] : lo.e[k];
+            hi.e[k] = c.e[k] > hi.e[k] ? c.e[k] : hi.e[k];
+        }
+    }
+    // Cubic cells, or a flat mesh would be cut into slabs along its
+    // thinnest axis.
+    f32 size = 0.0f;
+    for (u32 k = 0; k < 3; ++k) {
+        size = hi.e[k] - lo.e[k] > size ? hi.e[k] - lo.e[k] : size;
+    }
+    hi = vec3_add_s(lo, size);
+    morton3_encode_points(centroids, tri_count, lo, hi, keys);
+    u32 shift = 3 * MORTON3_BITS - SIMPLIFY_BUCKET_BITS;
+    for (u32 b = 0; b <= buckets; ++b) {
+        bucket_start[b] = 0;
+    }
+    for (u32 t = 0; t < tri_count; ++t) {
+        ++bucket_start[(keys[t] >> shift) + 1];
+    }
+    for (u32 b = 0; b < buckets; ++b) {
+        bucket_start[b + 1] += bucket_start[b];
+    }
+    job->part_start[0] = 0;
+    u32 p = 1;
+    for (u32 b = 1; b <= buckets && p < parts; ++b) {
+        if (bucket_start[b] >= (u64)tri_count * p / parts) {
+            job->part_start[p++] = bucket_start[b];
+        }
+    }
+    while (p <= parts) {
+        job->part_start[p++] = tri_count;
+    }
+    for (u32 t = 0; t < tri_count; ++t) {
+        job->part_tris[bucket_start[keys[t] >> shift]++] = t;
+    }
+
+    for (u32 v = 0; v < vertex_count; ++v) {
+        job->owner[v] = SIMPLIFY_REMOVED;
+    }
+    for (p = 0; p < parts; ++p) {
+        for (u32 i = job->part_start[p]; i < job->part_start[p + 1]; ++i) {
+            const u32* tri = job->tris + job->part_tris[i] * 3;
+            for (u32 k = 0; k < 3; ++k) {
+                u32* owner = job->owner + tri[k];
+                *owner = *owner == SIMPLIFY_REMOVED || *owner == p ? p : SIMPLIFY_SHARED;
+            }
+        }
+    }
+    // Triangles on the shared vertices cannot go in this pass, so each
+    // partition brings only the others down to the target ratio.
+    for (p = 0; p < parts; ++p) {
+        u32 border = 0;
+        for (u32 i = job->part_start[p]; i < job->part_start[p + 1]; ++i) {
+            const u32* tri = job->tris + job->part_tris[i] * 3;
+            border += job->owner[tri[0]] == SIMPLIFY_SHARED || job->owner[tri[1]] == SIMPLIFY_SHARED
+                || job->owner[tri[2]] == SIMPLIFY_SHARED;
+        }
+        u32 inner = job->part_start[p + 1] - job->part_start[p] - border;
+        job->part_targets[p] = (u32)((u64)inner * target / tri_count) + border;
+    }
+    YS_FREE(centroids);
+    YS_FREE(keys);
+    YS_FREE(bucket_start);
+    return parts;
+}
+
+static void simplify_job_free(simplify_job* job) {
+    YS_FREE(job->points);
+    YS_FREE(job->quadrics);
+    YS_FREE(job->tris);
+    YS_FREE(job->dead);
+    YS_FREE(job->corner_next);
+    YS_FREE(job->corner_head);
+    YS_FREE(job->corner_tail);
+    YS_FREE(job->versions);
+    YS_FREE(job->owner);
+    YS_FREE(job->part_tris);
+    YS_FREE(job->part_start);
+    YS_FREE(job->part_targets);
+}
+
+// Collapses edges, cheapest quadric error first, until the mesh has at
+// most target_index_count indices or the error of every remaining
+// collapse exceeds max_error. That error is the area weighted RMS
+// distance from the new vertex to the original planes of the faces
+// merged into it, as a fraction of the largest extent of the mesh. It
+// bounds how far vertices leave those planes on average, not the largest
+// distance between the two surfaces. Large meshes are first simplified
+// per partition in parallel, then the seams between partitions in one
+// serial pass. Open borders, uv seams included, are held in place by
+// extra planes, which add to the error. The surviving vertices move to
+// their optimal positions; other attributes are kept as they are, and
+// removed vertices stay in the streams until mesh_optimize_vertex_fetch
+// drops them. Returns 0 when out of memory, leaving the mesh as it was.
+b32 simplify_mesh(mesh* m, const u32 target_index_count, const f32 max_error) {
+    u32 tri_count = m->index_count / 3;
+    u32 vertex_count = m->vertex_count;
+    u32 target = target_index_count / 3;
+    if (tri_count <= target) {
+        return 1;
+    }
+    u32 vertices = vertex_count > 0 ? vertex_count : 1;
+    simplify_job job = {0};
+    mesh_adjacency a;
+    if (!mesh_adjacency_create(&a, m)) {
+        return 0;
+    }
+    job.a = &a;
+    job.points = (point3*)YS_MALLOC(sizeof(point3) * vertices);
+    job.quadrics = (simplify_quadric*)YS_MALLOC(sizeof(simplify_quadric) * vertices);
+    job.tris = (u32*)YS_MALLOC(sizeof(u32) * tri_count * 3);
+    job.dead = (u8*)YS_MALLOC(tri_count);
+    job.corner_next = (u32*)YS_MALLOC(sizeof(u32) * tri_count * 3);
+    job.corner_head = (u32*)YS_MALLOC(sizeof(u32) * vertices);
+    job.corner_tail = (u32*)YS_MALLOC(sizeof(u32) * vertices);
+    job.versions = (u32*)YS_MALLOC(sizeof(u32) * vertices);
+    job.owner = (u32*)YS_MALLOC(sizeof(u32) * vertices);
+    job.part_tris = (u32*)YS_MALLOC(sizeof(u32) * tri_count);
+    if (!job.points || !job.quadrics || !job.tris || !job.dead || !job.corner_next || !job.corner_head
+            || !job.corner_tail || !job.versions || !job.owner || !job.part_tris) {
+        simplify_job_free(&job);
+        mesh_adjacency_free(&a);
+        return 0;
+    }
+
+    // Quadrics are far better conditioned around the origin at unit scale.
+    aabb3 box = aabb3_empty();
+    for (u32 v = 0; v < vertex_count; ++v) {
+        box = aabb3_grow(box, m->positions[v]);
+    }
+    point3 center = aabb3_center(box);
+    vec3 extent = vec3_sub(box.max, box.min);
+    f32 scale = extent.x > extent.y ? extent.x : extent.y;
+    scale = scale > extent.z ? scale : extent.z;
+    scale = scale > 0.0f ? scale : 1.0f;
+    for (u32 v = 0; v < vertex_count; ++v) {
+        job.points[v] = vec3_mul_s(vec3_sub(m->positions[v], center), 1.0f / scale);
+        job.corner_head[v] = SIMPLIFY_REMOVED;
+        job.versions[v] = 0;
+    }
+    for (u32 i = 0; i < tri_count * 3; ++i) {
+        u32 v = m->indices[i];
+        job.tris[i] = v;
+        job.corner_next[i] = SIMPLIFY_REMOVED;
+        if (job.corner_head[v] == SIMPLIFY_REMOVED) {
+            job.corner_head[v] = i;
+        } else {
+            job.corner_next[job.corner_tail[v]] = i;
+        }
+        job.corner_tail[v] = i;
+    }
+    for (u32 t = 0; t < tri_count; ++t) {
+        job.dead[t] = 0;
+    }
+    job.max_cost = max_error * max_error;
+    parallel_for(vertex_count, SIMPLIFY_VERTEX_GRAIN, simplify_quadric_task, &job);
+
+    if (tri_count >= 2 * SIMPLIFY_PARTITION_TRIS) {
+        u32 parts = simplify_partition(&job, tri_count, vertex_count, target);
+        if (parts == 0) {
+            simplify_job_free(&job);
+            mesh_adjacency_free(&a);
+            return 0;
+        }
+        parallel_for(parts, 1, simplify_part_task, &job);
+    }
+    u32 live = 0;
+    for (u32 t = 0; t < tri_count; ++t) {
+        if (!job.dead[t]) {
+            job.part_tris[live++] = t;
+        }
+    }
+    if (!job.failed && live > target) {
+        simplify_pass(&job, job.part_tris, live, SIMPLIFY_ANY, target);
+    }
+    if (job.failed) {
+        simplify_job_free(&job);
+        mesh_adjacency_free(&a);
+        return 0;
+    }
+
+    for (u32 v = 0; v < vertex_count; ++v) {
+        if (job.versions[v] != 0 && job.versions[v] != SIMPLIFY_REMOVED) {
+            m->positions[v] = vec3_add(vec3_mul_s(job.points[v], scale), center);
+        }
+    }
+    u32 n = 0;
+    for (u32 t = 0; t < tri_count; ++t) {
+        if (!job.dead[t]) {
+            m->indices[n++] = job.tris[t * 3];
+            m->indices[n++] = job.tris[t * 3 + 1];
+            m->indices[n++] = job.tris[t * 3 + 2];
+        }
+    }
+    m->index_count = n;
+    simplify_job_free(&job);
+    mesh_adjacency_free(&a);
+    return 1;
+}
+
+#endif
+#endif
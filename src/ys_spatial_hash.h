@@ -0,0 +1,309 @@
+#ifndef YS_SPATIAL_HASH_H
+#define YS_SPATIAL_HASH_H
+
+#include <math.h>
+#include "ys_math.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Points per parallel_for chunk of a rebuild.
+#define SPATIAL_HASH_GRAIN 16384
+
+/*
+ *  === DATA DEFINITIONS ===
+*/
+
+// Uniform grid over unbounded space, cells hashed into a fixed power of
+// two table. Rebuilt from scratch every frame with a counting sort, so the
+// points of one bucket sit next to each other in `ids` and `positions`.
+// Distinct cells can share a bucket, queries return candidates only.
+typedef struct spatial_hash {
+    u32* cell_start;     // table_size + 1 offsets into ids/positions
+    u32* cursor;         // scatter position per bucket during a rebuild
+    u32* point_bucket;   // bucket of each input point
+    u32* ids;            // input index per sorted slot
+    point3* positions;   // point per sorted slot
+    u32 table_size;
+    u32 point_count;
+    u32 point_capacity;
+    f32 cell_size;
+    f32 inv_cell_size;
+} spatial_hash;
+
+// Walks the points of the 27 cells around a position. Buckets shared by
+// several of those cells are visited once.
+typedef struct spatial_hash_query {
+    u32 buckets[27];
+    u32 bucket_count;
+    u32 bucket;
+    u32 slot;
+    u32 end;
+} spatial_hash_query;
+
+
+/*
+ * === SPATIAL HASH INTERFACE ===
+*/
+b32 spatial_hash_create(spatial_hash* h, const f32 cell_size, const u32 table_size);
+void spatial_hash_free(spatial_hash* h);
+b32 spatial_hash_rebuild(spatial_hash* h, const point3* points, const u32 count);
+u32 spatial_hash_bucket(const spatial_hash* h, const i32 x, const i32 y, const i32 z);
+void spatial_hash_query_init(const spatial_hash* h, spatial_hash_query* q, const point3 p);
+b32 spatial_hash_query_next(const spatial_hash* h, spatial_hash_query* q, u32* slot);
+u32 spatial_hash_radius(const spatial_hash* h, const point3 p, const f32 radius, u32* ids, const u32 max_ids);
+
+
+#ifdef YS_SPATIAL_HASH_IMPLEMENTATION
+
+// `table_size` is rounded up to a power of two. About twice the expected
+// point count keeps buckets short.
+b32 spatial_hash_create(spatial_hash* h, const f32 cell_size, const u32 table_size) {
+    u32 size = 1;
+    while (size < table_size && size < 0x80000000u) {
+        size <<= 1;
+    }
+    h->cell_start = (u32*)YS_MALLOC(sizeof(u32) * (size + 1));
+    h->cursor = (u32*)YS_MALLOC(sizeof(u32) * size);
+    h->point_bucket = 0;
+    h->ids = 0;
+    h->positions = 0;
+    h->table_size = size;
+    h->point_count = 0;
+    h->point_capacity = 0;
+    h->cell_size = cell_size;
+    h->inv_cell_size = 1.0f / cell_size;
+    if (!h->cell_start || !h->cursor) {
+        spatial_hash_free(h);
+        return 0;
+    }
+    for (u32 i = 0; i <= size; ++i) {
+        h->cell_start[i] = 0;
+    }
+    return 1;
+}
+
+void spatial_hash_free(spatial_hash* h) {
+    YS_FREE(h->cell_start);
+    YS_FREE(h->cursor);
+    YS_FREE(h->point_bucket);
+    YS_FREE(h->ids);
+    YS_FREE(h->positions);
+    h->cell_start = 0;
+    h->cursor = 0;
+    h->point_bucket = 0;
+    h->ids = 0;
+    h->positions = 0;
+    h->point_count = 0;
+    h->point_capacity = 0;
+}
+
+u32 spatial_hash_bucket(const spatial_hash* h, const i32 x, const i32 y, const i32 z) {
+    u32 hash = ((u32)x * 73856093u) ^ ((u32)y * 19349663u) ^ ((u32)z * 83492791u);
+    return hash & (h->table_size - 1);
+}
+
+static i32 spatial_hash_cell(const spatial_hash* h, const f32 v) {
+    return (i32)floorf(v * h->inv_cell_size);
+}
+
+
+/*
+ * ==== REBUILD =======
+*/
+
+typedef struct spatial_hash_job {
+    spatial_hash* h;
+    const point3* points;
+    u32 block_size;
+    u32* block_sums;
+    b32 shared;   // point passes run on several threads
+} spatial_hash_job;
+
+// Locked adds cost several times a plain one even uncontended, so they
+// are only used when the point passes are actually split across threads.
+static u32 spatial_hash_bump(const spatial_hash_job* job, u32* counter) {
+    return job->shared ? atomic_add_u32(counter, 1) : (*counter)++;
+}
+
+static void spatial_hash_clear_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    spatial_hash_job* job = (spatial_hash_job*)ctx;
+    (void)thread;
+    u32* cursor = job->h->cursor;
+    for (u32 i = begin; i < end; ++i) {
+        cursor[i] = 0;
+    }
+}
+
+static void spatial_hash_count_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    spatial_hash_job* job = (spatial_hash_job*)ctx;
+    spatial_hash* h = job->h;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        point3 p = job->points[i];
+        u32 b = spatial_hash_bucket(h, spatial_hash_cell(h, p.x), spatial_hash_cell(h, p.y),
+            spatial_hash_cell(h, p.z));
+        h->point_bucket[i] = b;
+        spatial_hash_bump(job, &h->cursor[b]);
+    }
+}
+
+// Scan in two passes over blocks of the table: local sums, then local
+// prefix sums offset by the scanned block sums.
+static void spatial_hash_sum_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    spatial_hash_job* job = (spatial_hash_job*)ctx;
+    (void)thread;
+    for (u32 b = begin; b < end; ++b) {
+        u32 first = b * job->block_size;
+        u32 last = first + job->block_size;
+        last = last > job->h->table_size ? job->h->table_size : last;
+        u32 sum = 0;
+        for (u32 i = first; i < last; ++i) {
+            sum += job->h->cursor[i];
+        }
+        job->block_sums[b] = sum;
+    }
+}
+
+static void spatial_hash_scan_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    spatial_hash_job* job = (spatial_hash_job*)ctx;
+    spatial_hash* h = job->h;
+    (void)thread;
+    for (u32 b = begin; b < end; ++b) {
+        u32 first = b * job->block_size;
+        u32 last = first + job->block_size;
+        last = last > h->table_size ? h->table_size : last;
+        u32 offset = job->block_sums[b];
+        for (u32 i = first; i < last; ++i) {
+            u32 n = h->cursor[i];
+            h->cell_start[i] = offset;
+            h->cursor[i] = offset;
+            offset += n;
+        }
+    }
+}
+
+static void spatial_hash_scatter_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    spatial_hash_job* job = (spatial_hash_job*)ctx;
+    spatial_hash* h = job->h;
+    (void)thread;
+    for (u32 i = begin; i < end; ++i) {
+        u32 slot = spatial_hash_bump(job, &h->cursor[h->point_bucket[i]]);
+        h->ids[slot] = i;
+        h->positions[slot] = job->points[i];
+    }
+}
+
+// Sorts the points into their buckets. Every pass runs over parallel_for;
+// the order of points inside one bucket depends on thread timing.
+b32 spatial_hash_rebuild(spatial_hash* h, const point3* points, const u32 count) {
+    if (count > h->point_capacity) {
+        YS_FREE(h->point_bucket);
+        YS_FREE(h->ids);
+        YS_FREE(h->positions);
+        h->point_bucket = (u32*)YS_MALLOC(sizeof(u32) * count);
+        h->ids = (u32*)YS_MALLOC(sizeof(u32) * count);
+        h->positions = (point3*)YS_MALLOC(sizeof(point3) * count);
+        h->point_capacity = count;
+        if (!h->point_bucket || !h->ids || !h->positions) {
+            h->point_capacity = 0;
+            h->point_count = 0;
+            return 0;
+        }
+    }
+
+    u32 blocks = h->table_size < 64 ? 1 : 64;
+    u32 block_sums[64];
+    spatial_hash_job job;
+    job.h = h;
+    job.points = points;
+    job.block_size = (h->table_size + blocks - 1) / blocks;
+    job.block_sums = block_sums;
+    job.shared = thread_count() > 1 && count > SPATIAL_HASH_GRAIN;
+
+    parallel_for(h->table_size, SPATIAL_HASH_GRAIN, spatial_hash_clear_task, &job);
+    parallel_for(count, SPATIAL_HASH_GRAIN, spatial_hash_count_task, &job);
+    parallel_for(blocks, 1, spatial_hash_sum_task, &job);
+    u32 offset = 0;
+    for (u32 b = 0; b < blocks; ++b) {
+        u32 n = block_sums[b];
+        block_sums[b] = offset;
+        offset += n;
+    }
+    parallel_for(blocks, 1, spatial_hash_scan_task, &job);
+    h->cell_start[h->table_size] = count;
+    parallel_for(count, SPATIAL_HASH_GRAIN, spatial_hash_scatter_task, &job);
+    h->point_count = count;
+    return 1;
+}
+
+
+/*
+ * ==== QUERIES =======
+*/
+
+void spatial_hash_query_init(const spatial_hash* h, spatial_hash_query* q, const point3 p) {
+    i32 cx = spatial_hash_cell(h, p.x);
+    i32 cy = spatial_hash_cell(h, p.y);
+    i32 cz = spatial_hash_cell(h, p.z);
+    q->bucket_count = 0;
+    for (i32 z = -1; z <= 1; ++z) {
+        for (i32 y = -1; y <= 1; ++y) {
+            for (i32 x = -1; x <= 1; ++x) {
+                u32 b = spatial_hash_bucket(h, cx + x, cy + y, cz + z);
+                u32 i = 0;
+                while (i < q->bucket_count && q->buckets[i] != b) {
+                    ++i;
+                }
+                if (i == q->bucket_count && h->cell_start[b] != h->cell_start[b + 1]) {
+                    q->buckets[q->bucket_count++] = b;
+                }
+            }
+        }
+    }
+    q->bucket = 0;
+    q->slot = 0;
+    q->end = 0;
+}
+
+// Returns the next candidate slot: h->positions[slot] is the point and
+// h->ids[slot] its input index. Returns 0 once all 27 cells are done.
+b32 spatial_hash_query_next(const spatial_hash* h, spatial_hash_query* q, u32* slot) {
+    while (q->slot == q->end) {
+        if (q->bucket == q->bucket_count) {
+            return 0;
+        }
+        u32 b = q->buckets[q->bucket++];
+        q->slot = h->cell_start[b];
+        q->end = h->cell_start[b + 1];
+    }
+    *slot = q->slot++;
+    return 1;
+}
+
+// Input indices of the points within `radius` of p, radius <= cell_size.
+// Writes the first max_ids and returns the total count.
+u32 spatial_hash_radius(const spatial_hash* h, const point3 p, const f32 radius, u32* ids, const u32 max_ids) {
+    spatial_hash_query q;
+    spatial_hash_query_init(h, &q, p);
+    f32 radius_sq = radius * radius;
+    u32 found = 0;
+    u32 slot;
+    while (spatial_hash_query_next(h, &q, &slot)) {
+        vec3 d = vec3_sub(h->positions[slot], p);
+        if (vec3_dot(d, d) <= radius_sq) {
+            if (found < max_ids) {
+                ids[found] = h->ids[slot];
+            }
+            ++found;
+        }
+    }
+    return found;
+}
+
+#endif
+#endif
@@ -0,0 +1,182 @@
+#ifndef YS_THREAD_H
+#define YS_THREAD_H
+
+#include "ys_types.h"
+
+#ifndef PLATFORM
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+#define PLATFORM 0
+#elif defined(__linux__) || defined(__unix) || defined(__FreeBSD__)
+#define PLATFORM 1
+#elif defined(__ANDROID__)
+#define PLATFORM 2
+#elif defined(__APPLE__)
+#define PLATFORM 3
+#else
+#define PLATFORM 4
+#endif
+#endif
+
+#ifndef YS_MAX_THREADS
+#define YS_MAX_THREADS 64
+#endif
+
+/*
+ * === THREAD INTERFACE ===
+*/
+
+// Called with a half-open range [begin, end) of the work items and the
+// index of the worker running it, in [0, thread_count()).
+typedef void (*parallel_for_fn)(void* ctx, u32 begin, u32 end, u32 thread);
+
+u32 thread_count(void);
+void parallel_for(u32 count, u32 grain, parallel_for_fn fn, void* ctx);
+u32 atomic_add_u32(volatile u32* value, u32 add);
+
+
+#ifdef YS_THREAD_IMPLEMENTATION
+
+#if PLATFORM == 0
+#include <windows.h>
+#elif PLATFORM != 4
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+typedef struct parallel_for_job {
+    parallel_for_fn fn;
+    void* ctx;
+    u64 next;
+    u32 count;
+    u32 grain;
+} parallel_for_job;
+
+typedef struct parallel_for_worker_arg {
+    parallel_for_job* job;
+    u32 thread;
+} parallel_for_worker_arg;
+
+static u64 parallel_for_grab(parallel_for_job* job) {
+#if PLATFORM == 0
+    return (u64)InterlockedExchangeAdd64((volatile LONG64*)&job->next, job->grain);
+#else
+    return __atomic_fetch_add(&job->next, (u64)job->grain, __ATOMIC_RELAXED);
+#endif
+}
+
+static void parallel_for_run(parallel_for_job* job, u32 thread) {
+    for (;;) {
+        u64 begin = parallel_for_grab(job);
+        if (begin >= job->count) {
+            break;
+        }
+        u64 end = begin + job->grain;
+        if (end > job->count) {
+            end = job->count;
+        }
+        job->fn(job->ctx, (u32)begin, (u32)end, thread);
+    }
+}
+
+#if PLATFORM == 0
+static DWORD WINAPI parallel_for_worker(LPVOID param) {
+    parallel_for_worker_arg* arg = (parallel_for_worker_arg*)param;
+    parallel_for_run(arg->job, arg->thread);
+    return 0;
+}
+#elif PLATFORM != 4
+static void* parallel_for_worker(void* param) {
+    parallel_for_worker_arg* arg = (parallel_for_worker_arg*)param;
+    parallel_for_run(arg->job, arg->thread);
+    return 0;
+}
+#endif
+
+u32 thread_count(void) {
+    u32 n = 1;
+#if PLATFORM == 0
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    n = (u32)info.dwNumberOfProcessors;
+#elif PLATFORM != 4
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    n = online > 0 ? (u32)online : 1;
+#endif
+    return n > YS_MAX_THREADS ? YS_MAX_THREADS : n;
+}
+
+// Adds to *value atomically and returns the previous value.
+u32 atomic_add_u32(volatile u32* value, u32 add) {
+#if PLATFORM == 0
+    return (u32)InterlockedExchangeAdd((volatile LONG*)value, (LONG)add);
+#else
+    return __atomic_fetch_add(value, add, __ATOMIC_RELAXED);
+#endif
+}
+
+// Splits [0, count) into chunks of `grain` items that are handed out
+// dynamically to the workers. The calling thread works as thread 0 and
+// the call returns once every chunk is done.
+void parallel_for(u32 count, u32 grain, parallel_for_fn fn, void* ctx) {
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    parallel_for_job job;
+    job.fn = fn;
+    job.ctx = ctx;
+    job.next = 0;
+    job.count = count;
+    job.grain = grain;
+
+    u32 chunks = (count + grain - 1) / grain;
+    u32 threads = thread_count();
+    if (threads > chunks) {
+        threads = chunks;
+    }
+    if (threads <= 1) {
+        fn(ctx, 0, count, 0);
+        return;
+    }
+
+    parallel_for_worker_arg args[YS_MAX_THREADS];
+#if PLATFORM == 0
+    HANDLE handles[YS_MAX_THREADS];
+    u32 started = 0;
+    for (u32 i = 1; i < threads; ++i) {
+        args[i].job = &job;
+        args[i].thread = i;
+        handles[started] = CreateThread(0, 0, parallel_for_worker, &args[i], 0, 0);
+        if (handles[started]) {
+            ++started;
+        }
+    }
+    parallel_for_run(&job, 0);
+    WaitForMultipleObjects(started, handles, TRUE, INFINITE);
+    for (u32 i = 0; i < started; ++i) {
+        CloseHandle(handles[i]);
+    }
+#elif PLATFORM != 4
+    pthread_t handles[YS_MAX_THREADS];
+    b8 started[YS_MAX_THREADS];
+    for (u32 i = 1; i < threads; ++i) {
+        args[i].job = &job;
+        args[i].thread = i;
+        started[i] = pthread_create(&handles[i], 0, parallel_for_worker, &args[i]) == 0;
+    }
+    parallel_for_run(&job, 0);
+    for (u32 i = 1; i < threads; ++i) {
+        if (started[i]) {
+            pthread_join(handles[i], 0);
+        }
+    }
+#else
+    parallel_for_run(&job, 0);
+#endif
+}
+
+#endif
+#endif
@@ -0,0 +1,302 @@
+#ifndef YS_VOXELIZE_H
+#define YS_VOXELIZE_H
+
+#include <math.h>
+#include "ys_grid.h"
+#include "ys_thread.h"
+
+#ifndef YS_MALLOC
+#include <stdlib.h>
+#define YS_MALLOC malloc
+#define YS_FREE free
+#endif
+
+// Slabs per parallel_for chunk.
+#define VOXELIZE_GRAIN 1
+
+/*
+ * === VOXELIZE INTERFACE ===
+*/
+b32 voxelize_conservative(voxel_grid* g, const point3* positions, const u32* indices, const u32 tri_count);
+b32 voxelize_solid(voxel_grid* g, const point3* positions, const u32* indices, const u32 tri_count);
+
+
+#ifdef YS_VOXELIZE_IMPLEMENTATION
+
+/*
+ * ==== SLABS =======
+*/
+
+// The grid is split into slabs of whole z layers that start on a word of
+// the bit array, so threads working on different slabs never write the
+// same word. Triangles are binned to every slab their z range touches.
+typedef struct voxelize_job {
+    voxel_grid* g;
+    const point3* positions;
+    const u32* indices;
+    u32 slab_layers;
+    u32 slab_count;
+    u32* slab_start;   // slab_count + 1 offsets into slab_tris
+    u32* slab_tris;
+} voxelize_job;
+
+// Floor of v clamped to [-1, max], so far away triangles do not overflow.
+static i32 voxelize_cell(const f32 v, const i32 max) {
+    f32 f = floorf(v);
+    return f < -1.0f ? -1 : f > (f32)max ? max : (i32)f;
+}
+
+static void voxelize_tri_layers(const voxelize_job* job, const u32 t, i32* first, i32* last) {
+    const voxel_grid* g = job->g;
+    const u32* tri = job->indices + t * 3;
+    f32 z0 = job->positions[tri[0]].z, z1 = job->positions[tri[1]].z, z2 = job->positions[tri[2]].z;
+    f32 lo = z0 < z1 ? (z0 < z2 ? z0 : z2) : (z1 < z2 ? z1 : z2);
+    f32 hi = z0 > z1 ? (z0 > z2 ? z0 : z2) : (z1 > z2 ? z1 : z2);
+    f32 inv_cell = 1.0f / g->cell_size;
+    *first = voxelize_cell((lo - g->origin.z) * inv_cell, g->dims[2]);
+    *last = voxelize_cell((hi - g->origin.z) * inv_cell, g->dims[2]);
+    *first = *first < 0 ? 0 : *first;
+    *last = *last > g->dims[2] - 1 ? g->dims[2] - 1 : *last;
+}
+
+// Counting sort of the triangles into the slabs. Returns 0 when out of
+// memory.
+static b32 voxelize_bin(voxelize_job* job, const u32 tri_count) {
+    voxel_grid* g = job->g;
+    u64 layer = (u64)g->dims[0] * g->dims[1];
+    job->slab_layers = 1;
+    while ((layer * job->slab_layers) & 63) {
+        job->slab_layers <<= 1;
+    }
+    job->slab_count = ((u32)g->dims[2] + job->slab_layers - 1) / job->slab_layers;
+    job->slab_start = (u32*)YS_MALLOC(sizeof(u32) * (job->slab_count + 1));
+    job->slab_tris = 0;
+    if (!job->slab_start) {
+        return 0;
+    }
+    for (u32 s = 0; s <= job->slab_count; ++s) {
+        job->slab_start[s] = 0;
+    }
+    for (u32 t = 0; t < tri_count; ++t) {
+        i32 first, last;
+        voxelize_tri_layers(job, t, &first, &last);
+        for (i32 s = first / (i32)job->slab_layers; s <= last / (i32)job->slab_layers; ++s) {
+            ++job->slab_start[s + 1];
+        }
+    }
+    for (u32 s = 0; s < job->slab_count; ++s) {
+        job->slab_start[s + 1] += job->slab_start[s];
+    }
+    u32 total = job->slab_start[job->slab_count];
+    job->slab_tris = (u32*)YS_MALLOC(sizeof(u32) * (total > 0 ? total : 1));
+    if (!job->slab_tris) {
+        YS_FREE(job->slab_start);
+        return 0;
+    }
+    for (u32 t = 0; t < tri_count; ++t) {
+        i32 first, last;
+        voxelize_tri_layers(job, t, &first, &last);
+        for (i32 s = first / (i32)job->slab_layers; s <= last / (i32)job->slab_layers; ++s) {
+            job->slab_tris[job->slab_start[s]++] = t;
+        }
+    }
+    // The fill pass left every start on the next slab's start.
+    for (u32 s = job->slab_count; s > 0; --s) {
+        job->slab_start[s] = job->slab_start[s - 1];
+    }
+    job->slab_start[0] = 0;
+    return 1;
+}
+
+static void voxelize_job_free(voxelize_job* job) {
+    YS_FREE(job->slab_start);
+    YS_FREE(job->slab_tris);
+}
+
+
+/*
+ * ==== CONSERVATIVE =======
+*/
+
+static void voxelize_conservative_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    voxelize_job* job = (voxelize_job*)ctx;
+    voxel_grid* g = job->g;
+    (void)thread;
+    f32 inv_cell = 1.0f / g->cell_size;
+    for (u32 s = begin; s < end; ++s) {
+        i32 z_first = (i32)(s * job->slab_layers);
+        i32 z_last = z_first + (i32)job->slab_layers - 1;
+        z_last = z_last > g->dims[2] - 1 ? g->dims[2] - 1 : z_last;
+        for (u32 i = job->slab_start[s]; i < job->slab_start[s + 1]; ++i) {
+            const u32* tri = job->indices + job->slab_tris[i] * 3;
+            point3 p0 = job->positions[tri[0]];
+            point3 p1 = job->positions[tri[1]];
+            point3 p2 = job->positions[tri[2]];
+            aabb3 bounds = aabb3_triangle(p0, p1, p2);
+            i32 lo[3], hi[3];
+            for (int k = 0; k < 3; ++k) {
+                lo[k] = voxelize_cell((bounds.min.e[k] - g->origin.e[k]) * inv_cell, g->dims[k]);
+                hi[k] = voxelize_cell((bounds.max.e[k] - g->origin.e[k]) * inv_cell, g->dims[k]);
+                lo[k] = lo[k] < 0 ? 0 : lo[k];
+                hi[k] = hi[k] > g->dims[k] - 1 ? g->dims[k] - 1 : hi[k];
+            }
+            lo[2] = lo[2] < z_first ? z_first : lo[2];
+            hi[2] = hi[2] > z_last ? z_last : hi[2];
+            for (i32 z = lo[2]; z <= hi[2]; ++z) {
+                for (i32 y = lo[1]; y <= hi[1]; ++y) {
+                    for (i32 x = lo[0]; x <= hi[0]; ++x) {
+                        aabb3 box;
+                        box.min.x = g->origin.x + x * g->cell_size;
+                        box.min.y = g->origin.y + y * g->cell_size;
+                        box.min.z = g->origin.z + z * g->cell_size;
+                        box.max.x = box.min.x + g->cell_size;
+                        box.max.y = box.min.y + g->cell_size;
+                        box.max.z = box.min.z + g->cell_size;
+                        if (aabb3_triangle_overlaps(box, p0, p1, p2)) {
+                            voxel_grid_set(g, x, y, z);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Sets every voxel a triangle touches, keeping voxels already set. Slabs
+// run in parallel. Returns 0 when out of memory.
+b32 voxelize_conservative(voxel_grid* g, const point3* positions, const u32* indices, const u32 tri_count) {
+    voxelize_job job;
+    job.g = g;
+    job.positions = positions;
+    job.indices = indices;
+    if (!voxelize_bin(&job, tri_count)) {
+        return 0;
+    }
+    parallel_for(job.slab_count, VOXELIZE_GRAIN, voxelize_conservative_task, &job);
+    voxelize_job_free(&job);
+    return 1;
+}
+
+
+/*
+ * ==== SOLID =======
+*/
+
+// Flips bits [begin, end) of the grid.
+static void voxelize_flip(u64* bits, const u64 begin, const u64 end) {
+    if (begin >= end) {
+        return;
+    }
+    u64 first = begin >> 6;
+    u64 last = (end - 1) >> 6;
+    u64 head = ~(u64)0 << (begin & 63);
+    u64 tail = ~(u64)0 >> (63 - ((end - 1) & 63));
+    if (first == last) {
+        bits[first] ^= head & tail;
+        return;
+    }
+    bits[first] ^= head;
+    for (u64 w = first + 1; w < last; ++w) {
+        bits[w] = ~bits[w];
+    }
+    bits[last] ^= tail;
+}
+
+// Edge function of the yz projection of edge pq at (y, z). The edge is
+// evaluated in one fixed vertex order, so the two triangles sharing it
+// get exactly opposite values.
+static f32 voxelize_edge(const point3 p, const point3 q, const f32 y, const f32 z, f32 normal[2]) {
+    b32 swap = p.y > q.y || (p.y == q.y && p.z > q.z);
+    point3 a = swap ? q : p;
+    point3 b = swap ? p : q;
+    f32 sign = swap ? -1.0f : 1.0f;
+    normal[0] = -(b.z - a.z) * sign;
+    normal[1] = (b.y - a.y) * sign;
+    return ((b.y - a.y) * (z - a.z) - (b.z - a.z) * (y - a.y)) * sign;
+}
+
+static void voxelize_solid_task(void* ctx, u32 begin, u32 end, u32 thread) {
+    voxelize_job* job = (voxelize_job*)ctx;
+    voxel_grid* g = job->g;
+    (void)thread;
+    f32 inv_cell = 1.0f / g->cell_size;
+    u64 layer = (u64)g->dims[0] * g->dims[1];
+    for (u32 s = begin; s < end; ++s) {
+        i32 z_first = (i32)(s * job->slab_layers);
+        i32 z_last = z_first + (i32)job->slab_layers - 1;
+        z_last = z_last > g->dims[2] - 1 ? g->dims[2] - 1 : z_last;
+        for (u64 w = z_first * layer / 64; w < ((z_last + 1) * layer + 63) / 64; ++w) {
+            g->bits[w] = 0;
+        }
+
+        for (u32 i = job->slab_start[s]; i < job->slab_start[s + 1]; ++i) {
+            const u32* tri = job->indices + job->slab_tris[i] * 3;
+            point3 v[3] = {job->positions[tri[0]], job->positions[tri[1]], job->positions[tri[2]]};
+            vec3 n = vec3_cross(vec3_sub(v[1], v[0]), vec3_sub(v[2], v[0]));
+            if (n.x == 0) {
+                continue;
+            }
+            f32 side = n.x > 0 ? 1.0f : -1.0f;
+            aabb3 bounds = aabb3_triangle(v[0], v[1], v[2]);
+            if (bounds.min.x > g->origin.x + g->dims[0] * g->cell_size) {
+                continue;
+            }
+            // Voxel centers inside the projected bounds, plus one row below
+            // that the edge tests reject.
+            i32 y_lo = voxelize_cell((bounds.min.y - g->origin.y) * inv_cell - 0.5f, g->dims[1]);
+            i32 y_hi = voxelize_cell((bounds.max.y - g->origin.y) * inv_cell - 0.5f, g->dims[1]);
+            i32 z_lo = voxelize_cell((bounds.min.z - g->origin.z) * inv_cell - 0.5f, g->dims[2]);
+            i32 z_hi = voxelize_cell((bounds.max.z - g->origin.z) * inv_cell - 0.5f, g->dims[2]);
+            y_lo = y_lo < 0 ? 0 : y_lo;
+            y_hi = y_hi > g->dims[1] - 1 ? g->dims[1] - 1 : y_hi;
+            z_lo = z_lo < z_first ? z_first : z_lo;
+            z_hi = z_hi > z_last ? z_last : z_hi;
+            for (i32 z = z_lo; z <= z_hi; ++z) {
+                f32 cz = g->origin.z + (z + 0.5f) * g->cell_size;
+                for (i32 y = y_lo; y <= y_hi; ++y) {
+                    f32 cy = g->origin.y + (y + 0.5f) * g->cell_size;
+                    // Centers on an edge belong to the triangle the edge's
+                    // inward normal points into first along +y, then +z,
+                    // so rows through shared edges flip once.
+                    b32 inside = 1;
+                    for (int k = 0; k < 3 && inside; ++k) {
+                        f32 normal[2];
+                        f32 w = voxelize_edge(v[k], v[(k + 1) % 3], cy, cz, normal) * side;
+                        inside = w > 0 || (w == 0 && (normal[0] * side > 0
+                            || (normal[0] == 0 && normal[1] * side > 0)));
+                    }
+                    if (!inside) {
+                        continue;
+                    }
+                    // Flip the row from the first center past the crossing.
+                    f32 x = v[0].x - (n.y * (cy - v[0].y) + n.z * (cz - v[0].z)) / n.x;
+                    i32 first = voxelize_cell((x - g->origin.x) * inv_cell - 0.5f, g->dims[0]) + 1;
+                    first = first < 0 ? 0 : first;
+                    u64 row = (u64)g->dims[0] * ((u64)y + (u64)g->dims[1] * z);
+                    voxelize_flip(g->bits, row + first, row + g->dims[0]);
+                }
+            }
+        }
+    }
+}
+
+// Sets the voxels whose centers are inside the closed mesh and clears
+// the rest. Every triangle flips the voxels of the rows along +x that
+// cross it beyond the crossing (Schwarz and Seidel), which leaves the
+// inside set for watertight meshes of either winding. Slabs run in
+// parallel. Returns 0 when out of memory.
+b32 voxelize_solid(voxel_grid* g, const point3* positions, const u32* indices, const u32 tri_count) {
+    voxelize_job job;
+    job.g = g;
+    job.positions = positions;
+    job.indices = indices;
+    if (!voxelize_bin(&job, tri_count)) {
+        return 0;
+    }
+    parallel_for(job.slab_count, VOXELIZE_GRAIN, voxelize_solid_task, &job);
+    voxelize_job_free(&job);
+    return 1;
+}
+
+#endif
+#endif
@@ -0,0 +1,425 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_FILE_IMPLEMENTATION
+#define YS_BVH_IMPLEMENTATION
+#include "../src/ys_bvh.h"
+#include <math.h>
+#include <string.h>
+
+#define TEST_TRIS 4096
+
+static point3 positions[TEST_TRIS * 3];
+static u32 indices[TEST_TRIS * 3];
+static aabb3 tri_bounds[TEST_TRIS];
+static u32 rng_state;
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+static void make_triangles(f32 size) {
+    rng_state = 1234;
+    for (u32 i = 0; i < TEST_TRIS; ++i) {
+        point3 c = {rand_f32() * 100.0f, rand_f32() * 100.0f, rand_f32() * 100.0f};
+        for (u32 k = 0; k < 3; ++k) {
+            point3 p = {c.x + rand_f32() * size, c.y + rand_f32() * size, c.z + rand_f32() * size};
+            positions[i * 3 + k] = p;
+            indices[i * 3 + k] = i * 3 + k;
+        }
+    }
+}
+
+static void compute_bounds(void) {
+    for (u32 i = 0; i < TEST_TRIS; ++i) {
+        tri_bounds[i] = aabb3_triangle(positions[indices[i * 3]],
+            positions[indices[i * 3 + 1]], positions[indices[i * 3 + 2]]);
+    }
+}
+
+static b32 aabb3_contains(const aabb3 outer, const aabb3 inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z
+        && outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+// Checks that every node encloses its children and returns the number of
+// primitives below it.
+static u32 check_node(const bvh* b, u32 index, u32 depth) {
+    const bvh_node* n = &b->nodes[index];
+    TEST_ASSERT_TRUE(depth < BVH_MAX_DEPTH);
+    if (n->count) {
+        for (u32 i = 0; i < n->count; ++i) {
+            TEST_ASSERT_TRUE(aabb3_contains(n->bounds, tri_bounds[b->prims[n->first + i]]));
+        }
+        return n->count;
+    }
+    TEST_ASSERT_TRUE(n->first + 1 < b->node_count);
+    TEST_ASSERT_TRUE(aabb3_contains(n->bounds, b->nodes[n->first].bounds));
+    TEST_ASSERT_TRUE(aabb3_contains(n->bounds, b->nodes[n->first + 1].bounds));
+    return check_node(b, n->first, depth + 1) + check_node(b, n->first + 1, depth + 1);
+}
+
+static void check_bvh(const bvh* b) {
+    TEST_ASSERT_EQUAL_UINT32(TEST_TRIS, check_node(b, 0, 0));
+    static u8 seen[TEST_TRIS];
+    memset(seen, 0, sizeof(seen));
+    for (u32 i = 0; i < b->prim_count; ++i) {
+        TEST_ASSERT_FALSE(seen[b->prims[i]]);
+        seen[b->prims[i]] = 1;
+    }
+}
+
+static void deform(f32 amount) {
+    for (u32 i = 0; i < TEST_TRIS * 3; ++i) {
+        positions[i].x += sinf(positions[i].y * 0.1f) * amount;
+        positions[i].y += cosf(positions[i].z * 0.1f) * amount;
+    }
+}
+
+// Larger triangles for the ray and point queries, so random rays hit
+// often enough to exercise the traversal.
+static void make_query_triangles(void) {
+    make_triangles(4.0f);
+    compute_bounds();
+}
+
+void setUp(void) {
+    make_triangles(1.0f);
+    compute_bounds();
+}
+
+void tearDown(void) {
+}
+
+void test_aabb3_area(void) {
+    aabb3 a = {{0.0f, 0.0f, 0.0f}, {1.0f, 2.0f, 3.0f}};
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 22.0f, aabb3_area(a));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, aabb3_area(aabb3_empty()));
+}
+
+void test_bvh_build(void) {
+    bvh b;
+    TEST_ASSERT_TRUE(bvh_build(&b, tri_bounds, TEST_TRIS));
+    TEST_ASSERT_TRUE(b.node_count <= TEST_TRIS * 2 - 1);
+    check_bvh(&b);
+    TEST_ASSERT_TRUE(b.build_cost > 0);
+    bvh_free(&b);
+}
+
+void test_bvh_build_single_prim(void) {
+    bvh b;
+    TEST_ASSERT_TRUE(bvh_build(&b, tri_bounds, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, b.node_count);
+    TEST_ASSERT_EQUAL_UINT32(1, b.nodes[0].count);
+    bvh_free(&b);
+}
+
+void test_bvh_refit(void) {
+    bvh b;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    deform(5.0f);
+    compute_bounds();
+    bvh_refit(&b, tri_bounds);
+    check_bvh(&b);
+    bvh_free(&b);
+}
+
+void test_bvh_refit_triangles(void) {
+    bvh b;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    deform(5.0f);
+    compute_bounds();
+    bvh_refit_triangles(&b, positions, indices);
+    check_bvh(&b);
+    bvh_free(&b);
+}
+
+void test_bvh_rotate_lowers_cost(void) {
+    bvh b;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    deform(40.0f);
+    compute_bounds();
+    bvh_refit(&b, tri_bounds);
+    f32 drifted = bvh_sah_cost(&b);
+    TEST_ASSERT_TRUE(drifted > b.build_cost);
+
+    TEST_ASSERT_TRUE(bvh_rotate(&b) > 0);
+    check_bvh(&b);
+    f32 rotated = bvh_sah_cost(&b);
+    TEST_ASSERT_TRUE(rotated < drifted);
+
+    bvh_optimize(&b, 1.0f, 16);
+    check_bvh(&b);
+    TEST_ASSERT_TRUE(bvh_sah_cost(&b) <= rotated);
+    bvh_free(&b);
+}
+
+static ray3 random_ray(void) {
+    ray3 r;
+    r.origin.x = rand_f32() * 140.0f - 20.0f;
+    r.origin.y = rand_f32() * 140.0f - 20.0f;
+    r.origin.z = -10.0f;
+    point3 target = {rand_f32() * 100.0f, rand_f32() * 100.0f, rand_f32() * 100.0f};
+    r.dir = vec3_normal(vec3_sub(target, r.origin));
+    return r;
+}
+
+static b32 brute_force_intersect(const ray3 r, ray3_hit* hit) {
+    b32 found = 0;
+    hit->t = FLT_MAX;
+    for (u32 i = 0; i < TEST_TRIS; ++i) {
+        f32 t, u, v;
+        if (ray3_triangle(r, positions[indices[i * 3]], positions[indices[i * 3 + 1]],
+                positions[indices[i * 3 + 2]], &t, &u, &v) && t < hit->t) {
+            hit->t = t;
+            hit->prim = i;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+void test_bvh_wide_matches_brute_force(void) {
+    make_query_triangles();
+    bvh b;
+    bvh_wide w;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    TEST_ASSERT_TRUE(bvh_wide_build(&w, &b));
+    TEST_ASSERT_EQUAL_UINT32(TEST_TRIS, w.prim_count);
+
+    u32 hits = 0;
+    for (u32 i = 0; i < 2000; ++i) {
+        ray3 r = random_ray();
+        ray3_hit expected;
+        ray3_hit actual;
+        b32 e = brute_force_intersect(r, &expected);
+        b32 a = bvh_wide_intersect(&w, positions, indices, r, FLT_MAX, &actual);
+        TEST_ASSERT_EQUAL_INT(e, a);
+        if (e) {
+            TEST_ASSERT_EQUAL_UINT32(expected.prim, actual.prim);
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.t, actual.t);
+            ++hits;
+        }
+    }
+    TEST_ASSERT_TRUE(hits > 100);
+
+#if BVH_WIDE_BITS == 8
+    // 8-bit wide nodes should take a fraction of the binary nodes, and
+    // only the nodes used are allocated.
+    TEST_ASSERT_EQUAL_UINT32(w.node_count, w.node_capacity);
+    u64 binary_bytes = (u64)b.node_count * sizeof(bvh_node);
+    u64 wide_bytes = (u64)w.node_capacity * sizeof(bvh_wide_node);
+    TEST_ASSERT_TRUE(wide_bytes * 2 < binary_bytes);
+#endif
+
+    bvh_wide_free(&w);
+    bvh_free(&b);
+}
+
+void test_bvh_intersect_matches_brute_force(void) {
+    make_query_triangles();
+    bvh b;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    for (u32 i = 0; i < 2000; ++i) {
+        ray3 r = random_ray();
+        ray3_hit expected;
+        ray3_hit actual;
+        b32 e = brute_force_intersect(r, &expected);
+        TEST_ASSERT_EQUAL_INT(e, bvh_intersect(&b, positions, indices, r, FLT_MAX, &actual));
+        if (e) {
+            TEST_ASSERT_EQUAL_UINT32(expected.prim, actual.prim);
+        } else {
+            TEST_ASSERT_EQUAL_UINT32(BVH_NO_HIT, actual.prim);
+        }
+    }
+    bvh_free(&b);
+}
+
+void test_bvh_closest_point_matches_brute_force(void) {
+    make_query_triangles();
+    bvh b;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    for (u32 i = 0; i < 500; ++i) {
+        point3 p = {rand_f32() * 120.0f - 10.0f, rand_f32() * 120.0f - 10.0f, rand_f32() * 120.0f - 10.0f};
+        f32 expected = FLT_MAX;
+        for (u32 t = 0; t < TEST_TRIS; ++t) {
+            point3 q = closest_point_triangle(p, positions[indices[t * 3]], positions[indices[t * 3 + 1]],
+                positions[indices[t * 3 + 2]]);
+            f32 d = vec3_len_sq(vec3_sub(q, p));
+            expected = d < expected ? d : expected;
+        }
+        bvh_point_hit hit;
+        TEST_ASSERT_TRUE(bvh_closest_point(&b, positions, indices, p, FLT_MAX, &hit));
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, expected, hit.dist_sq);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.0f, hit.bary[0] + hit.bary[1] + hit.bary[2]);
+
+        // Nothing within a radius below the true distance.
+        TEST_ASSERT_FALSE(bvh_closest_point(&b, positions, indices, p, sqrtf(expected) * 0.9f, &hit));
+    }
+    bvh_free(&b);
+}
+
+// Camera style packet: one origin, directions spread over a small cone.
+static void coherent_packet(ray3* rays, u32 count) {
+    point3 origin = {rand_f32() * 100.0f, rand_f32() * 100.0f, -10.0f};
+    point3 target = {rand_f32() * 100.0f, rand_f32() * 100.0f, 50.0f};
+    for (u32 i = 0; i < count; ++i) {
+        point3 t = {target.x + rand_f32() * 6.0f, target.y + rand_f32() * 6.0f, target.z};
+        rays[i].origin = origin;
+        rays[i].dir = vec3_normal(vec3_sub(t, origin));
+    }
+}
+
+void test_bvh_intersect_packet(void) {
+    make_query_triangles();
+    bvh b;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    for (u32 k = 0; k < 400; ++k) {
+        ray3 rays[BVH_PACKET_SIZE];
+        ray3_hit hits[BVH_PACKET_SIZE];
+        u32 count = k % 2 ? BVH_PACKET_SIZE : 1 + k % BVH_PACKET_SIZE;
+        if (k % 4 == 3) {
+            for (u32 i = 0; i < count; ++i) {
+                rays[i] = random_ray();
+            }
+        } else {
+            coherent_packet(rays, count);
+        }
+        u32 mask = bvh_intersect_packet(&b, positions, indices, rays, count, FLT_MAX, hits);
+        for (u32 i = 0; i < count; ++i) {
+            ray3_hit expected;
+            b32 e = brute_force_intersect(rays[i], &expected);
+            TEST_ASSERT_EQUAL_INT(e, (mask >> i) & 1);
+            if (e) {
+                TEST_ASSERT_EQUAL_UINT32(expected.prim, hits[i].prim);
+            }
+        }
+    }
+    bvh_free(&b);
+}
+
+void test_bvh_intersect_stream(void) {
+    make_query_triangles();
+    enum { STREAM_RAYS = 3000 };
+    static ray3 rays[STREAM_RAYS];
+    static ray3_hit hits[STREAM_RAYS];
+    bvh b;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    for (u32 i = 0; i < STREAM_RAYS; ++i) {
+        rays[i] = random_ray();
+        rays[i].origin.z = i % 2 ? -10.0f : 110.0f;
+        if (i % 3 == 0) {
+            vec3_negate(&rays[i].dir);
+            rays[i].origin = vec3_sub(rays[i].origin, vec3_mul_s(rays[i].dir, 200.0f));
+        }
+    }
+    u32 found = bvh_intersect_stream(&b, positions, indices, rays, STREAM_RAYS, FLT_MAX, hits);
+    u32 expected_found = 0;
+    for (u32 i = 0; i < STREAM_RAYS; ++i) {
+        ray3_hit expected;
+        if (brute_force_intersect(rays[i], &expected)) {
+            ++expected_found;
+            TEST_ASSERT_EQUAL_UINT32(expected.prim, hits[i].prim);
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.t, hits[i].t);
+        } else {
+            TEST_ASSERT_EQUAL_UINT32(BVH_NO_HIT, hits[i].prim);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(expected_found, found);
+    bvh_free(&b);
+}
+
+void test_bvh_save_and_map(void) {
+    make_query_triangles();
+    bvh b;
+    bvh_build(&b, tri_bounds, TEST_TRIS);
+    const char* path = "test_ys_bvh.bin";
+    TEST_ASSERT_TRUE(bvh_save(&b, path));
+
+    bvh mapped;
+    mapped_file f;
+    TEST_ASSERT_TRUE(bvh_load_mapped(&mapped, &f, path));
+    TEST_ASSERT_EQUAL_UINT32(b.node_count, mapped.node_count);
+    TEST_ASSERT_EQUAL_UINT32(b.prim_count, mapped.prim_count);
+    TEST_ASSERT_EQUAL_MEMORY(b.nodes, mapped.nodes, b.node_count * sizeof(bvh_node));
+    TEST_ASSERT_EQUAL_MEMORY(b.prims, mapped.prims, b.prim_count * sizeof(u32));
+
+    for (u32 i = 0; i < 200; ++i) {
+        ray3 r = random_ray();
+        ray3_hit expected;
+        ray3_hit actual;
+        TEST_ASSERT_EQUAL_INT(bvh_intersect(&b, positions, indices, r, FLT_MAX, &expected),
+            bvh_intersect(&mapped, positions, indices, r, FLT_MAX, &actual));
+        TEST_ASSERT_EQUAL_UINT32(expected.prim, actual.prim);
+    }
+    unmap_file(&f);
+    remove(path);
+    bvh_free(&b);
+}
+
+void test_bvh_deserialize_rejects_bad_images(void) {
+    make_query_triangles();
+    bvh b;
+    bvh_build(&b, tri_bounds, 64);
+    u64 size = bvh_serialized_size(&b);
+    u64* image = (u64*)malloc(size + BVH_FILE_ALIGN);
+    u8* aligned = (u8*)(((uintptr_t)image + BVH_FILE_ALIGN - 1) & ~(uintptr_t)(BVH_FILE_ALIGN - 1));
+    TEST_ASSERT_EQUAL_UINT64(size, bvh_serialize(&b, aligned, size));
+
+    bvh view;
+    TEST_ASSERT_TRUE(bvh_deserialize(&view, aligned, size));
+    TEST_ASSERT_FALSE(bvh_deserialize(&view, aligned, size - 1));
+    bvh_file_header* h = (bvh_file_header*)aligned;
+    bvh_node* nodes = (bvh_node*)(aligned + h->nodes_offset);
+    h->version = BVH_FILE_VERSION + 1;
+    TEST_ASSERT_FALSE(bvh_deserialize(&view, aligned, size));
+    bvh_serialize(&b, aligned, size);
+    h->magic = BVH_FILE_MAGIC_SWAPPED;
+    TEST_ASSERT_FALSE(bvh_deserialize(&view, aligned, size));
+    // Offsets that wrap around.
+    bvh_serialize(&b, aligned, size);
+    h->nodes_offset = ~(u64)0 - (BVH_FILE_ALIGN - 1);
+    TEST_ASSERT_FALSE(bvh_deserialize(&view, aligned, size));
+    // A child past the node array.
+    bvh_serialize(&b, aligned, size);
+    nodes[0].first = h->node_count - 1;
+    TEST_ASSERT_FALSE(bvh_deserialize(&view, aligned, size));
+    // A cycle back to the root.
+    bvh_serialize(&b, aligned, size);
+    nodes[nodes[0].first].count = 0;
+    nodes[nodes[0].first].first = 0;
+    TEST_ASSERT_FALSE(bvh_deserialize(&view, aligned, size));
+    // A leaf past the primitive array.
+    bvh_serialize(&b, aligned, size);
+    for (u32 i = 0; i < h->node_count; ++i) {
+        if (nodes[i].count) {
+            nodes[i].first = h->prim_count;
+            break;
+        }
+    }
+    TEST_ASSERT_FALSE(bvh_deserialize(&view, aligned, size));
+    free(image);
+    bvh_free(&b);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_aabb3_area);
+    RUN_TEST(test_bvh_build);
+    RUN_TEST(test_bvh_build_single_prim);
+    RUN_TEST(test_bvh_refit);
+    RUN_TEST(test_bvh_refit_triangles);
+    RUN_TEST(test_bvh_rotate_lowers_cost);
+    RUN_TEST(test_bvh_wide_matches_brute_force);
+    RUN_TEST(test_bvh_intersect_matches_brute_force);
+    RUN_TEST(test_bvh_intersect_packet);
+    RUN_TEST(test_bvh_intersect_stream);
+    RUN_TEST(test_bvh_closest_point_matches_brute_force);
+    RUN_TEST(test_bvh_save_and_map);
+    RUN_TEST(test_bvh_deserialize_rejects_bad_images);
+
+    return UNITY_END();
+}
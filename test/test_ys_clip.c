@@ -0,0 +1,259 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_CLIP_IMPLEMENTATION
+#include "../src/ys_clip.h"
+#include <math.h>
+
+#define TEST_EPSILON 1e-4f
+#define RANDOM_TRIANGLES 2000
+#define SAMPLE_GRID 48
+
+static u32 rng_state;
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / 16777216.0f;
+}
+
+static vec4 make_vec4(f32 x, f32 y, f32 z, f32 w) {
+    vec4 v = {{x, y, z, w}};
+    return v;
+}
+
+static f32 cross2(const f32 ax, const f32 ay, const f32 bx, const f32 by, const f32 px, const f32 py) {
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// Whether (px, py) is strictly inside the convex polygon after the
+// perspective divide, by at least `margin` from each edge.
+static b32 inside_projected(const vec4* v, const u32 count, const f32 px, const f32 py, const f32 margin) {
+    f32 area = 0.0f;
+    for (u32 i = 0; i < count; ++i) {
+        vec4 a = v[i], b = v[(i + 1) % count];
+        area += a.x / a.w * (b.y / b.w) - b.x / b.w * (a.y / a.w);
+    }
+    f32 s = area > 0.0f ? 1.0f : -1.0f;
+    for (u32 i = 0; i < count; ++i) {
+        vec4 a = v[i], b = v[(i + 1) % count];
+        f32 ax = a.x / a.w, ay = a.y / a.w, bx = b.x / b.w, by = b.y / b.w;
+        f32 len = sqrtf((bx - ax) * (bx - ax) + (by - ay) * (by - ay));
+        if (s * cross2(ax, ay, bx, by, px, py) <= margin * len) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Clipped vertices are inside the planes they were clipped against and
+// their weights rebuild them from the source triangle.
+static void check_vertices(const vec4* tri, const clip_vertex* out, const u32 n, const u8 planes) {
+    for (u32 i = 0; i < n; ++i) {
+        vec4 p = out[i].position;
+        vec4 r = vec4_add(vec4_add(vec4_mul_s(tri[0], out[i].weights.x), vec4_mul_s(tri[1], out[i].weights.y)),
+            vec4_mul_s(tri[2], out[i].weights.z));
+        for (u32 k = 0; k < 4; ++k) {
+            TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON * (1.0f + fabsf(p.e[k])), p.e[k], r.e[k]);
+        }
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 1.0f, out[i].weights.x + out[i].weights.y + out[i].weights.z);
+        u8 code;
+        clip_outcodes(&p, 1, &code);
+        TEST_ASSERT_EQUAL_UINT8(0, code & planes);
+    }
+}
+
+void setUp(void) {
+    rng_state = 11;
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// CLASSIFICATION TESTS
+// =============================================================================
+
+void test_clip_outcodes(void) {
+    vec4 v[] = {
+        make_vec4(0.0f, 0.0f, 0.0f, 1.0f),
+        make_vec4(-2.0f, 0.5f, 0.0f, 1.0f),
+        make_vec4(3.0f, 3.0f, 0.0f, 2.0f),
+        make_vec4(0.0f, -1.0f, 5.0f, 1.0f),
+        make_vec4(0.0f, 0.0f, -2.0f, 1.0f),
+        make_vec4(1.0f, -1.0f, 1.0f, 1.0f),
+    };
+    u8 codes[6];
+    clip_outcodes(v, 6, codes);
+    TEST_ASSERT_EQUAL_UINT8(0, codes[0]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_LEFT, codes[1]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_RIGHT | CLIP_TOP, codes[2]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_FAR, codes[3]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_NEAR, codes[4]);
+    // On the planes counts as inside.
+    TEST_ASSERT_EQUAL_UINT8(0, codes[5]);
+}
+
+void test_clip_classify(void) {
+    vec4 v[] = {
+        make_vec4(0.0f, 0.0f, 0.0f, 1.0f),
+        make_vec4(0.5f, 0.0f, 0.0f, 1.0f),
+        make_vec4(0.0f, 0.5f, 0.0f, 1.0f),
+        make_vec4(-3.0f, 0.0f, 0.0f, 1.0f),
+        make_vec4(-3.0f, 5.0f, 0.0f, 1.0f),
+        make_vec4(0.0f, 0.0f, -4.0f, 1.0f),
+    };
+    u32 indices[] = {
+        0, 1, 2,
+        3, 4, 3,
+        0, 1, 3,
+        0, 1, 5,
+        // Outside left and top, but never all outside one plane.
+        4, 1, 2,
+    };
+    u8 codes[6];
+    u8 masks[5];
+    clip_outcodes(v, 6, codes);
+    TEST_ASSERT_EQUAL_UINT32(3, clip_classify(codes, indices, 5, CLIP_ALL, masks));
+    TEST_ASSERT_EQUAL_UINT8(0, masks[0]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_REJECT, masks[1]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_LEFT, masks[2]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_NEAR, masks[3]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_LEFT | CLIP_TOP, masks[4]);
+
+    // Guard band: only depth planes need clipping, rejects still apply.
+    TEST_ASSERT_EQUAL_UINT32(1, clip_classify(codes, indices, 5, CLIP_NEAR | CLIP_FAR, masks));
+    TEST_ASSERT_EQUAL_UINT8(0, masks[0]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_REJECT, masks[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, masks[2]);
+    TEST_ASSERT_EQUAL_UINT8(CLIP_NEAR, masks[3]);
+    TEST_ASSERT_EQUAL_UINT8(0, masks[4]);
+}
+
+// =============================================================================
+// CLIPPING TESTS
+// =============================================================================
+
+void test_clip_triangle_covering(void) {
+    vec4 tri[] = {
+        make_vec4(-3.0f, -3.0f, 0.0f, 1.0f),
+        make_vec4(9.0f, -3.0f, 0.0f, 1.0f),
+        make_vec4(-3.0f, 9.0f, 0.0f, 1.0f),
+    };
+    clip_vertex out[CLIP_MAX_VERTICES];
+    u32 n = clip_triangle(tri[0], tri[1], tri[2], CLIP_ALL, out);
+    TEST_ASSERT_EQUAL_UINT32(4, n);
+    check_vertices(tri, out, n, CLIP_ALL);
+    f32 area = 0.0f;
+    for (u32 i = 0; i < n; ++i) {
+        vec4 a = out[i].position, b = out[(i + 1) % n].position;
+        area += a.x * b.y - b.x * a.y;
+    }
+    // Counterclockwise like the source triangle.
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 8.0f, area);
+
+    // Nothing to clip against leaves the triangle alone.
+    TEST_ASSERT_EQUAL_UINT32(3, clip_triangle(tri[0], tri[1], tri[2], 0, out));
+    TEST_ASSERT_EQUAL_FLOAT(9.0f, out[1].position.x);
+    TEST_ASSERT_EQUAL_UINT32(0, clip_triangle(tri[0], tri[0], tri[0], CLIP_ALL, out));
+}
+
+void test_clip_random_against_samples(void) {
+    clip_vertex out[CLIP_MAX_VERTICES];
+    for (u32 it = 0; it < RANDOM_TRIANGLES; ++it) {
+        vec4 tri[3];
+        for (u32 k = 0; k < 3; ++k) {
+            f32 w = 0.5f + rand_f32() * 1.5f;
+            tri[k] = make_vec4((rand_f32() * 5.0f - 2.5f) * w, (rand_f32() * 5.0f - 2.5f) * w,
+                (rand_f32() - 0.5f) * w, w);
+        }
+        u8 codes[3];
+        u8 mask;
+        u32 indices[] = {0, 1, 2};
+        clip_outcodes(tri, 3, codes);
+        clip_classify(codes, indices, 1, CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP, &mask);
+        u32 n = mask == CLIP_REJECT ? 0 : clip_triangle(tri[0], tri[1], tri[2], mask, out);
+        check_vertices(tri, out, n, CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP);
+        vec4 polygon[CLIP_MAX_VERTICES];
+        for (u32 i = 0; i < n; ++i) {
+            polygon[i] = out[i].position;
+        }
+        // Away from the borders, a sample is in the clipped polygon exactly
+        // when it is in both the triangle and the clip square.
+        for (u32 sy = 0; sy < SAMPLE_GRID; ++sy) {
+            for (u32 sx = 0; sx < SAMPLE_GRID; ++sx) {
+                f32 px = -1.2f + 2.4f * (sx + 0.5f) / SAMPLE_GRID;
+                f32 py = -1.2f + 2.4f * (sy + 0.5f) / SAMPLE_GRID;
+                f32 m = 1e-3f;
+                b32 in_square = fabsf(px) < 1.0f - m && fabsf(py) < 1.0f - m;
+                b32 out_square = fabsf(px) > 1.0f + m || fabsf(py) > 1.0f + m;
+                b32 in_tri = inside_projected(tri, 3, px, py, m);
+                b32 out_tri = !inside_projected(tri, 3, px, py, -m);
+                if (in_square && in_tri) {
+                    TEST_ASSERT_TRUE(n >= 3 && inside_projected(polygon, n, px, py, 0.0f));
+                } else if ((out_square || out_tri) && n >= 3) {
+                    TEST_ASSERT_FALSE(inside_projected(polygon, n, px, py, 0.0f));
+                }
+            }
+        }
+    }
+}
+
+void test_clip_near_plane(void) {
+    // Perspective projection, near 1 and far 100, of a triangle reaching
+    // behind the eye.
+    f32 n = 1.0f, f = 100.0f;
+    f32 a = -(f + n) / (f - n), b = -2.0f * f * n / (f - n);
+    f32 eye[3][3] = {{-1.0f, -1.0f, -5.0f}, {1.0f, -1.0f, -5.0f}, {0.0f, 1.0f, 3.0f}};
+    vec4 tri[3];
+    for (u32 k = 0; k < 3; ++k) {
+        tri[k] = make_vec4(eye[k][0], eye[k][1], a * eye[k][2] + b, -eye[k][2]);
+    }
+    clip_vertex out[CLIP_MAX_VERTICES];
+    u32 count = clip_triangle(tri[0], tri[1], tri[2], CLIP_NEAR, out);
+    TEST_ASSERT_EQUAL_UINT32(4, count);
+    check_vertices(tri, out, count, CLIP_NEAR);
+    for (u32 i = 0; i < count; ++i) {
+        TEST_ASSERT_TRUE(out[i].position.w > n - TEST_EPSILON);
+    }
+}
+
+void test_clip_shared_edge(void) {
+    // Two triangles share the edge (p, q) across the left plane, walked in
+    // opposite directions; both must cut it at the same point.
+    vec4 p = make_vec4(-2.3f, 0.1f, 0.2f, 1.1f);
+    vec4 q = make_vec4(0.7f, 0.3f, -0.1f, 0.9f);
+    vec4 r = make_vec4(0.1f, 0.8f, 0.0f, 1.0f);
+    vec4 s = make_vec4(0.2f, -0.6f, 0.1f, 1.3f);
+    clip_vertex first[CLIP_MAX_VERTICES];
+    clip_vertex second[CLIP_MAX_VERTICES];
+    u32 n1 = clip_triangle(p, q, r, CLIP_ALL, first);
+    u32 n2 = clip_triangle(q, p, s, CLIP_ALL, second);
+    u32 matches = 0;
+    for (u32 i = 0; i < n1; ++i) {
+        for (u32 j = 0; j < n2; ++j) {
+            vec4 a = first[i].position, b = second[j].position;
+            matches += a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+        }
+    }
+    // The cut point and q.
+    TEST_ASSERT_EQUAL_UINT32(2, matches);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Classification tests
+    RUN_TEST(test_clip_outcodes);
+    RUN_TEST(test_clip_classify);
+
+    // Clipping tests
+    RUN_TEST(test_clip_triangle_covering);
+    RUN_TEST(test_clip_random_against_samples);
+    RUN_TEST(test_clip_near_plane);
+    RUN_TEST(test_clip_shared_edge);
+
+    return UNITY_END();
+}
@@ -0,0 +1,286 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_MORTON_IMPLEMENTATION
+#define YS_PREDICATES_IMPLEMENTATION
+#define YS_DELAUNAY_IMPLEMENTATION
+#include "../src/ys_delaunay.h"
+#include <math.h>
+
+#define POINT_COUNT 20000
+#define GRID_SIZE 40
+#define TILE_COUNT 6
+
+static u32 rng_state;
+static delaunay d;
+static point2 points[POINT_COUNT];
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / 16777216.0f;
+}
+
+static b32 is_ghost(const u32 t) {
+    return d.triangles[t * 3] == DELAUNAY_INFINITE || d.triangles[t * 3 + 1] == DELAUNAY_INFINITE
+        || d.triangles[t * 3 + 2] == DELAUNAY_INFINITE;
+}
+
+// Twins match, finite triangles turn counterclockwise, every kept vertex
+// is used, and each unconstrained edge between finite triangles is locally
+// Delaunay, which makes the whole triangulation (constrained) Delaunay.
+// Returns the number of finite triangles.
+static u32 check_triangulation(const u32 count) {
+    u32 finite = 0;
+    for (u32 e = 0; e < d.triangle_count * 3; ++e) {
+        u32 f = d.halfedges[e];
+        TEST_ASSERT_EQUAL_UINT32(e, d.halfedges[f]);
+        TEST_ASSERT_EQUAL_UINT32(d.triangles[e], d.triangles[f - f % 3 + (f + 1) % 3]);
+        TEST_ASSERT_EQUAL_UINT8(d.constrained[e], d.constrained[f]);
+    }
+    for (u32 t = 0; t < d.triangle_count; ++t) {
+        if (is_ghost(t)) {
+            continue;
+        }
+        ++finite;
+        const u32* v = d.triangles + t * 3;
+        TEST_ASSERT_TRUE(orient2d(points[v[0]], points[v[1]], points[v[2]]) > 0.0);
+        for (u32 i = 0; i < 3; ++i) {
+            u32 f = d.halfedges[t * 3 + i];
+            if (d.constrained[t * 3 + i] || is_ghost(f / 3)) {
+                continue;
+            }
+            u32 y = d.triangles[f - f % 3 + (f + 2) % 3];
+            TEST_ASSERT_TRUE(incircle(points[v[0]], points[v[1]], points[v[2]], points[y]) <= 0.0);
+        }
+    }
+    for (u32 i = 0; i < count; ++i) {
+        u32 v = d.vertex_map[i];
+        TEST_ASSERT_TRUE(points[v].x == points[i].x && points[v].y == points[i].y);
+        TEST_ASSERT_TRUE(v == i || d.vertex_map[v] == v);
+    }
+    return finite;
+}
+
+static u32 unique_vertices(const u32 count) {
+    u32 n = 0;
+    for (u32 i = 0; i < count; ++i) {
+        n += d.vertex_map[i] == i;
+    }
+    return n;
+}
+
+static u32 hull_vertices(void) {
+    u32 n = 0;
+    for (u32 t = 0; t < d.triangle_count; ++t) {
+        n += is_ghost(t);
+    }
+    return n;
+}
+
+static b32 has_constrained_edge(const u32 a, const u32 b) {
+    for (u32 e = 0; e < d.triangle_count * 3; ++e) {
+        if (d.triangles[e] == a && d.triangles[e - e % 3 + (e + 1) % 3] == b) {
+            return d.constrained[e];
+        }
+    }
+    return 0;
+}
+
+static void make_grid(void) {
+    for (u32 y = 0; y < GRID_SIZE; ++y) {
+        for (u32 x = 0; x < GRID_SIZE; ++x) {
+            points[y * GRID_SIZE + x].x = (f32)x;
+            points[y * GRID_SIZE + x].y = (f32)y;
+        }
+    }
+}
+
+void setUp(void) {
+    rng_state = 3;
+    delaunay_create(&d, POINT_COUNT);
+}
+
+void tearDown(void) {
+    delaunay_free(&d);
+}
+
+// =============================================================================
+// DELAUNAY TESTS
+// =============================================================================
+
+void test_delaunay_random(void) {
+    for (u32 i = 0; i < POINT_COUNT; ++i) {
+        points[i].x = rand_f32() * 100.0f;
+        points[i].y = rand_f32() * 100.0f;
+    }
+    TEST_ASSERT_TRUE(delaunay_build(&d, points, POINT_COUNT));
+    u32 finite = check_triangulation(POINT_COUNT);
+    u32 n = unique_vertices(POINT_COUNT);
+    // Euler: 2n - 2 - h triangles for h hull vertices.
+    TEST_ASSERT_EQUAL_UINT32(2 * n - 2 - hull_vertices(), finite);
+    TEST_ASSERT_EQUAL_UINT32(2 * n - 2, d.triangle_count);
+}
+
+void test_delaunay_grid_with_duplicates(void) {
+    // Cocircular and collinear everywhere, plus every point twice.
+    make_grid();
+    for (u32 i = 0; i < GRID_SIZE * GRID_SIZE; ++i) {
+        points[GRID_SIZE * GRID_SIZE + i] = points[i];
+    }
+    u32 count = GRID_SIZE * GRID_SIZE * 2;
+    TEST_ASSERT_TRUE(delaunay_build(&d, points, count));
+    u32 finite = check_triangulation(count);
+    TEST_ASSERT_EQUAL_UINT32(GRID_SIZE * GRID_SIZE, unique_vertices(count));
+    TEST_ASSERT_EQUAL_UINT32(2 * (GRID_SIZE - 1) * (GRID_SIZE - 1), finite);
+    TEST_ASSERT_EQUAL_UINT32(4 * (GRID_SIZE - 1), hull_vertices());
+}
+
+void test_delaunay_degenerate(void) {
+    for (u32 i = 0; i < 100; ++i) {
+        points[i].x = (f32)i * 0.37f;
+        points[i].y = (f32)i * 0.37f;
+    }
+    TEST_ASSERT_TRUE(delaunay_build(&d, points, 100));
+    TEST_ASSERT_EQUAL_UINT32(0, d.triangle_count);
+    TEST_ASSERT_TRUE(delaunay_build(&d, points, 2));
+    TEST_ASSERT_EQUAL_UINT32(0, d.triangle_count);
+
+    // Collinear points first in Hilbert order, then one off the line.
+    points[100].x = 50.0f;
+    points[100].y = 0.0f;
+    TEST_ASSERT_TRUE(delaunay_build(&d, points, 101));
+    check_triangulation(101);
+    TEST_ASSERT_EQUAL_UINT32(2 * 101 - 2, d.triangle_count);
+    TEST_ASSERT_FALSE(delaunay_build(&d, points, POINT_COUNT + 1));
+}
+
+void test_delaunay_constrained(void) {
+    for (u32 i = 0; i < 4000; ++i) {
+        points[i].x = rand_f32() * 100.0f;
+        points[i].y = rand_f32() * 100.0f;
+    }
+    // A long diagonal, a polyline, and a segment through collinear points.
+    points[4000].x = 1.0f;
+    points[4000].y = 2.0f;
+    points[4001].x = 98.0f;
+    points[4001].y = 97.0f;
+    points[4002].x = 10.0f;
+    points[4002].y = 90.0f;
+    points[4003].x = 50.0f;
+    points[4003].y = 80.0f;
+    points[4004].x = 70.0f;
+    points[4004].y = 95.0f;
+    for (u32 i = 0; i < 5; ++i) {
+        points[4005 + i].x = 40.0f + 12.0f * i;
+        points[4005 + i].y = 25.0f;
+    }
+    TEST_ASSERT_TRUE(delaunay_build(&d, points, 4010));
+    u32 unconstrained = check_triangulation(4010);
+    u32 edges[] = {4000, 4001, 4002, 4003, 4003, 4004, 4005, 4009, 4001, 4000};
+    TEST_ASSERT_TRUE(delaunay_constrain(&d, edges, 5));
+    TEST_ASSERT_EQUAL_UINT32(unconstrained, check_triangulation(4010));
+    TEST_ASSERT_TRUE(has_constrained_edge(4000, 4001));
+    TEST_ASSERT_TRUE(has_constrained_edge(4001, 4000));
+    TEST_ASSERT_TRUE(has_constrained_edge(4002, 4003));
+    TEST_ASSERT_TRUE(has_constrained_edge(4003, 4004));
+    for (u32 i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(has_constrained_edge(4005 + i, 4006 + i));
+    }
+    u32 constrained = 0;
+    for (u32 e = 0; e < d.triangle_count * 3; ++e) {
+        constrained += d.constrained[e];
+    }
+    TEST_ASSERT_EQUAL_UINT32(2 * 7, constrained);
+
+    // Crossing an earlier constraint fails.
+    u32 crossing[] = {4002, 4009};
+    TEST_ASSERT_FALSE(delaunay_constrain(&d, crossing, 1));
+}
+
+void test_delaunay_constrained_grid(void) {
+    // Constraints on a grid run through vertices and along cocircular
+    // quads.
+    make_grid();
+    TEST_ASSERT_TRUE(delaunay_build(&d, points, GRID_SIZE * GRID_SIZE));
+    u32 edges[] = {
+        0, GRID_SIZE * GRID_SIZE - 1,
+        GRID_SIZE - 1, GRID_SIZE * (GRID_SIZE - 1),
+        GRID_SIZE * 3, GRID_SIZE * 3 + GRID_SIZE - 1,
+    };
+    TEST_ASSERT_FALSE(delaunay_constrain(&d, edges, 3));
+    TEST_ASSERT_TRUE(delaunay_build(&d, points, GRID_SIZE * GRID_SIZE));
+    u32 knight[] = {GRID_SIZE * 5 + 5, GRID_SIZE * 6 + 7, GRID_SIZE * 10 + 2, GRID_SIZE * 11 + 30};
+    TEST_ASSERT_TRUE(delaunay_constrain(&d, knight, 2));
+    TEST_ASSERT_TRUE(delaunay_constrain(&d, edges + 4, 1));
+    check_triangulation(GRID_SIZE * GRID_SIZE);
+    TEST_ASSERT_TRUE(has_constrained_edge(GRID_SIZE * 5 + 5, GRID_SIZE * 6 + 7));
+    TEST_ASSERT_TRUE(has_constrained_edge(GRID_SIZE * 10 + 2, GRID_SIZE * 11 + 30));
+    for (u32 x = 0; x + 1 < GRID_SIZE; ++x) {
+        TEST_ASSERT_TRUE(has_constrained_edge(GRID_SIZE * 3 + x, GRID_SIZE * 3 + x + 1));
+    }
+}
+
+void test_delaunay_tiles(void) {
+    static point2 tile_points[TILE_COUNT][1000];
+    delaunay tiles[TILE_COUNT];
+    const point2* tile_inputs[TILE_COUNT];
+    u32 counts[TILE_COUNT];
+    const u32* tile_edges[TILE_COUNT] = {0};
+    u32 edge_counts[TILE_COUNT] = {0};
+    u32 square[] = {0, 1, 1, 2, 2, 3, 3, 0};
+    for (u32 t = 0; t < TILE_COUNT; ++t) {
+        counts[t] = 200 + 150 * t;
+        for (u32 i = 0; i < counts[t]; ++i) {
+            tile_points[t][i].x = t * 10.0f + rand_f32() * 10.0f;
+            tile_points[t][i].y = rand_f32() * 10.0f;
+        }
+        tile_points[t][0].x = t * 10.0f + 2.0f;
+        tile_points[t][0].y = 2.0f;
+        tile_points[t][1].x = t * 10.0f + 8.0f;
+        tile_points[t][1].y = 2.0f;
+        tile_points[t][2].x = t * 10.0f + 8.0f;
+        tile_points[t][2].y = 8.0f;
+        tile_points[t][3].x = t * 10.0f + 2.0f;
+        tile_points[t][3].y = 8.0f;
+        tile_inputs[t] = tile_points[t];
+        if (t % 2) {
+            tile_edges[t] = square;
+            edge_counts[t] = 4;
+        }
+        TEST_ASSERT_TRUE(delaunay_create(&tiles[t], counts[t]));
+    }
+    TEST_ASSERT_TRUE(delaunay_build_tiles(tiles, tile_inputs, counts, tile_edges, edge_counts, TILE_COUNT));
+    for (u32 t = 0; t < TILE_COUNT; ++t) {
+        for (u32 i = 0; i < counts[t]; ++i) {
+            points[i] = tile_points[t][i];
+        }
+        TEST_ASSERT_TRUE(delaunay_build(&d, points, counts[t]));
+        if (t % 2) {
+            TEST_ASSERT_TRUE(delaunay_constrain(&d, square, 4));
+        }
+        TEST_ASSERT_EQUAL_UINT32(d.triangle_count, tiles[t].triangle_count);
+        for (u32 i = 0; i < d.triangle_count * 3; ++i) {
+            TEST_ASSERT_EQUAL_UINT32(d.triangles[i], tiles[t].triangles[i]);
+            TEST_ASSERT_EQUAL_UINT8(d.constrained[i], tiles[t].constrained[i]);
+        }
+        delaunay_free(&tiles[t]);
+    }
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Delaunay tests
+    RUN_TEST(test_delaunay_random);
+    RUN_TEST(test_delaunay_grid_with_duplicates);
+    RUN_TEST(test_delaunay_degenerate);
+    RUN_TEST(test_delaunay_constrained);
+    RUN_TEST(test_delaunay_constrained_grid);
+    RUN_TEST(test_delaunay_tiles);
+
+    return UNITY_END();
+}
@@ -0,0 +1,575 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#include "../src/ys_geom.h"
+#include <math.h>
+#include <float.h>
+
+#define TEST_EPSILON 1e-5f
+
+static u32 rng_state;
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+static ray3 make_ray(f32 ox, f32 oy, f32 oz, f32 dx, f32 dy, f32 dz) {
+    ray3 r;
+    r.origin.x = ox;
+    r.origin.y = oy;
+    r.origin.z = oz;
+    r.dir.x = dx;
+    r.dir.y = dy;
+    r.dir.z = dz;
+    return r;
+}
+
+void setUp(void) {
+    rng_state = 42;
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// RAY3 PRIMITIVE TESTS
+// =============================================================================
+
+void test_ray3_sphere(void) {
+    sphere s = {{0.0f, 0.0f, 5.0f}, 1.0f};
+    f32 t;
+    TEST_ASSERT_TRUE(ray3_sphere(make_ray(0, 0, 0, 0, 0, 1), s, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 4.0f, t);
+
+    // Unnormalized direction scales t.
+    TEST_ASSERT_TRUE(ray3_sphere(make_ray(0, 0, 0, 0, 0, 2), s, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 2.0f, t);
+
+    TEST_ASSERT_FALSE(ray3_sphere(make_ray(0, 2, 0, 0, 0, 1), s, FLT_MAX, &t));
+    TEST_ASSERT_FALSE(ray3_sphere(make_ray(0, 0, 0, 0, 0, -1), s, FLT_MAX, &t));
+    TEST_ASSERT_FALSE(ray3_sphere(make_ray(0, 0, 0, 0, 0, 1), s, 3.0f, &t));
+
+    // Starting inside hits right away.
+    TEST_ASSERT_TRUE(ray3_sphere(make_ray(0, 0, 5, 1, 0, 0), s, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 0.0f, t);
+}
+
+void test_ray3_plane(void) {
+    plane p = {{0.0f, 1.0f, 0.0f}, 2.0f};
+    f32 t;
+    TEST_ASSERT_TRUE(ray3_plane(make_ray(0, 0, 0, 0, 1, 0), p, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 2.0f, t);
+    TEST_ASSERT_FALSE(ray3_plane(make_ray(0, 0, 0, 1, 0, 0), p, FLT_MAX, &t));
+    TEST_ASSERT_FALSE(ray3_plane(make_ray(0, 0, 0, 0, -1, 0), p, FLT_MAX, &t));
+}
+
+void test_ray3_disk(void) {
+    disk d = {{0.0f, 0.0f, 3.0f}, {0.0f, 0.0f, -1.0f}, 1.0f};
+    f32 t;
+    TEST_ASSERT_TRUE(ray3_disk(make_ray(0.5f, 0.5f, 0, 0, 0, 1), d, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 3.0f, t);
+    TEST_ASSERT_FALSE(ray3_disk(make_ray(1.0f, 1.0f, 0, 0, 0, 1), d, FLT_MAX, &t));
+}
+
+void test_ray3_capsule(void) {
+    capsule c = {{0.0f, 0.0f, 0.0f}, {0.0f, 4.0f, 0.0f}, 1.0f};
+    f32 t;
+    // Side of the cylinder part.
+    TEST_ASSERT_TRUE(ray3_capsule(make_ray(-5, 2, 0, 1, 0, 0), c, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 4.0f, t);
+    // Along the axis into the bottom cap.
+    TEST_ASSERT_TRUE(ray3_capsule(make_ray(0, -5, 0, 0, 1, 0), c, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 4.0f, t);
+    // Into the top cap from above.
+    TEST_ASSERT_TRUE(ray3_capsule(make_ray(0, 9, 0, 0, -1, 0), c, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 4.0f, t);
+    // Passing beside it.
+    TEST_ASSERT_FALSE(ray3_capsule(make_ray(-5, 2, 1.5f, 1, 0, 0), c, FLT_MAX, &t));
+    // Inside.
+    TEST_ASSERT_TRUE(ray3_capsule(make_ray(0, 2, 0.5f, 1, 0, 0), c, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 0.0f, t);
+}
+
+// =============================================================================
+// RAY3 BATCH TESTS
+// =============================================================================
+
+#define BATCH 70
+
+void test_ray3_spheres_matches_scalar(void) {
+    f32 x[BATCH], y[BATCH], z[BATCH], radius[BATCH], t[BATCH];
+    u32 mask[(BATCH + 31) / 32];
+    sphere_soa s = {x, y, z, radius, BATCH};
+    for (u32 i = 0; i < BATCH; ++i) {
+        // Every other sphere sits close to the ray.
+        f32 spread = i % 2 ? 10.0f : 1.0f;
+        z[i] = rand_f32() * 10.0f;
+        x[i] = 0.1f * z[i] + rand_f32() * spread - spread * 0.5f;
+        y[i] = 0.05f * z[i] + rand_f32() * spread - spread * 0.5f;
+        radius[i] = rand_f32() * 2.0f;
+    }
+    ray3 r = make_ray(0, 0, -1, 0.1f, 0.05f, 1);
+    u32 hits = ray3_spheres(r, &s, 8.0f, mask, t);
+    u32 expected_hits = 0;
+    for (u32 i = 0; i < BATCH; ++i) {
+        sphere one = {{x[i], y[i], z[i]}, radius[i]};
+        f32 expected;
+        b32 hit = ray3_sphere(r, one, 8.0f, &expected);
+        expected_hits += hit;
+        TEST_ASSERT_EQUAL_UINT32(hit, (mask[i / 32] >> (i % 32)) & 1);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, hit ? expected : 8.0f, t[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(expected_hits, hits);
+    TEST_ASSERT_TRUE(hits > 0);
+}
+
+void test_ray3_capsules_matches_scalar(void) {
+    f32 ax[BATCH], ay[BATCH], az[BATCH], bx[BATCH], by[BATCH], bz[BATCH], radius[BATCH], t[BATCH];
+    u32 mask[(BATCH + 31) / 32];
+    capsule_soa c = {ax, ay, az, bx, by, bz, radius, BATCH};
+    for (u32 i = 0; i < BATCH; ++i) {
+        f32 spread = i % 2 ? 10.0f : 1.0f;
+        az[i] = rand_f32() * 10.0f;
+        ax[i] = 0.1f * az[i] + rand_f32() * spread - spread * 0.5f;
+        ay[i] = -0.05f * az[i] + rand_f32() * spread - spread * 0.5f;
+        bx[i] = ax[i] + rand_f32() * 4.0f - 2.0f;
+        by[i] = ay[i] + rand_f32() * 4.0f - 2.0f;
+        bz[i] = az[i] + rand_f32() * 4.0f - 2.0f;
+        radius[i] = rand_f32();
+    }
+    ray3 r = make_ray(0, 0, -1, 0.1f, -0.05f, 1);
+    u32 hits = ray3_capsules(r, &c, FLT_MAX, mask, t);
+    for (u32 i = 0; i < BATCH; ++i) {
+        capsule one = {{ax[i], ay[i], az[i]}, {bx[i], by[i], bz[i]}, radius[i]};
+        f32 expected;
+        b32 hit = ray3_capsule(r, one, FLT_MAX, &expected);
+        TEST_ASSERT_EQUAL_UINT32(hit, (mask[i / 32] >> (i % 32)) & 1);
+        if (hit) {
+            TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, expected, t[i]);
+            // The hit point lies on the capsule surface.
+            point3 p = ray3_at(r, t[i]);
+            vec3 ba = vec3_sub(one.b, one.a);
+            f32 s = vec3_dot(vec3_sub(p, one.a), ba) / vec3_len_sq(ba);
+            s = s < 0 ? 0 : s > 1 ? 1 : s;
+            f32 dist = vec3_len(vec3_sub(p, vec3_add(one.a, vec3_mul_s(ba, s))));
+            if (t[i] > 0) {
+                TEST_ASSERT_FLOAT_WITHIN(1e-3f, radius[i], dist);
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(hits > 0);
+}
+
+void test_ray3_planes_and_disks(void) {
+    f32 nx[2] = {0.0f, 1.0f}, ny[2] = {0.0f, 0.0f}, nz[2] = {1.0f, 0.0f}, d[2] = {5.0f, -1.0f};
+    f32 t[2];
+    u32 mask[1];
+    plane_soa p = {nx, ny, nz, d, 2};
+    ray3 r = make_ray(0, 0, 0, 0, 0, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, ray3_planes(r, &p, FLT_MAX, mask, t));
+    TEST_ASSERT_EQUAL_UINT32(1, mask[0]);
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 5.0f, t[0]);
+
+    f32 cx[2] = {0.0f, 3.0f}, cy[2] = {0.0f, 0.0f}, cz[2] = {2.0f, 2.0f}, radius[2] = {1.0f, 1.0f};
+    disk_soa ds = {cx, cy, cz, nx, ny, nz, radius, 2};
+    nx[1] = 0.0f;
+    nz[1] = 1.0f;
+    TEST_ASSERT_EQUAL_UINT32(1, ray3_disks(r, &ds, FLT_MAX, mask, t));
+    TEST_ASSERT_EQUAL_UINT32(1, mask[0]);
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 2.0f, t[0]);
+}
+
+// =============================================================================
+// FRUSTUM TESTS
+// =============================================================================
+
+void test_frustum_from_mat4(void) {
+    // The identity maps the clip cube [-1, 1]^3 to itself.
+    mat4 m = {0};
+    m.m00 = m.m11 = m.m22 = m.m33 = 1.0f;
+    frustum f = frustum_from_mat4(m);
+    aabb3 inside = {{{0.5f, 0.5f, 0.5f}}, {{0.9f, 0.9f, 0.9f}}};
+    aabb3 straddling = {{{0.5f, -3.0f, 0.0f}}, {{3.0f, 0.0f, 0.1f}}};
+    aabb3 beyond_far = {{{0.0f, 0.0f, 1.5f}}, {{0.1f, 0.1f, 2.0f}}};
+    aabb3 left = {{{-3.0f, 0.0f, 0.0f}}, {{-1.1f, 0.1f, 0.1f}}};
+    TEST_ASSERT_TRUE(frustum_aabb3(&f, inside));
+    TEST_ASSERT_TRUE(frustum_aabb3(&f, straddling));
+    TEST_ASSERT_FALSE(frustum_aabb3(&f, beyond_far));
+    TEST_ASSERT_FALSE(frustum_aabb3(&f, left));
+}
+
+// =============================================================================
+// GJK / EPA TESTS
+// =============================================================================
+
+static convex make_sphere(f32 x, f32 y, f32 z, f32 radius) {
+    convex c;
+    c.type = CONVEX_SPHERE;
+    c.s.center.x = x;
+    c.s.center.y = y;
+    c.s.center.z = z;
+    c.s.radius = radius;
+    return c;
+}
+
+static convex make_box(f32 x, f32 y, f32 z, f32 hx, f32 hy, f32 hz) {
+    convex c;
+    c.type = CONVEX_BOX;
+    c.box.min.x = x - hx;
+    c.box.min.y = y - hy;
+    c.box.min.z = z - hz;
+    c.box.max.x = x + hx;
+    c.box.max.y = y + hy;
+    c.box.max.z = z + hz;
+    return c;
+}
+
+void test_gjk_distance(void) {
+    point3 pa, pb;
+    convex a = make_sphere(0, 0, 0, 1);
+    convex b = make_sphere(5, 0, 0, 2);
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 2.0f, gjk_distance(&a, &b, &pa, &pb));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 1.0f, pa.x);
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 3.0f, pb.x);
+
+    // Unit cube as a hull against a box above one of its corners.
+    point3 cube[8];
+    for (u32 i = 0; i < 8; ++i) {
+        cube[i].x = (f32)(i & 1);
+        cube[i].y = (f32)((i >> 1) & 1);
+        cube[i].z = (f32)((i >> 2) & 1);
+    }
+    convex h;
+    h.type = CONVEX_HULL;
+    h.h.points = cube;
+    h.h.count = 8;
+    convex box = make_box(3, 3, 3, 1, 1, 1);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, sqrtf(3.0f), gjk_distance(&h, &box, &pa, &pb));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, pa.z);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f, pb.z);
+
+    // Capsule lying over the box.
+    convex cap;
+    cap.type = CONVEX_CAPSULE;
+    cap.cap.a.x = -4;
+    cap.cap.a.y = 6;
+    cap.cap.a.z = 3;
+    cap.cap.b.x = 9;
+    cap.cap.b.y = 6;
+    cap.cap.b.z = 3;
+    cap.cap.radius = 0.5f;
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.5f, gjk_distance(&cap, &box, &pa, &pb));
+    TEST_ASSERT_FALSE(gjk_overlap(&cap, &box));
+    cap.cap.radius = 2.5f;
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, gjk_distance(&cap, &box, &pa, &pb));
+    TEST_ASSERT_TRUE(gjk_overlap(&cap, &box));
+}
+
+void test_epa_penetration(void) {
+    contact3 c;
+    convex a = make_sphere(0, 0, 0, 1);
+    convex b = make_sphere(1.5f, 0, 0, 1);
+    TEST_ASSERT_TRUE(epa_penetration(&a, &b, &c));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 0.5f, c.depth);
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 1.0f, c.normal.x);
+
+    // Overlapping boxes push apart along the axis of least overlap.
+    for (u32 i = 0; i < 100; ++i) {
+        convex p = make_box(rand_f32(), rand_f32(), rand_f32(), 0.5f + rand_f32(), 0.5f + rand_f32(), 0.5f + rand_f32());
+        convex q = make_box(rand_f32(), rand_f32(), rand_f32(), 0.5f + rand_f32(), 0.5f + rand_f32(), 0.5f + rand_f32());
+        f32 expected = FLT_MAX;
+        for (int axis = 0; axis < 3; ++axis) {
+            f32 hi = p.box.max.e[axis] < q.box.max.e[axis] ? p.box.max.e[axis] : q.box.max.e[axis];
+            f32 lo = p.box.min.e[axis] > q.box.min.e[axis] ? p.box.min.e[axis] : q.box.min.e[axis];
+            f32 push = fminf(q.box.max.e[axis] - p.box.min.e[axis], p.box.max.e[axis] - q.box.min.e[axis]);
+            TEST_ASSERT_TRUE(hi > lo);
+            expected = push < expected ? push : expected;
+        }
+        TEST_ASSERT_TRUE(epa_penetration(&p, &q, &c));
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, expected, c.depth);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.0f, vec3_len(c.normal));
+    }
+
+    convex far = make_box(5, 0, 0, 1, 1, 1);
+    TEST_ASSERT_FALSE(epa_penetration(&a, &far, &c));
+}
+
+void test_gjk_overlap8_matches_scalar(void) {
+    convex a[GJK_LANES], b[GJK_LANES];
+    point3 tetra[4] = {{{0, 0, 0}}, {{2, 0, 0}}, {{0, 2, 0}}, {{0, 0, 2}}};
+    for (u32 round = 0; round < 20; ++round) {
+        for (u32 i = 0; i < GJK_LANES; ++i) {
+            f32 x = rand_f32() * 4.0f, y = rand_f32() * 4.0f, z = rand_f32() * 4.0f;
+            switch ((i + round) % 4) {
+            case 0: a[i] = make_sphere(x, y, z, 0.5f + rand_f32()); break;
+            case 1: a[i] = make_box(x, y, z, rand_f32() + 0.1f, rand_f32() + 0.1f, 1.0f); break;
+            case 2:
+                a[i].type = CONVEX_CAPSULE;
+                a[i].cap.a.x = x; a[i].cap.a.y = y; a[i].cap.a.z = z;
+                a[i].cap.b.x = y; a[i].cap.b.y = z; a[i].cap.b.z = x;
+                a[i].cap.radius = 0.3f;
+                break;
+            default:
+                a[i].type = CONVEX_HULL;
+                a[i].h.points = tetra;
+                a[i].h.count = 4;
+            }
+            b[i] = make_box(rand_f32() * 4.0f, rand_f32() * 4.0f, rand_f32() * 4.0f, 0.6f, 0.3f, 0.8f);
+        }
+        u32 mask = gjk_overlap8(a, b, GJK_LANES);
+        for (u32 i = 0; i < GJK_LANES; ++i) {
+            TEST_ASSERT_EQUAL_UINT32(gjk_overlap(&a[i], &b[i]), (mask >> i) & 1);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, gjk_overlap8(a, b, 0));
+}
+
+// =============================================================================
+// OBB TESTS
+// =============================================================================
+
+// Random rotation from Gram-Schmidt on two random vectors.
+static obb random_obb(f32 spread) {
+    obb o;
+    vec3 u = {{rand_f32() - 0.5f, rand_f32() - 0.5f, rand_f32() - 0.5f}};
+    vec3 v = {{rand_f32() - 0.5f, rand_f32() - 0.5f, rand_f32() - 0.5f}};
+    u = vec3_normal(u);
+    v = vec3_normal(vec3_sub(v, vec3_mul_s(u, vec3_dot(u, v))));
+    vec3 w = vec3_cross(u, v);
+    for (int k = 0; k < 3; ++k) {
+        o.axes.m[0][k] = u.e[k];
+        o.axes.m[1][k] = v.e[k];
+        o.axes.m[2][k] = w.e[k];
+        o.center.e[k] = rand_f32() * spread;
+        o.half.e[k] = 0.2f + rand_f32();
+    }
+    return o;
+}
+
+void test_obb_overlap_matches_gjk(void) {
+    u32 overlaps = 0;
+    for (u32 i = 0; i < 500; ++i) {
+        obb a = random_obb(4.0f);
+        obb b = random_obb(4.0f);
+        convex ca, cb;
+        ca.type = cb.type = CONVEX_OBB;
+        ca.o = a;
+        cb.o = b;
+        point3 pa, pb;
+        f32 dist = gjk_distance(&ca, &cb, &pa, &pb);
+        // Skip pairs too close to touching to call either way.
+        if (dist > 0 && dist < 1e-3f) {
+            continue;
+        }
+        b32 overlap = obb_overlap(&a, &b);
+        TEST_ASSERT_EQUAL_INT(dist == 0.0f, overlap);
+        overlaps += overlap;
+
+        u32 axis = obb_separating_axis(&a, &b, 7);
+        TEST_ASSERT_EQUAL_INT(overlap, axis == OBB_NO_AXIS);
+        if (!overlap) {
+            // The axis found is reported again when passed as the hint.
+            TEST_ASSERT_EQUAL_UINT32(axis, obb_separating_axis(&a, &b, axis));
+        }
+    }
+    TEST_ASSERT_TRUE(overlaps > 50 && overlaps < 450);
+}
+
+void test_obb_overlap8_matches_scalar(void) {
+    obb a[OBB_LANES], b[OBB_LANES];
+    for (u32 round = 0; round < 50; ++round) {
+        for (u32 i = 0; i < OBB_LANES; ++i) {
+            a[i] = random_obb(4.0f);
+            b[i] = random_obb(4.0f);
+        }
+        u32 count = round % 9;
+        u32 mask = obb_overlap8(a, b, count);
+        for (u32 i = 0; i < OBB_LANES; ++i) {
+            u32 expected = i < count ? obb_overlap(&a[i], &b[i]) : 0;
+            TEST_ASSERT_EQUAL_UINT32(expected, (mask >> i) & 1);
+        }
+    }
+}
+
+// =============================================================================
+// CLOSEST POINT TESTS
+// =============================================================================
+
+static point3 random_point(f32 spread) {
+    point3 p = {{(rand_f32() - 0.5f) * spread, (rand_f32() - 0.5f) * spread, (rand_f32() - 0.5f) * spread}};
+    return p;
+}
+
+void test_closest_point_triangle(void) {
+    for (u32 round = 0; round < 200; ++round) {
+        point3 a = random_point(4.0f);
+        point3 b = random_point(4.0f);
+        point3 c = random_point(4.0f);
+        point3 p = random_point(8.0f);
+        point3 q = closest_point_triangle(p, a, b, c);
+        f32 best = vec3_len_sq(vec3_sub(p, q));
+        // No sample of the triangle is closer.
+        for (u32 i = 0; i <= 32; ++i) {
+            for (u32 j = 0; i + j <= 32; ++j) {
+                f32 v = (f32)i / 32.0f;
+                f32 w = (f32)j / 32.0f;
+                point3 s = vec3_add(a, vec3_add(vec3_mul_s(vec3_sub(b, a), v), vec3_mul_s(vec3_sub(c, a), w)));
+                TEST_ASSERT_TRUE(best <= vec3_len_sq(vec3_sub(p, s)) + 1e-4f);
+            }
+        }
+    }
+}
+
+void test_segment_segment_closest(void) {
+    point3 p1 = {{0.0f, 0.0f, 0.0f}}, q1 = {{2.0f, 0.0f, 0.0f}};
+    point3 p2 = {{1.0f, -1.0f, 1.0f}}, q2 = {{1.0f, 1.0f, 1.0f}};
+    f32 s, t;
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 1.0f, segment_segment_closest(p1, q1, p2, q2, &s, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 0.5f, s);
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 0.5f, t);
+    // Both degenerate.
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 3.0f, segment_segment_closest(p1, p1, p2, p2, &s, &t));
+
+    for (u32 round = 0; round < 200; ++round) {
+        p1 = random_point(4.0f);
+        q1 = random_point(4.0f);
+        p2 = random_point(4.0f);
+        q2 = round % 10 == 0 ? p2 : random_point(4.0f);
+        f32 d = segment_segment_closest(p1, q1, p2, q2, &s, &t);
+        point3 c1 = vec3_add(p1, vec3_mul_s(vec3_sub(q1, p1), s));
+        point3 c2 = vec3_add(p2, vec3_mul_s(vec3_sub(q2, p2), t));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, vec3_len_sq(vec3_sub(c1, c2)), d);
+        for (u32 i = 0; i <= 32; ++i) {
+            for (u32 j = 0; j <= 32; ++j) {
+                point3 a = vec3_add(p1, vec3_mul_s(vec3_sub(q1, p1), (f32)i / 32.0f));
+                point3 b = vec3_add(p2, vec3_mul_s(vec3_sub(q2, p2), (f32)j / 32.0f));
+                TEST_ASSERT_TRUE(d <= vec3_len_sq(vec3_sub(a, b)) + 1e-4f);
+            }
+        }
+    }
+}
+
+void test_closest_batch_matches_scalar(void) {
+    enum { N = 100 };
+    f32 buf[24][N];
+    point3_soa p = {buf[0], buf[1], buf[2], N};
+    point3_soa out = {buf[3], buf[4], buf[5], N};
+    triangle_soa tri = {buf[6], buf[7], buf[8], buf[9], buf[10], buf[11], buf[12], buf[13], buf[14], N};
+    segment_soa sa = {buf[6], buf[7], buf[8], buf[9], buf[10], buf[11], N};
+    segment_soa sb = {buf[12], buf[13], buf[14], buf[15], buf[16], buf[17], N};
+    f32* s = buf[18];
+    f32* t = buf[19];
+    f32* dist_sq = buf[20];
+    for (u32 k = 0; k < 18; ++k) {
+        if (k < 3 || k >= 6) {
+            for (u32 i = 0; i < N; ++i) {
+                buf[k][i] = (rand_f32() - 0.5f) * 4.0f;
+            }
+        }
+    }
+
+    closest_points_triangles(&p, &tri, &out, dist_sq);
+    for (u32 i = 0; i < N; ++i) {
+        point3 q = closest_point_triangle((point3){{p.x[i], p.y[i], p.z[i]}},
+            (point3){{tri.ax[i], tri.ay[i], tri.az[i]}}, (point3){{tri.bx[i], tri.by[i], tri.bz[i]}},
+            (point3){{tri.cx[i], tri.cy[i], tri.cz[i]}});
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, q.x, out.x[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, q.y, out.y[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, q.z, out.z[i]);
+    }
+
+    segments_closest(&sa, &sb, s, t, dist_sq);
+    for (u32 i = 0; i < N; ++i) {
+        f32 si, ti;
+        f32 d = segment_segment_closest((point3){{sa.ax[i], sa.ay[i], sa.az[i]}},
+            (point3){{sa.bx[i], sa.by[i], sa.bz[i]}}, (point3){{sb.ax[i], sb.ay[i], sb.az[i]}},
+            (point3){{sb.bx[i], sb.by[i], sb.bz[i]}}, &si, &ti);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, d, dist_sq[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, si, s[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, ti, t[i]);
+    }
+
+    aabb3 box = {{{-0.5f, -1.0f, -0.25f}}, {{0.5f, 1.0f, 0.25f}}};
+    points_aabb3_dist_sq(&p, box, dist_sq);
+    for (u32 i = 0; i < N; ++i) {
+        point3 pi = {{p.x[i], p.y[i], p.z[i]}};
+        f32 d = vec3_len_sq(vec3_sub(pi, closest_point_aabb3(pi, box)));
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, d, dist_sq[i]);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, d, point_aabb3_dist_sq(pi, box));
+    }
+}
+
+// =============================================================================
+// TRIANGLE OVERLAP TESTS
+// =============================================================================
+
+void test_aabb3_triangle_overlaps_matches_gjk(void) {
+    aabb3 box = {{{-1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f, 1.0f}}};
+    u32 overlaps = 0;
+    for (u32 i = 0; i < 1000; ++i) {
+        point3 p[3];
+        point3 c = {rand_f32() * 6.0f - 3.0f, rand_f32() * 6.0f - 3.0f, rand_f32() * 6.0f - 3.0f};
+        for (int k = 0; k < 3; ++k) {
+            p[k].x = c.x + rand_f32() * 4.0f - 2.0f;
+            p[k].y = c.y + rand_f32() * 4.0f - 2.0f;
+            p[k].z = c.z + rand_f32() * 4.0f - 2.0f;
+        }
+        convex ca, cb;
+        ca.type = CONVEX_BOX;
+        ca.box = box;
+        cb.type = CONVEX_HULL;
+        cb.h.points = p;
+        cb.h.count = 3;
+        point3 pa, pb;
+        f32 dist = gjk_distance(&ca, &cb, &pa, &pb);
+        if (dist > 0 && dist < 1e-3f) {
+            continue;
+        }
+        b32 overlap = aabb3_triangle_overlaps(box, p[0], p[1], p[2]);
+        TEST_ASSERT_EQUAL_INT(dist == 0.0f, overlap);
+        overlaps += overlap;
+    }
+    TEST_ASSERT_TRUE(overlaps > 100 && overlaps < 900);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Ray3 primitive tests
+    RUN_TEST(test_ray3_sphere);
+    RUN_TEST(test_ray3_plane);
+    RUN_TEST(test_ray3_disk);
+    RUN_TEST(test_ray3_capsule);
+
+    // Ray3 batch tests
+    RUN_TEST(test_ray3_spheres_matches_scalar);
+    RUN_TEST(test_ray3_capsules_matches_scalar);
+    RUN_TEST(test_ray3_planes_and_disks);
+
+    // Frustum tests
+    RUN_TEST(test_frustum_from_mat4);
+
+    // GJK / EPA tests
+    RUN_TEST(test_gjk_distance);
+    RUN_TEST(test_epa_penetration);
+    RUN_TEST(test_gjk_overlap8_matches_scalar);
+
+    // OBB tests
+    RUN_TEST(test_obb_overlap_matches_gjk);
+    RUN_TEST(test_obb_overlap8_matches_scalar);
+
+    // Closest point tests
+    RUN_TEST(test_closest_point_triangle);
+    RUN_TEST(test_segment_segment_closest);
+    RUN_TEST(test_closest_batch_matches_scalar);
+
+    // Triangle overlap tests
+    RUN_TEST(test_aabb3_triangle_overlaps_matches_gjk);
+
+    return UNITY_END();
+}
@@ -0,0 +1,219 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_GRID_IMPLEMENTATION
+#include "../src/ys_grid.h"
+#include <math.h>
+#include <float.h>
+
+#define TEST_EPSILON 1e-4f
+
+static u32 rng_state;
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+static ray3 random_ray(void) {
+    ray3 r;
+    r.origin.x = rand_f32() * 48.0f - 8.0f;
+    r.origin.y = rand_f32() * 48.0f - 8.0f;
+    r.origin.z = rand_f32() * 48.0f - 8.0f;
+    point3 target = {rand_f32() * 32.0f, rand_f32() * 32.0f, rand_f32() * 32.0f};
+    r.dir = vec3_sub(target, r.origin);
+    return r;
+}
+
+static voxel_grid grid;
+static const i32 grid_dims[3] = {32, 32, 32};
+
+void setUp(void) {
+    rng_state = 7;
+    point3 origin = {0.0f, 0.0f, 0.0f};
+    voxel_grid_create(&grid, grid_dims, origin, 1.0f);
+    for (u32 i = 0; i < 600; ++i) {
+        voxel_grid_set(&grid, (i32)(rand_f32() * 32), (i32)(rand_f32() * 32), (i32)(rand_f32() * 32));
+    }
+}
+
+void tearDown(void) {
+    voxel_grid_free(&grid);
+}
+
+// Reference: march in tiny steps and report the first occupied voxel.
+static b32 march(const ray3 r, f32 t_max, i32 cell[3]) {
+    f32 len = vec3_len(r.dir);
+    f32 dt = 0.002f / len;
+    for (f32 t = 0; t < t_max; t += dt) {
+        point3 p = ray3_at(r, t);
+        i32 x = (i32)floorf(p.x), y = (i32)floorf(p.y), z = (i32)floorf(p.z);
+        if (x >= 0 && y >= 0 && z >= 0 && x < 32 && y < 32 && z < 32 && voxel_grid_get(&grid, x, y, z)) {
+            cell[0] = x;
+            cell[1] = y;
+            cell[2] = z;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void test_grid_dda_visits_neighbouring_cells(void) {
+    for (u32 k = 0; k < 200; ++k) {
+        ray3 r = random_ray();
+        grid_dda d;
+        if (!grid_dda_init(&d, grid_dims, grid.origin, 1.0f, r, FLT_MAX)) {
+            continue;
+        }
+        i32 prev[3] = {d.cell[0], d.cell[1], d.cell[2]};
+        f32 prev_t = d.t;
+        while (grid_dda_step(&d)) {
+            i32 moved = abs(d.cell[0] - prev[0]) + abs(d.cell[1] - prev[1]) + abs(d.cell[2] - prev[2]);
+            TEST_ASSERT_EQUAL_INT(1, moved);
+            TEST_ASSERT_TRUE(d.t >= prev_t);
+            // The midpoint of the span lies in the reported cell.
+            point3 p = ray3_at(r, (d.t + grid_dda_exit(&d)) * 0.5f);
+            TEST_ASSERT_EQUAL_INT(d.cell[0], (i32)floorf(p.x));
+            TEST_ASSERT_EQUAL_INT(d.cell[1], (i32)floorf(p.y));
+            TEST_ASSERT_EQUAL_INT(d.cell[2], (i32)floorf(p.z));
+            prev[0] = d.cell[0];
+            prev[1] = d.cell[1];
+            prev[2] = d.cell[2];
+            prev_t = d.t;
+        }
+    }
+}
+
+void test_voxel_grid_raycast_matches_march(void) {
+    u32 hits = 0;
+    for (u32 k = 0; k < 300; ++k) {
+        ray3 r = random_ray();
+        f32 t;
+        i32 cell[3];
+        i32 expected[3];
+        b32 e = march(r, 2.0f, expected);
+        b32 a = voxel_grid_raycast(&grid, r, 2.0f, &t, cell);
+        if (e) {
+            TEST_ASSERT_TRUE(a);
+            TEST_ASSERT_EQUAL_INT32_ARRAY(expected, cell, 3);
+            ++hits;
+        } else if (a) {
+            // Marching can step over a corner the ray only grazes.
+            aabb3 box = {{(f32)cell[0], (f32)cell[1], (f32)cell[2]},
+                {cell[0] + 1.0f, cell[1] + 1.0f, cell[2] + 1.0f}};
+            f32 t_near;
+            TEST_ASSERT_TRUE(ray3_aabb3(r, ray3_inv_dir(r), box, 2.0f, &t_near));
+            TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, t_near, t);
+        }
+    }
+    TEST_ASSERT_TRUE(hits > 10);
+}
+
+void test_voxel_grid_visible(void) {
+    voxel_grid_set(&grid, 0, 0, 0);
+    point3 a = {0.5f, 0.5f, 5.5f};
+    point3 b = {0.5f, 0.5f, -3.0f};
+    point3 c = {0.5f, 0.5f, 3.0f};
+    for (i32 z = 1; z < 6; ++z) {
+        voxel_grid_clear(&grid, 0, 0, z);
+    }
+    TEST_ASSERT_FALSE(voxel_grid_visible(&grid, a, b));
+    TEST_ASSERT_TRUE(voxel_grid_visible(&grid, a, c));
+}
+
+void test_voxel_grid_raycast_batch_matches_scalar(void) {
+    enum { RAYS = 333 };
+    ray3 rays[RAYS];
+    f32 t[RAYS];
+    u32 mask[(RAYS + 31) / 32];
+    for (u32 i = 0; i < RAYS; ++i) {
+        rays[i] = random_ray();
+    }
+    u32 hits = voxel_grid_raycast_batch(&grid, rays, RAYS, 2.0f, mask, t);
+    u32 expected_hits = 0;
+    for (u32 i = 0; i < RAYS; ++i) {
+        f32 te;
+        i32 cell[3];
+        b32 e = voxel_grid_raycast(&grid, rays[i], 2.0f, &te, cell);
+        expected_hits += e;
+        TEST_ASSERT_EQUAL_UINT32(e, (mask[i / 32] >> (i % 32)) & 1);
+        TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, e ? te : 2.0f, t[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(expected_hits, hits);
+}
+
+void test_brick_grid_matches_voxel_grid(void) {
+    brick_grid bg;
+    const i32 brick_dims[3] = {4, 4, 4};
+    TEST_ASSERT_TRUE(brick_grid_create(&bg, brick_dims, grid.origin, 1.0f, 64));
+    for (i32 z = 0; z < 32; ++z) {
+        for (i32 y = 0; y < 32; ++y) {
+            for (i32 x = 0; x < 32; ++x) {
+                // Only keep the lower half so some bricks stay empty.
+                if (voxel_grid_get(&grid, x, y, z) && y < 16) {
+                    TEST_ASSERT_TRUE(brick_grid_set(&bg, x, y, z));
+                } else {
+                    voxel_grid_clear(&grid, x, y, z);
+                }
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(bg.brick_count <= 32);
+    for (u32 k = 0; k < 300; ++k) {
+        ray3 r = random_ray();
+        f32 te, ta;
+        i32 ce[3], ca[3];
+        b32 e = voxel_grid_raycast(&grid, r, 2.0f, &te, ce);
+        b32 a = brick_grid_raycast(&bg, r, 2.0f, &ta, ca);
+        TEST_ASSERT_EQUAL_INT(e, a);
+        if (e) {
+            TEST_ASSERT_EQUAL_INT32_ARRAY(ce, ca, 3);
+            TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, te, ta);
+        }
+    }
+    brick_grid_free(&bg);
+}
+
+void test_heightfield_raycast(void) {
+    f32 heights[16 * 16];
+    for (u32 i = 0; i < 16 * 16; ++i) {
+        heights[i] = 0.0f;
+    }
+    // A wall of height 5 across x = 8.
+    for (u32 z = 0; z < 16; ++z) {
+        heights[8 + 16 * z] = 5.0f;
+    }
+    heightfield h = {heights, {16, 16}, {0.0f, 0.0f, 0.0f}, 1.0f};
+    ray3 r = {{0.5f, 2.0f, 4.5f}, {1.0f, 0.0f, 0.0f}};
+    f32 t;
+    TEST_ASSERT_TRUE(heightfield_raycast(&h, r, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 7.5f, t);
+
+    r.origin.y = 6.0f;
+    TEST_ASSERT_FALSE(heightfield_raycast(&h, r, FLT_MAX, &t));
+
+    // Dipping below the top of the wall inside its column.
+    r.origin.y = 9.0f;
+    r.dir.y = -0.5f;
+    TEST_ASSERT_TRUE(heightfield_raycast(&h, r, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 8.0f, t);
+
+    // Descending onto the flat ground past the wall.
+    r.origin.x = 9.5f;
+    r.origin.y = 3.0f;
+    TEST_ASSERT_TRUE(heightfield_raycast(&h, r, FLT_MAX, &t));
+    TEST_ASSERT_FLOAT_WITHIN(TEST_EPSILON, 6.0f, t);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_grid_dda_visits_neighbouring_cells);
+    RUN_TEST(test_voxel_grid_raycast_matches_march);
+    RUN_TEST(test_voxel_grid_visible);
+    RUN_TEST(test_voxel_grid_raycast_batch_matches_scalar);
+    RUN_TEST(test_brick_grid_matches_voxel_grid);
+    RUN_TEST(test_heightfield_raycast);
+
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_HULL_IMPLEMENTATION
+#include "../src/ys_hull.h"
+#include <math.h>
+
+#define TEST_POINTS 20000
+
+static point3 points[TEST_POINTS];
+static point2 points2[TEST_POINTS];
+static u32 hull_ids[TEST_POINTS];
+static hull_mesh mesh;
+static u32 rng_state;
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+void setUp(void) {
+    rng_state = 2024;
+    hull_mesh_create(&mesh, TEST_POINTS);
+}
+
+void tearDown(void) {
+    hull_mesh_free(&mesh);
+}
+
+// Closed, consistently linked, convex and containing every input point
+// within `tolerance`.
+static void check_hull(const hull_mesh* h, const point3* input, const u32 count, const f32 tolerance) {
+    TEST_ASSERT_EQUAL_UINT32(3 * h->face_count, h->edge_count);
+    TEST_ASSERT_EQUAL_UINT32(2 * h->vertex_count - 4, h->face_count);
+    for (u32 i = 0; i < h->vertex_count; ++i) {
+        point3 p = input[h->vertex_ids[i]];
+        TEST_ASSERT_TRUE(p.x == h->vertices[i].x && p.y == h->vertices[i].y && p.z == h->vertices[i].z);
+    }
+    for (u32 i = 0; i < h->edge_count; ++i) {
+        const hull_edge* e = &h->edges[i];
+        const hull_edge* twin = &h->edges[e->twin];
+        TEST_ASSERT_EQUAL_UINT32(i, twin->twin);
+        TEST_ASSERT_EQUAL_UINT32(e->vertex, h->edges[twin->next].vertex);
+        TEST_ASSERT_EQUAL_UINT32(twin->vertex, h->edges[e->next].vertex);
+        TEST_ASSERT_EQUAL_UINT32(i / 3, e->face);
+    }
+    for (u32 f = 0; f < h->face_count; ++f) {
+        plane p = h->faces[f].plane;
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, vec3_len(p.normal));
+        f32 worst = 0.0f;
+        for (u32 i = 0; i < count; ++i) {
+            f32 d = vec3_dot(p.normal, input[i]) - p.d;
+            worst = d > worst ? d : worst;
+        }
+        TEST_ASSERT_TRUE(worst < tolerance);
+    }
+}
+
+// =============================================================================
+// QUICKHULL 3D TESTS
+// =============================================================================
+
+void test_quickhull3_random_cube(void) {
+    for (u32 i = 0; i < TEST_POINTS; ++i) {
+        points[i].x = rand_f32() * 4.0f - 2.0f;
+        points[i].y = rand_f32() * 2.0f + 5.0f;
+        points[i].z = rand_f32() * 3.0f;
+    }
+    TEST_ASSERT_TRUE(quickhull3(&mesh, points, TEST_POINTS));
+    TEST_ASSERT_TRUE(mesh.vertex_count > 20);
+    check_hull(&mesh, points, TEST_POINTS, 1e-4f);
+
+    // Small inputs skip the prefilter.
+    TEST_ASSERT_TRUE(quickhull3(&mesh, points, 40));
+    check_hull(&mesh, points, 40, 1e-4f);
+}
+
+static void random_sphere(const u32 count, const f32 radius) {
+    for (u32 i = 0; i < count; ++i) {
+        f32 z = rand_f32() * 2.0f - 1.0f;
+        f32 a = rand_f32() * 6.28318531f;
+        f32 r = sqrtf(1.0f - z * z);
+        points[i].x = r * cosf(a) * radius;
+        points[i].y = r * sinf(a) * radius;
+        points[i].z = z * radius;
+    }
+}
+
+void test_quickhull3_sphere_keeps_every_point(void) {
+    u32 count = 2000;
+    random_sphere(count, 10.0f);
+    // Plus interior points the prefilter should drop.
+    for (u32 i = count; i < TEST_POINTS; ++i) {
+        points[i].x = rand_f32() * 8.0f - 4.0f;
+        points[i].y = rand_f32() * 8.0f - 4.0f;
+        points[i].z = rand_f32() * 8.0f - 4.0f;
+    }
+    TEST_ASSERT_TRUE(quickhull3(&mesh, points, TEST_POINTS));
+    TEST_ASSERT_EQUAL_UINT32(count, mesh.vertex_count);
+    for (u32 i = 0; i < mesh.vertex_count; ++i) {
+        TEST_ASSERT_TRUE(mesh.vertex_ids[i] < count);
+    }
+    check_hull(&mesh, points, TEST_POINTS, 1e-4f);
+}
+
+void test_quickhull3_sphere_stays_convex(void) {
+    // Close pairs of points make thin faces whose planes tilt; no point
+    // may end up above one, whatever the seed and the scale.
+    static const f32 radii[2] = {10.0f, 1.0f};
+    u32 count = 2000;
+    for (u32 seed = 1; seed <= 48; ++seed) {
+        for (u32 r = 0; r < 2; ++r) {
+            rng_state = seed;
+            random_sphere(count, radii[r]);
+            TEST_ASSERT_TRUE(quickhull3(&mesh, points, count));
+            TEST_ASSERT_EQUAL_UINT32(count, mesh.vertex_count);
+            check_hull(&mesh, points, count, 1e-5f * radii[r]);
+        }
+    }
+}
+
+void test_quickhull3_box_with_duplicates(void) {
+    // Corners repeated many times and points on the faces: only the 8
+    // corners remain.
+    for (u32 i = 0; i < 1000; ++i) {
+        u32 c = i % 8;
+        points[i].x = c & 1 ? 1.0f : -1.0f;
+        points[i].y = c & 2 ? 1.0f : -1.0f;
+        points[i].z = c & 4 ? 1.0f : -1.0f;
+        if (i >= 800) {
+            points[i].x = rand_f32() * 2.0f - 1.0f;
+            points[i].y = rand_f32() * 2.0f - 1.0f;
+        }
+    }
+    TEST_ASSERT_TRUE(quickhull3(&mesh, points, 1000));
+    TEST_ASSERT_EQUAL_UINT32(8, mesh.vertex_count);
+    check_hull(&mesh, points, 1000, 1e-4f);
+}
+
+void test_quickhull3_rejects_flat_and_oversized_input(void) {
+    for (u32 i = 0; i < 100; ++i) {
+        points[i].x = rand_f32();
+        points[i].y = rand_f32();
+        points[i].z = 0.5f * points[i].x + 0.25f * points[i].y;
+    }
+    TEST_ASSERT_FALSE(quickhull3(&mesh, points, 100));
+    TEST_ASSERT_EQUAL_UINT32(0, mesh.face_count);
+
+    hull_mesh small;
+    TEST_ASSERT_TRUE(hull_mesh_create(&small, 10));
+    TEST_ASSERT_FALSE(quickhull3(&small, points, 11));
+    hull_mesh_free(&small);
+}
+
+// =============================================================================
+// QUICKHULL 2D TESTS
+// =============================================================================
+
+static void check_hull2(const point2* input, const u32 count, const u32* hull, const u32 n) {
+    for (u32 k = 0; k < n; ++k) {
+        point2 a = input[hull[k]];
+        point2 b = input[hull[(k + 1) % n]];
+        point2 c = input[hull[(k + 2) % n]];
+        TEST_ASSERT_TRUE((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x) > 0);
+        for (u32 i = 0; i < count; ++i) {
+            point2 p = input[i];
+            TEST_ASSERT_TRUE((b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x) > -1e-4f);
+        }
+    }
+}
+
+void test_quickhull2_random_points(void) {
+    for (u32 i = 0; i < TEST_POINTS; ++i) {
+        f32 a = rand_f32() * 6.28318531f;
+        f32 r = sqrtf(rand_f32()) * 3.0f;
+        points2[i].x = cosf(a) * r + 1.0f;
+        points2[i].y = sinf(a) * r * 0.5f;
+    }
+    u32 n = quickhull2(points2, TEST_POINTS, hull_ids);
+    TEST_ASSERT_TRUE(n > 20);
+    check_hull2(points2, TEST_POINTS, hull_ids, n);
+    for (u32 k = 1; k < n; ++k) {
+        TEST_ASSERT_TRUE(points2[hull_ids[0]].x <= points2[hull_ids[k]].x);
+    }
+
+    n = quickhull2(points2, 30, hull_ids);
+    check_hull2(points2, 30, hull_ids, n);
+}
+
+void test_quickhull2_degenerate(void) {
+    // A square with points on its edges and inside.
+    for (u32 i = 0; i < 500; ++i) {
+        points2[i].x = i % 4 == 1 || i % 4 == 2 ? 1.0f : 0.0f;
+        points2[i].y = i % 4 >= 2 ? 1.0f : 0.0f;
+        if (i >= 4 && i % 3 == 0) {
+            points2[i].x = rand_f32();
+        }
+    }
+    u32 n = quickhull2(points2, 500, hull_ids);
+    TEST_ASSERT_EQUAL_UINT32(4, n);
+    check_hull2(points2, 500, hull_ids, n);
+
+    for (u32 i = 0; i < 100; ++i) {
+        points2[i].x = rand_f32();
+        points2[i].y = 2.0f * points2[i].x;
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, quickhull2(points2, 100, hull_ids));
+
+    // All the same point.
+    for (u32 i = 0; i < 100; ++i) {
+        points2[i] = points2[0];
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, quickhull2(points2, 100, hull_ids));
+    TEST_ASSERT_EQUAL_UINT32(0, hull_ids[0]);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Quickhull 3D tests
+    RUN_TEST(test_quickhull3_random_cube);
+    RUN_TEST(test_quickhull3_sphere_keeps_every_point);
+    RUN_TEST(test_quickhull3_sphere_stays_convex);
+    RUN_TEST(test_quickhull3_box_with_duplicates);
+    RUN_TEST(test_quickhull3_rejects_flat_and_oversized_input);
+
+    // Quickhull 2D tests
+    RUN_TEST(test_quickhull2_random_points);
+    RUN_TEST(test_quickhull2_degenerate);
+
+    return UNITY_END();
+}
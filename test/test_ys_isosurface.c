@@ -0,0 +1,222 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_MESH_IMPLEMENTATION
+#define YS_ISOSURFACE_IMPLEMENTATION
+#include "../src/ys_isosurface.h"
+#include <math.h>
+
+// More than two chunks per axis, so the surface crosses chunk borders.
+#define FIELD_SIZE 70
+#define SPHERE_RADIUS 25.0f
+#define MAX_VERTICES 300000
+#define MAX_INDICES 3000000
+
+static scalar_field f;
+static isosurface_pyramid p;
+static mesh m;
+static u64 edge_keys[MAX_INDICES];
+static u32 rng_state;
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / 16777216.0f;
+}
+
+static point3 sphere_center(void) {
+    point3 c = {{34.3f, 34.7f, 35.1f}};
+    return c;
+}
+
+static void make_sphere(void) {
+    point3 c = sphere_center();
+    for (i32 z = 0; z < FIELD_SIZE; ++z) {
+        for (i32 y = 0; y < FIELD_SIZE; ++y) {
+            for (i32 x = 0; x < FIELD_SIZE; ++x) {
+                point3 s = {{(f32)x, (f32)y, (f32)z}};
+                f.values[x + FIELD_SIZE * (y + FIELD_SIZE * z)] = vec3_len(vec3_sub(s, c)) - SPHERE_RADIUS;
+            }
+        }
+    }
+}
+
+static int compare_u64(const void* a, const void* b) {
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    return x < y ? -1 : x > y;
+}
+
+static b32 on_border(const point3 a, const point3 b) {
+    for (u32 k = 0; k < 3; ++k) {
+        if ((a.e[k] == 0.0f && b.e[k] == 0.0f) || (a.e[k] == FIELD_SIZE - 1 && b.e[k] == FIELD_SIZE - 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Every directed edge is used once and has a twin, except on the border
+// of the field where the surface is cut open.
+static void check_edges(void) {
+    u32 count = m.index_count;
+    for (u32 i = 0; i < count; ++i) {
+        u32 a = m.indices[i];
+        u32 b = m.indices[i - i % 3 + (i + 1) % 3];
+        TEST_ASSERT_TRUE(a < m.vertex_count && b < m.vertex_count);
+        TEST_ASSERT_TRUE(a != b);
+        edge_keys[i] = ((u64)a << 32) | b;
+    }
+    qsort(edge_keys, count, sizeof(u64), compare_u64);
+    for (u32 i = 0; i < count; ++i) {
+        TEST_ASSERT_TRUE(i == 0 || edge_keys[i] != edge_keys[i - 1]);
+        u64 twin = (edge_keys[i] << 32) | (edge_keys[i] >> 32);
+        if (!bsearch(&twin, edge_keys, count, sizeof(u64), compare_u64)) {
+            TEST_ASSERT_TRUE(on_border(m.positions[edge_keys[i] >> 32], m.positions[edge_keys[i] & 0xFFFFFFFFu]));
+        }
+    }
+}
+
+void setUp(void) {
+    i32 dims[3] = {FIELD_SIZE, FIELD_SIZE, FIELD_SIZE};
+    point3 origin = {{0.0f, 0.0f, 0.0f}};
+    scalar_field_create(&f, dims, origin, 1.0f);
+    mesh_create(&m, MAX_VERTICES, MAX_INDICES, MESH_NORMALS);
+    rng_state = 7;
+}
+
+void tearDown(void) {
+    scalar_field_free(&f);
+    isosurface_pyramid_free(&p);
+    mesh_free(&m);
+}
+
+// =============================================================================
+// ISOSURFACE TESTS
+// =============================================================================
+
+void test_isosurface_sphere(void) {
+    make_sphere();
+    TEST_ASSERT_TRUE(isosurface_pyramid_create(&p, &f));
+    TEST_ASSERT_TRUE(isosurface_extract(&m, &f, &p, 0.0f));
+    TEST_ASSERT_TRUE(m.index_count > 10000);
+    TEST_ASSERT_EQUAL_UINT32(0, m.index_count % 3);
+
+    // Welded across chunks: closed, with V - E + F = 2.
+    check_edges();
+    u32 faces = m.index_count / 3;
+    TEST_ASSERT_EQUAL_INT32(2, (i32)m.vertex_count - (i32)(faces * 3 / 2) + (i32)faces);
+
+    point3 c = sphere_center();
+    for (u32 v = 0; v < m.vertex_count; ++v) {
+        vec3 d = vec3_sub(m.positions[v], c);
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, SPHERE_RADIUS, vec3_len(d));
+        TEST_ASSERT_TRUE(vec3_dot(m.normals[v], d) > 0.99f * vec3_len(d));
+    }
+    for (u32 t = 0; t < faces; ++t) {
+        point3 a = m.positions[m.indices[t * 3]];
+        point3 b = m.positions[m.indices[t * 3 + 1]];
+        point3 e = m.positions[m.indices[t * 3 + 2]];
+        vec3 n = vec3_cross(vec3_sub(b, a), vec3_sub(e, a));
+        TEST_ASSERT_TRUE(vec3_dot(n, vec3_sub(a, c)) > 0.0f);
+    }
+}
+
+void test_isosurface_empty(void) {
+    for (u32 i = 0; i < FIELD_SIZE * FIELD_SIZE * FIELD_SIZE; ++i) {
+        f.values[i] = 1.0f;
+    }
+    TEST_ASSERT_TRUE(isosurface_pyramid_create(&p, &f));
+    TEST_ASSERT_TRUE(isosurface_extract(&m, &f, &p, 0.0f));
+    TEST_ASSERT_EQUAL_UINT32(0, m.index_count);
+    TEST_ASSERT_EQUAL_UINT32(0, m.vertex_count);
+
+    // A sample exactly at the iso value counts as outside.
+    TEST_ASSERT_TRUE(isosurface_extract(&m, &f, &p, 1.0f));
+    TEST_ASSERT_EQUAL_UINT32(0, m.index_count);
+
+    make_sphere();
+    isosurface_pyramid_update(&p, &f, (i32[3]){0, 0, 0}, (i32[3]){FIELD_SIZE - 1, FIELD_SIZE - 1, FIELD_SIZE - 1});
+    TEST_ASSERT_TRUE(isosurface_extract(&m, &f, &p, -100.0f));
+    TEST_ASSERT_EQUAL_UINT32(0, m.index_count);
+}
+
+void test_isosurface_noise_is_manifold(void) {
+    // Noise in a block across chunk borders, touching the field border on x.
+    for (i32 z = 0; z < FIELD_SIZE; ++z) {
+        for (i32 y = 0; y < FIELD_SIZE; ++y) {
+            for (i32 x = 0; x < FIELD_SIZE; ++x) {
+                b32 noise = x < 40 && y >= 20 && y < 50 && z >= 20 && z < 50;
+                f.values[x + FIELD_SIZE * (y + FIELD_SIZE * z)] = noise ? rand_f32() - 0.5f : 1.0f;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(isosurface_pyramid_create(&p, &f));
+    TEST_ASSERT_TRUE(isosurface_extract(&m, &f, &p, 0.0f));
+    TEST_ASSERT_TRUE(m.index_count > 0);
+    check_edges();
+    for (u32 v = 0; v < m.vertex_count; ++v) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.0f, vec3_len(m.normals[v]));
+    }
+}
+
+void test_isosurface_pyramid_update(void) {
+    make_sphere();
+    TEST_ASSERT_TRUE(isosurface_pyramid_create(&p, &f));
+    TEST_ASSERT_TRUE(isosurface_extract(&m, &f, &p, 0.0f));
+    u32 sphere_indices = m.index_count;
+
+    // Carve a box in a corner the sphere does not reach, on block borders.
+    i32 lo[3] = {2, 4, 5};
+    i32 hi[3] = {8, 12, 9};
+    for (i32 z = lo[2]; z <= hi[2]; ++z) {
+        for (i32 y = lo[1]; y <= hi[1]; ++y) {
+            for (i32 x = lo[0]; x <= hi[0]; ++x) {
+                f.values[x + FIELD_SIZE * (y + FIELD_SIZE * z)] = -1.0f;
+            }
+        }
+    }
+    isosurface_pyramid_update(&p, &f, lo, hi);
+    isosurface_pyramid rebuilt;
+    TEST_ASSERT_TRUE(isosurface_pyramid_create(&rebuilt, &f));
+    u32 nodes = rebuilt.offsets[ISOSURFACE_LEVELS - 1] + (u32)(rebuilt.dims[ISOSURFACE_LEVELS - 1][0]
+        * rebuilt.dims[ISOSURFACE_LEVELS - 1][1] * rebuilt.dims[ISOSURFACE_LEVELS - 1][2]);
+    for (u32 i = 0; i < nodes * 2; ++i) {
+        TEST_ASSERT_EQUAL_FLOAT(rebuilt.ranges[i], p.ranges[i]);
+    }
+    isosurface_pyramid_free(&rebuilt);
+
+    TEST_ASSERT_TRUE(isosurface_extract(&m, &f, &p, 0.0f));
+    check_edges();
+    TEST_ASSERT_TRUE(m.index_count > sphere_indices);
+}
+
+void test_isosurface_capacity(void) {
+    make_sphere();
+    TEST_ASSERT_TRUE(isosurface_pyramid_create(&p, &f));
+    mesh small;
+    TEST_ASSERT_TRUE(mesh_create(&small, 100, 300, 0));
+    small.vertex_count = 3;
+    small.index_count = 3;
+    TEST_ASSERT_FALSE(isosurface_extract(&small, &f, &p, 0.0f));
+    TEST_ASSERT_EQUAL_UINT32(3, small.vertex_count);
+    TEST_ASSERT_EQUAL_UINT32(3, small.index_count);
+    mesh_free(&small);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Isosurface tests
+    RUN_TEST(test_isosurface_sphere);
+    RUN_TEST(test_isosurface_empty);
+    RUN_TEST(test_isosurface_noise_is_manifold);
+    RUN_TEST(test_isosurface_pyramid_update);
+    RUN_TEST(test_isosurface_capacity);
+
+    return UNITY_END();
+}
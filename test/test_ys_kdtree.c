@@ -0,0 +1,169 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_KDTREE_IMPLEMENTATION
+#include "../src/ys_kdtree.h"
+#include <float.h>
+
+#define TEST_POINTS 5000
+#define TEST_QUERIES 200
+#define TEST_K 10
+
+static u32 rng_state;
+static point3 points[TEST_POINTS];
+static point3 queries[TEST_QUERIES];
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+static point3 random_point(void) {
+    point3 p;
+    p.x = rand_f32() * 100.0f;
+    p.y = rand_f32() * 100.0f;
+    p.z = rand_f32() * 10.0f;
+    return p;
+}
+
+static f32 dist_sq(point3 a, point3 b) {
+    vec3 d = vec3_sub(a, b);
+    return vec3_dot(d, d);
+}
+
+// k-th smallest squared distance by brute force.
+static f32 brute_force_kth(point3 q, u32 count, u32 k) {
+    f32 best[TEST_K];
+    u32 found = 0;
+    for (u32 i = 0; i < count; ++i) {
+        f32 d = dist_sq(points[i], q);
+        u32 j = found < k ? found++ : k;
+        if (j == k && d >= best[k - 1]) {
+            continue;
+        }
+        if (j == k) {
+            j = k - 1;
+        }
+        while (j > 0 && best[j - 1] > d) {
+            best[j] = best[j - 1];
+            --j;
+        }
+        best[j] = d;
+    }
+    return best[(found < k ? found : k) - 1];
+}
+
+void setUp(void) {
+    rng_state = 7;
+    for (u32 i = 0; i < TEST_POINTS; ++i) {
+        points[i] = random_point();
+    }
+    for (u32 i = 0; i < TEST_QUERIES; ++i) {
+        queries[i] = random_point();
+    }
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// KDTREE TESTS
+// =============================================================================
+
+void test_kdtree_knn_matches_brute_force(void) {
+    kdtree t;
+    TEST_ASSERT_TRUE(kdtree_build(&t, points, TEST_POINTS));
+    for (u32 i = 0; i < TEST_QUERIES; ++i) {
+        u32 ids[TEST_K];
+        f32 d[TEST_K];
+        TEST_ASSERT_EQUAL_UINT32(TEST_K, kdtree_knn(&t, queries[i], TEST_K, ids, d));
+        for (u32 j = 0; j < TEST_K; ++j) {
+            TEST_ASSERT_EQUAL_FLOAT(dist_sq(points[ids[j]], queries[i]), d[j]);
+            if (j > 0) {
+                TEST_ASSERT_TRUE(d[j - 1] <= d[j]);
+            }
+        }
+        TEST_ASSERT_EQUAL_FLOAT(brute_force_kth(queries[i], TEST_POINTS, TEST_K), d[TEST_K - 1]);
+    }
+    kdtree_free(&t);
+}
+
+void test_kdtree_small_and_duplicate(void) {
+    kdtree t;
+    TEST_ASSERT_TRUE(kdtree_build(&t, points, 0));
+    u32 id;
+    f32 d;
+    TEST_ASSERT_EQUAL_UINT32(0, kdtree_knn(&t, queries[0], 1, &id, &d));
+    kdtree_free(&t);
+
+    // Fewer points than k.
+    TEST_ASSERT_TRUE(kdtree_build(&t, points, 3));
+    u32 ids[TEST_K];
+    f32 ds[TEST_K];
+    TEST_ASSERT_EQUAL_UINT32(3, kdtree_knn(&t, queries[0], TEST_K, ids, ds));
+    kdtree_free(&t);
+
+    // Many equal coordinates still split into valid halves.
+    for (u32 i = 0; i < TEST_POINTS; ++i) {
+        points[i].x = (f32)(i % 3);
+        points[i].y = 1.0f;
+    }
+    TEST_ASSERT_TRUE(kdtree_build(&t, points, TEST_POINTS));
+    TEST_ASSERT_EQUAL_UINT32(TEST_K, kdtree_knn(&t, queries[0], TEST_K, ids, ds));
+    TEST_ASSERT_EQUAL_FLOAT(brute_force_kth(queries[0], TEST_POINTS, TEST_K), ds[TEST_K - 1]);
+    kdtree_free(&t);
+}
+
+void test_kdtree_radius_matches_brute_force(void) {
+    kdtree t;
+    TEST_ASSERT_TRUE(kdtree_build(&t, points, TEST_POINTS));
+    u32 ids[TEST_POINTS];
+    for (u32 i = 0; i < TEST_QUERIES; ++i) {
+        f32 radius = 2.0f + rand_f32() * 6.0f;
+        u32 expected = 0;
+        for (u32 j = 0; j < TEST_POINTS; ++j) {
+            expected += dist_sq(points[j], queries[i]) <= radius * radius;
+        }
+        u32 found = kdtree_radius(&t, queries[i], radius, ids, TEST_POINTS);
+        TEST_ASSERT_EQUAL_UINT32(expected, found);
+        for (u32 j = 0; j < found; ++j) {
+            TEST_ASSERT_TRUE(dist_sq(points[ids[j]], queries[i]) <= radius * radius);
+        }
+        // A short buffer still reports the full count.
+        TEST_ASSERT_EQUAL_UINT32(expected, kdtree_radius(&t, queries[i], radius, ids, 1));
+    }
+    kdtree_free(&t);
+}
+
+void test_kdtree_batch_matches_scalar(void) {
+    static u32 ids[TEST_QUERIES * TEST_K];
+    static f32 d[TEST_QUERIES * TEST_K];
+    static u32 counts[TEST_QUERIES];
+    kdtree t;
+    TEST_ASSERT_TRUE(kdtree_build(&t, points, TEST_POINTS));
+    kdtree_knn_batch(&t, queries, TEST_QUERIES, TEST_K, ids, d);
+    kdtree_radius_batch(&t, queries, TEST_QUERIES, 5.0f, TEST_K, ids, counts);
+    for (u32 i = 0; i < TEST_QUERIES; ++i) {
+        u32 one[TEST_K];
+        f32 one_d[TEST_K];
+        kdtree_knn(&t, queries[i], TEST_K, one, one_d);
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(one_d, d + i * TEST_K, TEST_K);
+        TEST_ASSERT_EQUAL_UINT32(kdtree_radius(&t, queries[i], 5.0f, one, 0), counts[i]);
+    }
+    kdtree_free(&t);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_kdtree_knn_matches_brute_force);
+    RUN_TEST(test_kdtree_small_and_duplicate);
+    RUN_TEST(test_kdtree_radius_matches_brute_force);
+    RUN_TEST(test_kdtree_batch_matches_scalar);
+
+    return UNITY_END();
+}
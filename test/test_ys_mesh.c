@@ -0,0 +1,297 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_MESH_IMPLEMENTATION
+#include "../src/ys_mesh.h"
+#include <math.h>
+
+#define GRID_SIZE 64
+#define GRID_VERTS ((GRID_SIZE + 1) * (GRID_SIZE + 1))
+#define GRID_TRIS (GRID_SIZE * GRID_SIZE * 2)
+#define SPHERE_SEGMENTS 32
+#define SPHERE_VERTS ((SPHERE_SEGMENTS + 1) * (SPHERE_SEGMENTS + 1))
+#define SPHERE_TRIS (SPHERE_SEGMENTS * SPHERE_SEGMENTS * 2)
+
+static mesh m;
+static u32 original[GRID_TRIS * 3];
+static u32 rng_state;
+
+static u32 rand_u32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+// Regular grid in the xy plane with uv = position, triangles shuffled and
+// vertices numbered in a random order.
+static void make_grid(void) {
+    u32 perm[GRID_VERTS];
+    for (u32 v = 0; v < GRID_VERTS; ++v) {
+        perm[v] = v;
+    }
+    for (u32 v = GRID_VERTS - 1; v > 0; --v) {
+        u32 k = rand_u32() % (v + 1);
+        u32 t = perm[v];
+        perm[v] = perm[k];
+        perm[k] = t;
+    }
+    for (u32 y = 0; y <= GRID_SIZE; ++y) {
+        for (u32 x = 0; x <= GRID_SIZE; ++x) {
+            u32 v = perm[y * (GRID_SIZE + 1) + x];
+            m.positions[v].x = (f32)x;
+            m.positions[v].y = (f32)y;
+            m.positions[v].z = 0.0f;
+            m.normals[v].x = 0.0f;
+            m.normals[v].y = 0.0f;
+            m.normals[v].z = 1.0f;
+            m.uvs[v].x = (f32)x;
+            m.uvs[v].y = (f32)y;
+        }
+    }
+    u32 n = 0;
+    for (u32 y = 0; y < GRID_SIZE; ++y) {
+        for (u32 x = 0; x < GRID_SIZE; ++x) {
+            u32 a = perm[y * (GRID_SIZE + 1) + x];
+            u32 b = perm[y * (GRID_SIZE + 1) + x + 1];
+            u32 c = perm[(y + 1) * (GRID_SIZE + 1) + x];
+            u32 d = perm[(y + 1) * (GRID_SIZE + 1) + x + 1];
+            m.indices[n++] = a;
+            m.indices[n++] = b;
+            m.indices[n++] = d;
+            m.indices[n++] = a;
+            m.indices[n++] = d;
+            m.indices[n++] = c;
+        }
+    }
+    for (u32 t = GRID_TRIS - 1; t > 0; --t) {
+        u32 k = rand_u32() % (t + 1);
+        for (u32 i = 0; i < 3; ++i) {
+            u32 s = m.indices[t * 3 + i];
+            m.indices[t * 3 + i] = m.indices[k * 3 + i];
+            m.indices[k * 3 + i] = s;
+        }
+    }
+    m.vertex_count = GRID_VERTS;
+    m.index_count = GRID_TRIS * 3;
+}
+
+// Unit sphere with u around z and v from the +z pole, outward winding. The
+// seam and pole vertices are duplicated, as a uv mapping needs.
+static void make_sphere(mesh* s) {
+    for (u32 i = 0; i <= SPHERE_SEGMENTS; ++i) {
+        for (u32 j = 0; j <= SPHERE_SEGMENTS; ++j) {
+            u32 v = i * (SPHERE_SEGMENTS + 1) + j;
+            f32 theta = 3.14159265f * i / SPHERE_SEGMENTS;
+            f32 phi = 6.28318531f * j / SPHERE_SEGMENTS;
+            s->positions[v].x = sinf(theta) * cosf(phi);
+            s->positions[v].y = sinf(theta) * sinf(phi);
+            s->positions[v].z = cosf(theta);
+            s->uvs[v].x = (f32)j / SPHERE_SEGMENTS;
+            s->uvs[v].y = (f32)i / SPHERE_SEGMENTS;
+        }
+    }
+    u32 n = 0;
+    for (u32 i = 0; i < SPHERE_SEGMENTS; ++i) {
+        for (u32 j = 0; j < SPHERE_SEGMENTS; ++j) {
+            u32 a = i * (SPHERE_SEGMENTS + 1) + j;
+            u32 c = a + SPHERE_SEGMENTS + 1;
+            s->indices[n++] = a;
+            s->indices[n++] = c;
+            s->indices[n++] = a + 1;
+            s->indices[n++] = a + 1;
+            s->indices[n++] = c;
+            s->indices[n++] = c + 1;
+        }
+    }
+    s->vertex_count = SPHERE_VERTS;
+    s->index_count = n;
+}
+
+// Triangle as its corner positions packed into one key, starting from the
+// smallest corner so the winding is kept.
+static u64 triangle_key(const point3* positions, const u32* tri) {
+    u32 corner[3];
+    for (u32 i = 0; i < 3; ++i) {
+        corner[i] = (u32)positions[tri[i]].y * (GRID_SIZE + 1) + (u32)positions[tri[i]].x;
+    }
+    u32 first = 0;
+    for (u32 i = 1; i < 3; ++i) {
+        first = corner[i] < corner[first] ? i : first;
+    }
+    return ((u64)corner[first] << 40) | ((u64)corner[(first + 1) % 3] << 20) | corner[(first + 2) % 3];
+}
+
+static int compare_u64(const void* a, const void* b) {
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void sort_keys(const point3* positions, const u32* indices, u64* keys) {
+    for (u32 t = 0; t < GRID_TRIS; ++t) {
+        keys[t] = triangle_key(positions, indices + t * 3);
+    }
+    qsort(keys, GRID_TRIS, sizeof(u64), compare_u64);
+}
+
+void setUp(void) {
+    rng_state = 7;
+    mesh_create(&m, GRID_VERTS + 1, GRID_TRIS * 3, MESH_NORMALS | MESH_UVS);
+}
+
+void tearDown(void) {
+    mesh_free(&m);
+}
+
+// =============================================================================
+// VERTEX CACHE TESTS
+// =============================================================================
+
+void test_mesh_optimize_vertex_cache(void) {
+    make_grid();
+    for (u32 i = 0; i < m.index_count; ++i) {
+        original[i] = m.indices[i];
+    }
+    f32 before = mesh_acmr(m.indices, m.index_count, m.vertex_count, MESH_CACHE_SIZE);
+    TEST_ASSERT_TRUE(before > 2.5f);
+
+    TEST_ASSERT_TRUE(mesh_optimize_vertex_cache(&m, MESH_CACHE_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(GRID_TRIS * 3, m.index_count);
+    f32 after = mesh_acmr(m.indices, m.index_count, m.vertex_count, MESH_CACHE_SIZE);
+    TEST_ASSERT_TRUE(after < 0.8f);
+
+    static u64 keys_before[GRID_TRIS];
+    static u64 keys_after[GRID_TRIS];
+    sort_keys(m.positions, original, keys_before);
+    sort_keys(m.positions, m.indices, keys_after);
+    for (u32 t = 0; t < GRID_TRIS; ++t) {
+        TEST_ASSERT_TRUE(keys_before[t] == keys_after[t]);
+    }
+}
+
+void test_mesh_acmr(void) {
+    u32 strip[6] = {0, 1, 2, 2, 1, 3};
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 2.0f, mesh_acmr(strip, 6, 4, 16));
+    // With a single entry only the repeated vertex right after itself hits.
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 2.5f, mesh_acmr(strip, 6, 4, 1));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, mesh_acmr(strip, 0, 4, 16));
+}
+
+// =============================================================================
+// VERTEX FETCH TESTS
+// =============================================================================
+
+void test_mesh_optimize_vertex_fetch(void) {
+    make_grid();
+    TEST_ASSERT_TRUE(mesh_optimize_vertex_cache(&m, MESH_CACHE_SIZE));
+    static u64 keys_before[GRID_TRIS];
+    static u64 keys_after[GRID_TRIS];
+    sort_keys(m.positions, m.indices, keys_before);
+
+    // An extra vertex no triangle uses is dropped.
+    m.positions[GRID_VERTS].x = -1.0f;
+    m.vertex_count = GRID_VERTS + 1;
+    TEST_ASSERT_TRUE(mesh_optimize_vertex_fetch(&m));
+    TEST_ASSERT_EQUAL_UINT32(GRID_VERTS, m.vertex_count);
+
+    u32 next = 0;
+    for (u32 i = 0; i < m.index_count; ++i) {
+        TEST_ASSERT_TRUE(m.indices[i] <= next);
+        next += m.indices[i] == next;
+    }
+    TEST_ASSERT_EQUAL_UINT32(m.vertex_count, next);
+    for (u32 v = 0; v < m.vertex_count; ++v) {
+        TEST_ASSERT_EQUAL_FLOAT(m.positions[v].x, m.uvs[v].x);
+        TEST_ASSERT_EQUAL_FLOAT(m.positions[v].y, m.uvs[v].y);
+        TEST_ASSERT_EQUAL_FLOAT(1.0f, m.normals[v].z);
+    }
+    sort_keys(m.positions, m.indices, keys_after);
+    for (u32 t = 0; t < GRID_TRIS; ++t) {
+        TEST_ASSERT_TRUE(keys_before[t] == keys_after[t]);
+    }
+}
+
+// =============================================================================
+// NORMALS AND TANGENTS TESTS
+// =============================================================================
+
+void test_mesh_compute_normals_grid(void) {
+    make_grid();
+    mesh_adjacency a;
+    TEST_ASSERT_TRUE(mesh_adjacency_create(&a, &m));
+    for (u32 v = 0; v < m.vertex_count; ++v) {
+        m.normals[v].z = 0.0f;
+    }
+    TEST_ASSERT_TRUE(mesh_compute_normals(&m, &a));
+    for (u32 v = 0; v < m.vertex_count; ++v) {
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, m.normals[v].x);
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, m.normals[v].y);
+        TEST_ASSERT_EQUAL_FLOAT(1.0f, m.normals[v].z);
+    }
+    // The adjacency has to match the mesh.
+    m.vertex_count = GRID_VERTS + 1;
+    TEST_ASSERT_FALSE(mesh_compute_normals(&m, &a));
+    mesh_adjacency_free(&a);
+}
+
+void test_mesh_compute_normals_sphere(void) {
+    mesh s;
+    TEST_ASSERT_TRUE(mesh_create(&s, SPHERE_VERTS, SPHERE_TRIS * 3, MESH_NORMALS | MESH_UVS | MESH_TANGENTS));
+    make_sphere(&s);
+    mesh_adjacency a;
+    TEST_ASSERT_TRUE(mesh_adjacency_create(&a, &s));
+    TEST_ASSERT_TRUE(mesh_compute_normals(&s, &a));
+    for (u32 v = 0; v < s.vertex_count; ++v) {
+        vec3 t = {s.tangents[v].x, s.tangents[v].y, s.tangents[v].z};
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, vec3_len(s.normals[v]));
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, vec3_len(t));
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, vec3_dot(t, s.normals[v]));
+        // Pole vertices only touch sliver triangles, so their normals are
+        // unit but not meaningful.
+        u32 row = v / (SPHERE_SEGMENTS + 1);
+        if (row > 0 && row < SPHERE_SEGMENTS) {
+            TEST_ASSERT_TRUE(vec3_dot(s.normals[v], s.positions[v]) > 0.98f);
+            f32 phi = 6.28318531f * s.uvs[v].x;
+            vec3 du = {-sinf(phi), cosf(phi), 0.0f};
+            TEST_ASSERT_TRUE(vec3_dot(t, du) > 0.98f);
+            TEST_ASSERT_EQUAL_FLOAT(-1.0f, s.tangents[v].w);
+        }
+    }
+
+    // Mirrored u flips the tangent and the handedness, with the adjacency
+    // reused.
+    for (u32 v = 0; v < s.vertex_count; ++v) {
+        s.uvs[v].x = 1.0f - s.uvs[v].x;
+    }
+    TEST_ASSERT_TRUE(mesh_compute_normals(&s, &a));
+    for (u32 v = SPHERE_SEGMENTS + 1; v < s.vertex_count - SPHERE_SEGMENTS - 1; ++v) {
+        f32 phi = 6.28318531f * (1.0f - s.uvs[v].x);
+        vec3 t = {s.tangents[v].x, s.tangents[v].y, s.tangents[v].z};
+        vec3 du = {-sinf(phi), cosf(phi), 0.0f};
+        TEST_ASSERT_TRUE(vec3_dot(t, du) < -0.98f);
+        TEST_ASSERT_EQUAL_FLOAT(1.0f, s.tangents[v].w);
+    }
+    mesh_adjacency_free(&a);
+    mesh_free(&s);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Vertex cache tests
+    RUN_TEST(test_mesh_optimize_vertex_cache);
+    RUN_TEST(test_mesh_acmr);
+
+    // Vertex fetch tests
+    RUN_TEST(test_mesh_optimize_vertex_fetch);
+
+    // Normals and tangents tests
+    RUN_TEST(test_mesh_compute_normals_grid);
+    RUN_TEST(test_mesh_compute_normals_sphere);
+
+    return UNITY_END();
+}
@@ -0,0 +1,152 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_MORTON_IMPLEMENTATION
+#include "../src/ys_morton.h"
+
+static u32 rng_state;
+
+static u32 rand_u32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state;
+}
+
+static u32 abs_diff(u32 a, u32 b) {
+    return a > b ? a - b : b - a;
+}
+
+void setUp(void) {
+    rng_state = 3;
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// MORTON TESTS
+// =============================================================================
+
+void test_morton2(void) {
+    TEST_ASSERT_EQUAL_HEX32(1, morton2_encode(1, 0));
+    TEST_ASSERT_EQUAL_HEX32(2, morton2_encode(0, 1));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFFu, morton2_encode(0xFFFF, 0xFFFF));
+    TEST_ASSERT_EQUAL_HEX32(0x55555555u, morton2_encode(0xFFFF, 0));
+    for (u32 i = 0; i < 1000; ++i) {
+        u32 x = rand_u32() & 0xFFFF, y = rand_u32() & 0xFFFF, dx, dy;
+        morton2_decode(morton2_encode(x, y), &dx, &dy);
+        TEST_ASSERT_EQUAL_UINT32(x, dx);
+        TEST_ASSERT_EQUAL_UINT32(y, dy);
+    }
+}
+
+void test_morton3(void) {
+    TEST_ASSERT_EQUAL_HEX64(1, morton3_encode(1, 0, 0));
+    TEST_ASSERT_EQUAL_HEX64(2, morton3_encode(0, 1, 0));
+    TEST_ASSERT_EQUAL_HEX64(4, morton3_encode(0, 0, 1));
+    TEST_ASSERT_EQUAL_HEX64(0x7FFFFFFFFFFFFFFFull, morton3_encode(0x1FFFFF, 0x1FFFFF, 0x1FFFFF));
+    for (u32 i = 0; i < 1000; ++i) {
+        u32 x = rand_u32() & 0x1FFFFF, y = rand_u32() & 0x1FFFFF, z = rand_u32() & 0x1FFFFF, dx, dy, dz;
+        morton3_decode(morton3_encode(x, y, z), &dx, &dy, &dz);
+        TEST_ASSERT_EQUAL_UINT32(x, dx);
+        TEST_ASSERT_EQUAL_UINT32(y, dy);
+        TEST_ASSERT_EQUAL_UINT32(z, dz);
+    }
+}
+
+// =============================================================================
+// HILBERT TESTS
+// =============================================================================
+
+void test_hilbert2_is_continuous(void) {
+    // The first 4^6 keys fill the 64x64 block at the origin, each step
+    // moving to a neighbouring cell.
+    u32 px = 0, py = 0;
+    for (u32 key = 0; key < 4096; ++key) {
+        u32 x, y;
+        hilbert2_decode(key, &x, &y);
+        TEST_ASSERT_TRUE(x < 64 && y < 64);
+        TEST_ASSERT_EQUAL_UINT32(key, hilbert2_encode(x, y));
+        if (key > 0) {
+            TEST_ASSERT_EQUAL_UINT32(1, abs_diff(x, px) + abs_diff(y, py));
+        }
+        px = x;
+        py = y;
+    }
+}
+
+void test_hilbert3_is_continuous(void) {
+    u32 px = 0, py = 0, pz = 0;
+    for (u32 key = 0; key < 4096; ++key) {
+        u32 x, y, z;
+        hilbert3_decode(key, &x, &y, &z);
+        TEST_ASSERT_TRUE(x < 16 && y < 16 && z < 16);
+        TEST_ASSERT_EQUAL_UINT64(key, hilbert3_encode(x, y, z));
+        if (key > 0) {
+            TEST_ASSERT_EQUAL_UINT32(1, abs_diff(x, px) + abs_diff(y, py) + abs_diff(z, pz));
+        }
+        px = x;
+        py = y;
+        pz = z;
+    }
+    for (u32 i = 0; i < 1000; ++i) {
+        u32 x = rand_u32() & 0x1FFFFF, y = rand_u32() & 0x1FFFFF, z = rand_u32() & 0x1FFFFF, dx, dy, dz;
+        hilbert3_decode(hilbert3_encode(x, y, z), &dx, &dy, &dz);
+        TEST_ASSERT_EQUAL_UINT32(x, dx);
+        TEST_ASSERT_EQUAL_UINT32(y, dy);
+        TEST_ASSERT_EQUAL_UINT32(z, dz);
+    }
+}
+
+// =============================================================================
+// BATCH TESTS
+// =============================================================================
+
+void test_encode_points(void) {
+    point3 points[100];
+    point2 flat[100];
+    u64 keys[100];
+    u64 hkeys[100];
+    u32 keys2[100];
+    for (u32 i = 0; i < 100; ++i) {
+        points[i].x = (f32)i - 10.0f;  // runs past both ends of the range
+        points[i].y = 0.5f * i;
+        points[i].z = 20.0f;
+        flat[i].x = points[i].x;
+        flat[i].y = points[i].y;
+    }
+    point3 min = {{0.0f, 0.0f, 0.0f}};
+    point3 max = {{80.0f, 80.0f, 40.0f}};
+    morton3_encode_points(points, 100, min, max, keys);
+    hilbert3_encode_points(points, 100, min, max, hkeys);
+    for (u32 i = 0; i < 100; ++i) {
+        u32 x, y, z;
+        morton3_decode(keys[i], &x, &y, &z);
+        u32 expected_x = i < 10 ? 0 : i >= 90 ? 0x1FFFFF : (u32)((points[i].x / 80.0f) * (1 << 21));
+        TEST_ASSERT_EQUAL_UINT32(expected_x, x);
+        TEST_ASSERT_EQUAL_UINT32(1u << 20, z);
+        TEST_ASSERT_EQUAL_UINT64(hilbert3_encode(x, y, z), hkeys[i]);
+    }
+
+    point2 min2 = {{0.0f, 0.0f}};
+    point2 max2 = {{80.0f, 80.0f}};
+    morton2_encode_points(flat, 100, min2, max2, keys2);
+    for (u32 i = 1; i < 100; ++i) {
+        // Both coordinates grow, so the keys never shrink.
+        TEST_ASSERT_TRUE(keys2[i - 1] <= keys2[i]);
+    }
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_morton2);
+    RUN_TEST(test_morton3);
+    RUN_TEST(test_hilbert2_is_continuous);
+    RUN_TEST(test_hilbert3_is_continuous);
+    RUN_TEST(test_encode_points);
+
+    return UNITY_END();
+}
@@ -0,0 +1,211 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_OCTREE_IMPLEMENTATION
+#include "../src/ys_octree.h"
+#include <float.h>
+
+#define TEST_ITEMS 2000
+
+static u32 rng_state;
+static aabb3 boxes[TEST_ITEMS];
+static u32 handles[TEST_ITEMS];
+static b8 alive[TEST_ITEMS];
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+// Mostly small boxes, a few large ones, some sticking out of the root.
+static aabb3 random_box(void) {
+    f32 size = rand_f32() < 0.05f ? rand_f32() * 30.0f : rand_f32() * 2.0f;
+    aabb3 b;
+    for (int a = 0; a < 3; ++a) {
+        b.min.e[a] = rand_f32() * 120.0f - 60.0f;
+        b.max.e[a] = b.min.e[a] + size * (0.2f + rand_f32());
+    }
+    return b;
+}
+
+static u32 brute_force_overlaps(aabb3 box) {
+    u32 count = 0;
+    for (u32 i = 0; i < TEST_ITEMS; ++i) {
+        count += alive[i] && aabb3_overlaps(boxes[i], box);
+    }
+    return count;
+}
+
+static void build_nodes(octree* o, u32 max_nodes) {
+    point3 center = {{0.0f, 0.0f, 0.0f}};
+    TEST_ASSERT_TRUE(octree_create(o, center, 50.0f, 8, TEST_ITEMS, max_nodes));
+    for (u32 i = 0; i < TEST_ITEMS; ++i) {
+        boxes[i] = random_box();
+        handles[i] = octree_insert(o, boxes[i]);
+        alive[i] = 1;
+        TEST_ASSERT_NOT_EQUAL(OCTREE_NONE, handles[i]);
+    }
+}
+
+static void build(octree* o) {
+    build_nodes(o, 4096);
+}
+
+void setUp(void) {
+    rng_state = 5;
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// OCTREE TESTS
+// =============================================================================
+
+void test_octree_query_aabb3(void) {
+    octree o;
+    build(&o);
+    static u32 found[TEST_ITEMS];
+    for (u32 step = 0; step < 3; ++step) {
+        for (u32 q = 0; q < 50; ++q) {
+            aabb3 box = random_box();
+            u32 n = octree_query_aabb3(&o, box, found, TEST_ITEMS);
+            TEST_ASSERT_EQUAL_UINT32(brute_force_overlaps(box), n);
+            for (u32 i = 0; i < n; ++i) {
+                TEST_ASSERT_TRUE(aabb3_overlaps(o.items[found[i]].bounds, box));
+            }
+        }
+        // Move, remove and re-add items, then check again.
+        for (u32 i = 0; i < TEST_ITEMS; ++i) {
+            if (i % 3 == 0) {
+                vec3 d = {{rand_f32() - 0.5f, rand_f32() - 0.5f, rand_f32() - 0.5f}};
+                boxes[i].min = vec3_add(boxes[i].min, d);
+                boxes[i].max = vec3_add(boxes[i].max, d);
+                octree_update(&o, handles[i], boxes[i]);
+            } else if (i % 3 == 1) {
+                if (alive[i]) {
+                    octree_remove(&o, handles[i]);
+                } else {
+                    boxes[i] = random_box();
+                    handles[i] = octree_insert(&o, boxes[i]);
+                }
+                alive[i] = !alive[i];
+            }
+        }
+    }
+    octree_free(&o);
+}
+
+void test_octree_empties_and_recycles(void) {
+    octree o;
+    build(&o);
+    u32 used = o.node_used;
+    for (u32 i = 0; i < TEST_ITEMS; ++i) {
+        octree_remove(&o, handles[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, o.nodes[0].count);
+    TEST_ASSERT_EQUAL_UINT32(OCTREE_NONE, o.nodes[0].children);
+    for (u32 i = 0; i < TEST_ITEMS; ++i) {
+        TEST_ASSERT_NOT_EQUAL(OCTREE_NONE, octree_insert(&o, boxes[i]));
+    }
+    // The second fill reuses the freed blocks.
+    TEST_ASSERT_TRUE(o.node_used <= used);
+    octree_free(&o);
+}
+
+void test_octree_query_frustum(void) {
+    octree o;
+    build(&o);
+    // Axis aligned box frustum [-10, 10] x [-10, 10] x [0, 40].
+    frustum f;
+    f32 n[6][4] = {{1, 0, 0, -10}, {-1, 0, 0, -10}, {0, 1, 0, -10}, {0, -1, 0, -10}, {0, 0, 1, 0}, {0, 0, -1, -40}};
+    for (u32 i = 0; i < 6; ++i) {
+        f.planes[i].normal.x = n[i][0];
+        f.planes[i].normal.y = n[i][1];
+        f.planes[i].normal.z = n[i][2];
+        f.planes[i].d = n[i][3];
+    }
+    aabb3 region = {{{-10.0f, -10.0f, 0.0f}}, {{10.0f, 10.0f, 40.0f}}};
+    static u32 found[TEST_ITEMS];
+    TEST_ASSERT_EQUAL_UINT32(brute_force_overlaps(region), octree_query_frustum(&o, &f, found, TEST_ITEMS));
+    octree_free(&o);
+}
+
+void test_octree_insert_batch_matches_serial(void) {
+    // Enough nodes that the pool never runs out: a full pool stops the
+    // splits after different items in the two orders.
+    octree serial;
+    build_nodes(&serial, 32768);
+    octree batch;
+    point3 center = {{0.0f, 0.0f, 0.0f}};
+    static u32 batch_handles[TEST_ITEMS];
+    TEST_ASSERT_TRUE(octree_create(&batch, center, 50.0f, 8, TEST_ITEMS, 32768));
+    TEST_ASSERT_EQUAL_UINT32(TEST_ITEMS, octree_insert_batch(&batch, boxes, TEST_ITEMS, batch_handles));
+    // Same handles and the same cells. Splits happen in another order, so
+    // the node indices differ.
+    TEST_ASSERT_EQUAL_UINT32(serial.node_used, batch.node_used);
+    for (u32 i = 0; i < TEST_ITEMS; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(handles[i], batch_handles[i]);
+        const octree_node* a = &serial.nodes[serial.items[handles[i]].node];
+        const octree_node* b = &batch.nodes[batch.items[batch_handles[i]].node];
+        TEST_ASSERT_EQUAL_FLOAT(a->half_size, b->half_size);
+        TEST_ASSERT_EQUAL_FLOAT(a->center.x, b->center.x);
+        TEST_ASSERT_EQUAL_FLOAT(a->center.y, b->center.y);
+        TEST_ASSERT_EQUAL_FLOAT(a->center.z, b->center.z);
+        TEST_ASSERT_EQUAL_UINT32(a->count, b->count);
+    }
+    aabb3 region = {{{-20.0f, -5.0f, -30.0f}}, {{15.0f, 25.0f, 10.0f}}};
+    static u32 found[TEST_ITEMS];
+    TEST_ASSERT_EQUAL_UINT32(brute_force_overlaps(region), octree_query_aabb3(&batch, region, found, TEST_ITEMS));
+
+    // A full pool stops the batch.
+    TEST_ASSERT_EQUAL_UINT32(0, octree_insert_batch(&batch, boxes, 1, batch_handles));
+    octree_free(&serial);
+    octree_free(&batch);
+}
+
+void test_octree_raycast(void) {
+    octree o;
+    build(&o);
+    for (u32 q = 0; q < 200; ++q) {
+        ray3 r;
+        r.origin.x = rand_f32() * 100.0f - 50.0f;
+        r.origin.y = rand_f32() * 100.0f - 50.0f;
+        r.origin.z = -70.0f;
+        r.dir.x = rand_f32() - 0.5f;
+        r.dir.y = rand_f32() - 0.5f;
+        r.dir.z = 1.0f;
+        vec3 inv = ray3_inv_dir(r);
+        f32 expected = FLT_MAX;
+        for (u32 i = 0; i < TEST_ITEMS; ++i) {
+            f32 t;
+            if (ray3_aabb3(r, inv, boxes[i], expected, &t) && t < expected) {
+                expected = t;
+            }
+        }
+        f32 t = FLT_MAX;
+        u32 hit = octree_raycast(&o, r, FLT_MAX, 0, 0, &t);
+        TEST_ASSERT_EQUAL_INT(expected < FLT_MAX, hit != OCTREE_NONE);
+        if (hit != OCTREE_NONE) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected, t);
+        }
+    }
+    octree_free(&o);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_octree_query_aabb3);
+    RUN_TEST(test_octree_empties_and_recycles);
+    RUN_TEST(test_octree_query_frustum);
+    RUN_TEST(test_octree_insert_batch_matches_serial);
+    RUN_TEST(test_octree_raycast);
+
+    return UNITY_END();
+}
@@ -0,0 +1,290 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_PREDICATES_IMPLEMENTATION
+#include "../src/ys_predicates.h"
+#include <math.h>
+
+#define QUERY_COUNT 2000
+
+static u32 rng_state;
+static point2 points2[QUERY_COUNT];
+static point3 points3[QUERY_COUNT];
+static u32 indices[QUERY_COUNT * 5];
+static i8 signs[QUERY_COUNT];
+
+static u32 rand_u32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static i32 sign_of(const f64 x) {
+    return (x > 0.0) - (x < 0.0);
+}
+
+static i32 sign_i128(const __int128 x) {
+    return (x > 0) - (x < 0);
+}
+
+// Small integer coordinates: many exactly degenerate queries, with the
+// true sign computable in 128-bit integers. The exact forms are checked
+// on their own too, since the filters settle every other query.
+static void make_grid_points(const u32 range) {
+    for (u32 i = 0; i < QUERY_COUNT; ++i) {
+        points2[i].x = (f32)(rand_u32() % range);
+        points2[i].y = (f32)(rand_u32() % range);
+        points3[i].x = (f32)(rand_u32() % range);
+        points3[i].y = (f32)(rand_u32() % range);
+        points3[i].z = (f32)(rand_u32() % range);
+    }
+    for (u32 i = 0; i < QUERY_COUNT * 5; ++i) {
+        indices[i] = rand_u32() % QUERY_COUNT;
+    }
+}
+
+static __int128 det2(const __int128 a, const __int128 b, const __int128 c, const __int128 d) {
+    return a * d - b * c;
+}
+
+static __int128 det3(const __int128* r0, const __int128* r1, const __int128* r2) {
+    return r0[0] * det2(r1[1], r1[2], r2[1], r2[2]) - r0[1] * det2(r1[0], r1[2], r2[0], r2[2])
+        + r0[2] * det2(r1[0], r1[1], r2[0], r2[1]);
+}
+
+static i32 exact_orient2d(const point2 a, const point2 b, const point2 c) {
+    return sign_i128(det2((i64)a.x - (i64)c.x, (i64)a.y - (i64)c.y, (i64)b.x - (i64)c.x, (i64)b.y - (i64)c.y));
+}
+
+static i32 exact_orient3d(const point3 a, const point3 b, const point3 c, const point3 d) {
+    __int128 r[3][3];
+    const point3* p[3] = {&a, &b, &c};
+    for (u32 i = 0; i < 3; ++i) {
+        for (u32 k = 0; k < 3; ++k) {
+            r[i][k] = (i64)p[i]->e[k] - (i64)d.e[k];
+        }
+    }
+    return sign_i128(det3(r[0], r[1], r[2]));
+}
+
+static i32 exact_incircle(const point2 a, const point2 b, const point2 c, const point2 d) {
+    __int128 r[3][3];
+    const point2* p[3] = {&a, &b, &c};
+    for (u32 i = 0; i < 3; ++i) {
+        r[i][0] = (i64)p[i]->x - (i64)d.x;
+        r[i][1] = (i64)p[i]->y - (i64)d.y;
+        r[i][2] = r[i][0] * r[i][0] + r[i][1] * r[i][1];
+    }
+    return sign_i128(det3(r[0], r[1], r[2]));
+}
+
+static i32 exact_insphere(const point3 a, const point3 b, const point3 c, const point3 d, const point3 e) {
+    __int128 r[4][4];
+    const point3* p[4] = {&a, &b, &c, &d};
+    for (u32 i = 0; i < 4; ++i) {
+        for (u32 k = 0; k < 3; ++k) {
+            r[i][k] = (i64)p[i]->e[k] - (i64)e.e[k];
+        }
+        r[i][3] = r[i][0] * r[i][0] + r[i][1] * r[i][1] + r[i][2] * r[i][2];
+    }
+    // Expand along the lift column.
+    __int128 det = 0;
+    for (u32 i = 0; i < 4; ++i) {
+        __int128 m[3][3];
+        for (u32 j = 0, row = 0; j < 4; ++j) {
+            if (j != i) {
+                m[row][0] = r[j][0];
+                m[row][1] = r[j][1];
+                m[row][2] = r[j][2];
+                ++row;
+            }
+        }
+        __int128 term = r[i][3] * det3(m[0], m[1], m[2]);
+        det += i & 1 ? term : -term;
+    }
+    return sign_i128(det);
+}
+
+static void to_f64_2(const point2 p, f64* out) {
+    out[0] = p.x;
+    out[1] = p.y;
+}
+
+static void to_f64_3(const point3 p, f64* out) {
+    out[0] = p.x;
+    out[1] = p.y;
+    out[2] = p.z;
+}
+
+void setUp(void) {
+    rng_state = 11;
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// EXACT ARITHMETIC TESTS
+// =============================================================================
+
+void test_orient2d_grid(void) {
+    make_grid_points(8);
+    u32 zeros = 0;
+    for (u32 i = 0; i < QUERY_COUNT; ++i) {
+        const u32* q = indices + i * 3;
+        i32 expected = exact_orient2d(points2[q[0]], points2[q[1]], points2[q[2]]);
+        TEST_ASSERT_EQUAL_INT32(expected, sign_of(orient2d(points2[q[0]], points2[q[1]], points2[q[2]])));
+        zeros += expected == 0;
+        f64 p[3][2];
+        for (u32 k = 0; k < 3; ++k) {
+            to_f64_2(points2[q[k]], p[k]);
+        }
+        TEST_ASSERT_EQUAL_INT32(expected, sign_of(orient2d_exact(p[0], p[1], p[2])));
+    }
+    TEST_ASSERT_TRUE(zeros > 0);
+    orient2d_batch(points2, QUERY_COUNT, indices, QUERY_COUNT, signs);
+    for (u32 i = 0; i < QUERY_COUNT; ++i) {
+        const u32* q = indices + i * 3;
+        TEST_ASSERT_EQUAL_INT32(exact_orient2d(points2[q[0]], points2[q[1]], points2[q[2]]), signs[i]);
+    }
+}
+
+void test_orient3d_grid(void) {
+    make_grid_points(6);
+    orient3d_batch(points3, QUERY_COUNT, indices, QUERY_COUNT, signs);
+    for (u32 i = 0; i < QUERY_COUNT; ++i) {
+        const u32* q = indices + i * 4;
+        i32 expected = exact_orient3d(points3[q[0]], points3[q[1]], points3[q[2]], points3[q[3]]);
+        TEST_ASSERT_EQUAL_INT32(expected, sign_of(orient3d(points3[q[0]], points3[q[1]], points3[q[2]], points3[q[3]])));
+        f64 p[4][3];
+        for (u32 k = 0; k < 4; ++k) {
+            to_f64_3(points3[q[k]], p[k]);
+        }
+        TEST_ASSERT_EQUAL_INT32(expected, sign_of(orient3d_exact(p[0], p[1], p[2], p[3])));
+        TEST_ASSERT_EQUAL_INT32(expected, signs[i]);
+    }
+}
+
+void test_incircle_grid(void) {
+    make_grid_points(6);
+    incircle_batch(points2, QUERY_COUNT, indices, QUERY_COUNT, signs);
+    for (u32 i = 0; i < QUERY_COUNT; ++i) {
+        const u32* q = indices + i * 4;
+        i32 expected = exact_incircle(points2[q[0]], points2[q[1]], points2[q[2]], points2[q[3]]);
+        TEST_ASSERT_EQUAL_INT32(expected, sign_of(incircle(points2[q[0]], points2[q[1]], points2[q[2]], points2[q[3]])));
+        f64 p[4][2];
+        for (u32 k = 0; k < 4; ++k) {
+            to_f64_2(points2[q[k]], p[k]);
+        }
+        TEST_ASSERT_EQUAL_INT32(expected, sign_of(incircle_exact(p[0], p[1], p[2], p[3])));
+        TEST_ASSERT_EQUAL_INT32(expected, signs[i]);
+    }
+}
+
+void test_insphere_grid(void) {
+    make_grid_points(4);
+    insphere_batch(points3, QUERY_COUNT, indices, QUERY_COUNT, signs);
+    for (u32 i = 0; i < QUERY_COUNT; ++i) {
+        const u32* q = indices + i * 5;
+        point3 a = points3[q[0]], b = points3[q[1]], c = points3[q[2]], d = points3[q[3]], e = points3[q[4]];
+        i32 expected = exact_insphere(a, b, c, d, e);
+        TEST_ASSERT_EQUAL_INT32(expected, sign_of(insphere(a, b, c, d, e)));
+        f64 p[5][3];
+        for (u32 k = 0; k < 5; ++k) {
+            to_f64_3(points3[q[k]], p[k]);
+        }
+        TEST_ASSERT_EQUAL_INT32(expected, sign_of(insphere_exact(p[0], p[1], p[2], p[3], p[4])));
+        TEST_ASSERT_EQUAL_INT32(expected, signs[i]);
+    }
+}
+
+// =============================================================================
+// NEAR DEGENERATE TESTS
+// =============================================================================
+
+void test_orient_mixed_magnitudes(void) {
+    // On the line y = x with coordinates whose differences do not fit a
+    // double, then one ulp off it.
+    f32 t[4] = {1e-20f, 3.7f, 1.3e19f, 5e25f};
+    for (u32 i = 0; i < 4; ++i) {
+        for (u32 j = 0; j < 4; ++j) {
+            if (i == j) {
+                continue;
+            }
+            for (u32 k = 0; k < 4; ++k) {
+                point2 a = {{t[i], t[i]}}, b = {{t[j], t[j]}}, c = {{t[k], t[k]}};
+                TEST_ASSERT_EQUAL_INT32(0, sign_of(orient2d(a, b, c)));
+                point2 above = {{t[k], nextafterf(t[k], INFINITY)}};
+                TEST_ASSERT_EQUAL_INT32(t[j] > t[i] ? 1 : -1, sign_of(orient2d(a, b, above)));
+
+                // The plane x = y through three of its points, and a point
+                // one ulp in front.
+                point3 p = {{t[i], t[i], -t[k]}}, q = {{t[j], t[j], 2.0f}}, r = {{t[k], t[k], t[j]}};
+                point3 s = {{t[k], t[k], t[i]}};
+                TEST_ASSERT_EQUAL_INT32(0, sign_of(orient3d(p, q, r, s)));
+                point3 front = {{nextafterf(t[k], INFINITY), t[k], t[i]}};
+                point3 far = {{t[k] + 1e30f, t[k], t[i]}};
+                f64 side = orient3d(p, q, r, far);
+                if (side != 0.0) {
+                    TEST_ASSERT_EQUAL_INT32(sign_of(side), sign_of(orient3d(p, q, r, front)));
+                }
+            }
+        }
+    }
+}
+
+void test_incircle_cocircular(void) {
+    // Points of the circle of radius 5s, and one a single ulp off it,
+    // where the double evaluation loses the sign.
+    for (i32 e = -60; e <= 60; e += 20) {
+        f32 s = ldexpf(1.0f, e);
+        point2 a = {{3.0f * s, 4.0f * s}}, b = {{-4.0f * s, 3.0f * s}}, c = {{-3.0f * s, -4.0f * s}};
+        point2 d = {{5.0f * s, 0.0f}};
+        TEST_ASSERT_EQUAL_INT32(0, sign_of(incircle(a, b, c, d)));
+        point2 out = {{nextafterf(5.0f * s, INFINITY), 0.0f}};
+        point2 in = {{nextafterf(5.0f * s, 0.0f), 0.0f}};
+        TEST_ASSERT_EQUAL_INT32(-1, sign_of(incircle(a, b, c, out)));
+        TEST_ASSERT_EQUAL_INT32(1, sign_of(incircle(a, b, c, in)));
+        TEST_ASSERT_EQUAL_INT32(-1, sign_of(incircle(b, a, c, in)));
+    }
+}
+
+void test_insphere_cospherical(void) {
+    // Points of the sphere of radius 3s: (1, 2, 2) and permutations.
+    for (i32 e = -40; e <= 40; e += 20) {
+        f32 s = ldexpf(1.0f, e);
+        point3 a = {{3.0f * s, 0.0f, 0.0f}}, b = {{0.0f, 3.0f * s, 0.0f}}, c = {{0.0f, 0.0f, 3.0f * s}};
+        point3 d = {{-s, -2.0f * s, -2.0f * s}};
+        if (orient3d(a, b, c, d) < 0.0) {
+            point3 t = a;
+            a = b;
+            b = t;
+        }
+        TEST_ASSERT_TRUE(orient3d(a, b, c, d) > 0.0);
+        point3 on = {{2.0f * s, -s, 2.0f * s}};
+        TEST_ASSERT_EQUAL_INT32(0, sign_of(insphere(a, b, c, d, on)));
+        point3 out = {{nextafterf(2.0f * s, INFINITY), -s, 2.0f * s}};
+        point3 in = {{nextafterf(2.0f * s, 0.0f), -s, 2.0f * s}};
+        TEST_ASSERT_EQUAL_INT32(-1, sign_of(insphere(a, b, c, d, out)));
+        TEST_ASSERT_EQUAL_INT32(1, sign_of(insphere(a, b, c, d, in)));
+    }
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Exact arithmetic tests
+    RUN_TEST(test_orient2d_grid);
+    RUN_TEST(test_orient3d_grid);
+    RUN_TEST(test_incircle_grid);
+    RUN_TEST(test_insphere_grid);
+
+    // Near degenerate tests
+    RUN_TEST(test_orient_mixed_magnitudes);
+    RUN_TEST(test_incircle_cocircular);
+    RUN_TEST(test_insphere_cospherical);
+
+    return UNITY_END();
+}
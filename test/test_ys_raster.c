@@ -0,0 +1,365 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_CLIP_IMPLEMENTATION
+#define YS_RASTER_IMPLEMENTATION
+#include "../src/ys_raster.h"
+#include <math.h>
+
+// Neither a multiple of the tile size nor of four pixels.
+#define TARGET_WIDTH 200
+#define TARGET_HEIGHT 150
+#define GRID_X 14
+#define GRID_Y 11
+#define GRID_TRIANGLES ((GRID_X - 1) * (GRID_Y - 1) * 2)
+#define MAX_VERTICES (GRID_TRIANGLES * 3)
+
+static u32 rng_state;
+static rasterizer r;
+static raster_target t;
+static point3 positions[MAX_VERTICES];
+static color4 colors[MAX_VERTICES];
+static u32 indices[MAX_VERTICES];
+// Grid vertices in subpixels, as the rasterizer snaps them.
+static i64 grid_x[GRID_X * GRID_Y];
+static i64 grid_y[GRID_X * GRID_Y];
+static u32 grid_tris[GRID_TRIANGLES][3];
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / 16777216.0f;
+}
+
+static point3 make_point3(f32 x, f32 y, f32 z) {
+    point3 p = {{x, y, z}};
+    return p;
+}
+
+static color4 make_color4(f32 r, f32 g, f32 b, f32 a) {
+    color4 c = {{r, g, b, a}};
+    return c;
+}
+
+static mat4 identity(void) {
+    mat4 m;
+    for (u32 i = 0; i < 16; ++i) {
+        m.e[i] = i % 5 == 0 ? 1.0f : 0.0f;
+    }
+    return m;
+}
+
+static mat4 perspective(const f32 tan_half_fov, const f32 n, const f32 f) {
+    mat4 m;
+    for (u32 i = 0; i < 16; ++i) {
+        m.e[i] = 0.0f;
+    }
+    m.m00 = 1.0f / tan_half_fov;
+    m.m11 = 1.0f / tan_half_fov;
+    m.m22 = -(f + n) / (f - n);
+    m.m23 = -2.0f * f * n / (f - n);
+    m.m32 = -1.0f;
+    return m;
+}
+
+static i64 edge(const u32 a, const u32 b, const i64 px, const i64 py) {
+    return (grid_x[b] - grid_x[a]) * (py - grid_y[a]) - (grid_y[b] - grid_y[a]) * (px - grid_x[a]);
+}
+
+// Reference coverage with the top-left rule, for y down.
+static b32 covers(const u32* tri, const i64 px, const i64 py) {
+    u32 v[3] = {tri[0], tri[1], tri[2]};
+    if (edge(v[0], v[1], grid_x[v[2]], grid_y[v[2]]) < 0) {
+        v[1] = tri[2];
+        v[2] = tri[1];
+    }
+    for (u32 i = 0; i < 3; ++i) {
+        u32 a = v[i], b = v[(i + 1) % 3];
+        i64 dx = grid_x[b] - grid_x[a], dy = grid_y[b] - grid_y[a];
+        i64 e = edge(a, b, px, py);
+        b32 top_left = dy < 0 || (dy == 0 && dx > 0);
+        if (e < 0 || (e == 0 && !top_left)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void setUp(void) {
+    rng_state = 5;
+    rasterizer_create(&r, MAX_VERTICES, GRID_TRIANGLES);
+    raster_target_create(&t, TARGET_WIDTH, TARGET_HEIGHT, RASTER_COLOR4 | RASTER_RGBA8 | RASTER_DEPTH);
+    raster_target_clear(&t, make_color4(0.0f, 0.0f, 0.0f, 0.0f), 1.0f);
+}
+
+void tearDown(void) {
+    rasterizer_free(&r);
+    raster_target_free(&t);
+}
+
+// =============================================================================
+// COVERAGE TESTS
+// =============================================================================
+
+void test_raster_grid_is_watertight(void) {
+    // A jittered grid reaching past the target on every side, on subpixel
+    // positions so the reference sees the same vertices. Every pixel is
+    // covered by exactly one triangle.
+    f32 cell_x = (TARGET_WIDTH + 40.0f) / (GRID_X - 1);
+    f32 cell_y = (TARGET_HEIGHT + 40.0f) / (GRID_Y - 1);
+    for (u32 j = 0; j < GRID_Y; ++j) {
+        for (u32 i = 0; i < GRID_X; ++i) {
+            f32 jitter_x = (i == 0 || i == GRID_X - 1) ? 0.0f : (rand_f32() - 0.5f) * cell_x * 0.6f;
+            f32 jitter_y = (j == 0 || j == GRID_Y - 1) ? 0.0f : (rand_f32() - 0.5f) * cell_y * 0.6f;
+            f32 x = floorf((-20.0f + i * cell_x + jitter_x) * 16.0f) / 16.0f;
+            f32 y = floorf((-20.0f + j * cell_y + jitter_y) * 16.0f) / 16.0f;
+            // A few vertices exactly on pixel centers and edges.
+            if ((i + j) % 5 == 0) {
+                x = floorf(x) + 0.5f;
+                y = floorf(y);
+            }
+            grid_x[j * GRID_X + i] = (i64)(x * 16.0f);
+            grid_y[j * GRID_X + i] = (i64)(y * 16.0f);
+        }
+    }
+    u32 n = 0;
+    for (u32 j = 0; j + 1 < GRID_Y; ++j) {
+        for (u32 i = 0; i + 1 < GRID_X; ++i) {
+            u32 a = j * GRID_X + i, b = a + 1, c = a + GRID_X, d = c + 1;
+            // Alternate the diagonal and the winding.
+            u32 quad[2][3] = {{a, b, d}, {a, d, c}};
+            if ((i + j) % 2) {
+                quad[0][0] = a;
+                quad[0][1] = c;
+                quad[0][2] = b;
+                quad[1][0] = b;
+                quad[1][1] = c;
+                quad[1][2] = d;
+            }
+            for (u32 k = 0; k < 2; ++k) {
+                for (u32 v = 0; v < 3; ++v) {
+                    u32 g = quad[k][v];
+                    grid_tris[n][v] = g;
+                    positions[n * 3 + v] = make_point3((f32)grid_x[g] / 16.0f / (TARGET_WIDTH * 0.5f) - 1.0f,
+                        1.0f - (f32)grid_y[g] / 16.0f / (TARGET_HEIGHT * 0.5f), 0.0f);
+                    colors[n * 3 + v] = make_color4((f32)(n & 255) / 255.0f, (f32)(n >> 8) / 255.0f, 0.0f, 1.0f);
+                    indices[n * 3 + v] = n * 3 + v;
+                }
+                ++n;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(rasterizer_draw(&r, &t, identity(), positions, colors, n * 3, indices, n));
+
+    for (u32 y = 0; y < TARGET_HEIGHT; ++y) {
+        for (u32 x = 0; x < TARGET_WIDTH; ++x) {
+            i64 px = x * 16 + 8, py = y * 16 + 8;
+            u32 owner = 0, owners = 0;
+            for (u32 i = 0; i < n; ++i) {
+                if (covers(grid_tris[i], px, py)) {
+                    owner = i;
+                    ++owners;
+                }
+            }
+            TEST_ASSERT_EQUAL_UINT32(1, owners);
+            u32 expected = (owner & 255) | (owner >> 8) << 8 | 255u << 24;
+            TEST_ASSERT_EQUAL_HEX32(expected, t.rgba8[y * TARGET_WIDTH + x]);
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, (f32)(owner & 255) / 255.0f, t.color[y * TARGET_WIDTH + x].r);
+        }
+    }
+}
+
+void test_raster_guard_band(void) {
+    // Far past the guard band on every side: clipped to the target, then
+    // drawn over every pixel, in both windings.
+    positions[0] = make_point3(-3000.0f, -3000.0f, 0.0f);
+    positions[1] = make_point3(6000.0f, -3000.0f, 0.0f);
+    positions[2] = make_point3(-3000.0f, 6000.0f, 0.0f);
+    for (u32 i = 0; i < 3; ++i) {
+        colors[i] = make_color4(0.25f, 0.5f, 0.75f, 1.0f);
+        indices[i] = i;
+    }
+    u32 packed = 64u | 128u << 8 | 191u << 16 | 255u << 24;
+    for (u32 pass = 0; pass < 2; ++pass) {
+        raster_target_clear(&t, make_color4(0.0f, 0.0f, 0.0f, 0.0f), 1.0f);
+        TEST_ASSERT_TRUE(rasterizer_draw(&r, &t, identity(), positions, colors, 3, indices, 1));
+        for (u32 i = 0; i < TARGET_WIDTH * TARGET_HEIGHT; ++i) {
+            TEST_ASSERT_EQUAL_HEX32(packed, t.rgba8[i]);
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.75f, t.color[i].b);
+        }
+        indices[1] = 2;
+        indices[2] = 1;
+    }
+}
+
+// =============================================================================
+// DEPTH TESTS
+// =============================================================================
+
+void test_raster_depth(void) {
+    positions[0] = make_point3(-0.9f, -0.9f, 0.2f);
+    positions[1] = make_point3(0.9f, -0.9f, 0.2f);
+    positions[2] = make_point3(0.0f, 0.9f, 0.2f);
+    positions[3] = make_point3(-0.9f, 0.9f, -0.3f);
+    positions[4] = make_point3(0.9f, 0.9f, -0.3f);
+    positions[5] = make_point3(0.0f, -0.9f, -0.3f);
+    for (u32 i = 0; i < 6; ++i) {
+        colors[i] = i < 3 ? make_color4(1.0f, 0.0f, 0.0f, 1.0f) : make_color4(0.0f, 1.0f, 0.0f, 1.0f);
+    }
+    u32 orders[2][6] = {{0, 1, 2, 3, 4, 5}, {3, 4, 5, 0, 1, 2}};
+    u32 center = TARGET_HEIGHT / 2 * TARGET_WIDTH + TARGET_WIDTH / 2;
+    for (u32 pass = 0; pass < 2; ++pass) {
+        raster_target_clear(&t, make_color4(0.0f, 0.0f, 0.0f, 0.0f), 1.0f);
+        TEST_ASSERT_TRUE(rasterizer_draw(&r, &t, identity(), positions, colors, 6, orders[pass], 2));
+        // The nearer green triangle wins where they overlap.
+        TEST_ASSERT_EQUAL_HEX32(0xFF00FF00u, t.rgba8[center]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.35f, t.depth[center]);
+        TEST_ASSERT_EQUAL_FLOAT(1.0f, t.depth[0]);
+    }
+
+    // Depth only: the color stays, the depth test still applies.
+    positions[0].z = -0.8f;
+    positions[1].z = -0.8f;
+    positions[2].z = -0.8f;
+    TEST_ASSERT_TRUE(rasterizer_draw(&r, &t, identity(), positions, 0, 3, indices, 1));
+    TEST_ASSERT_EQUAL_HEX32(0xFF00FF00u, t.rgba8[center]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.1f, t.depth[center]);
+}
+
+void test_raster_clipped_keeps_submission_order(void) {
+    // A red triangle past the guard band, which is clipped into a fan, and
+    // a small green one over the center, at the same depth.
+    positions[0] = make_point3(-3000.0f, -3000.0f, 0.2f);
+    positions[1] = make_point3(6000.0f, -3000.0f, 0.2f);
+    positions[2] = make_point3(-3000.0f, 6000.0f, 0.2f);
+    positions[3] = make_point3(-0.5f, -0.5f, 0.2f);
+    positions[4] = make_point3(0.5f, -0.5f, 0.2f);
+    positions[5] = make_point3(0.0f, 0.5f, 0.2f);
+    for (u32 i = 0; i < 6; ++i) {
+        colors[i] = i < 3 ? make_color4(1.0f, 0.0f, 0.0f, 1.0f) : make_color4(0.0f, 1.0f, 0.0f, 1.0f);
+    }
+    u32 orders[2][6] = {{0, 1, 2, 3, 4, 5}, {3, 4, 5, 0, 1, 2}};
+    u32 center = TARGET_HEIGHT / 2 * TARGET_WIDTH + TARGET_WIDTH / 2;
+
+    // Without depth the later triangle is on top.
+    raster_target flat;
+    TEST_ASSERT_TRUE(raster_target_create(&flat, TARGET_WIDTH, TARGET_HEIGHT, RASTER_COLOR4 | RASTER_RGBA8));
+    u32 last[2] = {0xFF00FF00u, 0xFF0000FFu};
+    for (u32 pass = 0; pass < 2; ++pass) {
+        raster_target_clear(&flat, make_color4(0.0f, 0.0f, 0.0f, 0.0f), 1.0f);
+        TEST_ASSERT_TRUE(rasterizer_draw(&r, &flat, identity(), positions, colors, 6, orders[pass], 2));
+        TEST_ASSERT_EQUAL_HEX32(last[pass], flat.rgba8[center]);
+        TEST_ASSERT_EQUAL_HEX32(0xFF0000FFu, flat.rgba8[0]);
+    }
+    raster_target_free(&flat);
+
+    // With depth a tie goes to the earlier triangle.
+    u32 first[2] = {0xFF0000FFu, 0xFF00FF00u};
+    for (u32 pass = 0; pass < 2; ++pass) {
+        raster_target_clear(&t, make_color4(0.0f, 0.0f, 0.0f, 0.0f), 1.0f);
+        TEST_ASSERT_TRUE(rasterizer_draw(&r, &t, identity(), positions, colors, 6, orders[pass], 2));
+        TEST_ASSERT_EQUAL_HEX32(first[pass], t.rgba8[center]);
+    }
+}
+
+// =============================================================================
+// INTERPOLATION TESTS
+// =============================================================================
+
+void test_raster_perspective_floor(void) {
+    // A floor at y = -1 running from behind the eye to z = -100, so it is
+    // clipped at the near plane and reaches far past the sides. Its color
+    // is linear in eye space, which only perspective correct
+    // interpolation reproduces on screen.
+    raster_target square;
+    TEST_ASSERT_TRUE(raster_target_create(&square, 128, 128, RASTER_COLOR4 | RASTER_DEPTH));
+    raster_target_clear(&square, make_color4(0.0f, 0.0f, 0.0f, 0.0f), 1.0f);
+    f32 corners[4][2] = {{-50.0f, 20.0f}, {50.0f, 20.0f}, {50.0f, -100.0f}, {-50.0f, -100.0f}};
+    for (u32 i = 0; i < 4; ++i) {
+        positions[i] = make_point3(corners[i][0], -1.0f, corners[i][1]);
+        colors[i] = make_color4((corners[i][1] + 100.0f) / 120.0f, (corners[i][0] + 50.0f) / 100.0f, 0.0f, 1.0f);
+    }
+    u32 quad[6] = {0, 1, 2, 0, 2, 3};
+    TEST_ASSERT_TRUE(rasterizer_draw(&r, &square, perspective(1.0f, 0.5f, 200.0f), positions, colors, 4, quad, 2));
+
+    u32 checked = 0;
+    for (u32 y = 0; y < 128; ++y) {
+        for (u32 x = 0; x < 128; ++x) {
+            color4 c = square.color[y * 128 + x];
+            f32 dx = (x + 0.5f) / 64.0f - 1.0f;
+            f32 dy = 1.0f - (y + 0.5f) / 64.0f;
+            if (dy > -0.02f) {
+                // At or above the horizon.
+                if (dy > 0.02f) {
+                    TEST_ASSERT_EQUAL_FLOAT(0.0f, c.a);
+                }
+                continue;
+            }
+            // Eye ray (dx, dy, -1) meets the floor at s = -1 / dy.
+            f32 s = -1.0f / dy;
+            f32 ex = dx * s, ez = -s;
+            if (ez < -99.0f || fabsf(ex) > 49.0f) {
+                continue;
+            }
+            TEST_ASSERT_EQUAL_FLOAT(1.0f, c.a);
+            // Near the horizon a subpixel of vertex snapping is meters of
+            // floor, so colors are only compared closer in.
+            if (dy < -0.1f) {
+                TEST_ASSERT_FLOAT_WITHIN(2e-3f, (ez + 100.0f) / 120.0f, c.r);
+                TEST_ASSERT_FLOAT_WITHIN(2e-3f, (ex + 50.0f) / 100.0f, c.g);
+                ++checked;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(checked > 4000);
+    raster_target_free(&square);
+}
+
+void test_raster_limits(void) {
+    positions[0] = make_point3(0.0f, 0.0f, 0.0f);
+    TEST_ASSERT_FALSE(rasterizer_draw(&r, &t, identity(), positions, 0, MAX_VERTICES + 1, indices, 1));
+    TEST_ASSERT_FALSE(rasterizer_draw(&r, &t, identity(), positions, 0, 3, indices, GRID_TRIANGLES + 1));
+    raster_target big = t;
+    big.width = RASTER_MAX_SIZE + 1;
+    TEST_ASSERT_FALSE(rasterizer_draw(&r, &big, identity(), positions, 0, 3, indices, 1));
+
+    // Nothing visible: behind the eye, degenerate, or between samples.
+    positions[0] = make_point3(-0.5f, -0.5f, 2.0f);
+    positions[1] = make_point3(0.5f, -0.5f, 2.0f);
+    positions[2] = make_point3(0.0f, 0.5f, 2.0f);
+    positions[3] = make_point3(0.1f, 0.1f, 0.0f);
+    positions[4] = make_point3(0.2f, 0.2f, 0.0f);
+    positions[5] = make_point3(0.3f, 0.3f, 0.0f);
+    positions[6] = make_point3(0.001f, 0.001f, 0.0f);
+    positions[7] = make_point3(0.002f, 0.001f, 0.0f);
+    positions[8] = make_point3(0.001f, 0.002f, 0.0f);
+    for (u32 i = 0; i < 9; ++i) {
+        colors[i] = make_color4(1.0f, 1.0f, 1.0f, 1.0f);
+        indices[i] = i;
+    }
+    TEST_ASSERT_TRUE(rasterizer_draw(&r, &t, identity(), positions, colors, 9, indices, 3));
+    for (u32 i = 0; i < TARGET_WIDTH * TARGET_HEIGHT; ++i) {
+        TEST_ASSERT_EQUAL_HEX32(0, t.rgba8[i]);
+    }
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Coverage tests
+    RUN_TEST(test_raster_grid_is_watertight);
+    RUN_TEST(test_raster_guard_band);
+
+    // Depth tests
+    RUN_TEST(test_raster_depth);
+    RUN_TEST(test_raster_clipped_keeps_submission_order);
+
+    // Interpolation tests
+    RUN_TEST(test_raster_perspective_floor);
+    RUN_TEST(test_raster_limits);
+
+    return UNITY_END();
+}
@@ -0,0 +1,123 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_SAP_IMPLEMENTATION
+#include "../src/ys_sap.h"
+
+#define TEST_BODIES 3000
+#define TEST_MAX_PAIRS 20000
+
+static u32 rng_state;
+static aabb3 bounds[TEST_BODIES];
+static sap_pair pairs[TEST_MAX_PAIRS];
+static u8 overlap[TEST_BODIES * TEST_BODIES / 8 + 1];
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+static void random_bodies(void) {
+    for (u32 i = 0; i < TEST_BODIES; ++i) {
+        f32 size = 0.5f + rand_f32() * 2.0f;
+        for (int a = 0; a < 3; ++a) {
+            bounds[i].min.e[a] = rand_f32() * 60.0f - 30.0f;
+            bounds[i].max.e[a] = bounds[i].min.e[a] + size;
+        }
+    }
+}
+
+static void move_bodies(f32 amount) {
+    for (u32 i = 0; i < TEST_BODIES; ++i) {
+        for (int a = 0; a < 3; ++a) {
+            f32 d = (rand_f32() - 0.5f) * amount;
+            bounds[i].min.e[a] += d;
+            bounds[i].max.e[a] += d;
+        }
+    }
+}
+
+// Compares the pairs against all n^2 box tests, each pair reported once.
+static void check_pairs(u32 count) {
+    u32 expected = 0;
+    for (u32 i = 0; i < TEST_BODIES * TEST_BODIES / 8 + 1; ++i) {
+        overlap[i] = 0;
+    }
+    for (u32 i = 0; i < TEST_BODIES; ++i) {
+        for (u32 j = i + 1; j < TEST_BODIES; ++j) {
+            if (aabb3_overlaps(bounds[i], bounds[j])) {
+                u32 bit = i * TEST_BODIES + j;
+                overlap[bit / 8] |= (u8)(1u << (bit % 8));
+                ++expected;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(expected, count);
+    for (u32 i = 0; i < count; ++i) {
+        TEST_ASSERT_TRUE(pairs[i].a < pairs[i].b);
+        u32 bit = pairs[i].a * TEST_BODIES + pairs[i].b;
+        TEST_ASSERT_TRUE(overlap[bit / 8] & (1u << (bit % 8)));
+        overlap[bit / 8] &= (u8)~(1u << (bit % 8));
+    }
+}
+
+void setUp(void) {
+    rng_state = 9;
+    random_bodies();
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// SAP TESTS
+// =============================================================================
+
+void test_sap_matches_brute_force(void) {
+    sap s;
+    TEST_ASSERT_TRUE(sap_create(&s, TEST_BODIES));
+    u32 count = sap_update(&s, bounds, TEST_BODIES, pairs, TEST_MAX_PAIRS);
+    TEST_ASSERT_TRUE(s.full_sort);
+    TEST_ASSERT_TRUE(count > 0 && count < TEST_MAX_PAIRS);
+    check_pairs(count);
+
+    // Small motion stays on the insertion sort.
+    for (u32 frame = 0; frame < 3; ++frame) {
+        move_bodies(0.2f);
+        count = sap_update(&s, bounds, TEST_BODIES, pairs, TEST_MAX_PAIRS);
+        TEST_ASSERT_FALSE(s.full_sort);
+        check_pairs(count);
+    }
+
+    // A teleport falls back to the radix sort.
+    random_bodies();
+    count = sap_update(&s, bounds, TEST_BODIES, pairs, TEST_MAX_PAIRS);
+    TEST_ASSERT_TRUE(s.full_sort);
+    check_pairs(count);
+    sap_free(&s);
+}
+
+void test_sap_short_pair_buffer(void) {
+    sap s;
+    TEST_ASSERT_TRUE(sap_create(&s, TEST_BODIES));
+    u32 all = sap_update(&s, bounds, TEST_BODIES, pairs, TEST_MAX_PAIRS);
+    pairs[10].a = 0xDEAD;
+    TEST_ASSERT_EQUAL_UINT32(all, sap_update(&s, bounds, TEST_BODIES, pairs, 10));
+    TEST_ASSERT_EQUAL_UINT32(0xDEAD, pairs[10].a);
+    TEST_ASSERT_EQUAL_UINT32(0, sap_update(&s, bounds, TEST_BODIES + 1, pairs, 10));
+    sap_free(&s);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sap_matches_brute_force);
+    RUN_TEST(test_sap_short_pair_buffer);
+
+    return UNITY_END();
+}
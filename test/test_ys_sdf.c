@@ -0,0 +1,248 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_FILE_IMPLEMENTATION
+#define YS_BVH_IMPLEMENTATION
+#define YS_SDF_IMPLEMENTATION
+#include "../src/ys_sdf.h"
+#include <math.h>
+
+// Cube [-1, 1]^3 split into 2 triangles per face.
+#define CUBE_TRIS 12
+
+static point3 positions[8];
+static u32 indices[CUBE_TRIS * 3];
+static aabb3 tri_bounds[CUBE_TRIS];
+static bvh cube_bvh;
+static u32 rng_state;
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+static void make_cube(void) {
+    static const u32 faces[6][4] = {
+        {0, 1, 3, 2}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 3, 7, 5},
+    };
+    for (u32 i = 0; i < 8; ++i) {
+        positions[i].x = i & 1 ? 1.0f : -1.0f;
+        positions[i].y = i & 2 ? 1.0f : -1.0f;
+        positions[i].z = i & 4 ? 1.0f : -1.0f;
+    }
+    for (u32 f = 0; f < 6; ++f) {
+        u32 quad[2][3] = {{faces[f][0], faces[f][1], faces[f][2]}, {faces[f][0], faces[f][2], faces[f][3]}};
+        for (u32 k = 0; k < 2; ++k) {
+            u32* tri = indices + (f * 2 + k) * 3;
+            point3 a = positions[quad[k][0]];
+            point3 b = positions[quad[k][1]];
+            point3 c = positions[quad[k][2]];
+            // Wind counter-clockwise seen from outside: the normal points
+            // away from the center of the cube.
+            vec3 n = vec3_cross(vec3_sub(b, a), vec3_sub(c, a));
+            b32 flip = vec3_dot(n, vec3_add(vec3_add(a, b), c)) < 0;
+            tri[0] = quad[k][0];
+            tri[1] = flip ? quad[k][2] : quad[k][1];
+            tri[2] = flip ? quad[k][1] : quad[k][2];
+        }
+    }
+    for (u32 i = 0; i < CUBE_TRIS; ++i) {
+        tri_bounds[i] = aabb3_triangle(positions[indices[i * 3]], positions[indices[i * 3 + 1]],
+            positions[indices[i * 3 + 2]]);
+    }
+}
+
+static f32 box_distance(const point3 p) {
+    f32 q[3] = {fabsf(p.x) - 1.0f, fabsf(p.y) - 1.0f, fabsf(p.z) - 1.0f};
+    f32 outside = 0.0f;
+    f32 inside = -FLT_MAX;
+    for (int i = 0; i < 3; ++i) {
+        f32 v = q[i] > 0 ? q[i] : 0;
+        outside += v * v;
+        inside = q[i] > inside ? q[i] : inside;
+    }
+    return sqrtf(outside) + (inside < 0 ? inside : 0);
+}
+
+// 6^3 bricks of 8 cells of 0.1 around the cube.
+static b32 make_volume(sdf_volume* s, const u32 max_bricks) {
+    i32 dims[3] = {6, 6, 6};
+    point3 origin = {-2.4f, -2.4f, -2.4f};
+    return sdf_create(s, dims, origin, 0.1f, 0.2f, max_bricks);
+}
+
+static point3 random_point(const f32 extent) {
+    point3 p = {(rand_f32() * 2.0f - 1.0f) * extent, (rand_f32() * 2.0f - 1.0f) * extent,
+        (rand_f32() * 2.0f - 1.0f) * extent};
+    return p;
+}
+
+void setUp(void) {
+    rng_state = 4321;
+    make_cube();
+    bvh_build(&cube_bvh, tri_bounds, CUBE_TRIS);
+}
+
+void tearDown(void) {
+    bvh_free(&cube_bvh);
+}
+
+// =============================================================================
+// BAKE TESTS
+// =============================================================================
+
+void test_sdf_bake_matches_box_distance(void) {
+    sdf_volume s;
+    TEST_ASSERT_TRUE(make_volume(&s, 216));
+    TEST_ASSERT_TRUE(sdf_bake(&s, &cube_bvh, positions, 8, indices, CUBE_TRIS));
+    TEST_ASSERT_TRUE(s.brick_count > 0);
+    TEST_ASSERT_TRUE(s.brick_count < 216);
+
+    // Samples land on the true distance, including corners and edges.
+    u32 cells = (u32)(s.dims[0] * s.dims[1] * s.dims[2]);
+    for (u32 i = 0; i < cells; ++i) {
+        if (s.bricks[i] == SDF_BRICK_EMPTY) {
+            continue;
+        }
+        u32 bx = i % 6, by = (i / 6) % 6, bz = i / 36;
+        const f32* v = s.values + (u64)s.bricks[i] * SDF_BRICK_VALUES;
+        for (u32 k = 0; k < SDF_BRICK_VALUES; ++k) {
+            u32 x = k % SDF_BRICK_SAMPLES;
+            u32 y = (k / SDF_BRICK_SAMPLES) % SDF_BRICK_SAMPLES;
+            u32 z = k / (SDF_BRICK_SAMPLES * SDF_BRICK_SAMPLES);
+            point3 p = {-2.4f + (bx * 8 + x) * 0.1f, -2.4f + (by * 8 + y) * 0.1f, -2.4f + (bz * 8 + z) * 0.1f};
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, box_distance(p), v[k]);
+        }
+    }
+
+    // Close to the surface the interpolated distance is accurate; farther
+    // out it keeps its sign and never overestimates.
+    for (u32 i = 0; i < 5000; ++i) {
+        point3 p = random_point(3.0f);
+        f32 expected = box_distance(p);
+        f32 d = sdf_distance(&s, p);
+        if (fabsf(expected) < 0.1f) {
+            TEST_ASSERT_FLOAT_WITHIN(0.02f, expected, d);
+        } else {
+            TEST_ASSERT_TRUE(d * expected > 0);
+            TEST_ASSERT_TRUE(fabsf(d) <= fabsf(expected) + 0.02f);
+        }
+    }
+
+    vec3 g = sdf_gradient(&s, (point3){1.05f, 0.3f, -0.2f});
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 1.0f, g.x);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, g.y);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, g.z);
+    sdf_free(&s);
+}
+
+void test_sdf_bake_fails_over_capacity(void) {
+    sdf_volume s;
+    TEST_ASSERT_TRUE(make_volume(&s, 1));
+    TEST_ASSERT_FALSE(sdf_bake(&s, &cube_bvh, positions, 8, indices, CUBE_TRIS));
+    TEST_ASSERT_EQUAL_UINT32(0, s.brick_count);
+    for (u32 i = 0; i < 216; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(SDF_BRICK_EMPTY, s.bricks[i]);
+    }
+    // The cell bounds that remain are still conservative.
+    for (u32 i = 0; i < 2000; ++i) {
+        point3 p = random_point(2.4f);
+        f32 expected = box_distance(p);
+        f32 d = sdf_distance(&s, p);
+        TEST_ASSERT_TRUE(d * expected >= 0);
+        TEST_ASSERT_TRUE(fabsf(d) <= fabsf(expected) + 1e-4f);
+    }
+    sdf_free(&s);
+
+    // With a wide band, cells that would have had a brick keep their bound
+    // rather than reporting the surface: this one is 1 from the cube.
+    i32 dims[3] = {6, 6, 6};
+    point3 origin = {{-2.4f, -2.4f, -2.4f}};
+    TEST_ASSERT_TRUE(sdf_create(&s, dims, origin, 0.1f, 0.6f, 1));
+    TEST_ASSERT_FALSE(sdf_bake(&s, &cube_bvh, positions, 8, indices, CUBE_TRIS));
+    f32 d = sdf_distance(&s, (point3){{2.0f, 0.4f, 0.4f}});
+    TEST_ASSERT_TRUE(d > 0.3f);
+    TEST_ASSERT_TRUE(d <= 1.0f);
+    sdf_free(&s);
+}
+
+// =============================================================================
+// SPHERE TRACING TESTS
+// =============================================================================
+
+void test_sdf_raycast_hits_box(void) {
+    sdf_volume s;
+    TEST_ASSERT_TRUE(make_volume(&s, 216));
+    TEST_ASSERT_TRUE(sdf_bake(&s, &cube_bvh, positions, 8, indices, CUBE_TRIS));
+
+    u32 hits = 0;
+    for (u32 i = 0; i < 1000; ++i) {
+        ray3 r;
+        r.origin = random_point(1.0f);
+        r.origin.z = -5.0f;
+        point3 target = random_point(1.5f);
+        r.dir = vec3_mul_s(vec3_normal(vec3_sub(target, r.origin)), 2.0f);
+
+        vec3 inv = ray3_inv_dir(r);
+        aabb3 box = {{{-1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f, 1.0f}}};
+        f32 expected;
+        b32 hit = ray3_aabb3(r, inv, box, 100.0f, &expected);
+
+        f32 t;
+        if (sdf_raycast(&s, r, 100.0f, &t)) {
+            // Grazing rays may stop within the hit epsilon of an edge.
+            point3 p = ray3_at(r, t);
+            TEST_ASSERT_TRUE(box_distance(p) < 0.02f);
+            if (hit) {
+                TEST_ASSERT_FLOAT_WITHIN(0.01f, expected, t);
+                ++hits;
+            }
+        } else {
+            TEST_ASSERT_FALSE(hit && box_distance(ray3_at(r, expected + 0.05f)) < -0.01f);
+        }
+    }
+    TEST_ASSERT_TRUE(hits > 100);
+
+    ray3 miss = {{{3.0f, 3.0f, -5.0f}}, {{0.0f, 0.0f, 1.0f}}};
+    f32 t;
+    TEST_ASSERT_FALSE(sdf_raycast(&s, miss, 100.0f, &t));
+    sdf_free(&s);
+}
+
+void test_sdf_soft_shadow(void) {
+    sdf_volume s;
+    TEST_ASSERT_TRUE(make_volume(&s, 216));
+    TEST_ASSERT_TRUE(sdf_bake(&s, &cube_bvh, positions, 8, indices, CUBE_TRIS));
+
+    ray3 blocked = {{{0.0f, 0.0f, -1.5f}}, {{0.0f, 0.0f, 1.0f}}};
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, sdf_soft_shadow(&s, blocked, 0.01f, 10.0f, 8.0f));
+
+    ray3 open = {{{0.0f, 0.0f, 1.01f}}, {{0.0f, 0.0f, 1.0f}}};
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.0f, sdf_soft_shadow(&s, open, 0.05f, 10.0f, 8.0f));
+
+    // Passing 0.2 above the top face is in penumbra.
+    ray3 grazing = {{{-1.5f, 1.2f, 0.0f}}, {{1.0f, 0.0f, 0.0f}}};
+    f32 shade = sdf_soft_shadow(&s, grazing, 0.05f, 10.0f, 8.0f);
+    TEST_ASSERT_TRUE(shade > 0.0f);
+    TEST_ASSERT_TRUE(shade < 1.0f);
+    sdf_free(&s);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Bake tests
+    RUN_TEST(test_sdf_bake_matches_box_distance);
+    RUN_TEST(test_sdf_bake_fails_over_capacity);
+
+    // Sphere tracing tests
+    RUN_TEST(test_sdf_raycast_hits_box);
+    RUN_TEST(test_sdf_soft_shadow);
+
+    return UNITY_END();
+}
@@ -0,0 +1,238 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_MORTON_IMPLEMENTATION
+#define YS_MESH_IMPLEMENTATION
+#define YS_SIMPLIFY_IMPLEMENTATION
+#include "../src/ys_simplify.h"
+#include <math.h>
+
+#define SPHERE_RINGS 24
+#define SPHERE_SEGMENTS 48
+#define SPHERE_VERTS ((SPHERE_RINGS - 1) * SPHERE_SEGMENTS + 2)
+#define SPHERE_TRIS ((SPHERE_RINGS - 1) * SPHERE_SEGMENTS * 2)
+#define GRID_SIZE 128
+#define GRID_VERTS ((GRID_SIZE + 1) * (GRID_SIZE + 1))
+#define GRID_TRIS (GRID_SIZE * GRID_SIZE * 2)
+
+static mesh m;
+static u64 edge_keys[GRID_TRIS * 3];
+
+// Closed unit sphere with welded poles and seam, outward winding.
+static void make_sphere(void) {
+    u32 south = SPHERE_VERTS - 1;
+    m.positions[0].x = 0.0f;
+    m.positions[0].y = 0.0f;
+    m.positions[0].z = 1.0f;
+    m.positions[south].x = 0.0f;
+    m.positions[south].y = 0.0f;
+    m.positions[south].z = -1.0f;
+    for (u32 i = 1; i < SPHERE_RINGS; ++i) {
+        for (u32 j = 0; j < SPHERE_SEGMENTS; ++j) {
+            f32 theta = 3.14159265f * i / SPHERE_RINGS;
+            f32 phi = 6.28318531f * j / SPHERE_SEGMENTS;
+            point3* p = &m.positions[1 + (i - 1) * SPHERE_SEGMENTS + j];
+            p->x = sinf(theta) * cosf(phi);
+            p->y = sinf(theta) * sinf(phi);
+            p->z = cosf(theta);
+        }
+    }
+    u32 n = 0;
+    for (u32 j = 0; j < SPHERE_SEGMENTS; ++j) {
+        u32 j1 = (j + 1) % SPHERE_SEGMENTS;
+        m.indices[n++] = 0;
+        m.indices[n++] = 1 + j;
+        m.indices[n++] = 1 + j1;
+        for (u32 i = 1; i < SPHERE_RINGS - 1; ++i) {
+            u32 a = 1 + (i - 1) * SPHERE_SEGMENTS;
+            u32 c = a + SPHERE_SEGMENTS;
+            m.indices[n++] = a + j;
+            m.indices[n++] = c + j;
+            m.indices[n++] = a + j1;
+            m.indices[n++] = a + j1;
+            m.indices[n++] = c + j;
+            m.indices[n++] = c + j1;
+        }
+        u32 last = 1 + (SPHERE_RINGS - 2) * SPHERE_SEGMENTS;
+        m.indices[n++] = last + j;
+        m.indices[n++] = south;
+        m.indices[n++] = last + j1;
+    }
+    m.vertex_count = SPHERE_VERTS;
+    m.index_count = n;
+}
+
+// Open grid over [0, GRID_SIZE]^2 with height z = amplitude * bumps.
+static void make_grid(const f32 amplitude) {
+    for (u32 y = 0; y <= GRID_SIZE; ++y) {
+        for (u32 x = 0; x <= GRID_SIZE; ++x) {
+            point3* p = &m.positions[y * (GRID_SIZE + 1) + x];
+            p->x = (f32)x;
+            p->y = (f32)y;
+            p->z = amplitude * sinf(x * 0.1f) * cosf(y * 0.07f);
+        }
+    }
+    u32 n = 0;
+    for (u32 y = 0; y < GRID_SIZE; ++y) {
+        for (u32 x = 0; x < GRID_SIZE; ++x) {
+            u32 a = y * (GRID_SIZE + 1) + x;
+            u32 c = a + GRID_SIZE + 1;
+            m.indices[n++] = a;
+            m.indices[n++] = a + 1;
+            m.indices[n++] = c + 1;
+            m.indices[n++] = a;
+            m.indices[n++] = c + 1;
+            m.indices[n++] = c;
+        }
+    }
+    m.vertex_count = GRID_VERTS;
+    m.index_count = n;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    return x < y ? -1 : x > y;
+}
+
+static b32 has_edge(const u64* keys, const u32 count, const u64 key) {
+    return bsearch(&key, keys, count, sizeof(u64), compare_u64) != 0;
+}
+
+// Every directed edge is used once. On a closed mesh its twin exists too;
+// on an open one the edges without twin form the border.
+static u32 check_edges(const b32 closed) {
+    u32 count = m.index_count;
+    for (u32 i = 0; i < count; ++i) {
+        u32 a = m.indices[i];
+        u32 b = m.indices[i - i % 3 + (i + 1) % 3];
+        TEST_ASSERT_TRUE(a != b);
+        edge_keys[i] = ((u64)a << 32) | b;
+    }
+    qsort(edge_keys, count, sizeof(u64), compare_u64);
+    u32 border = 0;
+    for (u32 i = 0; i < count; ++i) {
+        TEST_ASSERT_TRUE(i == 0 || edge_keys[i] != edge_keys[i - 1]);
+        u64 twin = (edge_keys[i] << 32) | (edge_keys[i] >> 32);
+        b32 found = has_edge(edge_keys, count, twin);
+        TEST_ASSERT_TRUE(found || !closed);
+        border += !found;
+    }
+    return border;
+}
+
+static vec3 triangle_normal(const u32 t) {
+    point3 a = m.positions[m.indices[t * 3]];
+    point3 b = m.positions[m.indices[t * 3 + 1]];
+    point3 c = m.positions[m.indices[t * 3 + 2]];
+    return vec3_cross(vec3_sub(b, a), vec3_sub(c, a));
+}
+
+void setUp(void) {
+    mesh_create(&m, GRID_VERTS, GRID_TRIS * 3, 0);
+}
+
+void tearDown(void) {
+    mesh_free(&m);
+}
+
+// =============================================================================
+// SIMPLIFY TESTS
+// =============================================================================
+
+void test_simplify_sphere(void) {
+    make_sphere();
+    TEST_ASSERT_TRUE(simplify_mesh(&m, SPHERE_TRIS / 4 * 3, 1.0f));
+    TEST_ASSERT_TRUE(m.index_count <= SPHERE_TRIS / 4 * 3);
+    TEST_ASSERT_TRUE(m.index_count > SPHERE_TRIS / 5 * 3);
+    check_edges(1);
+    for (u32 t = 0; t < m.index_count / 3; ++t) {
+        point3 c = m.positions[m.indices[t * 3]];
+        TEST_ASSERT_TRUE(vec3_dot(triangle_normal(t), c) > 0.0f);
+        for (u32 k = 0; k < 3; ++k) {
+            TEST_ASSERT_FLOAT_WITHIN(0.03f, 1.0f, vec3_len(m.positions[m.indices[t * 3 + k]]));
+        }
+    }
+
+    // Down to a handful of triangles the surface stays closed.
+    TEST_ASSERT_TRUE(simplify_mesh(&m, 24, 1.0f));
+    TEST_ASSERT_TRUE(m.index_count <= 24);
+    TEST_ASSERT_TRUE(m.index_count >= 12);
+    check_edges(1);
+}
+
+void test_simplify_error_is_relative(void) {
+    make_sphere();
+    TEST_ASSERT_TRUE(simplify_mesh(&m, 3, 0.01f));
+    u32 loose = m.index_count;
+    TEST_ASSERT_TRUE(loose > 24 && loose < SPHERE_TRIS * 3 / 4);
+    check_edges(1);
+
+    // The error is measured against the extent, so a scaled copy stops at
+    // the same count, and a tighter bound keeps more triangles.
+    make_sphere();
+    for (u32 v = 0; v < m.vertex_count; ++v) {
+        m.positions[v] = vec3_mul_s(m.positions[v], 64.0f);
+    }
+    TEST_ASSERT_TRUE(simplify_mesh(&m, 3, 0.01f));
+    TEST_ASSERT_EQUAL_UINT32(loose, m.index_count);
+    make_sphere();
+    TEST_ASSERT_TRUE(simplify_mesh(&m, 3, 0.001f));
+    TEST_ASSERT_TRUE(m.index_count > loose);
+}
+
+void test_simplify_flat_grid_keeps_border(void) {
+    make_grid(0.0f);
+    TEST_ASSERT_TRUE(simplify_mesh(&m, 300, 1e-4f));
+    TEST_ASSERT_TRUE(m.index_count <= 300);
+    u32 border = check_edges(0);
+    TEST_ASSERT_TRUE(border >= 4);
+    f32 area = 0.0f;
+    for (u32 t = 0; t < m.index_count / 3; ++t) {
+        vec3 n = triangle_normal(t);
+        TEST_ASSERT_TRUE(n.z > 0.0f);
+        area += 0.5f * n.z;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, GRID_SIZE * GRID_SIZE, area);
+    for (u32 i = 0; i < m.index_count; ++i) {
+        point3 p = m.positions[m.indices[i]];
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, p.z);
+        TEST_ASSERT_TRUE(p.x >= 0.0f && p.x <= GRID_SIZE && p.y >= 0.0f && p.y <= GRID_SIZE);
+    }
+}
+
+void test_simplify_partitioned(void) {
+    // Large enough for the parallel pass.
+    make_grid(4.0f);
+    TEST_ASSERT_TRUE(simplify_mesh(&m, GRID_TRIS / 4 * 3, 1.0f));
+    TEST_ASSERT_TRUE(m.index_count <= GRID_TRIS / 4 * 3);
+    TEST_ASSERT_TRUE(m.index_count > GRID_TRIS / 5 * 3);
+    check_edges(0);
+    for (u32 t = 0; t < m.index_count / 3; ++t) {
+        TEST_ASSERT_TRUE(triangle_normal(t).z > 0.0f);
+    }
+
+    // A tight error bound stops well before the target.
+    make_grid(4.0f);
+    TEST_ASSERT_TRUE(simplify_mesh(&m, 3, 1e-4f));
+    TEST_ASSERT_TRUE(m.index_count > GRID_TRIS / 4 * 3);
+    TEST_ASSERT_TRUE(m.index_count < GRID_TRIS * 3);
+    check_edges(0);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Simplify tests
+    RUN_TEST(test_simplify_sphere);
+    RUN_TEST(test_simplify_error_is_relative);
+    RUN_TEST(test_simplify_flat_grid_keeps_border);
+    RUN_TEST(test_simplify_partitioned);
+
+    return UNITY_END();
+}
@@ -0,0 +1,100 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_SPATIAL_HASH_IMPLEMENTATION
+#include "../src/ys_spatial_hash.h"
+
+#define TEST_POINTS 20000
+
+static u32 rng_state;
+static point3 points[TEST_POINTS];
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+static f32 dist_sq(point3 a, point3 b) {
+    vec3 d = vec3_sub(a, b);
+    return vec3_dot(d, d);
+}
+
+void setUp(void) {
+    rng_state = 11;
+    // Centered on the origin so negative cells are covered too.
+    for (u32 i = 0; i < TEST_POINTS; ++i) {
+        points[i].x = rand_f32() * 60.0f - 30.0f;
+        points[i].y = rand_f32() * 60.0f - 30.0f;
+        points[i].z = rand_f32() * 20.0f - 10.0f;
+    }
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// SPATIAL HASH TESTS
+// =============================================================================
+
+void test_spatial_hash_rebuild(void) {
+    spatial_hash h;
+    TEST_ASSERT_TRUE(spatial_hash_create(&h, 1.0f, 3000));
+    TEST_ASSERT_EQUAL_UINT32(4096, h.table_size);
+    TEST_ASSERT_TRUE(spatial_hash_rebuild(&h, points, TEST_POINTS));
+
+    // Every point lands once, in the bucket of its cell.
+    static u8 seen[TEST_POINTS];
+    for (u32 b = 0; b < h.table_size; ++b) {
+        TEST_ASSERT_TRUE(h.cell_start[b] <= h.cell_start[b + 1]);
+        for (u32 s = h.cell_start[b]; s < h.cell_start[b + 1]; ++s) {
+            point3 p = h.positions[s];
+            TEST_ASSERT_EQUAL_UINT32(b, spatial_hash_bucket(&h, (i32)floorf(p.x), (i32)floorf(p.y),
+                (i32)floorf(p.z)));
+            TEST_ASSERT_EQUAL_MEMORY(&points[h.ids[s]], &p, sizeof(point3));
+            TEST_ASSERT_EQUAL_UINT8(0, seen[h.ids[s]]);
+            seen[h.ids[s]] = 1;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(TEST_POINTS, h.cell_start[h.table_size]);
+
+    // Rebuilding with fewer points reuses the buffers.
+    TEST_ASSERT_TRUE(spatial_hash_rebuild(&h, points, 10));
+    TEST_ASSERT_EQUAL_UINT32(10, h.cell_start[h.table_size]);
+    spatial_hash_free(&h);
+}
+
+void test_spatial_hash_radius_matches_brute_force(void) {
+    spatial_hash h;
+    // A small table forces collisions between neighbouring cells.
+    TEST_ASSERT_TRUE(spatial_hash_create(&h, 1.5f, 64));
+    TEST_ASSERT_TRUE(spatial_hash_rebuild(&h, points, TEST_POINTS));
+    static u32 ids[TEST_POINTS];
+    for (u32 i = 0; i < 300; ++i) {
+        point3 q = points[(i * 7919) % TEST_POINTS];
+        q.x += 0.3f;
+        f32 radius = 0.5f + rand_f32();
+        u32 expected = 0;
+        for (u32 j = 0; j < TEST_POINTS; ++j) {
+            expected += dist_sq(points[j], q) <= radius * radius;
+        }
+        u32 found = spatial_hash_radius(&h, q, radius, ids, TEST_POINTS);
+        TEST_ASSERT_EQUAL_UINT32(expected, found);
+        for (u32 j = 0; j < found; ++j) {
+            TEST_ASSERT_TRUE(dist_sq(points[ids[j]], q) <= radius * radius);
+        }
+    }
+    spatial_hash_free(&h);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_spatial_hash_rebuild);
+    RUN_TEST(test_spatial_hash_radius_matches_brute_force);
+
+    return UNITY_END();
+}
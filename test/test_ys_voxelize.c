@@ -0,0 +1,216 @@
+#include "unity/unity.h"
+#define YS_MATH_IMPLEMENTATION
+#define YS_GEOM_IMPLEMENTATION
+#define YS_GRID_IMPLEMENTATION
+#define YS_THREAD_IMPLEMENTATION
+#define YS_VOXELIZE_IMPLEMENTATION
+#include "../src/ys_voxelize.h"
+#include <math.h>
+
+#define TEST_TRIS 48
+#define SPHERE_SEGMENTS 24
+#define SPHERE_VERTS ((SPHERE_SEGMENTS + 1) * (SPHERE_SEGMENTS + 1))
+#define SPHERE_TRIS (SPHERE_SEGMENTS * SPHERE_SEGMENTS * 2)
+
+static point3 positions[SPHERE_VERTS];
+static u32 indices[SPHERE_TRIS * 3];
+static u32 rng_state;
+
+static f32 rand_f32(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+// Unit sphere, closed: the pole rows collapse to single points.
+static void make_sphere(void) {
+    for (u32 i = 0; i <= SPHERE_SEGMENTS; ++i) {
+        for (u32 j = 0; j <= SPHERE_SEGMENTS; ++j) {
+            f32 theta = 3.14159265f * i / SPHERE_SEGMENTS;
+            f32 phi = 6.28318531f * (j % SPHERE_SEGMENTS) / SPHERE_SEGMENTS;
+            point3 p = {sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)};
+            if (i == 0 || i == SPHERE_SEGMENTS) {
+                p.x = p.y = 0.0f;
+                p.z = i == 0 ? 1.0f : -1.0f;
+            }
+            positions[i * (SPHERE_SEGMENTS + 1) + j] = p;
+        }
+    }
+    u32 n = 0;
+    for (u32 i = 0; i < SPHERE_SEGMENTS; ++i) {
+        for (u32 j = 0; j < SPHERE_SEGMENTS; ++j) {
+            u32 a = i * (SPHERE_SEGMENTS + 1) + j;
+            u32 c = a + SPHERE_SEGMENTS + 1;
+            indices[n++] = a;
+            indices[n++] = c;
+            indices[n++] = a + 1;
+            indices[n++] = a + 1;
+            indices[n++] = c;
+            indices[n++] = c + 1;
+        }
+    }
+}
+
+// Cube [-1, 1]^3, two triangles per face.
+static void make_cube(void) {
+    static const u32 faces[6][4] = {
+        {0, 1, 3, 2}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 3, 7, 5},
+    };
+    for (u32 i = 0; i < 8; ++i) {
+        positions[i].x = i & 1 ? 1.0f : -1.0f;
+        positions[i].y = i & 2 ? 1.0f : -1.0f;
+        positions[i].z = i & 4 ? 1.0f : -1.0f;
+    }
+    for (u32 f = 0; f < 6; ++f) {
+        u32* tri = indices + f * 6;
+        tri[0] = faces[f][0];
+        tri[1] = faces[f][1];
+        tri[2] = faces[f][2];
+        tri[3] = faces[f][0];
+        tri[4] = faces[f][2];
+        tri[5] = faces[f][3];
+    }
+}
+
+static point3 voxel_center(const voxel_grid* g, const i32 x, const i32 y, const i32 z) {
+    point3 p = {g->origin.x + (x + 0.5f) * g->cell_size, g->origin.y + (y + 0.5f) * g->cell_size,
+        g->origin.z + (z + 0.5f) * g->cell_size};
+    return p;
+}
+
+void setUp(void) {
+    rng_state = 99;
+}
+
+void tearDown(void) {
+}
+
+// =============================================================================
+// CONSERVATIVE TESTS
+// =============================================================================
+
+void test_voxelize_conservative_matches_brute_force(void) {
+    for (u32 i = 0; i < TEST_TRIS * 3; ++i) {
+        positions[i].x = rand_f32() * 6.0f - 0.5f;
+        positions[i].y = rand_f32() * 4.0f - 0.5f;
+        positions[i].z = rand_f32() * 8.0f - 0.5f;
+        indices[i] = i;
+    }
+    // 20 * 12 voxels per layer puts slabs at every 4 layers.
+    voxel_grid g;
+    i32 dims[3] = {20, 12, 30};
+    point3 origin = {0.0f, 0.0f, 0.0f};
+    TEST_ASSERT_TRUE(voxel_grid_create(&g, dims, origin, 0.25f));
+    voxel_grid_set(&g, 19, 11, 29);
+    TEST_ASSERT_TRUE(voxelize_conservative(&g, positions, indices, TEST_TRIS));
+
+    u32 set = 0;
+    for (i32 z = 0; z < dims[2]; ++z) {
+        for (i32 y = 0; y < dims[1]; ++y) {
+            for (i32 x = 0; x < dims[0]; ++x) {
+                aabb3 box;
+                box.min.x = x * 0.25f;
+                box.min.y = y * 0.25f;
+                box.min.z = z * 0.25f;
+                box.max.x = box.min.x + 0.25f;
+                box.max.y = box.min.y + 0.25f;
+                box.max.z = box.min.z + 0.25f;
+                b32 expected = x == 19 && y == 11 && z == 29;
+                for (u32 t = 0; t < TEST_TRIS && !expected; ++t) {
+                    expected = aabb3_triangle_overlaps(box, positions[t * 3], positions[t * 3 + 1],
+                        positions[t * 3 + 2]);
+                }
+                TEST_ASSERT_EQUAL_INT(expected, voxel_grid_get(&g, x, y, z));
+                set += expected;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(set > 500);
+    voxel_grid_free(&g);
+}
+
+// =============================================================================
+// SOLID TESTS
+// =============================================================================
+
+void test_voxelize_solid_cube(void) {
+    make_cube();
+    // Centers never land on the faces, but rows with y == z cross the
+    // diagonals shared by the two triangles of the x faces.
+    voxel_grid g;
+    i32 dims[3] = {16, 16, 16};
+    point3 origin = {-2.0f, -2.0f, -2.0f};
+    TEST_ASSERT_TRUE(voxel_grid_create(&g, dims, origin, 0.25f));
+    voxel_grid_set(&g, 0, 0, 0);
+    TEST_ASSERT_TRUE(voxelize_solid(&g, positions, indices, 12));
+    for (i32 z = 0; z < 16; ++z) {
+        for (i32 y = 0; y < 16; ++y) {
+            for (i32 x = 0; x < 16; ++x) {
+                point3 c = voxel_center(&g, x, y, z);
+                b32 inside = fabsf(c.x) < 1.0f && fabsf(c.y) < 1.0f && fabsf(c.z) < 1.0f;
+                TEST_ASSERT_EQUAL_INT(inside, voxel_grid_get(&g, x, y, z));
+            }
+        }
+    }
+    voxel_grid_free(&g);
+}
+
+void test_voxelize_solid_sphere(void) {
+    make_sphere();
+    // The grid starts inside the sphere along x and has odd sized rows,
+    // so rows straddle words and start inside the mesh.
+    voxel_grid g;
+    i32 dims[3] = {13, 27, 27};
+    point3 origin = {0.01f, -1.31f, -1.33f};
+    TEST_ASSERT_TRUE(voxel_grid_create(&g, dims, origin, 0.1f));
+    TEST_ASSERT_TRUE(voxelize_solid(&g, positions, indices, SPHERE_TRIS));
+    u32 inside = 0;
+    for (i32 z = 0; z < dims[2]; ++z) {
+        for (i32 y = 0; y < dims[1]; ++y) {
+            for (i32 x = 0; x < dims[0]; ++x) {
+                point3 c = voxel_center(&g, x, y, z);
+                f32 r = vec3_len(c);
+                // The tessellation stays within 2% of the sphere.
+                if (r < 0.98f) {
+                    TEST_ASSERT_TRUE(voxel_grid_get(&g, x, y, z));
+                    ++inside;
+                } else if (r > 1.0f) {
+                    TEST_ASSERT_FALSE(voxel_grid_get(&g, x, y, z));
+                }
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(inside > 1500);
+
+    // Flipping every triangle gives the same voxels.
+    voxel_grid flipped;
+    TEST_ASSERT_TRUE(voxel_grid_create(&flipped, dims, origin, 0.1f));
+    for (u32 t = 0; t < SPHERE_TRIS; ++t) {
+        u32 k = indices[t * 3 + 1];
+        indices[t * 3 + 1] = indices[t * 3 + 2];
+        indices[t * 3 + 2] = k;
+    }
+    TEST_ASSERT_TRUE(voxelize_solid(&flipped, positions, indices, SPHERE_TRIS));
+    u64 words = ((u64)dims[0] * dims[1] * dims[2] + 63) / 64;
+    for (u64 i = 0; i < words; ++i) {
+        TEST_ASSERT_TRUE(g.bits[i] == flipped.bits[i]);
+    }
+    voxel_grid_free(&flipped);
+    voxel_grid_free(&g);
+}
+
+// =============================================================================
+// MAIN TEST RUNNER
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Conservative tests
+    RUN_TEST(test_voxelize_conservative_matches_brute_force);
+
+    // Solid tests
+    RUN_TEST(test_voxelize_solid_cube);
+    RUN_TEST(test_voxelize_solid_sphere);
+
+    return UNITY_END();
+}